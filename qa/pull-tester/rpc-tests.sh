@@ -161,8 +161,10 @@ testScriptsExt=(
   'headers_08.py'
   'headers_09.py'
   'headers_10.py'
+  'sendheaders.py'
   'checkblockatheight.py'
   'sc_big_block.py'
+  'sc_compact_blocks.py'
 );
 
 if [ "x$ENABLE_ZMQ" = "x1" ]; then
@@ -9,7 +9,10 @@
 
 from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import assert_equal, assert_greater_than, \
-    initialize_chain_clean, start_nodes, connect_nodes_bi
+    initialize_chain_clean, start_nodes, connect_nodes_bi, get_epoch_data, \
+    swap_bytes
+from test_framework.test_framework import MINIMAL_SC_HEIGHT
+from test_framework.mc_test.mc_test import CertTestUtils, generate_random_field_element_hex
 
 import struct
 import binascii
@@ -55,6 +58,10 @@ def http_post_call(host, port, path, requestdata = '', response_object = 0):
 
 class RESTTest (BitcoinTestFramework):
     FORMAT_SEPARATOR = "."
+    EPOCH_LENGTH = 10
+    FT_SC_FEE = Decimal('0')
+    MBTR_SC_FEE = Decimal('0')
+    CERT_FEE = Decimal('0.00015')
 
     def setup_chain(self):
         print("Initializing test directory "+self.options.tmpdir)
@@ -352,5 +359,139 @@ class RESTTest (BitcoinTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        # sidechain state endpoints
+        unknown_scid = "1a3e7ccbfd40c4e2304c3215f76d204e4de63c578ad835510f580d529516a874"
+        response = http_get_call(url.hostname, url.port, '/rest/sidechain/'+unknown_scid+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+        response = http_get_call(url.hostname, url.port, '/rest/sidechain/abcd'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+        response = http_get_call(url.hostname, url.port, '/rest/cert/'+bb_hash+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 404)
+        response = http_get_call(url.hostname, url.port, '/rest/cswnullifier/'+unknown_scid+'/00'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
+        # an unchanged state is answered with a 304 to a matching If-None-Match
+        nullifier = "00" * 32
+        path = '/rest/cswnullifier/'+unknown_scid+'/'+nullifier+self.FORMAT_SEPARATOR+'json'
+        conn = httplib.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', path)
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        assert_equal(json.loads(response.read())['data'], 'false')
+        etag = response.getheader('ETag')
+        conn.request('GET', path, '', {'If-None-Match': etag})
+        response = conn.getresponse()
+        assert_equal(response.status, 304)
+        response.read()
+
+        # a new block changes the tag
+        self.nodes[0].generate(1)
+        self.sync_all()
+        conn.request('GET', path, '', {'If-None-Match': etag})
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        assert(response.getheader('ETag') != etag)
+        response.read()
+
+        # sidechain and certificate replies
+        self.nodes[0].generate(MINIMAL_SC_HEIGHT - self.nodes[0].getblockcount())
+        self.sync_all()
+
+        mcTest = CertTestUtils(self.options.tmpdir, self.options.srcdir)
+        vk = mcTest.generate_params("sc1")
+        constant = generate_random_field_element_hex()
+        scid = self.nodes[0].sc_create({
+            "withdrawalEpochLength": self.EPOCH_LENGTH,
+            "toaddress": "dada",
+            "amount": Decimal("1.0"),
+            "wCertVk": vk,
+            "constant": constant
+        })['scid']
+        self.sync_all()
+
+        # an unconfirmed sidechain isn't in the chain state yet
+        response = http_get_call(url.hostname, url.port, '/rest/sidechain/'+scid+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+
+        self.nodes[0].generate(self.EPOCH_LENGTH)
+        self.sync_all()
+
+        # the json reply is the getscinfo record, the binary one starts with the state (ALIVE)
+        json_string = http_get_call(url.hostname, url.port, '/rest/sidechain/'+scid+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string, parse_float=Decimal)
+        assert_equal(json_obj, self.nodes[0].getscinfo(scid)['items'][0])
+        assert_equal(json_obj['state'], "ALIVE")
+        response = http_get_call(url.hostname, url.port, '/rest/sidechain/'+scid+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        assert_equal(response.getheader('Content-Type'), 'application/octet-stream')
+        sc_bin = response.read()
+        assert_equal(ord(sc_bin[0]), 2)
+        hex_string = http_get_call(url.hostname, url.port, '/rest/sidechain/'+scid+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(hex_string.strip(), binascii.hexlify(sc_bin))
+
+        epoch_number, epoch_cum_tree_hash = get_epoch_data(scid, self.nodes[0], self.EPOCH_LENGTH)
+        quality = 10
+        proof = mcTest.create_test_proof("sc1", str(swap_bytes(scid)), epoch_number, quality,
+            self.MBTR_SC_FEE, self.FT_SC_FEE, epoch_cum_tree_hash, constant, [], [])
+        cert = self.nodes[0].sc_send_certificate(scid, epoch_number, quality,
+            epoch_cum_tree_hash, proof, [], self.FT_SC_FEE, self.MBTR_SC_FEE, self.CERT_FEE)
+        self.sync_all()
+
+        # a certificate in the mempool is found, its binary form is the raw certificate
+        cert_hex = self.nodes[0].getrawtransaction(cert)
+        response = http_get_call(url.hostname, url.port, '/rest/cert/'+cert+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        assert_equal(binascii.hexlify(response.read()), cert_hex)
+        hex_string = http_get_call(url.hostname, url.port, '/rest/cert/'+cert+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(hex_string.strip(), cert_hex)
+
+        path = '/rest/cert/'+cert+self.FORMAT_SEPARATOR+'json'
+        conn = httplib.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', path)
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        assert_equal(response.getheader('Content-Type'), 'application/json')
+        json_obj = json.loads(response.read())
+        assert_equal(json_obj['txid'], cert)
+        assert('blockhash' not in json_obj)
+        etag = response.getheader('ETag')
+
+        # the same tag is given to an unchanged reply, a stale or foreign one gets the full reply
+        conn.request('GET', path, '', {'If-None-Match': etag})
+        response = conn.getresponse()
+        assert_equal(response.status, 304)
+        assert_equal(response.getheader('ETag'), etag)
+        assert_equal(response.read(), '')
+        conn.request('GET', path)
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        assert_equal(response.getheader('ETag'), etag)
+        response.read()
+        conn.request('GET', '/rest/cert/'+cert+self.FORMAT_SEPARATOR+'hex', '', {'If-None-Match': etag})
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        assert(response.getheader('ETag') != etag)
+        response.read()
+
+        # once mined, the certificate reply and the sidechain record change along with their tags
+        sc_etag = http_get_call(url.hostname, url.port, '/rest/sidechain/'+scid+self.FORMAT_SEPARATOR+'json', True).getheader('ETag')
+        block_hash = self.nodes[0].generate(1)[0]
+        self.sync_all()
+        conn.request('GET', path, '', {'If-None-Match': etag})
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        assert(response.getheader('ETag') != etag)
+        json_obj = json.loads(response.read())
+        assert_equal(json_obj['txid'], cert)
+        assert_equal(json_obj['blockhash'], block_hash)
+
+        conn.request('GET', '/rest/sidechain/'+scid+self.FORMAT_SEPARATOR+'json', '', {'If-None-Match': sc_etag})
+        response = conn.getresponse()
+        assert_equal(response.status, 200)
+        json_obj = json.loads(response.read(), parse_float=Decimal)
+        assert_equal(json_obj, self.nodes[0].getscinfo(scid)['items'][0])
+        assert_equal(json_obj['lastCertificateHash'], cert)
+        assert_equal(json_obj['lastCertificateEpoch'], epoch_number)
+
 if __name__ == '__main__':
     RESTTest().main()
@@ -0,0 +1,123 @@
+#!/usr/bin/env python2
+# Copyright (c) 2014 The Bitcoin Core developers
+# Copyright (c) 2018 The Zencash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_true, initialize_chain_clean, \
+    start_nodes, sync_blocks, sync_mempools, connect_nodes_bi, mark_logs, \
+    get_epoch_data, swap_bytes
+from test_framework.test_framework import MINIMAL_SC_HEIGHT
+from test_framework.mc_test.mc_test import *
+import time
+from decimal import Decimal
+
+DEBUG_MODE = 1
+NUMB_OF_NODES = 3
+EPOCH_LENGTH = 10
+FT_SC_FEE = Decimal('0')
+MBTR_SC_FEE = Decimal('0')
+CERT_FEE = Decimal('0.00015')
+NUM_OF_TXS = 40
+
+
+class sc_compact_blocks(BitcoinTestFramework):
+
+    def setup_chain(self, split=False):
+        print("Initializing test directory " + self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, NUMB_OF_NODES)
+
+    def setup_network(self, split=False):
+        common_args = ['-debug=py', '-debug=net', '-debug=cmpctblock', '-debug=cert', '-scproofqueuesize=0', '-logtimemicros=1']
+
+        # node 1 rebuilds blocks from compact blocks, node 2 downloads them in full
+        self.nodes = start_nodes(NUMB_OF_NODES, self.options.tmpdir, extra_args=[
+            common_args,
+            common_args,
+            common_args + ['-compactblocks=0']])
+
+        # node 0 is the only source of blocks for both the others
+        connect_nodes_bi(self.nodes, 0, 1)
+        connect_nodes_bi(self.nodes, 0, 2)
+        self.is_network_split = split
+        self.sync_all()
+
+    def wait_for_block(self, node, blockhash, timeout=60):
+        start = time.time()
+        while node.getbestblockhash() != blockhash:
+            assert_true(time.time() - start < timeout)
+            time.sleep(0.01)
+        return time.time() - start
+
+    def run_test(self):
+        '''
+        A block holding a certificate, a forward transfer and many transactions already in every
+        mempool is relayed to a node supporting compact blocks and to one that does not: both must
+        end up with the same block, the former receiving much less data.
+        '''
+        creation_amount = Decimal("1.0")
+        fwt_amount = Decimal("5.0")
+        bwt_amount = Decimal("0.5")
+
+        mark_logs("Node 0 generates {} blocks".format(MINIMAL_SC_HEIGHT), self.nodes, DEBUG_MODE)
+        self.nodes[0].generate(MINIMAL_SC_HEIGHT)
+        self.sync_all()
+
+        mcTest = CertTestUtils(self.options.tmpdir, self.options.srcdir)
+        vk = mcTest.generate_params("sc1")
+        constant = generate_random_field_element_hex()
+        ret = self.nodes[0].sc_create({
+            "withdrawalEpochLength": EPOCH_LENGTH,
+            "toaddress": "dada",
+            "amount": creation_amount,
+            "wCertVk": vk,
+            "constant": constant})
+        scid = ret['scid']
+        scid_swapped = str(swap_bytes(scid))
+        self.sync_all()
+        self.nodes[0].generate(1)
+        self.sync_all()
+
+        mc_return_address = self.nodes[0].getnewaddress()
+        self.nodes[0].sc_send([{'toaddress': "abcd", 'amount': fwt_amount, "scid": scid, "mcReturnAddress": mc_return_address}])
+        self.sync_all()
+        self.nodes[0].generate(EPOCH_LENGTH - 1)
+        self.sync_all()
+
+        mark_logs("Node 0 fills the mempools with a cert, a fwd transfer and {} txs".format(NUM_OF_TXS), self.nodes, DEBUG_MODE)
+        epoch_number, epoch_cum_tree_hash = get_epoch_data(scid, self.nodes[0], EPOCH_LENGTH)
+        addr_node1 = self.nodes[1].getnewaddress()
+        proof = mcTest.create_test_proof(
+            "sc1", scid_swapped, epoch_number, 0, MBTR_SC_FEE, FT_SC_FEE, epoch_cum_tree_hash, constant, [addr_node1], [bwt_amount])
+        cert = self.nodes[0].sc_send_certificate(scid, epoch_number, 0, epoch_cum_tree_hash, proof,
+            [{"address": addr_node1, "amount": bwt_amount}], FT_SC_FEE, MBTR_SC_FEE, CERT_FEE)
+        fwd_tx = self.nodes[0].sc_send([{'toaddress': "abcd", 'amount': fwt_amount, "scid": scid, "mcReturnAddress": mc_return_address}])
+        for i in range(NUM_OF_TXS):
+            self.nodes[0].sendtoaddress(self.nodes[2].getnewaddress(), Decimal("0.01"))
+        sync_mempools(self.nodes)
+
+        recv_before = [n.getnettotals()['totalbytesrecv'] for n in self.nodes[1:]]
+
+        mark_logs("Node 0 mines the block", self.nodes, DEBUG_MODE)
+        blockhash = self.nodes[0].generate(1)[0]
+        elapsed_cmpct = self.wait_for_block(self.nodes[1], blockhash)
+        elapsed_full = self.wait_for_block(self.nodes[2], blockhash)
+
+        recv_cmpct = self.nodes[1].getnettotals()['totalbytesrecv'] - recv_before[0]
+        recv_full = self.nodes[2].getnettotals()['totalbytesrecv'] - recv_before[1]
+        block_size = self.nodes[0].getblock(blockhash)['size']
+        mark_logs("Block size {}: node 1 received {} bytes in {:.3f}s, node 2 received {} bytes in {:.3f}s".format(
+            block_size, recv_cmpct, elapsed_cmpct, recv_full, elapsed_full), self.nodes, DEBUG_MODE)
+
+        block = self.nodes[1].getblock(blockhash)
+        assert_true(cert in block['cert'])
+        assert_true(fwd_tx in block['tx'])
+        assert_equal(block, self.nodes[2].getblock(blockhash))
+        assert_equal(len(self.nodes[1].getrawmempool()), 0)
+
+        assert_true(recv_full >= block_size)
+        assert_true(recv_cmpct < block_size / 2)
+
+
+if __name__ == '__main__':
+    sc_compact_blocks().main()
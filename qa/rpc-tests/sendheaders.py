@@ -0,0 +1,188 @@
+#!/usr/bin/env python2
+# Copyright (c) 2014 The Bitcoin Core developers
+# Copyright (c) 2018 The Zencash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+from test_framework.mininode import NodeConn, NodeConnCB, NetworkThread, \
+    msg_getheaders, msg_ping, msg_pong, msg_sendheaders, mininode_lock
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, \
+    start_nodes, sync_blocks, connect_nodes_bi, disconnect_nodes, mark_logs, \
+    p2p_port
+import time
+
+DEBUG_MODE = 1
+NUMB_OF_NODES = 3
+# headers a node puts in a single announcement, MAX_BLOCKS_TO_ANNOUNCE in main.h
+MAX_BLOCKS_TO_ANNOUNCE = 8
+
+
+# A peer asking for headers announcements, recording the block hashes announced to it
+class TestNode(NodeConnCB):
+    def __init__(self):
+        NodeConnCB.__init__(self)
+        self.create_callback_map()
+        self.connection = None
+        self.ping_counter = 1
+        self.last_pong = msg_pong()
+        self.headers_announced = []
+        self.inv_announced = []
+
+    def add_connection(self, conn):
+        self.connection = conn
+
+    def send_message(self, message):
+        self.connection.send_message(message)
+
+    def on_headers(self, conn, message):
+        hashes = []
+        for h in message.headers:
+            h.calc_sha256()
+            hashes.append("%064x" % h.sha256)
+        self.headers_announced.append(hashes)
+
+    def on_inv(self, conn, message):
+        self.inv_announced.append(["%064x" % i.hash for i in message.inv if i.type == 2])
+
+    def on_pong(self, conn, message):
+        self.last_pong = message
+
+    def wait_for_verack(self):
+        while True:
+            with mininode_lock:
+                if self.verack_received:
+                    return
+            time.sleep(0.05)
+
+    def sync_with_ping(self, timeout=30):
+        self.connection.send_message(msg_ping(nonce=self.ping_counter))
+        received_pong = False
+        sleep_time = 0.05
+        while not received_pong and timeout > 0:
+            time.sleep(sleep_time)
+            timeout -= sleep_time
+            with mininode_lock:
+                if self.last_pong.nonce == self.ping_counter:
+                    received_pong = True
+        self.ping_counter += 1
+        return received_pong
+
+    # Wait for a headers or inv message announcing the block, returning what announced it
+    def wait_for_announcement(self, blockhash, timeout=30):
+        while timeout > 0:
+            with mininode_lock:
+                for hashes in self.headers_announced:
+                    if blockhash in hashes:
+                        return ("headers", hashes)
+                for hashes in self.inv_announced:
+                    if blockhash in hashes:
+                        return ("inv", hashes)
+            time.sleep(0.05)
+            timeout -= 0.05
+        return (None, [])
+
+    def clear_announcements(self):
+        with mininode_lock:
+            self.headers_announced = []
+            self.inv_announced = []
+
+
+class sendheaders(BitcoinTestFramework):
+
+    def setup_chain(self, split=False):
+        print("Initializing test directory " + self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, NUMB_OF_NODES)
+
+    def setup_network(self, split=False):
+        self.nodes = start_nodes(NUMB_OF_NODES, self.options.tmpdir,
+            extra_args=[['-debug=py', '-debug=net', '-debug=forks', '-logtimemicros=1']] * NUMB_OF_NODES)
+
+        # a line: blocks and fork tips of node 0 reach node 2 only through node 1
+        connect_nodes_bi(self.nodes, 0, 1)
+        connect_nodes_bi(self.nodes, 1, 2)
+        self.is_network_split = split
+        self.sync_all()
+
+    def split_network(self):
+        disconnect_nodes(self.nodes[1], 2)
+        disconnect_nodes(self.nodes[2], 1)
+        self.is_network_split = True
+
+    def join_network(self):
+        connect_nodes_bi(self.nodes, 1, 2)
+        self.is_network_split = False
+
+    def run_test(self):
+        '''
+        Nodes announce new tips and fork tips with headers messages: check that new blocks, chains
+        longer than a single announcement and competing forks all propagate through the network.
+        Then check with a mininode peer that new blocks come as headers, and that a reorg to a chain
+        too far from the peer's one comes as an inv.
+        '''
+        mark_logs("Node 0 generates 5 blocks, one at a time", self.nodes, DEBUG_MODE)
+        for i in range(5):
+            self.nodes[0].generate(1)
+            sync_blocks(self.nodes)
+        assert_equal(self.nodes[2].getbestblockhash(), self.nodes[0].getbestblockhash())
+
+        mark_logs("Node 0 generates 20 blocks at once, more than a headers announcement holds", self.nodes, DEBUG_MODE)
+        self.nodes[0].generate(20)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[2].getblockcount(), 25)
+
+        mark_logs("Split the network, node 0 builds a fork while node 2 extends the main chain", self.nodes, DEBUG_MODE)
+        self.split_network()
+        fork_tip = self.nodes[0].generate(2)[-1]
+        sync_blocks(self.nodes[0:2])
+        self.nodes[2].generate(3)
+
+        mark_logs("Join the network: node 2 chain wins, node 1 keeps the fork tip", self.nodes, DEBUG_MODE)
+        self.join_network()
+        sync_blocks(self.nodes)
+        for i in range(NUMB_OF_NODES):
+            assert_equal(self.nodes[i].getbestblockhash(), self.nodes[2].getbestblockhash())
+            assert_equal(self.nodes[i].getblockcount(), 28)
+        for i in range(2):
+            assert_equal(fork_tip in [t['hash'] for t in self.nodes[i].getchaintips()], True)
+
+        mark_logs("Isolate node 0, keep a chain of %d blocks aside and build another one" % (MAX_BLOCKS_TO_ANNOUNCE + 2),
+            self.nodes, DEBUG_MODE)
+        disconnect_nodes(self.nodes[0], 1)
+        disconnect_nodes(self.nodes[1], 0)
+        fork_point = self.nodes[0].getbestblockhash()
+        long_chain = self.nodes[0].generate(MAX_BLOCKS_TO_ANNOUNCE + 2)
+        self.nodes[0].invalidateblock(long_chain[0])
+        assert_equal(self.nodes[0].getbestblockhash(), fork_point)
+        short_tip = self.nodes[0].generate(1)[-1]
+
+        mark_logs("A peer sending sendheaders, which got the headers up to node 0 tip", self.nodes, DEBUG_MODE)
+        test_node = TestNode()
+        test_node.add_connection(NodeConn('127.0.0.1', p2p_port(0), self.nodes[0], test_node))
+        NetworkThread().start()
+        test_node.wait_for_verack()
+        test_node.send_message(msg_sendheaders())
+        getheaders = msg_getheaders()
+        getheaders.locator.vHave = [int(fork_point, 16)]
+        test_node.send_message(getheaders)
+        assert_equal(test_node.wait_for_announcement(short_tip), ("headers", [short_tip]))
+        test_node.clear_announcements()
+
+        mark_logs("Node 0 generates blocks: each is announced with its header, not an inv", self.nodes, DEBUG_MODE)
+        for i in range(3):
+            blockhash = self.nodes[0].generate(1)[-1]
+            assert_equal(test_node.wait_for_announcement(blockhash), ("headers", [blockhash]))
+            assert_equal(test_node.inv_announced, [])
+        test_node.clear_announcements()
+
+        mark_logs("Node 0 reorgs to the chain aside, too many headers from the peer's one: it falls back to inv",
+            self.nodes, DEBUG_MODE)
+        self.nodes[0].reconsiderblock(long_chain[0])
+        assert_equal(self.nodes[0].getbestblockhash(), long_chain[-1])
+        assert_equal(test_node.wait_for_announcement(long_chain[-1]), ("inv", [long_chain[-1]]))
+        assert_equal(test_node.sync_with_ping(), True)
+        assert_equal(test_node.headers_announced, [])
+        test_node.connection.disconnect_node()
+
+
+if __name__ == '__main__':
+    sendheaders().main()
@@ -1205,6 +1205,22 @@ class msg_headers(object):
         return "msg_headers(headers=%s)" % repr(self.headers)
 
 
+class msg_sendheaders(object):
+    command = "sendheaders"
+
+    def __init__(self):
+        pass
+
+    def deserialize(self, f):
+        pass
+
+    def serialize(self):
+        return ""
+
+    def __repr__(self):
+        return "msg_sendheaders()"
+
+
 class msg_reject(object):
     command = "reject"
 
@@ -1259,7 +1275,8 @@ class NodeConnCB(object):
             "headers": self.on_headers,
             "getheaders": self.on_getheaders,
             "reject": self.on_reject,
-            "mempool": self.on_mempool
+            "mempool": self.on_mempool,
+            "sendheaders": self.on_sendheaders
         }
 
     def deliver(self, conn, message):
@@ -1305,6 +1322,7 @@ class NodeConnCB(object):
     def on_close(self, conn): pass
     def on_mempool(self, conn): pass
     def on_pong(self, conn, message): pass
+    def on_sendheaders(self, conn, message): pass
 
 
 # The actual NodeConn class
@@ -1326,7 +1344,8 @@ class NodeConn(asyncore.dispatcher):
         "headers": msg_headers,
         "getheaders": msg_getheaders,
         "reject": msg_reject,
-        "mempool": msg_mempool
+        "mempool": msg_mempool,
+        "sendheaders": msg_sendheaders
     }
     MAGIC_BYTES = {
         "mainnet": "\x63\x61\x73\x68",  # mainnet
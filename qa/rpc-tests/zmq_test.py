@@ -8,28 +8,49 @@
 #
 
 from test_framework.test_framework import BitcoinTestFramework
-from test_framework.util import assert_equal, bytes_to_hex_str, start_nodes
-
+from test_framework.test_framework import MINIMAL_SC_HEIGHT
+from test_framework.util import assert_equal, bytes_to_hex_str, start_nodes, start_node, stop_node, \
+    connect_nodes_bi, get_epoch_data, log_filename, swap_bytes
+from test_framework.mc_test.mc_test import CertTestUtils, generate_random_field_element_hex
+
+import os
+import subprocess
+import time
 import zmq
 import struct
+from decimal import Decimal
+
+EPOCH_LENGTH = 10
+CERT_FEE = Decimal('0.00015')
 
 class ZMQTest(BitcoinTestFramework):
 
     port = 28332
 
+    def zmq_args(self, topics):
+        return ['-zmq' + topic + '=tcp://127.0.0.1:' + str(self.port) for topic in topics]
+
     def setup_nodes(self):
         self.zmqContext = zmq.Context()
         self.zmqSubSocket = self.zmqContext.socket(zmq.SUB)
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashblock")
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashtx")
+        self.zmqSubSocket.setsockopt(zmq.RCVTIMEO, 60000)
         self.zmqSubSocket.connect("tcp://127.0.0.1:%i" % self.port)
         return start_nodes(4, self.options.tmpdir, extra_args=[
-            ['-zmqpubhashtx=tcp://127.0.0.1:'+str(self.port), '-zmqpubhashblock=tcp://127.0.0.1:'+str(self.port)],
+            self.zmq_args(['pubhashtx', 'pubhashblock']),
             [],
             [],
             []
             ])
 
+    def recv_topic(self, topic):
+        # skip the notifications of the other topics
+        while True:
+            msg = self.zmqSubSocket.recv_multipart()
+            if msg[0] == topic:
+                return msg[1]
+
     def run_test(self):
         self.sync_all()
 
@@ -90,6 +111,76 @@ class ZMQTest(BitcoinTestFramework):
 
         assert_equal(hashRPC, hashZMQ) #blockhash from generate must be equal to the hash received over zmq
 
+        self.test_sidechain_notifications()
+
+    def test_sidechain_notifications(self):
+        node = self.nodes[0]
+        node.generate(MINIMAL_SC_HEIGHT - node.getblockcount())
+        self.sync_all()
+
+        # two sidechains, only the events of the first one are going to be published
+        mcTest = CertTestUtils(self.options.tmpdir, self.options.srcdir)
+        scids = []
+        constants = []
+        for i in range(2):
+            constants.append(generate_random_field_element_hex())
+            ret = node.sc_create({
+                "withdrawalEpochLength": EPOCH_LENGTH,
+                "toaddress": "dada",
+                "amount": Decimal("1.0"),
+                "wCertVk": mcTest.generate_params("sc" + str(i)),
+                "constant": constants[i]
+            })
+            scids.append(ret['scid'])
+        node.generate(1)
+        self.sync_all()
+
+        cert_topics = ['pubhashtx', 'pubhashblock', 'pubhashcert', 'pubscevent']
+        stop_node(node, 0)
+
+        # a malformed sidechain id makes the node fail to start rather than silently drop the notifier
+        with open(os.devnull, "w") as devnull:
+            ret = subprocess.call([os.getenv("BITCOIND", "zend"), "-datadir=" + os.path.join(self.options.tmpdir, "node0")] +
+                self.zmq_args(cert_topics) + ['-zmqpubsceventscid=' + "zz" * 32], stdout=devnull, stderr=devnull)
+        assert(ret != 0)
+        with open(log_filename(self.options.tmpdir, 0, "debug.log")) as debug_log:
+            assert("Invalid sidechain id for -zmqpubsceventscid" in debug_log.read())
+
+        self.nodes[0] = node = start_node(0, self.options.tmpdir,
+            self.zmq_args(cert_topics) + ['-zmqpubsceventscid=' + scids[0]])
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashcert")
+        self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"scevent")
+        # let the subscriber reconnect to the restarted node
+        time.sleep(1)
+
+        node.generate(EPOCH_LENGTH - 1)
+        self.sync_all()
+
+        # certificates are published on acceptance to the mempool, whatever their sidechain
+        certs = []
+        for i in range(2):
+            epoch_number, epoch_cum_tree_hash = get_epoch_data(scids[i], node, EPOCH_LENGTH)
+            proof = mcTest.create_test_proof("sc" + str(i), str(swap_bytes(scids[i])), epoch_number, 1,
+                Decimal("0"), Decimal("0"), epoch_cum_tree_hash, constants[i], [], [])
+            certs.append(node.sc_send_certificate(scids[i], epoch_number, 1, epoch_cum_tree_hash, proof, [],
+                Decimal("0"), Decimal("0"), CERT_FEE))
+        self.sync_all()
+        assert_equal(sorted(certs), sorted([bytes_to_hex_str(self.recv_topic(b"hashcert")) for i in range(2)]))
+
+        # the certificates of the new block are signalled before the block itself
+        blockhash = node.generate(1)[0]
+        self.sync_all()
+        scevents = []
+        while True:
+            msg = self.zmqSubSocket.recv_multipart()
+            if msg[0] == b"scevent":
+                # the serialized sidechain id comes first
+                scevents.append(bytes_to_hex_str(msg[1][:32][::-1]))
+            elif msg[0] == b"hashblock" and bytes_to_hex_str(msg[1]) == blockhash:
+                break
+        assert_equal([scids[0]], scevents)
+
 
 if __name__ == '__main__':
     ZMQTest ().main ()
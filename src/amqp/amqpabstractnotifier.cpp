@@ -19,3 +19,13 @@ bool AMQPAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool AMQPAbstractNotifier::NotifyCertificate(const CScCertificate &/*certificate*/)
+{
+    return true;
+}
+
+bool AMQPAbstractNotifier::NotifyCertStatusUpdate(const CScCertificateStatusUpdateInfo &/*certStatusInfo*/)
+{
+    return true;
+}
@@ -6,8 +6,13 @@
 #define ZCASH_AMQP_AMQPABSTRACTNOTIFIER_H
 
 #include "amqpconfig.h"
+#include "uint256.h"
+
+#include <set>
 
 class CBlockIndex;
+class CScCertificate;
+struct CScCertificateStatusUpdateInfo;
 class AMQPAbstractNotifier;
 
 typedef AMQPAbstractNotifier* (*AMQPNotifierFactory)();
@@ -28,16 +33,23 @@ public:
     void SetType(const std::string &t) { type = t; }
     std::string GetAddress() const { return address; }
     void SetAddress(const std::string &a) { address = a; }
+    //! Restrict certificate and sidechain event notifications to the given sidechains (empty: all of them)
+    void SetScIdFilter(const std::set<uint256> &f) { scIdFilter = f; }
 
     virtual bool Initialize() = 0;
     virtual void Shutdown() = 0;
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyCertificate(const CScCertificate &certificate);
+    virtual bool NotifyCertStatusUpdate(const CScCertificateStatusUpdateInfo &certStatusInfo);
 
 protected:
     std::string type;
     std::string address;
+    std::set<uint256> scIdFilter;
+
+    bool IsScIdNotified(const uint256 &scId) const { return scIdFilter.empty() || scIdFilter.count(scId) != 0; }
 };
 
 #endif // ZCASH_AMQP_AMQPABSTRACTNOTIFIER_H
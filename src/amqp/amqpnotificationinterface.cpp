@@ -39,7 +39,8 @@ AMQPNotificationInterface::~AMQPNotificationInterface()
     }
 }
 
-AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const std::map<std::string, std::string> &args)
+AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const std::map<std::string, std::string> &args,
+                                                                          const std::map<std::string, std::vector<std::string> > &multiArgs)
 {
     AMQPNotificationInterface* notificationInterface = nullptr;
     std::map<std::string, AMQPNotifierFactory> factories;
@@ -49,6 +50,9 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
     factories["pubhashtx"] = AMQPAbstractNotifier::Create<AMQPPublishHashTransactionNotifier>;
     factories["pubrawblock"] = AMQPAbstractNotifier::Create<AMQPPublishRawBlockNotifier>;
     factories["pubrawtx"] = AMQPAbstractNotifier::Create<AMQPPublishRawTransactionNotifier>;
+    factories["pubhashcert"] = AMQPAbstractNotifier::Create<AMQPPublishHashCertificateNotifier>;
+    factories["pubrawcert"] = AMQPAbstractNotifier::Create<AMQPPublishRawCertificateNotifier>;
+    factories["pubscevent"] = AMQPAbstractNotifier::Create<AMQPPublishSidechainEventNotifier>;
 
     for (std::map<std::string, AMQPNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i) {
         std::map<std::string, std::string>::const_iterator j = args.find("-amqp" + i->first);
@@ -58,6 +62,16 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
             AMQPAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+
+            // the sidechain ids were checked at startup
+            std::set<uint256> scIdFilter;
+            std::map<std::string, std::vector<std::string> >::const_iterator k = multiArgs.find("-amqp" + i->first + "scid");
+            if (k!=multiArgs.end()) {
+                for (const std::string& strScId : k->second)
+                    scIdFilter.insert(uint256S(strScId));
+            }
+
+            notifier->SetScIdFilter(scIdFilter);
             notifiers.push_back(notifier);
         }
     }
@@ -134,3 +148,29 @@ void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+void AMQPNotificationInterface::SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth)
+{
+    for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
+        AMQPAbstractNotifier *notifier = *i;
+        if (notifier->NotifyCertificate(cert)) {
+            i++;
+        } else {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
+
+void AMQPNotificationInterface::SyncCertStatusInfo(const CScCertificateStatusUpdateInfo &certStatusInfo)
+{
+    for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
+        AMQPAbstractNotifier *notifier = *i;
+        if (notifier->NotifyCertStatusUpdate(certStatusInfo)) {
+            i++;
+        } else {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
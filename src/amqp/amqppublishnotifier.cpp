@@ -4,6 +4,7 @@
 
 #include "amqppublishnotifier.h"
 #include "main.h"
+#include "primitives/certificate.h"
 #include "util.h"
 
 #include "amqpsender.h"
@@ -17,6 +18,9 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_HASHCERT  = "hashcert";
+static const char *MSG_RAWCERT   = "rawcert";
+static const char *MSG_SCEVENT   = "scevent";
 
 // Invoke this method from a new thread to run the proton container event loop.
 void AMQPAbstractPublishNotifier::SpawnProtonContainer()
@@ -152,19 +156,13 @@ bool AMQPPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("amqp", "amqp: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex)) {
-            LogPrint("amqp", "amqp: Can't read block from disk\n");
-            return false;
-        }
-
-        ss << block;
+    std::shared_ptr<const CDataStream> ss = GetSerializedBlock(pindex);
+    if (!ss) {
+        LogPrint("amqp", "amqp: Can't read block from disk\n");
+        return false;
     }
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, &(*ss->begin()), ss->size());
 }
 
 bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -175,3 +173,41 @@ bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool AMQPPublishHashCertificateNotifier::NotifyCertificate(const CScCertificate &certificate)
+{
+    if (!IsScIdNotified(certificate.GetScId()))
+        return true;
+
+    uint256 hash = certificate.GetHash();
+    LogPrint("amqp", "amqp: Publish hashcert %s\n", hash.GetHex());
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHCERT, data, 32);
+}
+
+bool AMQPPublishRawCertificateNotifier::NotifyCertificate(const CScCertificate &certificate)
+{
+    if (!IsScIdNotified(certificate.GetScId()))
+        return true;
+
+    uint256 hash = certificate.GetHash();
+    LogPrint("amqp", "amqp: Publish rawcert %s\n", hash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << certificate;
+    return SendMessage(MSG_RAWCERT, &(*ss.begin()), ss.size());
+}
+
+bool AMQPPublishSidechainEventNotifier::NotifyCertStatusUpdate(const CScCertificateStatusUpdateInfo &certStatusInfo)
+{
+    if (!IsScIdNotified(certStatusInfo.scId))
+        return true;
+
+    LogPrint("amqp", "amqp: Publish scevent %s\n", certStatusInfo.ToString());
+    // scId is not part of the serialized status info, send it first
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << certStatusInfo.scId;
+    ss << certStatusInfo;
+    return SendMessage(MSG_SCEVENT, &(*ss.begin()), ss.size());
+}
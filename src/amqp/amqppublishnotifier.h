@@ -53,4 +53,22 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+class AMQPPublishHashCertificateNotifier : public AMQPAbstractPublishNotifier
+{
+public:
+    bool NotifyCertificate(const CScCertificate &certificate);
+};
+
+class AMQPPublishRawCertificateNotifier : public AMQPAbstractPublishNotifier
+{
+public:
+    bool NotifyCertificate(const CScCertificate &certificate);
+};
+
+class AMQPPublishSidechainEventNotifier : public AMQPAbstractPublishNotifier
+{
+public:
+    bool NotifyCertStatusUpdate(const CScCertificateStatusUpdateInfo &certStatusInfo);
+};
+
 #endif // ZCASH_AMQP_AMQPPUBLISHNOTIFIER_H
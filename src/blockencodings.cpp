@@ -0,0 +1,217 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockencodings.h"
+
+#include "consensus/consensus.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+#include "hash.h"
+#include "random.h"
+#include "streams.h"
+#include "txmempool.h"
+#include "util.h"
+#include "version.h"
+
+#include <unordered_map>
+
+#define MIN_TRANSACTION_SIZE (::GetSerializeSize(CTransaction(), SER_NETWORK, PROTOCOL_VERSION))
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block) :
+        nonce(GetRand(std::numeric_limits<uint64_t>::max())),
+        shorttxids(block.vtx.size() - 1), prefilledtxn(1), shortcertids(block.vcert.size()),
+        header(block.GetBlockHeader()) {
+    FillShortTxIDSelector();
+    prefilledtxn[0] = {0, block.vtx[0]};
+    for (size_t i = 1; i < block.vtx.size(); i++)
+        shorttxids[i - 1] = GetShortID(block.vtx[i].GetHash());
+    for (size_t i = 0; i < block.vcert.size(); i++)
+        shortcertids[i] = GetShortID(block.vcert[i].GetHash());
+}
+
+void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const {
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << header << nonce;
+    CSHA256 hasher;
+    hasher.Write((unsigned char*)&(*stream.begin()), stream.end() - stream.begin());
+    uint256 shorttxidhash;
+    hasher.Finalize(shorttxidhash.begin());
+    shorttxidk0 = ReadLE64(shorttxidhash.begin());
+    shorttxidk1 = ReadLE64(shorttxidhash.begin() + 8);
+}
+
+uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& hash) const {
+    static_assert(SHORTTXIDS_LENGTH == 6, "shorttxids calculation assumes 6-byte shorttxids");
+    return SipHashUint256(shorttxidk0, shorttxidk1, hash) & 0xffffffffffffL;
+}
+
+// Place the prefilled entries of a list, returning false if their positions are not consistent
+template <typename T>
+static bool PlacePrefilled(const std::vector<CPrefilledEntry<T> >& prefilled, size_t nShortIDs,
+                           std::vector<T>& available, std::vector<bool>& have)
+{
+    int64_t lastprefilledindex = -1;
+    for (size_t i = 0; i < prefilled.size(); i++) {
+        lastprefilledindex += int64_t(prefilled[i].index) + 1;
+        if (lastprefilledindex >= (int64_t)available.size())
+            return false;
+        if ((uint64_t)lastprefilledindex > nShortIDs + i) {
+            // If we are inserting a tx at an index greater than our full list of shortids
+            // plus the number of prefilled txn we've inserted, then we have txn for which we
+            // have neither a prefilled txn or a shortid!
+            return false;
+        }
+        available[lastprefilledindex] = prefilled[i].tx;
+        have[lastprefilledindex] = true;
+    }
+    return true;
+}
+
+// Map the short ids of a list to their positions, skipping the prefilled ones.
+// Returns false if the ids collide or are too unevenly distributed (well-formed
+// messages have a roughly uniform distribution of short ids).
+static bool MapShortIDs(const std::vector<uint64_t>& shortids, const std::vector<bool>& have,
+                        std::unordered_map<uint64_t, uint32_t>& positions)
+{
+    positions.reserve(shortids.size());
+    uint32_t index_offset = 0;
+    for (size_t i = 0; i < shortids.size(); i++) {
+        while (have[i + index_offset])
+            index_offset++;
+        positions[shortids[i]] = i + index_offset;
+        if (positions.bucket_size(positions.bucket(shortids[i])) > 12)
+            return false;
+    }
+    return positions.size() == shortids.size();
+}
+
+ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock) {
+    if (cmpctblock.header.IsNull() || (cmpctblock.shorttxids.empty() && cmpctblock.prefilledtxn.empty()))
+        return READ_STATUS_INVALID;
+    if (cmpctblock.BlockTxCount() + cmpctblock.BlockCertCount() > MAX_BLOCK_SIZE / MIN_TRANSACTION_SIZE)
+        return READ_STATUS_INVALID;
+
+    assert(header.IsNull() && txn_available.empty() && certs_available.empty());
+    header = cmpctblock.header;
+
+    txn_available.resize(cmpctblock.BlockTxCount());
+    txn_have.assign(cmpctblock.BlockTxCount(), false);
+    certs_available.resize(cmpctblock.BlockCertCount());
+    certs_have.assign(cmpctblock.BlockCertCount(), false);
+
+    if (!PlacePrefilled(cmpctblock.prefilledtxn, cmpctblock.shorttxids.size(), txn_available, txn_have) ||
+        !PlacePrefilled(cmpctblock.prefilledcerts, cmpctblock.shortcertids.size(), certs_available, certs_have))
+        return READ_STATUS_INVALID;
+
+    std::unordered_map<uint64_t, uint32_t> shorttxids;
+    std::unordered_map<uint64_t, uint32_t> shortcertids;
+    if (!MapShortIDs(cmpctblock.shorttxids, txn_have, shorttxids) ||
+        !MapShortIDs(cmpctblock.shortcertids, certs_have, shortcertids))
+        return READ_STATUS_FAILED;
+
+    // Two mempool entries matching the same short id can't tell which one is in the block: ask for it
+    std::vector<bool> txn_collided(txn_have.size(), false);
+    std::vector<bool> certs_collided(certs_have.size(), false);
+    prefilled_count = cmpctblock.prefilledtxn.size() + cmpctblock.prefilledcerts.size();
+    {
+        LOCK(pool->cs);
+        for (auto it = pool->mapTx.begin(); it != pool->mapTx.end(); ++it) {
+            auto idit = shorttxids.find(cmpctblock.GetShortID(it->first));
+            if (idit == shorttxids.end() || txn_collided[idit->second])
+                continue;
+            if (!txn_have[idit->second]) {
+                txn_available[idit->second] = it->second.GetTx();
+                txn_have[idit->second] = true;
+                mempool_count++;
+            } else if (txn_available[idit->second].GetHash() != it->first) {
+                txn_have[idit->second] = false;
+                txn_collided[idit->second] = true;
+                mempool_count--;
+            }
+        }
+        for (auto it = pool->mapCertificate.begin(); it != pool->mapCertificate.end(); ++it) {
+            auto idit = shortcertids.find(cmpctblock.GetShortID(it->first));
+            if (idit == shortcertids.end() || certs_collided[idit->second])
+                continue;
+            if (!certs_have[idit->second]) {
+                certs_available[idit->second] = it->second.GetCertificate();
+                certs_have[idit->second] = true;
+                mempool_count++;
+            } else if (certs_available[idit->second].GetHash() != it->first) {
+                certs_have[idit->second] = false;
+                certs_collided[idit->second] = true;
+                mempool_count--;
+            }
+        }
+    }
+
+    LogPrint("cmpctblock", "Initialized PartiallyDownloadedBlock for block %s using a cmpctblock of size %lu, %lu txs/certs from mempool\n",
+        cmpctblock.header.GetHash().ToString(), ::GetSerializeSize(cmpctblock, SER_NETWORK, PROTOCOL_VERSION), mempool_count);
+
+    return READ_STATUS_OK;
+}
+
+bool PartiallyDownloadedBlock::IsTxAvailable(size_t index) const {
+    assert(!header.IsNull());
+    assert(index < txn_have.size());
+    return txn_have[index];
+}
+
+bool PartiallyDownloadedBlock::IsCertAvailable(size_t index) const {
+    assert(!header.IsNull());
+    assert(index < certs_have.size());
+    return certs_have[index];
+}
+
+ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<CTransaction>& vtx_missing,
+                                               const std::vector<CScCertificate>& vcert_missing) {
+    assert(!header.IsNull());
+    block.SetNull();
+    block.SetBlockHeader(header);
+    block.vtx.resize(txn_available.size());
+    block.vcert.resize(certs_available.size());
+
+    size_t tx_missing_offset = 0;
+    for (size_t i = 0; i < txn_available.size(); i++) {
+        if (txn_have[i]) {
+            block.vtx[i] = txn_available[i];
+        } else {
+            if (vtx_missing.size() <= tx_missing_offset)
+                return READ_STATUS_INVALID;
+            block.vtx[i] = vtx_missing[tx_missing_offset++];
+        }
+    }
+
+    size_t cert_missing_offset = 0;
+    for (size_t i = 0; i < certs_available.size(); i++) {
+        if (certs_have[i]) {
+            block.vcert[i] = certs_available[i];
+        } else {
+            if (vcert_missing.size() <= cert_missing_offset)
+                return READ_STATUS_INVALID;
+            block.vcert[i] = vcert_missing[cert_missing_offset++];
+        }
+    }
+
+    // Make sure we can't call FillBlock again.
+    header.SetNull();
+    txn_available.clear();
+    txn_have.clear();
+    certs_available.clear();
+    certs_have.clear();
+
+    if (vtx_missing.size() != tx_missing_offset || vcert_missing.size() != cert_missing_offset)
+        return READ_STATUS_INVALID;
+
+    // The merkle root commits to vtx followed by vcert, hence also to the certificates ordering:
+    // a mismatch here is most likely a short id collision, rather than an invalid block
+    bool mutated;
+    if (block.BuildMerkleTree(&mutated) != block.hashMerkleRoot || mutated)
+        return READ_STATUS_FAILED;
+
+    LogPrint("cmpctblock", "Successfully reconstructed block %s with %lu txs/certs prefilled, %lu from mempool and %lu requested\n",
+        block.GetHash().ToString(), prefilled_count, mempool_count, vtx_missing.size() + vcert_missing.size());
+
+    return READ_STATUS_OK;
+}
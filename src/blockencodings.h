@@ -0,0 +1,226 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKENCODINGS_H
+#define BITCOIN_BLOCKENCODINGS_H
+
+#include "primitives/block.h"
+
+#include <algorithm>
+#include <ios>
+#include <limits>
+#include <vector>
+
+class CTxMemPool;
+
+/**
+ * Compact blocks (after BIP 152), extended to certificates.
+ *
+ * Transactions and certificates are kept in two separate lists, each with its own positions:
+ * a block is rebuilt with both lists in the same order as the original one, so that the merkle
+ * root (which commits to vtx followed by vcert) and the certificates ordering are preserved.
+ */
+
+//! Positions in the block are sent as the difference from the previous position, minus one
+template <typename Stream, typename Operation>
+void ReadWriteDifferentialIndexes(Stream& s, Operation ser_action, int nType, int nVersion, std::vector<uint32_t>& indexes)
+{
+    uint64_t indexes_size = (uint64_t)indexes.size();
+    READWRITE(COMPACTSIZE(indexes_size));
+    if (ser_action.ForRead()) {
+        size_t i = 0;
+        while (indexes.size() < indexes_size) {
+            indexes.resize(std::min((uint64_t)(1000 + indexes.size()), indexes_size));
+            for (; i < indexes.size(); i++) {
+                uint64_t index = 0;
+                READWRITE(COMPACTSIZE(index));
+                if (index > std::numeric_limits<uint32_t>::max())
+                    throw std::ios_base::failure("index overflowed 32 bits");
+                indexes[i] = index;
+            }
+        }
+
+        uint64_t offset = 0;
+        for (size_t j = 0; j < indexes.size(); j++) {
+            if (uint64_t(indexes[j]) + offset > std::numeric_limits<uint32_t>::max())
+                throw std::ios_base::failure("indexes overflowed 32 bits");
+            indexes[j] = indexes[j] + offset;
+            offset = uint64_t(indexes[j]) + 1;
+        }
+    } else {
+        for (size_t i = 0; i < indexes.size(); i++) {
+            uint64_t index = indexes[i] - (i == 0 ? 0 : (indexes[i - 1] + 1));
+            READWRITE(COMPACTSIZE(index));
+        }
+    }
+}
+
+//! Short ids are 6 bytes long
+template <typename Stream, typename Operation>
+void ReadWriteShortIDs(Stream& s, Operation ser_action, int nType, int nVersion, std::vector<uint64_t>& shortids)
+{
+    uint64_t shortids_size = (uint64_t)shortids.size();
+    READWRITE(COMPACTSIZE(shortids_size));
+    if (ser_action.ForRead()) {
+        size_t i = 0;
+        while (shortids.size() < shortids_size) {
+            shortids.resize(std::min((uint64_t)(1000 + shortids.size()), shortids_size));
+            for (; i < shortids.size(); i++) {
+                uint32_t lsb = 0; uint16_t msb = 0;
+                READWRITE(lsb);
+                READWRITE(msb);
+                shortids[i] = (uint64_t(msb) << 32) | uint64_t(lsb);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < shortids.size(); i++) {
+            uint32_t lsb = shortids[i] & 0xffffffff;
+            uint16_t msb = (shortids[i] >> 32) & 0xffff;
+            READWRITE(lsb);
+            READWRITE(msb);
+        }
+    }
+}
+
+/** Transactions and certificates requested to complete a compact block, by position */
+class BlockTransactionsRequest {
+public:
+    uint256 blockhash;
+    std::vector<uint32_t> txindexes;
+    std::vector<uint32_t> certindexes;
+
+    bool IsEmpty() const { return txindexes.empty() && certindexes.empty(); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(blockhash);
+        ReadWriteDifferentialIndexes(s, ser_action, nType, nVersion, txindexes);
+        ReadWriteDifferentialIndexes(s, ser_action, nType, nVersion, certindexes);
+    }
+};
+
+/** Answer to a BlockTransactionsRequest, in the order of the requested positions */
+class BlockTransactions {
+public:
+    uint256 blockhash;
+    std::vector<CTransaction> txn;
+    std::vector<CScCertificate> certs;
+
+    BlockTransactions() {}
+    BlockTransactions(const BlockTransactionsRequest& req) :
+        blockhash(req.blockhash), txn(req.txindexes.size()), certs(req.certindexes.size()) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(blockhash);
+        READWRITE(txn);
+        READWRITE(certs);
+    }
+};
+
+/** A transaction or certificate sent in full within a compact block */
+template <typename T>
+struct CPrefilledEntry {
+    //! Offset from the position of the previous prefilled entry of the same list, minus one
+    uint32_t index;
+    T tx;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        uint64_t idx = index;
+        READWRITE(COMPACTSIZE(idx));
+        if (idx > std::numeric_limits<uint32_t>::max())
+            throw std::ios_base::failure("index overflowed 32 bits");
+        index = idx;
+        READWRITE(tx);
+    }
+};
+
+typedef CPrefilledEntry<CTransaction> PrefilledTransaction;
+typedef CPrefilledEntry<CScCertificate> PrefilledCertificate;
+
+typedef enum ReadStatus_t
+{
+    READ_STATUS_OK,
+    READ_STATUS_INVALID, // Invalid object, peer is sending bogus crap
+    READ_STATUS_FAILED, // Failed to process object, e.g. short id collisions: fetch the full block instead
+} ReadStatus;
+
+/** The cmpctblock message: header, short ids of the transactions and certificates, and the prefilled ones */
+class CBlockHeaderAndShortTxIDs {
+private:
+    mutable uint64_t shorttxidk0, shorttxidk1;
+    uint64_t nonce;
+
+    void FillShortTxIDSelector() const;
+
+    friend class PartiallyDownloadedBlock;
+
+    static const int SHORTTXIDS_LENGTH = 6;
+protected:
+    std::vector<uint64_t> shorttxids;
+    std::vector<PrefilledTransaction> prefilledtxn;
+    std::vector<uint64_t> shortcertids;
+    std::vector<PrefilledCertificate> prefilledcerts;
+
+public:
+    CBlockHeader header;
+
+    // Dummy for deserialization
+    CBlockHeaderAndShortTxIDs() {}
+
+    //! The coinbase is prefilled, everything else is sent as short ids
+    explicit CBlockHeaderAndShortTxIDs(const CBlock& block);
+
+    uint64_t GetShortID(const uint256& hash) const;
+
+    size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
+    size_t BlockCertCount() const { return shortcertids.size() + prefilledcerts.size(); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(header);
+        READWRITE(nonce);
+        ReadWriteShortIDs(s, ser_action, nType, nVersion, shorttxids);
+        READWRITE(prefilledtxn);
+        ReadWriteShortIDs(s, ser_action, nType, nVersion, shortcertids);
+        READWRITE(prefilledcerts);
+
+        if (ser_action.ForRead())
+            FillShortTxIDSelector();
+    }
+};
+
+/** A block being rebuilt from a compact block, the mempool and the missing transactions/certificates */
+class PartiallyDownloadedBlock {
+protected:
+    std::vector<CTransaction> txn_available;
+    std::vector<bool> txn_have;
+    std::vector<CScCertificate> certs_available;
+    std::vector<bool> certs_have;
+    size_t prefilled_count, mempool_count;
+    CTxMemPool* pool;
+public:
+    CBlockHeader header;
+    PartiallyDownloadedBlock(CTxMemPool* poolIn) : prefilled_count(0), mempool_count(0), pool(poolIn) {}
+
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock);
+    bool IsTxAvailable(size_t index) const;
+    bool IsCertAvailable(size_t index) const;
+    size_t TxCount() const { return txn_available.size(); }
+    size_t CertCount() const { return certs_available.size(); }
+    //! vtx_missing and vcert_missing must be in the order of the positions not available
+    ReadStatus FillBlock(CBlock& block, const std::vector<CTransaction>& vtx_missing,
+                         const std::vector<CScCertificate>& vcert_missing);
+};
+
+#endif // BITCOIN_BLOCKENCODINGS_H
@@ -0,0 +1,101 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "chain.h"
+#include "main.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<const CMappedFile> CMappedFile::Open(const boost::filesystem::path& path)
+{
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return std::shared_ptr<const CMappedFile>();
+
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return std::shared_ptr<const CMappedFile>();
+
+    return std::shared_ptr<const CMappedFile>(new CMappedFile((const char*)p, st.st_size));
+#else
+    return std::shared_ptr<const CMappedFile>();
+#endif
+}
+
+CMappedFile::~CMappedFile()
+{
+#ifndef WIN32
+    munmap((void*)pData, nSize);
+#endif
+}
+
+CBlockFileMapCache::CBlockFileMapCache(unsigned int nMaxFilesIn) : nMaxFiles(0)
+{
+    SetMaxFiles(nMaxFilesIn);
+}
+
+void CBlockFileMapCache::SetMaxFiles(unsigned int nMaxFilesIn)
+{
+    LOCK(cs);
+    // Mapping whole block files doesn't fit in a 32 bits address space
+    nMaxFiles = sizeof(void*) >= 8 ? nMaxFilesIn : 0;
+    while (lMapped.size() > nMaxFiles)
+        lMapped.pop_back();
+}
+
+std::shared_ptr<const CMappedFile> CBlockFileMapCache::Get(int nFile, bool fUndo, uint64_t nEnd)
+{
+    LOCK(cs);
+    if (nMaxFiles == 0)
+        return std::shared_ptr<const CMappedFile>();
+
+    for (std::list<CEntry>::iterator it = lMapped.begin(); it != lMapped.end(); ++it) {
+        if (it->nFile == nFile && it->fUndo == fUndo) {
+            if (it->mapped->size() >= nEnd) {
+                lMapped.splice(lMapped.begin(), lMapped, it);
+                return it->mapped;
+            }
+            // the file has grown since it was mapped
+            lMapped.erase(it);
+            break;
+        }
+    }
+
+    std::shared_ptr<const CMappedFile> mapped = CMappedFile::Open(GetBlockPosFilename(CDiskBlockPos(nFile, 0), fUndo ? "rev" : "blk"));
+    if (!mapped || mapped->size() < nEnd)
+        return std::shared_ptr<const CMappedFile>();
+
+    CEntry entry;
+    entry.nFile = nFile;
+    entry.fUndo = fUndo;
+    entry.mapped = mapped;
+    lMapped.push_front(entry);
+    if (lMapped.size() > nMaxFiles)
+        lMapped.pop_back();
+    return mapped;
+}
+
+void CBlockFileMapCache::Forget(int nFile)
+{
+    LOCK(cs);
+    std::list<CEntry>::iterator it = lMapped.begin();
+    while (it != lMapped.end()) {
+        if (it->nFile == nFile)
+            it = lMapped.erase(it);
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEMAP_H
+#define BITCOIN_BLOCKFILEMAP_H
+
+#include "sync.h"
+
+#include <list>
+#include <memory>
+#include <stdint.h>
+
+#include <boost/filesystem/path.hpp>
+
+/** Default number of blk and rev files kept memory-mapped for reads */
+static const unsigned int DEFAULT_BLOCKFILE_MAPS = 64;
+
+/** A read-only memory mapping of a whole file, unmapped when the last reference goes */
+class CMappedFile
+{
+public:
+    /** Map the file at path as it is now; NULL if it is empty or can't be mapped. */
+    static std::shared_ptr<const CMappedFile> Open(const boost::filesystem::path& path);
+    ~CMappedFile();
+
+    const char* data() const { return pData; }
+    size_t size() const { return nSize; }
+
+private:
+    CMappedFile(const char* pDataIn, size_t nSizeIn) : pData(pDataIn), nSize(nSizeIn) {}
+    CMappedFile(const CMappedFile&);
+    CMappedFile& operator=(const CMappedFile&);
+
+    const char* pData;
+    size_t nSize;
+};
+
+/**
+ * The most recently read blk and rev files, memory-mapped, so that historical
+ * blocks and undo data are deserialized in place instead of going through
+ * open, seek and read for every access.
+ *
+ * The mappings are shared and read-only, so they see what is appended to the
+ * files afterwards; a read past the mapped length maps the file again. Files
+ * about to be truncated or deleted must be forgotten first.
+ */
+class CBlockFileMapCache
+{
+public:
+    explicit CBlockFileMapCache(unsigned int nMaxFilesIn);
+
+    /** Set how many files can be mapped at the same time, 0 to disable the mappings. */
+    void SetMaxFiles(unsigned int nMaxFilesIn);
+
+    /** Mapping of blk file nFile (rev if fUndo) covering at least its first nEnd bytes; NULL if not available. */
+    std::shared_ptr<const CMappedFile> Get(int nFile, bool fUndo, uint64_t nEnd);
+
+    /** Drop the mappings of the blk and rev files nFile; the readers holding them can go on. */
+    void Forget(int nFile);
+
+private:
+    struct CEntry
+    {
+        int nFile;
+        bool fUndo;
+        std::shared_ptr<const CMappedFile> mapped;
+    };
+
+    CCriticalSection cs;
+    unsigned int nMaxFiles;
+    //! Most recently used first
+    std::list<CEntry> lMapped;
+};
+
+#endif // BITCOIN_BLOCKFILEMAP_H
@@ -0,0 +1,169 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilereader.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "consensus/consensus.h"
+#include "consensus/validation.h"
+#include "main.h"
+#include "util.h"
+
+#include <boost/bind.hpp>
+
+CBlockFileReader::CBlockFileReader(FILE* fileIn, int nFileIn, bool fHeadersOnlyIn, int nThreads) :
+    nFile(nFileIn), fHeadersOnly(fHeadersOnlyIn), nQueuedBytes(0), fEof(false), fStop(false)
+{
+    threads.create_thread(boost::bind(&CBlockFileReader::ThreadRead, this, fileIn));
+    for (int i = 0; i < std::max(nThreads, 1); i++)
+        threads.create_thread(boost::bind(&CBlockFileReader::ThreadCheck, this));
+}
+
+CBlockFileReader::~CBlockFileReader()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+        cond.notify_all();
+    }
+    threads.join_all();
+}
+
+std::shared_ptr<CBlockFileEntry> CBlockFileReader::Next()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (queue.empty() ? !fEof : !queue.front()->fReady)
+        cond.wait(lock);
+    if (queue.empty())
+        return std::shared_ptr<CBlockFileEntry>();
+
+    std::shared_ptr<CBlockFileEntry> entry = queue.front();
+    queue.pop_front();
+    nQueuedBytes -= entry->nSize;
+    cond.notify_all();
+    return entry;
+}
+
+/**
+ * Whether the record just read ends where another one starts, at the end of the file or where the
+ * zeroed space preallocated after the last block of a file starts. Moves the read position.
+ */
+static bool IsAtRecordBoundary(CBufferedFile& blkdat, const CChainParams& chainparams)
+{
+    blkdat.SetLimit();
+    unsigned char buf[MESSAGE_START_SIZE];
+    try {
+        blkdat >> FLATDATA(buf);
+    } catch (const std::exception&) {
+        return true;
+    }
+    static const unsigned char zeros[MESSAGE_START_SIZE] = {};
+    return memcmp(buf, chainparams.MessageStart(), MESSAGE_START_SIZE) == 0 ||
+           memcmp(buf, zeros, MESSAGE_START_SIZE) == 0;
+}
+
+void CBlockFileReader::ThreadRead(FILE* fileIn)
+{
+    RenameThread("horizen-blkread");
+
+    const CChainParams& chainparams = Params();
+    // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor. The buffer
+    // is large enough for a whole block on top of the rewind margin, so blocks are read in one go.
+    CBufferedFile blkdat(fileIn, 4*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
+    uint64_t nRewind = blkdat.GetPos();
+    while (!blkdat.eof())
+    {
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[MESSAGE_START_SIZE];
+            blkdat.FindByte(chainparams.MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> FLATDATA(buf);
+            if (memcmp(buf, chainparams.MessageStart(), MESSAGE_START_SIZE))
+                continue; //only first byte of magic number matches. Keep searching...
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
+                continue; //magic number matches but size can't be block one. Keep searching...
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            break;
+        }
+        try
+        {
+            // read block
+            uint64_t nBlockPos = blkdat.GetPos();
+            std::shared_ptr<CBlockFileEntry> entry = std::make_shared<CBlockFileEntry>(SER_DISK, CLIENT_VERSION);
+            entry->pos = CDiskBlockPos(nFile, nBlockPos);
+            entry->nSize = nSize;
+            entry->ssRaw.resize(nSize);
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.read(&entry->ssRaw[0], nSize);
+            nRewind = blkdat.GetPos();
+            // The size of a corrupt record can look valid and cover the blocks that follow it: the checking
+            // threads will tell whether this one is a block, but unless the next one starts right after it,
+            // keep searching from the byte after its message start
+            if (!IsAtRecordBoundary(blkdat, chainparams))
+                nRewind = nBlockPos - sizeof(nSize) - MESSAGE_START_SIZE + 1;
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fStop && !queue.empty() && nQueuedBytes + nSize > MAX_BLOCKFILE_READAHEAD)
+                cond.wait(lock);
+            if (fStop)
+                break;
+            queue.push_back(entry);
+            queueToCheck.push_back(entry);
+            nQueuedBytes += nSize;
+            cond.notify_all();
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fEof = true;
+    cond.notify_all();
+}
+
+void CBlockFileReader::ThreadCheck()
+{
+    RenameThread("horizen-blkcheck");
+
+    while (true)
+    {
+        std::shared_ptr<CBlockFileEntry> entry;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fStop && !fEof && queueToCheck.empty())
+                cond.wait(lock);
+            if (fStop || queueToCheck.empty())
+                return;
+            entry = queueToCheck.front();
+            queueToCheck.pop_front();
+        }
+
+        try
+        {
+            if (fHeadersOnly)
+                entry->ssRaw >> *static_cast<CBlockHeader*>(&entry->block);
+            else
+                entry->ssRaw >> entry->block;
+            entry->hash = entry->block.GetHash();
+            CValidationState state;
+            entry->fHeaderOk = CheckBlockHeader(entry->block, state);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+        entry->ssRaw = CDataStream(SER_DISK, CLIENT_VERSION);
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        entry->fReady = true;
+        cond.notify_all();
+    }
+}
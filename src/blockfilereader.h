@@ -0,0 +1,96 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEREADER_H
+#define BITCOIN_BLOCKFILEREADER_H
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include <deque>
+#include <memory>
+#include <stdio.h>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/** Maximum size of the blocks read ahead of validation, raw or deserialized */
+static const size_t MAX_BLOCKFILE_READAHEAD = 64 * 1024 * 1024;
+/** Maximum number of threads deserializing and checking the blocks read */
+static const int MAX_BLOCKFILE_CHECK_THREADS = 4;
+
+/** A block found in a block file, on its way from the file to validation */
+struct CBlockFileEntry
+{
+    //! Position of the block data in the file (the file number is the one given to the reader)
+    CDiskBlockPos pos;
+    unsigned int nSize;
+    //! The serialized block, released once deserialized
+    CDataStream ssRaw;
+    //! The block, or only its header when reading headers
+    CBlock block;
+    uint256 hash;
+    //! The block could be deserialized, and its Equihash solution and proof of work are valid
+    bool fHeaderOk;
+    //! Done by the checking threads (guarded by the mutex of the reader)
+    bool fReady;
+
+    CBlockFileEntry(int nTypeIn, int nVersionIn) : nSize(0), ssRaw(nTypeIn, nVersionIn), fHeaderOk(false), fReady(false) {}
+};
+
+/**
+ * Reads the blocks of a block file (blk?????.dat, bootstrap.dat...) through a
+ * pipeline: one thread scans the file with large sequential reads and hands
+ * the serialized blocks to a few threads, which deserialize them, hash them
+ * and check their header, while the caller takes them back in file order and
+ * validates them. Only MAX_BLOCKFILE_READAHEAD bytes of blocks are read ahead
+ * of the caller.
+ *
+ * The file is closed when the reader is done with it. Destroying the reader
+ * stops and joins its threads.
+ */
+class CBlockFileReader
+{
+public:
+    /**
+     * @param[in]   fileIn        The file, which the reader takes over
+     * @param[in]   nFile         File number reported in the positions of the blocks
+     * @param[in]   fHeadersOnly  Deserialize only the headers of the blocks
+     * @param[in]   nThreads      Number of threads deserializing and checking the blocks
+     */
+    CBlockFileReader(FILE* fileIn, int nFile, bool fHeadersOnly, int nThreads);
+    ~CBlockFileReader();
+
+    /** Next block of the file, in file order; NULL at the end of the file. */
+    std::shared_ptr<CBlockFileEntry> Next();
+
+private:
+    CBlockFileReader(const CBlockFileReader&);
+    CBlockFileReader& operator=(const CBlockFileReader&);
+
+    void ThreadRead(FILE* fileIn);
+    void ThreadCheck();
+
+    const int nFile;
+    const bool fHeadersOnly;
+
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    //! Blocks read, in file order
+    std::deque<std::shared_ptr<CBlockFileEntry> > queue;
+    //! Blocks read and not yet taken by a checking thread
+    std::deque<std::shared_ptr<CBlockFileEntry> > queueToCheck;
+    //! Serialized size of the blocks in queue
+    size_t nQueuedBytes;
+    //! The reading thread reached the end of the file
+    bool fEof;
+    bool fStop;
+
+    boost::thread_group threads;
+};
+
+#endif // BITCOIN_BLOCKFILEREADER_H
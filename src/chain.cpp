@@ -46,9 +46,29 @@ CBlockLocator CChain::GetLocator(const CBlockIndex *pindex) const {
 const CBlockIndex *CChain::FindFork(const CBlockIndex *pindex) const {
     if (pindex->nHeight > Height())
         pindex = pindex->GetAncestor(Height());
-    while (pindex && !Contains(pindex))
-        pindex = pindex->pprev;
-    return pindex;
+    if (pindex == NULL || Contains(pindex))
+        return pindex;
+    if (!Contains(pindex->GetAncestor(0)))
+        return NULL;
+
+    // Being in this chain is monotonic along the ancestors of pindex: look for the highest one that is
+    // with skip list jumps of growing length, then bisect the last one, rather than walking pprev.
+    int nOut = pindex->nHeight; // not in this chain
+    int nIn = nOut;             // in this chain, once found
+    for (int nStep = 1; ; nStep *= 2) {
+        nIn = std::max(nOut - nStep, 0);
+        if (Contains(pindex->GetAncestor(nIn)))
+            break;
+        nOut = nIn;
+    }
+    while (nOut - nIn > 1) {
+        int nMid = nIn + (nOut - nIn) / 2;
+        if (Contains(pindex->GetAncestor(nMid)))
+            nIn = nMid;
+        else
+            nOut = nMid;
+    }
+    return pindex->GetAncestor(nIn);
 }
 
 /** Turn the lowest '1' bit in the binary representation of a number into a '0'. */
@@ -11,6 +11,7 @@
 #include "tinyformat.h"
 #include "uint256.h"
 
+#include <memory>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -423,12 +424,57 @@ public:
     }
 };
 
+/**
+ * An immutable view of a chain, as of a given tip. Block index entries are
+ * never modified in the fields it relies on (height, hash, pprev and pskip)
+ * once they are reachable from a tip, so it can be queried without the lock
+ * protecting the chain; heights are resolved through the skip list.
+ */
+class CChainSnapshot {
+private:
+    const CBlockIndex* pindexTip;
+
+public:
+    explicit CChainSnapshot(const CBlockIndex* pindexTipIn) : pindexTip(pindexTipIn) {}
+
+    const CBlockIndex* Tip() const {
+        return pindexTip;
+    }
+
+    int Height() const {
+        return pindexTip ? pindexTip->nHeight : -1;
+    }
+
+    const CBlockIndex* operator[](int nHeight) const {
+        if (nHeight < 0 || nHeight > Height())
+            return NULL;
+        return pindexTip->GetAncestor(nHeight);
+    }
+
+    bool Contains(const CBlockIndex* pindex) const {
+        return (*this)[pindex->nHeight] == pindex;
+    }
+
+    const CBlockIndex* Next(const CBlockIndex* pindex) const {
+        return Contains(pindex) ? (*this)[pindex->nHeight + 1] : NULL;
+    }
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain {
 private:
     std::vector<CBlockIndex*> vChain;
+    //! Published by SetTip, for readers which don't hold the lock of the chain
+    std::shared_ptr<const CChainSnapshot> snapshot;
 
 public:
+    CChain() : snapshot(std::make_shared<const CChainSnapshot>(nullptr)) {}
+
+    /** Returns a view of the chain as of its current tip. Safe to call without the lock of the chain. */
+    std::shared_ptr<const CChainSnapshot> Snapshot() const {
+        return std::atomic_load(&snapshot);
+    }
+
     /** Returns the index entry for the genesis block of this chain, or NULL if none. */
     CBlockIndex *Genesis() const {
         return (*this)[0];
@@ -473,6 +519,7 @@ public:
 
     /** Set/initialize a chain with a given tip. */
     virtual void SetTip(CBlockIndex *pindex) {
+        std::atomic_store(&snapshot, std::make_shared<const CChainSnapshot>(pindex));
         if (pindex == NULL) {
             vChain.clear();
             return;
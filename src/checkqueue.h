@@ -6,9 +6,13 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <stdint.h>
 #include <vector>
 
-#include <boost/foreach.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -16,21 +20,70 @@
 template <typename T>
 class CCheckQueueControl;
 
-/** 
+/** Counters of one round of verifications, i.e. of the checks added between two Wait() */
+struct CCheckQueueStats
+{
+    //! Number of checks added to the queue
+    uint64_t nChecks;
+    //! Number of checks a worker took from the queue of another one
+    uint64_t nStolen;
+    //! Number of times a worker queue lock was found taken
+    uint64_t nContended;
+    //! Time spent running checks, summed over the threads
+    int64_t nBusyMicros;
+    //! Time the threads (including the master) spent without work before the round was over
+    int64_t nIdleMicros;
+
+    CCheckQueueStats() : nChecks(0), nStolen(0), nContended(0), nBusyMicros(0), nIdleMicros(0) {}
+};
+
+/**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
-  * operator(), returning a bool.
+  * operator(), returning a bool, and a swap method.
   *
   * One thread (the master) is assumed to push batches of verifications
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker has its own deque, which the master fills in turn: a worker
+  * takes its jobs from the back of its deque, and when it runs out of them it
+  * steals from the front of the others, so that workers only contend on a
+  * lock with the master and the occasional thief.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    struct WorkerQueue
+    {
+        //! Mutex to protect the deque
+        boost::mutex mutex;
+
+        //! The jobs of this worker. As the order of booleans doesn't matter,
+        //! the owner uses it as a LIFO and thieves take the oldest jobs.
+        std::deque<T> checks;
+
+        //! Number of jobs in the deque, to skip empty queues without locking them
+        std::atomic<unsigned int> nSize;
+
+        WorkerQueue() : nSize(0) {}
+    };
+
+    //! The maximum number of worker queues; further workers share them
+    const unsigned int nMaxQueues;
+
+    //! The worker queues, the first one belonging to the master
+    std::unique_ptr<WorkerQueue[]> vQueues;
+
+    //! The total number of workers (including the master)
+    std::atomic<unsigned int> nTotal;
+
+    //! Next worker queue the master adds to
+    unsigned int nNextQueue;
+
+    //! Mutex to protect the sleep of the workers and of the master
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,122 +92,204 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of workers (excluding the master) that are sleeping
+    std::atomic<int> nIdle;
 
-    //! The total number of workers (including the master).
-    int nTotal;
-
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! Number of jobs in the worker queues
+    std::atomic<unsigned int> nQueued;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
 
-    //! Whether we're shutting down.
-    bool fQuit;
+    //! The temporary evaluation result.
+    std::atomic<bool> fAllOk;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! Counters of the current round
+    std::atomic<uint64_t> nChecks;
+    std::atomic<uint64_t> nStolen;
+    std::atomic<uint64_t> nContended;
+    std::atomic<int64_t> nBusyMicros;
+    std::chrono::steady_clock::time_point roundStart;
+
+    static int64_t MicrosSince(const std::chrono::steady_clock::time_point& start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    unsigned int QueueCount() const
+    {
+        return std::min(nTotal.load(), nMaxQueues);
+    }
+
+    void LockQueue(boost::unique_lock<boost::mutex>& lock)
+    {
+        if (!lock.try_lock()) {
+            nContended++;
+            lock.lock();
+        }
+    }
+
+    /**
+     * Move a batch of jobs from the queue nQueue to vChecks. Aim for increasingly smaller
+     * batches, leaving half of the jobs to the thieves, and don't do batches larger than nBatchSize.
+     */
+    unsigned int TakeFrom(unsigned int nQueue, bool fOwn, std::vector<T>& vChecks)
+    {
+        WorkerQueue& queue = vQueues[nQueue];
+        if (queue.nSize == 0)
+            return 0;
+        boost::unique_lock<boost::mutex> lock(queue.mutex, boost::defer_lock);
+        LockQueue(lock);
+        const unsigned int nNow = std::min(nBatchSize, ((unsigned int)queue.checks.size() + 1) / 2);
+        vChecks.resize(nNow);
+        for (unsigned int i = 0; i < nNow; i++) {
+            // We want the lock on the mutex to be as short as possible, so swap jobs from the
+            // queue to the local batch vector instead of copying.
+            if (fOwn) {
+                vChecks[i].swap(queue.checks.back());
+                queue.checks.pop_back();
+            } else {
+                vChecks[i].swap(queue.checks.front());
+                queue.checks.pop_front();
+            }
+        }
+        queue.nSize -= nNow;
+        nQueued -= nNow;
+        return nNow;
+    }
+
+    //! Take a batch of jobs from the worker's own queue, or else steal one from the others
+    unsigned int Take(unsigned int nId, std::vector<T>& vChecks)
+    {
+        unsigned int nNow = TakeFrom(nId, true, vChecks);
+        const unsigned int nQueues = QueueCount();
+        for (unsigned int i = 1; nNow == 0 && i < nQueues && nQueued != 0; i++) {
+            nNow = TakeFrom((nId + i) % nQueues, false, vChecks);
+            nStolen += nNow;
+        }
+        return nNow;
+    }
+
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    bool Loop(unsigned int nId, bool fMaster = false)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+            const unsigned int nNow = Take(nId, vChecks);
+            if (nNow) {
+                // Check whether we need to do work at all
+                bool fOk = fAllOk;
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for (T& check : vChecks)
+                    if (fOk)
+                        fOk = check();
+                vChecks.clear();
+                nBusyMicros += MicrosSince(start);
+                if (!fOk)
+                    fAllOk = false;
+                if ((nTodo -= nNow) == 0) {
+                    // We processed the last element; inform the master it can exit and return the result
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    condMaster.notify_one();
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+                continue;
+            }
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fMaster) {
+                // No more jobs will be added until we return: just wait for the others to complete theirs
+                while (nTodo != 0 && nQueued == 0)
+                    condMaster.wait(lock);
+                if (nTodo == 0) {
+                    bool fRet = fAllOk;
+                    // reset the status for new work later
+                    fAllOk = true;
+                    return fRet;
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+            } else {
+                // The master checks nIdle after publishing new jobs in nQueued,
+                // so either it sees us sleeping or we see its jobs.
+                nIdle++;
+                while (nQueued == 0)
+                    condWorker.wait(lock);
+                nIdle--;
             }
-            // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
         } while (true);
     }
 
 public:
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn, unsigned int nMaxQueuesIn = 64) :
+        nMaxQueues(std::max(1U, nMaxQueuesIn)), vQueues(new WorkerQueue[nMaxQueues]), nTotal(1), nNextQueue(0),
+        nIdle(0), nQueued(0), nTodo(0), fAllOk(true), nBatchSize(nBatchSizeIn),
+        nChecks(0), nStolen(0), nContended(0), nBusyMicros(0) {}
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        Loop(nTotal++ % nMaxQueues);
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        return Loop(0, true);
     }
 
-    //! Add a batch of checks to the queue
+    //! Add a batch of checks to the queue, spreading them over the worker queues
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
+        if (nChecks == 0)
+            roundStart = std::chrono::steady_clock::now();
+        nChecks += vChecks.size();
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+
+        const unsigned int nQueues = QueueCount();
+        for (size_t nStart = 0; nStart < vChecks.size(); nStart += nBatchSize) {
+            const size_t nEnd = std::min(vChecks.size(), nStart + nBatchSize);
+            // The master only works on its own queue once it's done adding
+            nNextQueue = nQueues > 1 ? 1 + nNextQueue % (nQueues - 1) : 0;
+            WorkerQueue& queue = vQueues[nNextQueue];
+            boost::unique_lock<boost::mutex> lock(queue.mutex, boost::defer_lock);
+            LockQueue(lock);
+            for (size_t i = nStart; i < nEnd; i++) {
+                queue.checks.push_back(T());
+                queue.checks.back().swap(vChecks[i]);
+            }
+            queue.nSize += nEnd - nStart;
+            nQueued += nEnd - nStart;
+        }
+
+        if (nIdle > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
+    }
+
+    //! Return the counters of the round completed by the last Wait(), and start a new one
+    CCheckQueueStats PopStats()
+    {
+        CCheckQueueStats stats;
+        stats.nChecks = nChecks.exchange(0);
+        stats.nStolen = nStolen.exchange(0);
+        stats.nContended = nContended.exchange(0);
+        stats.nBusyMicros = nBusyMicros.exchange(0);
+        if (stats.nChecks)
+            stats.nIdleMicros = std::max<int64_t>(0, MicrosSince(roundStart) * nTotal - stats.nBusyMicros);
+        return stats;
     }
 
     ~CCheckQueue()
@@ -164,12 +299,11 @@ public:
     bool IsIdle()
     {
         boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
+        return (nQueued == 0 && nTodo == 0 && fAllOk == true);
     }
-
 };
 
-/** 
+/**
  * RAII-style controller object for a CCheckQueue that guarantees the passed
  * queue is finished before continuing.
  */
@@ -179,6 +313,7 @@ class CCheckQueueControl
 private:
     CCheckQueue<T>* pqueue;
     bool fDone;
+    CCheckQueueStats stats;
 
 public:
     CCheckQueueControl(CCheckQueue<T>* pqueueIn) : pqueue(pqueueIn), fDone(false)
@@ -195,6 +330,7 @@ public:
         if (pqueue == NULL)
             return true;
         bool fRet = pqueue->Wait();
+        stats = pqueue->PopStats();
         fDone = true;
         return fRet;
     }
@@ -205,6 +341,9 @@ public:
             pqueue->Add(vChecks);
     }
 
+    //! Counters of the checks run through the queue, available after Wait()
+    const CCheckQueueStats& GetStats() const { return stats; }
+
     ~CCheckQueueControl()
     {
         if (!fDone)
@@ -215,6 +215,45 @@ bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock,
                             CNullifiersMap &mapNullifiers, CSidechainsMap& mapSidechains,
                             CSidechainEventsMap& mapSidechainEvents,
                             CCswNullifiersMap& cswNullifiers)                         { return false; }
+bool CCoinsView::BatchWriteDirty(const CCoinsMap &mapCoins, const uint256 &hashBlock,
+                                 const uint256 &hashAnchor, const CAnchorsMap &mapAnchors,
+                                 const CNullifiersMap &mapNullifiers, const CSidechainsMap& mapSidechains,
+                                 const CSidechainEventsMap& mapSidechainEvents,
+                                 const CCswNullifiersMap& cswNullifiers)
+{
+    CCoinsMap mapCoinsDirty;
+    for (const auto& entry : mapCoins)
+        if (entry.second.flags & CCoinsCacheEntry::DIRTY)
+            mapCoinsDirty.insert(entry);
+
+    CAnchorsMap mapAnchorsDirty;
+    for (const auto& entry : mapAnchors)
+        if (entry.second.flags & CAnchorsCacheEntry::DIRTY)
+            mapAnchorsDirty.insert(entry);
+
+    CNullifiersMap mapNullifiersDirty;
+    for (const auto& entry : mapNullifiers)
+        if (entry.second.flags & CNullifiersCacheEntry::DIRTY)
+            mapNullifiersDirty.insert(entry);
+
+    CSidechainsMap mapSidechainsDirty;
+    for (const auto& entry : mapSidechains)
+        if (entry.second.flag != CSidechainsCacheEntry::Flags::DEFAULT)
+            mapSidechainsDirty.insert(entry);
+
+    CSidechainEventsMap mapSidechainEventsDirty;
+    for (const auto& entry : mapSidechainEvents)
+        if (entry.second.flag != CSidechainEventsCacheEntry::Flags::DEFAULT)
+            mapSidechainEventsDirty.insert(entry);
+
+    CCswNullifiersMap mapCswNullifiersDirty;
+    for (const auto& entry : cswNullifiers)
+        if (entry.second.flag != CCswNullifiersCacheEntry::Flags::DEFAULT)
+            mapCswNullifiersDirty.insert(entry);
+
+    return BatchWrite(mapCoinsDirty, hashBlock, hashAnchor, mapAnchorsDirty, mapNullifiersDirty,
+                      mapSidechainsDirty, mapSidechainEventsDirty, mapCswNullifiersDirty);
+}
 bool CCoinsView::GetStats(CCoinsStats &stats)                                   const { return false; }
 
 
@@ -244,6 +283,13 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock,
                                   CCswNullifiersMap& cswNullifiers) { return base->BatchWrite(mapCoins, hashBlock, hashAnchor,
                                                                                               mapAnchors, mapNullifiers, mapSidechains,
                                                                                               mapSidechainEvents, cswNullifiers); }
+bool CCoinsViewBacked::BatchWriteDirty(const CCoinsMap &mapCoins, const uint256 &hashBlock,
+                                       const uint256 &hashAnchor, const CAnchorsMap &mapAnchors,
+                                       const CNullifiersMap &mapNullifiers, const CSidechainsMap& mapSidechains,
+                                       const CSidechainEventsMap& mapSidechainEvents,
+                                       const CCswNullifiersMap& cswNullifiers) { return base->BatchWriteDirty(mapCoins, hashBlock, hashAnchor,
+                                                                                                             mapAnchors, mapNullifiers, mapSidechains,
+                                                                                                             mapSidechainEvents, cswNullifiers); }
 bool CCoinsViewBacked::GetStats(CCoinsStats &stats)                                  const { return base->GetStats(stats); }
 
 CCoinsKeyHasher::CCoinsKeyHasher() : salt(GetRandHash()) {}
@@ -261,7 +307,7 @@ size_t CCswNullifiersKeyHasher::operator()(const std::pair<uint256, CFieldElemen
     return CalculateHash(buf, BUF_LEN, salt);
 }
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), cachedCoinsUsage(0) { }
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), cachedCoinsUsage(0), nAccessTick(0) { }
 
 CCoinsViewCache::~CCoinsViewCache()
 {
@@ -280,13 +326,17 @@ size_t CCoinsViewCache::DynamicMemoryUsage() const {
 
 CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256 &txid) const {
     CCoinsMap::iterator it = cacheCoins.find(txid);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        it->second.nLastAccess = nAccessTick;
         return it;
+    }
     CCoins tmp;
     if (!base->GetCoins(txid, tmp))
         return cacheCoins.end();
     CCoinsMap::iterator ret = cacheCoins.insert(std::make_pair(txid, CCoinsCacheEntry())).first;
     tmp.swap(ret->second.coins);
+    ret->second.nLastAccess = nAccessTick;
+    ret->second.SetBaseAvail();
     if (ret->second.coins.IsPruned()) {
         // The parent only has an empty entry for this txid; we can consider our
         // version as fresh.
@@ -489,12 +539,15 @@ CCoinsModifier CCoinsViewCache::ModifyCoins(const uint256 &txid) {
         } else if (ret.first->second.coins.IsPruned()) {
             // The parent view only has a pruned entry for this; mark it as fresh.
             ret.first->second.flags = CCoinsCacheEntry::FRESH;
+        } else {
+            ret.first->second.SetBaseAvail();
         }
     } else {
         cachedCoinUsage = ret.first->second.coins.DynamicMemoryUsage();
     }
     // Assume that whenever ModifyCoins is called, the entry will be modified.
     ret.first->second.flags |= CCoinsCacheEntry::DIRTY;
+    ret.first->second.nLastAccess = nAccessTick;
     return CCoinsModifier(*this, ret.first, cachedCoinUsage);
 }
 
@@ -581,6 +634,7 @@ size_t CCoinsViewCache::WriteCoins(const uint256& key, CCoinsCacheEntry& value)
                 assert(value.flags & CCoinsCacheEntry::FRESH);
                 CCoinsCacheEntry& entry = this->cacheCoins[key];
                 entry.coins.swap(value.coins);
+                entry.nLastAccess = nAccessTick;
                 res += entry.coins.DynamicMemoryUsage();
                     entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
                 }
@@ -598,6 +652,7 @@ size_t CCoinsViewCache::WriteCoins(const uint256& key, CCoinsCacheEntry& value)
                     // A normal modification.
                 res -= itUs->second.coins.DynamicMemoryUsage();
                 itUs->second.coins.swap(value.coins);
+                itUs->second.nLastAccess = nAccessTick;
                 res += itUs->second.coins.DynamicMemoryUsage();
                     itUs->second.flags |= CCoinsCacheEntry::DIRTY;
                 }
@@ -615,6 +670,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins,
                                  CSidechainEventsMap& mapSidechainEvents,
                                  CCswNullifiersMap& cswNullifiers) {
     assert(!hasModifier);
+    ++nAccessTick;
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ++it)
         cachedCoinsUsage += WriteCoins(it->first, it->second);
 
@@ -2331,6 +2387,165 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+bool CCoinsViewCache::Sync() {
+    assert(!hasModifier);
+
+    // The base writes the dirty entries, in place when it writes synchronously
+    if (!base->BatchWriteDirty(cacheCoins, hashBlock, hashAnchor, cacheAnchors, cacheNullifiers,
+                               cacheSidechains, cacheSidechainEvents, cacheCswNullifiers))
+        return false;
+
+    // Everything left now matches the base: drop what the base does not hold anymore,
+    // mark the rest as clean and recompute the memory usage from scratch
+    cachedCoinsUsage = 0;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); ) {
+        if (it->second.coins.IsPruned()) {
+            it = cacheCoins.erase(it);
+        } else {
+            it->second.flags = 0;
+            it->second.SetBaseAvail();
+            cachedCoinsUsage += it->second.coins.DynamicMemoryUsage();
+            ++it;
+        }
+    }
+
+    for (CAnchorsMap::iterator it = cacheAnchors.begin(); it != cacheAnchors.end(); ) {
+        if (!it->second.entered) {
+            it = cacheAnchors.erase(it);
+        } else {
+            it->second.flags = 0;
+            cachedCoinsUsage += it->second.tree.DynamicMemoryUsage();
+            ++it;
+        }
+    }
+
+    for (auto& entry : cacheNullifiers)
+        entry.second.flags = 0;
+
+    for (CSidechainsMap::iterator it = cacheSidechains.begin(); it != cacheSidechains.end(); ) {
+        if (it->second.flag == CSidechainsCacheEntry::Flags::ERASED) {
+            it = cacheSidechains.erase(it);
+        } else {
+            it->second.flag = CSidechainsCacheEntry::Flags::DEFAULT;
+            cachedCoinsUsage += it->second.sidechain.DynamicMemoryUsage();
+            ++it;
+        }
+    }
+
+    for (CSidechainEventsMap::iterator it = cacheSidechainEvents.begin(); it != cacheSidechainEvents.end(); ) {
+        if (it->second.flag == CSidechainEventsCacheEntry::Flags::ERASED) {
+            it = cacheSidechainEvents.erase(it);
+        } else {
+            it->second.flag = CSidechainEventsCacheEntry::Flags::DEFAULT;
+            cachedCoinsUsage += it->second.scEvents.DynamicMemoryUsage();
+            ++it;
+        }
+    }
+
+    for (CCswNullifiersMap::iterator it = cacheCswNullifiers.begin(); it != cacheCswNullifiers.end(); ) {
+        if (it->second.flag == CCswNullifiersCacheEntry::Flags::ERASED) {
+            it = cacheCswNullifiers.erase(it);
+        } else {
+            it->second.flag = CCswNullifiersCacheEntry::Flags::DEFAULT;
+            ++it;
+        }
+    }
+
+    return true;
+}
+
+void CCoinsViewCache::Trim(size_t nTargetUsage) {
+    assert(!hasModifier);
+
+    size_t nUsage = DynamicMemoryUsage();
+    if (nUsage <= nTargetUsage)
+        return;
+
+    // Without eviction the other maps would only ever grow between Flush()es; their entries are not tracked
+    // by use and cheap to read again, drop all the clean ones
+    for (CAnchorsMap::iterator it = cacheAnchors.begin(); it != cacheAnchors.end(); ) {
+        if (it->second.flags == 0) {
+            cachedCoinsUsage -= it->second.tree.DynamicMemoryUsage();
+            it = cacheAnchors.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (CNullifiersMap::iterator it = cacheNullifiers.begin(); it != cacheNullifiers.end(); ) {
+        if (it->second.flags == 0)
+            it = cacheNullifiers.erase(it);
+        else
+            ++it;
+    }
+
+    for (CSidechainsMap::iterator it = cacheSidechains.begin(); it != cacheSidechains.end(); ) {
+        if (it->second.flag == CSidechainsCacheEntry::Flags::DEFAULT) {
+            cachedCoinsUsage -= it->second.sidechain.DynamicMemoryUsage();
+            it = cacheSidechains.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (CSidechainEventsMap::iterator it = cacheSidechainEvents.begin(); it != cacheSidechainEvents.end(); ) {
+        if (it->second.flag == CSidechainEventsCacheEntry::Flags::DEFAULT) {
+            cachedCoinsUsage -= it->second.scEvents.DynamicMemoryUsage();
+            it = cacheSidechainEvents.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (CCswNullifiersMap::iterator it = cacheCswNullifiers.begin(); it != cacheCswNullifiers.end(); ) {
+        if (it->second.flag == CCswNullifiersCacheEntry::Flags::DEFAULT)
+            it = cacheCswNullifiers.erase(it);
+        else
+            ++it;
+    }
+
+    size_t nUsageCoins = DynamicMemoryUsage();
+    if (nUsageCoins <= nTargetUsage) {
+        LogPrint("coindb", "%s(): cache usage %u -> %u\n", __func__, nUsage, nUsageCoins);
+        return;
+    }
+
+    // Memory held by the clean entries, grouped by the tick they were last used at
+    static const size_t nNodeUsage = memusage::MallocUsage(sizeof(memusage::boost_unordered_node<CCoinsMap::value_type>));
+    std::map<uint32_t, size_t> mapUsageByAccess;
+    for (const auto& entry : cacheCoins)
+        if (entry.second.flags == 0)
+            mapUsageByAccess[entry.second.nLastAccess] += nNodeUsage + entry.second.coins.DynamicMemoryUsage();
+
+    if (mapUsageByAccess.empty())
+        return;
+
+    // Find the most recent tick to evict so that the target is met
+    size_t nToFree = nUsageCoins - nTargetUsage;
+    size_t nFreed = 0;
+    uint32_t nEvictUpTo = 0;
+    for (const auto& item : mapUsageByAccess) {
+        nEvictUpTo = item.first;
+        nFreed += item.second;
+        if (nFreed >= nToFree)
+            break;
+    }
+
+    size_t nEvicted = 0;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); ) {
+        if (it->second.flags == 0 && it->second.nLastAccess <= nEvictUpTo) {
+            cachedCoinsUsage -= it->second.coins.DynamicMemoryUsage();
+            it = cacheCoins.erase(it);
+            ++nEvicted;
+        } else {
+            ++it;
+        }
+    }
+
+    LogPrint("coindb", "%s(): evicted %u coins not used since tick %u (of %u), cache usage %u -> %u\n", __func__,
+        nEvicted, nEvictUpTo, nAccessTick, nUsage, DynamicMemoryUsage());
+}
+
 bool CCoinsViewCache::DecrementImmatureAmount(const uint256& scId, const CSidechainsMap::iterator& targetEntry, CAmount nValue, int maturityHeight)
 {
     // get the map of immature amounts, they are indexed by height
@@ -316,13 +316,34 @@ struct CCoinsCacheEntry
 {
     CCoins coins; // The actual cached data.
     unsigned char flags;
+    uint32_t nLastAccess; // Access tick of the owning cache when this entry was last used, for eviction.
+    // Number of outputs, and which of the first BASE_AVAIL_OUTPUTS ones are unspent, in the parent view as of
+    // when this entry was fetched from it or last synced to it. Lets a parent storing outputs separately
+    // write only the changed ones. Meaningless for FRESH entries.
+    uint32_t nBaseOutputs;
+    uint64_t nBaseAvail;
 
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
         FRESH = (1 << 1), // The parent view does not have this entry (or it is pruned).
     };
 
-    CCoinsCacheEntry() : coins(), flags(0) {}
+    static const unsigned int BASE_AVAIL_OUTPUTS = 64;
+
+    CCoinsCacheEntry() : coins(), flags(0), nLastAccess(0), nBaseOutputs(0), nBaseAvail(0) {}
+
+    //! Record the current outputs as the ones the parent view has
+    void SetBaseAvail() {
+        nBaseOutputs = coins.vout.size();
+        nBaseAvail = 0;
+        for (unsigned int i = 0; i < std::min((unsigned int)coins.vout.size(), BASE_AVAIL_OUTPUTS); i++)
+            if (!coins.vout[i].IsNull())
+                nBaseAvail |= (uint64_t)1 << i;
+    }
+
+    bool IsBaseAvail(unsigned int nPos) const {
+        return nPos < BASE_AVAIL_OUTPUTS && (nBaseAvail & ((uint64_t)1 << nPos)) != 0;
+    }
 };
 
 struct CAnchorsCacheEntry
@@ -536,6 +557,17 @@ public:
                             CSidechainEventsMap& mapCeasedScs,
                             CCswNullifiersMap& cswNullifiers);
 
+    //! Write the dirty entries of the maps like BatchWrite, leaving the maps untouched.
+    //! By default the dirty entries are copied and handed to BatchWrite.
+    virtual bool BatchWriteDirty(const CCoinsMap &mapCoins,
+                                 const uint256 &hashBlock,
+                                 const uint256 &hashAnchor,
+                                 const CAnchorsMap &mapAnchors,
+                                 const CNullifiersMap &mapNullifiers,
+                                 const CSidechainsMap& mapSidechains,
+                                 const CSidechainEventsMap& mapCeasedScs,
+                                 const CCswNullifiersMap& cswNullifiers);
+
     //! Calculate statistics about the unspent transaction output set
     virtual bool GetStats(CCoinsStats &stats) const;
 
@@ -575,6 +607,14 @@ public:
                     CSidechainsMap& mapSidechains,
                     CSidechainEventsMap& mapCeasedScs,
                     CCswNullifiersMap& cswNullifiers)                  override;
+    bool BatchWriteDirty(const CCoinsMap &mapCoins,
+                         const uint256 &hashBlock,
+                         const uint256 &hashAnchor,
+                         const CAnchorsMap &mapAnchors,
+                         const CNullifiersMap &mapNullifiers,
+                         const CSidechainsMap& mapSidechains,
+                         const CSidechainEventsMap& mapCeasedScs,
+                         const CCswNullifiersMap& cswNullifiers)       override;
     bool GetStats(CCoinsStats &stats)                                  const override;
 };
 
@@ -625,6 +665,9 @@ protected:
     /* Cached dynamic memory usage for the inner CCoins objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Advanced at every batch of changes (i.e. every connected block), stamped on the coins entries being used. */
+    uint32_t nAccessTick;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
     CCoinsViewCache(const CCoinsViewCache &) = delete; //we prevent accidentally using it when one intends to create a cache on top of a base cache.
@@ -769,6 +812,19 @@ public:
 
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base like Flush(), but keep the
+     * entries resident: written entries become clean, spent ones are dropped.
+     */
+    bool Sync();
+
+    /**
+     * Evict the clean anchors, nullifiers, sidechains and sidechain events, which are not tracked by
+     * use, then the least recently used clean coins until the dynamic memory usage of the cache is at
+     * most nTargetUsage (or no clean coins are left).
+     */
+    void Trim(size_t nTargetUsage);
+
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
@@ -0,0 +1,241 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/blake2b.h"
+
+#include "crypto/common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_AVX2)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace blake2b_avx2
+{
+void Compress_4way(const uint64_t* h, uint64_t t, const unsigned char* blocks, uint64_t* out);
+}
+#endif
+
+// Internal implementation code.
+namespace
+{
+/// Internal BLAKE2b implementation.
+namespace blake2b
+{
+const uint64_t IV[8] = {
+    0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull, 0xa54ff53a5f1d36f1ull,
+    0x510e527fade682d1ull, 0x9b05688c2b3e6c1full, 0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull
+};
+
+const uint8_t SIGMA[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}
+};
+
+uint64_t inline RotR(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+void inline G(uint64_t* v, int a, int b, int c, int d, uint64_t x, uint64_t y)
+{
+    v[a] = v[a] + v[b] + x;
+    v[d] = RotR(v[d] ^ v[a], 32);
+    v[c] = v[c] + v[d];
+    v[b] = RotR(v[b] ^ v[c], 24);
+    v[a] = v[a] + v[b] + y;
+    v[d] = RotR(v[d] ^ v[a], 16);
+    v[c] = v[c] + v[d];
+    v[b] = RotR(v[b] ^ v[c], 63);
+}
+
+/** Compress one block into h, t being the number of message bytes up to the end of the block. */
+void Compress(uint64_t* h, const unsigned char* block, uint64_t t, bool fLast)
+{
+    uint64_t m[16], v[16];
+    for (int i = 0; i < 16; i++)
+        m[i] = ReadLE64(block + 8 * i);
+    for (int i = 0; i < 8; i++) {
+        v[i] = h[i];
+        v[i + 8] = IV[i];
+    }
+    v[12] ^= t;
+    if (fLast)
+        v[14] = ~v[14];
+
+    for (int r = 0; r < 12; r++) {
+        const uint8_t* s = SIGMA[r];
+        G(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        G(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        G(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        G(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        G(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        G(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        G(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        G(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; i++)
+        h[i] ^= v[i] ^ v[i + 8];
+}
+
+/** Compress the final blocks of 4 messages sharing the state h; out receives their 4 states. */
+void Compress_4way(const uint64_t* h, uint64_t t, const unsigned char* blocks, uint64_t* out)
+{
+    for (int i = 0; i < 4; i++) {
+        memcpy(out + 8 * i, h, 8 * sizeof(uint64_t));
+        Compress(out + 8 * i, blocks + 128 * i, t, true);
+    }
+}
+
+typedef void (*Compress4Fn)(const uint64_t* h, uint64_t t, const unsigned char* blocks, uint64_t* out);
+
+Compress4Fn Compress4 = Compress_4way;
+
+bool SelfTest()
+{
+    // Check the selected 4-way compression against the standard one, on distinct blocks
+    uint64_t h[8], expected[32], out[32];
+    unsigned char blocks[4 * 128];
+    for (int i = 0; i < 8; i++)
+        h[i] = IV[i] * (i + 1);
+    for (int i = 0; i < 4 * 128; i++)
+        blocks[i] = i * 7 + 3;
+    Compress_4way(h, 1000, blocks, expected);
+    Compress4(h, 1000, blocks, out);
+    return memcmp(out, expected, sizeof(out)) == 0;
+}
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_AVX2)
+/** Check whether the OS has enabled the AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+#endif
+
+} // namespace blake2b
+} // namespace
+
+
+////// BLAKE2b of indices
+
+CBLAKE2bIndexHasher::CBLAKE2bIndexHasher(size_t outLenIn, const unsigned char personal[PERSONAL_SIZE],
+                                         const unsigned char* prefix, size_t prefixLen) :
+    tailLen(0), messageLen(prefixLen + sizeof(uint32_t)), outLen(outLenIn)
+{
+    assert(outLen > 0 && outLen <= MAX_OUTPUT_SIZE);
+
+    // Parameter block: no key, fanout and depth of 1, no salt
+    for (int i = 0; i < 8; i++)
+        h[i] = blake2b::IV[i];
+    h[0] ^= 0x01010000 ^ outLen;
+    h[6] ^= ReadLE64(personal);
+    h[7] ^= ReadLE64(personal + 8);
+
+    // Compress the whole blocks of the prefix: the index always follows them
+    uint64_t t = 0;
+    while (prefixLen >= 128) {
+        t += 128;
+        blake2b::Compress(h, prefix, t, false);
+        prefix += 128;
+        prefixLen -= 128;
+    }
+    tailLen = prefixLen;
+    memcpy(tail, prefix, tailLen);
+}
+
+void CBLAKE2bIndexHasher::Hash(const uint32_t* indices, size_t count, unsigned char* out) const
+{
+    unsigned char blocks[4 * 128];
+    if (tailLen + sizeof(uint32_t) <= 128) {
+        // Only the index differs between the final blocks
+        uint64_t states[4 * 8];
+        for (int i = 0; i < 4; i++) {
+            memcpy(blocks + 128 * i, tail, tailLen);
+            memset(blocks + 128 * i + tailLen, 0, 128 - tailLen);
+        }
+        while (count > 0) {
+            const size_t nNow = count < 4 ? count : 4;
+            for (size_t i = 0; i < nNow; i++)
+                WriteLE32(blocks + 128 * i + tailLen, indices[i]);
+            if (nNow == 4) {
+                blake2b::Compress4(h, messageLen, blocks, states);
+            } else {
+                for (size_t i = 0; i < nNow; i++) {
+                    memcpy(states + 8 * i, h, sizeof(h));
+                    blake2b::Compress(states + 8 * i, blocks + 128 * i, messageLen, true);
+                }
+            }
+            for (size_t i = 0; i < nNow; i++) {
+                unsigned char hash[MAX_OUTPUT_SIZE];
+                for (int j = 0; j < 8; j++)
+                    WriteLE64(hash + 8 * j, states[8 * i + j]);
+                memcpy(out, hash, outLen);
+                out += outLen;
+            }
+            indices += nNow;
+            count -= nNow;
+        }
+    } else {
+        // The index straddles two blocks
+        for (size_t n = 0; n < count; n++) {
+            unsigned char message[128 + sizeof(uint32_t)];
+            memcpy(message, tail, tailLen);
+            WriteLE32(message + tailLen, indices[n]);
+            memset(blocks, 0, 2 * 128);
+            memcpy(blocks, message, tailLen + sizeof(uint32_t));
+
+            uint64_t state[8];
+            memcpy(state, h, sizeof(h));
+            blake2b::Compress(state, blocks, messageLen - (tailLen + sizeof(uint32_t) - 128), false);
+            blake2b::Compress(state, blocks + 128, messageLen, true);
+            unsigned char hash[MAX_OUTPUT_SIZE];
+            for (int j = 0; j < 8; j++)
+                WriteLE64(hash + 8 * j, state[j]);
+            memcpy(out, hash, outLen);
+            out += outLen;
+        }
+    }
+}
+
+std::string BLAKE2bAutoDetect()
+{
+    std::string ret = "standard";
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_AVX2)
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        bool have_xsave = (ecx >> 27) & 1;
+        bool have_avx = (ecx >> 28) & 1;
+        if (have_xsave && have_avx && blake2b::AVXEnabled() && __get_cpuid_max(0, nullptr) >= 7) {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            if ((ebx >> 5) & 1) {
+                blake2b::Compress4 = blake2b_avx2::Compress_4way;
+                ret = "avx2(4way)";
+            }
+        }
+    }
+#endif
+#endif
+
+    assert(blake2b::SelfTest());
+    return ret;
+}
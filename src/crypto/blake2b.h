@@ -0,0 +1,46 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_BLAKE2B_H
+#define BITCOIN_CRYPTO_BLAKE2B_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/**
+ * BLAKE2b of a common prefix followed by a 32 bits little-endian index, for
+ * many indices: the way Equihash generates its leaves. The prefix is absorbed
+ * once, and the final blocks of several indices are compressed at the same
+ * time when the CPU supports it.
+ */
+class CBLAKE2bIndexHasher
+{
+public:
+    static const size_t PERSONAL_SIZE = 16;
+    static const size_t MAX_OUTPUT_SIZE = 64;
+
+    CBLAKE2bIndexHasher(size_t outLenIn, const unsigned char personal[PERSONAL_SIZE],
+                        const unsigned char* prefix, size_t prefixLen);
+
+    /** Write the outLen bytes hashes of count indices to out. */
+    void Hash(const uint32_t* indices, size_t count, unsigned char* out) const;
+
+private:
+    //! The state after the whole blocks of the prefix
+    uint64_t h[8];
+    //! The rest of the prefix, which ends up in the blocks of the indices
+    unsigned char tail[128];
+    size_t tailLen;
+    //! Total length of the hashed message, index included
+    uint64_t messageLen;
+    size_t outLen;
+};
+
+/** Autodetect the best available BLAKE2b implementation and return its name.
+ *  Not thread safe: call it once at startup, before any hashing starts.
+ */
+std::string BLAKE2bAutoDetect();
+
+#endif // BITCOIN_CRYPTO_BLAKE2B_H
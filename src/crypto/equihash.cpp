@@ -17,6 +17,7 @@
 #endif
 
 #include "compat/endian.h"
+#include "crypto/blake2b.h"
 #include "crypto/equihash.h"
 #include "util.h"
 
@@ -719,52 +720,107 @@ invalidsolution:
 }
 #endif // ENABLE_MINING
 
-template<unsigned int N, unsigned int K>
-bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln)
+template<unsigned int N, unsigned int K> template<typename LeafHasher>
+bool Equihash<N,K>::CheckSolutionTree(const unsigned char* soln, size_t solnLen, VerifyScratch& scratch,
+                                      const LeafHasher& hashLeaves)
 {
-    if (soln.size() != SolutionWidth) {
+    if (solnLen != SolutionWidth) {
         LogPrint("pow", "Invalid solution length: %d (expected %d)\n",
-                 soln.size(), SolutionWidth);
+                 solnLen, SolutionWidth);
         return false;
     }
 
-    std::vector<FullStepRow<FinalFullWidth>> X;
-    X.reserve(1 << K);
-    unsigned char tmpHash[HashOutput];
-    for (eh_index i : GetIndicesFromMinimal(soln, CollisionBitLength)) {
-        GenerateHash(base_state, i/IndicesPerHashOutput, tmpHash, HashOutput);
-        X.emplace_back(tmpHash+((i % IndicesPerHashOutput) * N/8),
-                       N/8, HashLength, CollisionBitLength, i);
+    const size_t nLeaves = 1 << K;
+    eh_index* indices = scratch.indices;
+    unsigned char (*rows)[HashLength] = scratch.rows;
+
+    // Decode the minimal encoding of the indices, reusing the rows as buffer
+    BOOST_STATIC_ASSERT(sizeof(scratch.rows) >= sizeof(scratch.indices));
+    const size_t bytePad = sizeof(eh_index) - ((CollisionBitLength+1)+7)/8;
+    unsigned char* array = reinterpret_cast<unsigned char*>(scratch.rows);
+    ExpandArray(soln, solnLen, array, nLeaves*sizeof(eh_index), CollisionBitLength+1, bytePad);
+    for (size_t i = 0; i < nLeaves; i++)
+        indices[i] = ArrayToEhIndex(array + i*sizeof(eh_index));
+
+    // Generate the leaves, a few BLAKE2b outputs at a time
+    const size_t nMaxBatch = 16;
+    const size_t nBatch = std::min(nMaxBatch, nLeaves);
+    for (size_t i = 0; i < nLeaves; i += nBatch) {
+        eh_index outputIndices[nMaxBatch];
+        unsigned char outputs[nMaxBatch][HashOutput];
+        for (size_t j = 0; j < nBatch; j++)
+            outputIndices[j] = indices[i+j] / IndicesPerHashOutput;
+        hashLeaves(outputIndices, nBatch, outputs[0]);
+        for (size_t j = 0; j < nBatch; j++) {
+            ExpandArray(outputs[j] + (indices[i+j] % IndicesPerHashOutput) * N/8, N/8,
+                        rows[i+j], HashLength, CollisionBitLength);
+        }
     }
 
-    size_t hashLen = HashLength;
-    size_t lenIndices = sizeof(eh_index);
-    while (X.size() > 1) {
-        std::vector<FullStepRow<FinalFullWidth>> Xc;
-        for (int i = 0; i < X.size(); i += 2) {
-            if (!HasCollision(X[i], X[i+1], CollisionByteLength)) {
+    // Combine the subtrees pairwise, each into the row of its first leaf: at
+    // every level the rows must collide on the next CollisionByteLength bytes
+    for (size_t level = 0, step = 1; level < K; level++, step *= 2) {
+        const size_t start = level*CollisionByteLength;
+        for (size_t i = 0; i < nLeaves; i += 2*step) {
+            unsigned char* a = rows[i];
+            const unsigned char* b = rows[i+step];
+            if (memcmp(a+start, b+start, CollisionByteLength) != 0) {
                 LogPrint("pow", "Invalid solution: invalid collision length between StepRows\n");
-                LogPrint("pow", "X[i]   = %s\n", X[i].GetHex(hashLen));
-                LogPrint("pow", "X[i+1] = %s\n", X[i+1].GetHex(hashLen));
+                LogPrint("pow", "X[i]   = %s\n", HexStr(a+start, a+HashLength));
+                LogPrint("pow", "X[i+1] = %s\n", HexStr(b+start, b+HashLength));
                 return false;
             }
-            if (X[i+1].IndicesBefore(X[i], hashLen, lenIndices)) {
+            // The first index of a subtree is the smallest of its own ones
+            if (indices[i+step] < indices[i]) {
                 LogPrint("pow", "Invalid solution: Index tree incorrectly ordered\n");
                 return false;
             }
-            if (!DistinctIndices(X[i], X[i+1], hashLen, lenIndices)) {
-                LogPrint("pow", "Invalid solution: duplicate indices\n");
-                return false;
-            }
-            Xc.emplace_back(X[i], X[i+1], hashLen, lenIndices, CollisionByteLength);
+            for (size_t j = start+CollisionByteLength; j < HashLength; j++)
+                a[j] ^= b[j];
         }
-        X = Xc;
-        hashLen -= CollisionByteLength;
-        lenIndices *= 2;
     }
 
-    assert(X.size() == 1);
-    return X[0].IsZero(hashLen);
+    // Every pair of leaves is combined at some level, so all indices must be distinct
+    std::copy(indices, indices+nLeaves, scratch.sortedIndices);
+    std::sort(scratch.sortedIndices, scratch.sortedIndices+nLeaves);
+    if (std::adjacent_find(scratch.sortedIndices, scratch.sortedIndices+nLeaves) != scratch.sortedIndices+nLeaves) {
+        LogPrint("pow", "Invalid solution: duplicate indices\n");
+        return false;
+    }
+
+    for (size_t j = K*CollisionByteLength; j < HashLength; j++) {
+        if (rows[0][j] != 0)
+            return false;
+    }
+    return true;
+}
+
+template<unsigned int N, unsigned int K>
+bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln)
+{
+    VerifyScratch scratch;
+    return CheckSolutionTree(soln.data(), soln.size(), scratch,
+        [&base_state](const eh_index* outputIndices, size_t count, unsigned char* out) {
+            for (size_t j = 0; j < count; j++)
+                GenerateHash(base_state, outputIndices[j], out + j*HashOutput, HashOutput);
+        });
+}
+
+template<unsigned int N, unsigned int K>
+bool Equihash<N,K>::IsValidSolution(const unsigned char* input, size_t inputLen,
+                                    const unsigned char* soln, size_t solnLen, VerifyScratch& scratch)
+{
+    uint32_t le_N = htole32(N);
+    uint32_t le_K = htole32(K);
+    unsigned char personalization[crypto_generichash_blake2b_PERSONALBYTES] = {};
+    memcpy(personalization, "ZcashPoW", 8);
+    memcpy(personalization+8,  &le_N, 4);
+    memcpy(personalization+12, &le_K, 4);
+    const CBLAKE2bIndexHasher hasher(HashOutput, personalization, input, inputLen);
+    return CheckSolutionTree(soln, solnLen, scratch,
+        [&hasher](const eh_index* outputIndices, size_t count, unsigned char* out) {
+            hasher.Hash(outputIndices, count, out);
+        });
 }
 
 // Explicit instantiations for Equihash<96,3>
@@ -777,7 +833,9 @@ template bool Equihash<96,3>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<96,3>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<96,3>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
+template bool Equihash<96,3>::IsValidSolution(const unsigned char* input, size_t inputLen,
+                                              const unsigned char* soln, size_t solnLen, VerifyScratch& scratch);
 
 // Explicit instantiations for Equihash<200,9>
 template int Equihash<200,9>::InitialiseState(eh_HashState& base_state);
@@ -789,7 +847,9 @@ template bool Equihash<200,9>::OptimisedSolve(const eh_HashState& base_state,
                                               const std::function<bool(std::vector<unsigned char>)> validBlock,
                                               const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
+template bool Equihash<200,9>::IsValidSolution(const unsigned char* input, size_t inputLen,
+                                               const unsigned char* soln, size_t solnLen, VerifyScratch& scratch);
 
 // Explicit instantiations for Equihash<96,5>
 template int Equihash<96,5>::InitialiseState(eh_HashState& base_state);
@@ -801,7 +861,9 @@ template bool Equihash<96,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<96,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<96,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
+template bool Equihash<96,5>::IsValidSolution(const unsigned char* input, size_t inputLen,
+                                              const unsigned char* soln, size_t solnLen, VerifyScratch& scratch);
 
 // Explicit instantiations for Equihash<48,5>
 template int Equihash<48,5>::InitialiseState(eh_HashState& base_state);
@@ -813,4 +875,6 @@ template bool Equihash<48,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
+template bool Equihash<48,5>::IsValidSolution(const unsigned char* input, size_t inputLen,
+                                              const unsigned char* soln, size_t solnLen, VerifyScratch& scratch);
@@ -190,7 +190,28 @@ public:
                         const std::function<bool(std::vector<unsigned char>)> validBlock,
                         const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-    bool IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+    /** Working memory of the solution verifier, that callers can keep on the stack or reuse */
+    struct VerifyScratch
+    {
+        eh_index indices[1 << K];
+        eh_index sortedIndices[1 << K];
+        unsigned char rows[1 << K][HashLength];
+    };
+
+    bool IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
+    /** Check the solution of the BLAKE2b input (I||V), without allocating: leaves are hashed several at a time */
+    bool IsValidSolution(const unsigned char* input, size_t inputLen,
+                         const unsigned char* soln, size_t solnLen, VerifyScratch& scratch);
+    bool IsValidSolution(const unsigned char* input, size_t inputLen, const std::vector<unsigned char>& soln)
+    {
+        VerifyScratch scratch;
+        return IsValidSolution(input, inputLen, soln.data(), soln.size(), scratch);
+    }
+
+private:
+    template<typename LeafHasher>
+    bool CheckSolutionTree(const unsigned char* soln, size_t solnLen, VerifyScratch& scratch,
+                           const LeafHasher& hashLeaves);
 };
 
 #include "equihash.tcc"
@@ -263,6 +284,19 @@ inline bool EhOptimisedSolveUncancellable(unsigned int n, unsigned int k, const
 }
 #endif // ENABLE_MINING
 
+#define EhIsValidSolutionOfInput(n, k, input, inputLen, soln, ret) \
+    if (n == 96 && k == 3) {                                       \
+        ret = Eh96_3.IsValidSolution(input, inputLen, soln);       \
+    } else if (n == 200 && k == 9) {                               \
+        ret = Eh200_9.IsValidSolution(input, inputLen, soln);      \
+    } else if (n == 96 && k == 5) {                                \
+        ret = Eh96_5.IsValidSolution(input, inputLen, soln);       \
+    } else if (n == 48 && k == 5) {                                \
+        ret = Eh48_5.IsValidSolution(input, inputLen, soln);       \
+    } else {                                                       \
+        throw std::invalid_argument("Unsupported Equihash parameters"); \
+    }
+
 #define EhIsValidSolution(n, k, base_state, soln, ret)   \
     if (n == 96 && k == 3) {                             \
         ret = Eh96_3.IsValidSolution(base_state, soln);  \
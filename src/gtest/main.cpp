@@ -1,5 +1,7 @@
 #include "gmock/gmock.h"
+#include "crypto/blake2b.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "key.h"
 #include "pubkey.h"
 #include "zcash/JoinSplit.hpp"
@@ -21,6 +23,8 @@ ZCJoinSplit* params;
 
 int main(int argc, char **argv) {
   assert(init_and_check_sodium() != -1);
+  SHA256AutoDetect();
+  BLAKE2bAutoDetect();
   ECC_Start();
 
   libsnark::default_r1cs_ppzksnark_pp::init_public_params();
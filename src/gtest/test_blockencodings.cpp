@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include "blockencodings.h"
+#include "chainparams.h"
+#include "streams.h"
+#include "txmempool.h"
+#include "version.h"
+#include <gtest/tx_creation_utils.h>
+
+class BlockEncodingsTest : public ::testing::Test
+{
+protected:
+    CBlock block;
+
+    void SetUp() override
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+
+        block.vtx.push_back(txCreationUtils::createCoinBase(CAmount(10)));
+        for (int i = 1; i <= 3; i++)
+            block.vtx.push_back(txCreationUtils::createNewSidechainTxWith(CAmount(i)));
+        for (int i = 0; i < 2; i++)
+            block.vcert.push_back(txCreationUtils::createCertificate(uint256S("aaa"), /*epochNum*/i,
+                CFieldElement{}, /*changeTotalAmount*/0, /*numChangeOut*/0, /*bwtTotalAmount*/1,
+                /*numBwt*/1, /*ftScFee*/0, /*mbtrScFee*/0));
+        block.hashMerkleRoot = block.BuildMerkleTree();
+    }
+
+    void AddTx(CTxMemPool& pool, const CTransaction& tx)
+    {
+        CTxMemPoolEntry entry(tx, /*fee*/CAmount(1), /*time*/ 1000, /*priority*/1.0, /*height*/1987);
+        pool.addUnchecked(tx.GetHash(), entry);
+    }
+
+    void AddCert(CTxMemPool& pool, const CScCertificate& cert)
+    {
+        CCertificateMemPoolEntry entry(cert, /*fee*/CAmount(1), /*time*/ 1000, /*priority*/1.0, /*height*/1987);
+        pool.addUnchecked(cert.GetHash(), entry);
+    }
+
+    // Send a compact block over the wire, as a peer would
+    CBlockHeaderAndShortTxIDs RoundTrip(const CBlockHeaderAndShortTxIDs& cmpctblock)
+    {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << cmpctblock;
+        CBlockHeaderAndShortTxIDs res;
+        stream >> res;
+        return res;
+    }
+};
+
+TEST_F(BlockEncodingsTest, EverythingInMempool)
+{
+    CTxMemPool pool(::minRelayTxFee);
+    for (size_t i = 1; i < block.vtx.size(); i++)
+        AddTx(pool, block.vtx[i]);
+    for (const CScCertificate& cert : block.vcert)
+        AddCert(pool, cert);
+
+    CBlockHeaderAndShortTxIDs cmpctblock = RoundTrip(CBlockHeaderAndShortTxIDs(block));
+
+    PartiallyDownloadedBlock partialBlock(&pool);
+    ASSERT_EQ(partialBlock.InitData(cmpctblock), READ_STATUS_OK);
+    ASSERT_EQ(partialBlock.TxCount(), block.vtx.size());
+    ASSERT_EQ(partialBlock.CertCount(), block.vcert.size());
+    for (size_t i = 0; i < partialBlock.TxCount(); i++)
+        EXPECT_TRUE(partialBlock.IsTxAvailable(i));
+    for (size_t i = 0; i < partialBlock.CertCount(); i++)
+        EXPECT_TRUE(partialBlock.IsCertAvailable(i));
+
+    CBlock rebuilt;
+    ASSERT_EQ(partialBlock.FillBlock(rebuilt, std::vector<CTransaction>(), std::vector<CScCertificate>()), READ_STATUS_OK);
+    EXPECT_EQ(rebuilt.GetHash(), block.GetHash());
+    EXPECT_EQ(rebuilt.BuildMerkleTree(), block.hashMerkleRoot);
+}
+
+TEST_F(BlockEncodingsTest, MissingTxsAndCertsAreRequested)
+{
+    // Only one tx and the last cert are known
+    CTxMemPool pool(::minRelayTxFee);
+    AddTx(pool, block.vtx[2]);
+    AddCert(pool, block.vcert[1]);
+
+    CBlockHeaderAndShortTxIDs cmpctblock = RoundTrip(CBlockHeaderAndShortTxIDs(block));
+
+    PartiallyDownloadedBlock partialBlock(&pool);
+    ASSERT_EQ(partialBlock.InitData(cmpctblock), READ_STATUS_OK);
+
+    BlockTransactionsRequest req;
+    req.blockhash = block.GetHash();
+    for (size_t i = 0; i < partialBlock.TxCount(); i++)
+        if (!partialBlock.IsTxAvailable(i))
+            req.txindexes.push_back(i);
+    for (size_t i = 0; i < partialBlock.CertCount(); i++)
+        if (!partialBlock.IsCertAvailable(i))
+            req.certindexes.push_back(i);
+
+    EXPECT_EQ(req.txindexes, std::vector<uint32_t>({1, 3}));
+    EXPECT_EQ(req.certindexes, std::vector<uint32_t>({0}));
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << req;
+    BlockTransactionsRequest reqRead;
+    stream >> reqRead;
+    EXPECT_EQ(reqRead.blockhash, req.blockhash);
+    EXPECT_EQ(reqRead.txindexes, req.txindexes);
+    EXPECT_EQ(reqRead.certindexes, req.certindexes);
+
+    BlockTransactions resp(reqRead);
+    for (size_t i = 0; i < reqRead.txindexes.size(); i++)
+        resp.txn[i] = block.vtx[reqRead.txindexes[i]];
+    for (size_t i = 0; i < reqRead.certindexes.size(); i++)
+        resp.certs[i] = block.vcert[reqRead.certindexes[i]];
+
+    CBlock rebuilt;
+    ASSERT_EQ(partialBlock.FillBlock(rebuilt, resp.txn, resp.certs), READ_STATUS_OK);
+    EXPECT_EQ(rebuilt.GetHash(), block.GetHash());
+    ASSERT_EQ(rebuilt.vtx.size(), block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size(); i++)
+        EXPECT_EQ(rebuilt.vtx[i].GetHash(), block.vtx[i].GetHash());
+    ASSERT_EQ(rebuilt.vcert.size(), block.vcert.size());
+    for (size_t i = 0; i < block.vcert.size(); i++)
+        EXPECT_EQ(rebuilt.vcert[i].GetHash(), block.vcert[i].GetHash());
+}
+
+TEST_F(BlockEncodingsTest, WrongMissingItemsAreRejected)
+{
+    CTxMemPool pool(::minRelayTxFee);
+    CBlockHeaderAndShortTxIDs cmpctblock = RoundTrip(CBlockHeaderAndShortTxIDs(block));
+
+    // Too few
+    PartiallyDownloadedBlock partialBlock(&pool);
+    ASSERT_EQ(partialBlock.InitData(cmpctblock), READ_STATUS_OK);
+    CBlock rebuilt;
+    std::vector<CTransaction> vtx(block.vtx.begin() + 1, block.vtx.end());
+    EXPECT_EQ(partialBlock.FillBlock(rebuilt, vtx, std::vector<CScCertificate>()), READ_STATUS_INVALID);
+
+    // Certificates swapped: the merkle root does not match
+    PartiallyDownloadedBlock partialBlockSwapped(&pool);
+    ASSERT_EQ(partialBlockSwapped.InitData(cmpctblock), READ_STATUS_OK);
+    std::vector<CScCertificate> vcert(block.vcert.rbegin(), block.vcert.rend());
+    EXPECT_EQ(partialBlockSwapped.FillBlock(rebuilt, vtx, vcert), READ_STATUS_FAILED);
+}
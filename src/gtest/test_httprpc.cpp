@@ -4,6 +4,7 @@
 #include "httprpc.cpp"
 #include "httpserver.h"
 
+using ::testing::Invoke;
 using ::testing::Return;
 
 class MockHTTPRequest : public HTTPRequest {
@@ -13,6 +14,9 @@ public:
     MOCK_METHOD1(GetHeader, std::pair<bool, std::string>(const std::string& hdr));
     MOCK_METHOD2(WriteHeader, void(const std::string& hdr, const std::string& value));
     MOCK_METHOD2(WriteReply, void(int nStatus, const std::string& strReply));
+    MOCK_METHOD1(StartReply, void(int nStatus));
+    MOCK_METHOD1(WriteReplyChunk, bool(std::string& strChunk));
+    MOCK_METHOD0(EndReply, void());
 
     MockHTTPRequest() : HTTPRequest(nullptr) {}
     void CleanUp() {
@@ -60,3 +64,59 @@ TEST(HTTPRPC, FailsWithBadAuth) {
     EXPECT_FALSE(HTTPReq_JSONRPC(&req, ""));
     req.CleanUp();
 }
+
+TEST(HTTPReplyStream, SmallBodyIsAPlainReply) {
+    MockHTTPRequest req;
+    EXPECT_CALL(req, StartReply(::testing::_)).Times(0);
+    EXPECT_CALL(req, WriteReply(HTTP_OK, "{\"result\":1}\n"))
+        .Times(1);
+    {
+        HTTPReplyStream stream(&req, HTTP_OK, 100);
+        stream.Buffer() += "{\"result\":1}";
+        EXPECT_TRUE(stream.Flush());
+        stream.Buffer() += "\n";
+    }
+    req.CleanUp();
+}
+
+TEST(HTTPReplyStream, LargeBodyIsChunked) {
+    MockHTTPRequest req;
+    std::string strBody;
+    EXPECT_CALL(req, StartReply(HTTP_OK)).Times(1);
+    EXPECT_CALL(req, WriteReplyChunk(::testing::_))
+        .Times(::testing::AtLeast(2))
+        .WillRepeatedly(Invoke([&strBody](std::string& strChunk) {
+            strBody += strChunk;
+            strChunk.clear();
+            return true;
+        }));
+    EXPECT_CALL(req, EndReply()).Times(1);
+    EXPECT_CALL(req, WriteReply(::testing::_, ::testing::_)).Times(0);
+
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 1000; i++)
+        arr.push_back(std::string(99, 'a' + i % 26));
+    HTTPReplyStream stream(&req, HTTP_OK, 10000);
+    arr.write(stream.Buffer(), [&stream](std::string&) { stream.Flush(); });
+    EXPECT_LT(stream.Buffer().size(), 10000U);
+    stream.End();
+    EXPECT_EQ(arr.write(), strBody);
+    req.CleanUp();
+}
+
+TEST(HTTPReplyStream, StopsWhenTheClientIsGone) {
+    MockHTTPRequest req;
+    EXPECT_CALL(req, StartReply(HTTP_OK)).Times(1);
+    EXPECT_CALL(req, WriteReplyChunk(::testing::_))
+        .Times(1)
+        .WillOnce(Return(false));
+    EXPECT_CALL(req, EndReply()).Times(1);
+
+    HTTPReplyStream stream(&req, HTTP_OK, 10);
+    stream.Buffer() += std::string(10, 'a');
+    EXPECT_FALSE(stream.Flush());
+    stream.Buffer() += std::string(10, 'b');
+    EXPECT_FALSE(stream.Flush());
+    stream.End();
+    req.CleanUp();
+}
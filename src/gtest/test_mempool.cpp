@@ -409,3 +409,37 @@ TEST(ProcessMempoolMsgTest, TxesInMempoolAreRelayed)
     EXPECT_TRUE(theNode.pushedInvList.count(CInv{MSG_TX, scTx.GetHash()}));
     EXPECT_TRUE(theNode.pushedInvList.count(CInv{MSG_TX, cert.GetHash()}));
 }
+
+TEST(ProcessMempoolMsgTest, TxesBelowPeerFeeFilterAreNotRelayed)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+
+    CTxMemPool aMempool(::minRelayTxFee);
+
+    // A tx paying 1 zat and a cert paying 1000 zat
+    CTransaction scTx = txCreationUtils::createNewSidechainTxWith(CAmount(0), /*epochLength*/0);
+    CTxMemPoolEntry scTxPoolEntry(scTx, /*fee*/CAmount(1), /*time*/ 1000, /*priority*/1.0, /*height*/1987);
+    aMempool.addUnchecked(scTxPoolEntry.GetTx().GetHash(), scTxPoolEntry);
+
+    CScCertificate cert = txCreationUtils::createCertificate(uint256S("aaa"), /*epochNum*/0,
+            CFieldElement{}, /*changeTotalAmount*/0, /*numChangeOut*/0, /*bwtTotalAmount*/0,
+            /*numBwt*/4, /*ftScFee*/0, /*mbtrScFee*/0);
+    CCertificateMemPoolEntry certPoolEntry(cert, /*fee*/CAmount(1000), /*time*/ 1000, /*priority*/1.0, /*height*/1987);
+    aMempool.addUnchecked(certPoolEntry.GetCertificate().GetHash(), certPoolEntry);
+
+    CNodeExt theNode;
+    {
+        LOCK(theNode.cs_feeFilter);
+        theNode.minFeeFilter = CFeeRate(CAmount(2), scTxPoolEntry.GetTxSize()).GetFeePerK();
+        theNode.minCertFeeFilter = CFeeRate(CAmount(1000), certPoolEntry.GetCertificateSize()).GetFeePerK();
+    }
+    uint64_t nFilteredBefore = CNode::GetTotalBytesFeeFiltered();
+
+    //test
+    ProcessMempoolMsg(aMempool, &theNode);
+
+    //Checks: certificates are filtered by their own fee rate
+    EXPECT_TRUE(theNode.pushedInvList.size() == 1) << theNode.pushedInvList.size();
+    EXPECT_TRUE(theNode.pushedInvList.count(CInv{MSG_TX, cert.GetHash()}));
+    EXPECT_TRUE(CNode::GetTotalBytesFeeFiltered() >= nFilteredBefore + scTxPoolEntry.GetTxSize());
+}
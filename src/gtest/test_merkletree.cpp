@@ -11,6 +11,7 @@
 
 #include <stdexcept>
 
+#include "random.h"
 #include "utilstrencodings.h"
 #include "version.h"
 #include "serialize.h"
@@ -299,3 +300,100 @@ TEST(merkletree, testZeroElements) {
         ASSERT_TRUE(newTree.root() == oldroot);
     }
 }
+
+static std::string SerializeWitness(const ZCTestingIncrementalWitness& witness) {
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << witness;
+    return std::string(ss.begin(), ss.end());
+}
+
+TEST(merkletree, witnessFrontierMatchesAppend) {
+    // Fill the whole testing tree with runs of leaves of every length,
+    // witnessing some of them, and check that witnesses advanced by the
+    // frontier are the same as those the leaves are appended to.
+    const size_t maxSize = 1 << INCREMENTAL_MERKLE_TREE_DEPTH_TESTING;
+    for (size_t runLength = 0; runLength <= 7; runLength++) {
+        ZCTestingIncrementalMerkleTree tree;
+        std::vector<ZCTestingIncrementalWitness> appended;
+        std::vector<ZCTestingIncrementalWitness> advanced;
+        size_t n = 0;
+        size_t run = 0;
+        while (n < maxSize) {
+            // Vary the length of the runs, empty ones included
+            size_t length = std::min((runLength + run++) % 8, maxSize - n);
+
+            ZCTestingWitnessFrontier frontier(tree);
+            for (size_t i = 0; i < length; i++, n++) {
+                uint256 leaf = GetRandHash();
+                tree.append(leaf);
+                frontier.append(leaf);
+                for (ZCTestingIncrementalWitness& witness : appended) {
+                    witness.append(leaf);
+                }
+                if ((n + run) % 3 == 0) {
+                    appended.push_back(tree.witness());
+                    advanced.push_back(tree.witness());
+                }
+            }
+            ASSERT_EQ(tree.size(), frontier.size());
+
+            for (ZCTestingIncrementalWitness& witness : advanced) {
+                frontier.advance(witness);
+            }
+            for (size_t i = 0; i < advanced.size(); i++) {
+                ASSERT_TRUE(appended[i] == advanced[i]);
+                ASSERT_EQ(SerializeWitness(appended[i]), SerializeWitness(advanced[i]));
+                ASSERT_EQ(tree.root(), advanced[i].root());
+            }
+        }
+    }
+}
+
+TEST(merkletree, witnessFrontierRejectsStaleWitness) {
+    ZCTestingIncrementalMerkleTree tree;
+    tree.append(GetRandHash());
+    ZCTestingIncrementalWitness witness = tree.witness();
+    for (int i = 0; i < 8; i++) {
+        tree.append(GetRandHash());
+    }
+
+    // The witness missed leaves the frontier doesn't have
+    ZCTestingWitnessFrontier frontier(tree);
+    frontier.append(GetRandHash());
+    EXPECT_THROW(frontier.advance(witness), std::runtime_error);
+}
+
+TEST(merkletree, witnessCopiesAreIndependent) {
+    ZCTestingIncrementalMerkleTree tree;
+    for (int i = 0; i < 5; i++) {
+        tree.append(GetRandHash());
+    }
+    ZCTestingIncrementalWitness witness = tree.witness();
+    witness.append(GetRandHash());
+    witness.append(GetRandHash());
+
+    // A copy shares the state of the witness, which must not change when
+    // either of them is appended to or advanced.
+    ZCTestingIncrementalWitness copy = witness;
+    std::string serialized = SerializeWitness(copy);
+    witness.append(GetRandHash());
+    EXPECT_EQ(serialized, SerializeWitness(copy));
+    EXPECT_FALSE(witness == copy);
+
+    ZCTestingIncrementalMerkleTree advancedTree;
+    advancedTree.append(GetRandHash());
+    ZCTestingIncrementalWitness advanced = advancedTree.witness();
+    ZCTestingWitnessFrontier frontier(advancedTree);
+    ZCTestingIncrementalWitness copyAdvanced = advanced;
+    serialized = SerializeWitness(copyAdvanced);
+    frontier.append(GetRandHash());
+    frontier.advance(advanced);
+    EXPECT_EQ(serialized, SerializeWitness(copyAdvanced));
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << witness;
+    ZCTestingIncrementalWitness deserialized;
+    ss >> deserialized;
+    EXPECT_EQ(SerializeWitness(witness), SerializeWitness(deserialized));
+    EXPECT_EQ(witness.root(), deserialized.root());
+}
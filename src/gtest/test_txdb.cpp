@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+
+#include "main.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+
+#include <future>
+
+class CoinsViewDBTest : public ::testing::Test
+{
+protected:
+    boost::filesystem::path pathTemp;
+
+    void SetUp() override
+    {
+        pathTemp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        boost::filesystem::create_directories(pathTemp);
+        mapArgs["-datadir"] = pathTemp.string();
+        ClearDatadirCache();
+    }
+
+    void TearDown() override
+    {
+        mapArgs.erase("-datadir");
+        ClearDatadirCache();
+        boost::filesystem::remove_all(pathTemp);
+    }
+
+    static CCoinsCacheEntry MakeCoins(CAmount nValue)
+    {
+        CCoinsCacheEntry entry;
+        entry.coins.nVersion = 1;
+        entry.coins.vout.resize(1);
+        entry.coins.vout[0].nValue = nValue;
+        entry.flags = CCoinsCacheEntry::DIRTY;
+        return entry;
+    }
+
+    static bool Write(CCoinsViewDB& view, CCoinsMap& mapCoins, const uint256& hashBlock)
+    {
+        CAnchorsMap mapAnchors;
+        CNullifiersMap mapNullifiers;
+        CSidechainsMap mapSidechains;
+        CSidechainEventsMap mapSidechainEvents;
+        CCswNullifiersMap mapCswNullifiers;
+        return view.BatchWrite(mapCoins, hashBlock, uint256(), mapAnchors, mapNullifiers,
+                               mapSidechains, mapSidechainEvents, mapCswNullifiers);
+    }
+};
+
+TEST_F(CoinsViewDBTest, PendingChangesAreServedUntilWritten)
+{
+    CCoinsViewDB view(1 << 20, true, true);
+    CLevelDBWrapper other(pathTemp / "other", 1 << 20, true);
+
+    uint256 txidKept = GetRandHash();
+    uint256 txidSpent = GetRandHash();
+    uint256 hashFirst = GetRandHash();
+    CCoinsMap mapCoins;
+    mapCoins[txidKept] = MakeCoins(1);
+    mapCoins[txidSpent] = MakeCoins(2);
+    ASSERT_TRUE(Write(view, mapCoins, hashFirst));
+
+    CDBBackgroundWriter writer;
+    view.SetBackgroundWriter(&writer);
+
+    // Hold the writer thread until released
+    std::promise<void> release;
+    std::shared_future<void> released(release.get_future());
+    writer.Submit(other, std::unique_ptr<CLevelDBBatch>(new CLevelDBBatch()), false,
+                  [released](bool) { released.wait(); });
+
+    uint256 txidNew = GetRandHash();
+    uint256 hashSecond = GetRandHash();
+    mapCoins[txidKept] = MakeCoins(10);
+    mapCoins[txidSpent] = MakeCoins(0);
+    mapCoins[txidSpent].coins.Clear();
+    mapCoins[txidNew] = MakeCoins(3);
+    ASSERT_TRUE(Write(view, mapCoins, hashSecond));
+    EXPECT_TRUE(mapCoins.empty());
+
+    // Nothing is on disk yet, the view answers from the pending changes
+    CCoins coins;
+    EXPECT_EQ(view.GetBestBlock(), hashSecond);
+    ASSERT_TRUE(view.GetCoins(txidKept, coins));
+    EXPECT_EQ(coins.vout[0].nValue, 10);
+    EXPECT_FALSE(view.GetCoins(txidSpent, coins));
+    EXPECT_FALSE(view.HaveCoins(txidSpent));
+    EXPECT_TRUE(view.HaveCoins(txidNew));
+    // and the memory they hold is accounted for
+    EXPECT_GT(writer.PendingMemoryUsage(), 0);
+
+    release.set_value();
+    EXPECT_TRUE(writer.Wait());
+    EXPECT_EQ(writer.PendingMemoryUsage(), 0);
+
+    // Same answers once written
+    EXPECT_EQ(view.GetBestBlock(), hashSecond);
+    ASSERT_TRUE(view.GetCoins(txidKept, coins));
+    EXPECT_EQ(coins.vout[0].nValue, 10);
+    EXPECT_FALSE(view.HaveCoins(txidSpent));
+    EXPECT_TRUE(view.HaveCoins(txidNew));
+
+    view.SetBackgroundWriter(NULL);
+}
+
+TEST_F(CoinsViewDBTest, PerOutputLayoutUpgrade)
+{
+    CCoinsViewDB view(1 << 20, true, true);
+    ASSERT_FALSE(view.IsPerOutputLayout());
+
+    uint256 txid = GetRandHash();
+    uint256 certid = GetRandHash();
+    uint256 hashBlock = GetRandHash();
+    CCoinsMap mapCoins;
+    mapCoins[txid] = MakeCoins(1);
+    mapCoins[txid].coins.vout.resize(12);
+    for (unsigned int i = 1; i < 12; i++)
+        mapCoins[txid].coins.vout[i].nValue = i + 1;
+    mapCoins[certid] = MakeCoins(5);
+    mapCoins[certid].coins.nVersion = SC_CERT_VERSION;
+    mapCoins[certid].coins.vout.resize(3);
+    mapCoins[certid].coins.vout[2].nValue = 6;
+    mapCoins[certid].coins.nFirstBwtPos = 1;
+    mapCoins[certid].coins.nBwtMaturityHeight = 100;
+    ASSERT_TRUE(Write(view, mapCoins, hashBlock));
+
+    // as read from the record layout
+    CCoins txCoins, certCoins;
+    ASSERT_TRUE(view.GetCoins(txid, txCoins));
+    ASSERT_TRUE(view.GetCoins(certid, certCoins));
+
+    CBlockIndex index;
+    index.nHeight = 7;
+    mapBlockIndex[hashBlock] = &index;
+
+    CCoinsStats statsBefore;
+    ASSERT_TRUE(view.GetStats(statsBefore));
+
+    ASSERT_TRUE(view.UpgradeToPerOutputLayout());
+    EXPECT_TRUE(view.IsPerOutputLayout());
+
+    // Same coins, same statistics
+    CCoins coins;
+    ASSERT_TRUE(view.GetCoins(txid, coins));
+    EXPECT_TRUE(coins == txCoins);
+    ASSERT_TRUE(view.GetCoins(certid, coins));
+    EXPECT_TRUE(coins == certCoins);
+    EXPECT_EQ(coins.nFirstBwtPos, 1);
+    EXPECT_EQ(coins.nBwtMaturityHeight, 100);
+
+    CCoinsStats statsAfter;
+    ASSERT_TRUE(view.GetStats(statsAfter));
+    EXPECT_EQ(statsAfter.hashSerialized, statsBefore.hashSerialized);
+    EXPECT_EQ(statsAfter.nTransactionOutputs, 14u);
+    EXPECT_EQ(statsAfter.nTotalAmount, statsBefore.nTotalAmount);
+
+    // Spending some outputs, the others are left alone. Like in a cache, the entries tell what is on disk.
+    CCoinsCacheEntry txEntry, certEntry;
+    txEntry.coins = txCoins;
+    txEntry.SetBaseAvail();
+    certEntry.coins = certCoins;
+    certEntry.SetBaseAvail();
+    txCoins.Spend(3);
+    txCoins.Spend(11);
+    txEntry.coins = txCoins;
+    txEntry.flags = CCoinsCacheEntry::DIRTY;
+    mapCoins[txid] = txEntry;
+    ASSERT_TRUE(Write(view, mapCoins, hashBlock));
+    ASSERT_TRUE(view.GetCoins(txid, coins));
+    EXPECT_TRUE(coins == txCoins);
+    EXPECT_EQ(coins.vout.size(), 11u);
+
+    // Spending all of them removes the coins
+    certCoins.Clear();
+    certEntry.coins = certCoins;
+    certEntry.flags = CCoinsCacheEntry::DIRTY;
+    mapCoins[certid] = certEntry;
+    ASSERT_TRUE(Write(view, mapCoins, hashBlock));
+    EXPECT_FALSE(view.HaveCoins(certid));
+    EXPECT_FALSE(view.GetCoins(certid, coins));
+    EXPECT_TRUE(view.HaveCoins(txid));
+
+    mapBlockIndex.erase(hashBlock);
+}
+
+TEST_F(CoinsViewDBTest, PerOutputLayoutFromCache)
+{
+    CCoinsViewDB view(1 << 20, true, true);
+    ASSERT_TRUE(view.UpgradeToPerOutputLayout());
+
+    // more outputs than the cache entries keep track of
+    uint256 txid = GetRandHash();
+    CCoinsViewCache cache(&view);
+    {
+        CCoinsModifier modifier = cache.ModifyCoins(txid);
+        modifier->nVersion = 1;
+        modifier->vout.resize(CCoinsCacheEntry::BASE_AVAIL_OUTPUTS + 6);
+        for (unsigned int i = 0; i < modifier->vout.size(); i++)
+            modifier->vout[i].nValue = i + 1;
+    }
+    cache.SetBestBlock(GetRandHash());
+    ASSERT_TRUE(cache.Sync());
+
+    // spent on either side of the tracked outputs, and at the end
+    std::vector<unsigned int> vSpent = {3, CCoinsCacheEntry::BASE_AVAIL_OUTPUTS + 1, CCoinsCacheEntry::BASE_AVAIL_OUTPUTS + 4,
+                                        CCoinsCacheEntry::BASE_AVAIL_OUTPUTS + 5};
+    for (unsigned int nPos : vSpent) {
+        CCoinsModifier modifier = cache.ModifyCoins(txid);
+        modifier->Spend(nPos);
+    }
+    CCoins coinsExpected;
+    ASSERT_TRUE(cache.GetCoins(txid, coinsExpected));
+    ASSERT_TRUE(cache.Sync());
+
+    CCoins coins;
+    ASSERT_TRUE(view.GetCoins(txid, coins));
+    EXPECT_TRUE(coins == coinsExpected);
+    EXPECT_EQ(coins.vout.size(), CCoinsCacheEntry::BASE_AVAIL_OUTPUTS + 4);
+
+    // once evicted and read back, the entry still knows what is on disk
+    cache.Trim(0);
+    {
+        CCoinsModifier modifier = cache.ModifyCoins(txid);
+        modifier->Spend(0);
+        modifier->Spend(CCoinsCacheEntry::BASE_AVAIL_OUTPUTS + 3);
+    }
+    ASSERT_TRUE(cache.GetCoins(txid, coinsExpected));
+    ASSERT_TRUE(cache.Flush());
+    ASSERT_TRUE(view.GetCoins(txid, coins));
+    EXPECT_TRUE(coins == coinsExpected);
+}
+
+TEST_F(CoinsViewDBTest, SyncDoesNotWaitForTheWriter)
+{
+    CCoinsViewDB view(1 << 20, true, true);
+    CLevelDBWrapper other(pathTemp / "other", 1 << 20, true);
+
+    CDBBackgroundWriter writer;
+    view.SetBackgroundWriter(&writer);
+
+    std::promise<void> release;
+    std::shared_future<void> released(release.get_future());
+    writer.Submit(other, std::unique_ptr<CLevelDBBatch>(new CLevelDBBatch()), false,
+                  [released](bool) { released.wait(); });
+
+    uint256 txid = GetRandHash();
+    uint256 hashBlock = GetRandHash();
+    {
+        CCoinsViewCache cache(&view);
+        {
+            CCoinsModifier modifier = cache.ModifyCoins(txid);
+            modifier->nVersion = 1;
+            modifier->vout.resize(1);
+            modifier->vout[0].nValue = 5;
+        }
+        cache.SetBestBlock(hashBlock);
+
+        // returns with the writer still held, the entry stays in the cache
+        ASSERT_TRUE(cache.Sync());
+        EXPECT_EQ(cache.GetCacheSize(), 1);
+    }
+
+    // the cache is gone, the view answers from its copy of the dirty entries
+    CCoins coins;
+    EXPECT_EQ(view.GetBestBlock(), hashBlock);
+    ASSERT_TRUE(view.GetCoins(txid, coins));
+    EXPECT_EQ(coins.vout[0].nValue, 5);
+    EXPECT_GT(writer.PendingMemoryUsage(), 0);
+
+    release.set_value();
+    EXPECT_TRUE(writer.Wait());
+    ASSERT_TRUE(view.GetCoins(txid, coins));
+    EXPECT_EQ(coins.vout[0].nValue, 5);
+
+    view.SetBackgroundWriter(NULL);
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "primitives/transaction.h"
+#include "validationinterface.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class RecordingSubscriber : public CValidationInterface
+{
+public:
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::vector<int> heights;
+    bool fBlocked = false;
+    bool fEntered = false;
+
+    void Release()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        fBlocked = false;
+        cond.notify_all();
+    }
+
+    void WaitEntered()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cond.wait(lock, [this] { return fEntered; });
+    }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindex) override
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        fEntered = true;
+        cond.notify_all();
+        cond.wait(lock, [this] { return !fBlocked; });
+        heights.push_back(pindex->nHeight);
+    }
+};
+
+TEST(AsyncValidationInterface, DeliversInOrder) {
+    RecordingSubscriber subscriber;
+    std::vector<CBlockIndex> indexes(50);
+    {
+        CAsyncValidationInterface async("test", &subscriber, 5, NotificationQueuePolicy::BLOCK);
+        RegisterValidationInterface(&async);
+        for (size_t i = 0; i < indexes.size(); i++) {
+            indexes[i].nHeight = i;
+            GetMainSignals().UpdatedBlockTip(&indexes[i]);
+        }
+        UnregisterValidationInterface(&async);
+        async.Stop();
+
+        CAsyncValidationInterface::Stats stats = async.GetStats();
+        EXPECT_EQ(indexes.size(), stats.nProcessed);
+        EXPECT_EQ(0, stats.nDropped);
+        EXPECT_EQ(0, stats.queueSize);
+    }
+
+    ASSERT_EQ(indexes.size(), subscriber.heights.size());
+    for (size_t i = 0; i < indexes.size(); i++)
+        EXPECT_EQ(i, subscriber.heights[i]);
+}
+
+TEST(AsyncValidationInterface, DropsWhenFull) {
+    RecordingSubscriber subscriber;
+    subscriber.fBlocked = true;
+    std::vector<CBlockIndex> indexes(3);
+    for (size_t i = 0; i < indexes.size(); i++)
+        indexes[i].nHeight = i;
+
+    CAsyncValidationInterface async("test", &subscriber, 1, NotificationQueuePolicy::DROP);
+    RegisterValidationInterface(&async);
+
+    // the first notification is being delivered, the second one waits in the queue
+    GetMainSignals().UpdatedBlockTip(&indexes[0]);
+    subscriber.WaitEntered();
+    GetMainSignals().UpdatedBlockTip(&indexes[1]);
+    // and there is no room left for the third one
+    GetMainSignals().UpdatedBlockTip(&indexes[2]);
+    EXPECT_EQ(1, async.GetStats().nDropped);
+
+    subscriber.Release();
+    UnregisterValidationInterface(&async);
+    async.Stop();
+
+    EXPECT_EQ(2, async.GetStats().nProcessed);
+    ASSERT_EQ(2, subscriber.heights.size());
+    EXPECT_EQ(0, subscriber.heights[0]);
+    EXPECT_EQ(1, subscriber.heights[1]);
+}
+
+TEST(AsyncValidationInterface, NeverBlocksOnTransactions) {
+    RecordingSubscriber subscriber;
+    subscriber.fBlocked = true;
+    std::vector<CBlockIndex> indexes(2);
+    for (size_t i = 0; i < indexes.size(); i++)
+        indexes[i].nHeight = i;
+
+    CAsyncValidationInterface async("test", &subscriber, 1, NotificationQueuePolicy::BLOCK);
+    RegisterValidationInterface(&async);
+
+    GetMainSignals().UpdatedBlockTip(&indexes[0]);
+    subscriber.WaitEntered();
+    GetMainSignals().UpdatedBlockTip(&indexes[1]);
+    // signalled with cs_main held, it must not wait for the subscriber nor be lost
+    GetMainSignals().SyncTransaction(CTransaction(), NULL);
+    EXPECT_EQ(0, async.GetStats().nDropped);
+    EXPECT_EQ(2, async.GetStats().queueSize);
+
+    subscriber.Release();
+    UnregisterValidationInterface(&async);
+    async.Stop();
+
+    EXPECT_EQ(3, async.GetStats().nProcessed);
+    EXPECT_EQ(0, async.GetStats().nDropped);
+}
+
+TEST(AsyncValidationInterface, StopsWithSlowSubscriber) {
+    RecordingSubscriber subscriber;
+    subscriber.fBlocked = true;
+    std::vector<CBlockIndex> indexes(2);
+    for (size_t i = 0; i < indexes.size(); i++)
+        indexes[i].nHeight = i;
+
+    CAsyncValidationInterface async("test", &subscriber, 1, NotificationQueuePolicy::DROP);
+    RegisterValidationInterface(&async);
+
+    GetMainSignals().UpdatedBlockTip(&indexes[0]);
+    subscriber.WaitEntered();
+    GetMainSignals().UpdatedBlockTip(&indexes[1]);
+
+    UnregisterValidationInterface(&async);
+    std::thread releaser([&subscriber] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        subscriber.Release();
+    });
+    async.Stop(50);
+    releaser.join();
+
+    // the queued notification was discarded, Stop waited for the one being delivered
+    CAsyncValidationInterface::Stats stats = async.GetStats();
+    EXPECT_EQ(0, stats.queueSize);
+    EXPECT_EQ(1, stats.nDropped);
+    EXPECT_EQ(1, stats.nProcessed);
+    ASSERT_EQ(1, subscriber.heights.size());
+    EXPECT_EQ(0, subscriber.heights[0]);
+}
@@ -166,6 +166,9 @@ unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char
 
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64]);
 
+/** SipHash-2-4 of a 256-bit value, keyed with (k0, k1) */
+uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
+
 struct ObjectHasher
 {
     size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
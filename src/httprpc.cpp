@@ -129,12 +129,18 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 
             UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
 
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            // Send reply, serialized while it is sent as it can be huge
+            UniValue reply = JSONRPCReplyObj(std::move(result), NullUniValue, jreq.id);
+            req->WriteHeader("Content-Type", "application/json");
+            HTTPReplyStream stream(req, HTTP_OK);
+            reply.write(stream.Buffer(), [&stream](std::string&) { stream.Flush(); });
+            stream.Buffer() += "\n";
+            stream.End();
+            return true;
 
         // array of requests
         } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
+            strReply = JSONRPCExecBatch(valRequest.get_array(), &PostHTTPWork);
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
@@ -12,6 +12,7 @@
 #include "sync.h"
 #include "ui_interface.h"
 
+#include <atomic>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,6 +23,7 @@
 
 #include <event2/event.h>
 #include <event2/http.h>
+#include <event2/http_struct.h>
 #include <event2/thread.h>
 #include <event2/buffer.h>
 #include <event2/util.h>
@@ -58,6 +60,22 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Work item running a function on behalf of a request being handled */
+class HTTPWorkFunction : public HTTPClosure
+{
+public:
+    HTTPWorkFunction(const boost::function<void()>& func): func(func)
+    {
+    }
+    void operator()()
+    {
+        func();
+    }
+
+private:
+    boost::function<void()> func;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -187,6 +205,21 @@ static WorkQueue<HTTPClosure>* workQueue = 0;
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
 std::vector<evhttp_bound_socket *> boundSockets;
+//! Set by InterruptHTTPServer, so that chunked replies stop waiting for their clients
+static std::atomic<bool> fHTTPInterrupted(false);
+
+/** State of a chunked reply, shared by the worker producing it and the http thread sending it */
+struct HTTPReplyChunks
+{
+    CWaitableCriticalSection cs;
+    CConditionVariable cond;
+    //! Bytes handed to the http thread since the connection last drained its output
+    size_t nQueued;
+    //! The connection went away: the request must not be touched anymore
+    bool fClosed;
+
+    HTTPReplyChunks() : nQueued(0), fClosed(false) {}
+};
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr)
@@ -444,6 +477,7 @@ boost::thread threadHTTP;
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
+    fHTTPInterrupted = false;
     int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
     LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     threadHTTP = boost::thread(boost::bind(&ThreadHTTP, eventBase, eventHTTP));
@@ -458,6 +492,7 @@ bool StartHTTPServer()
 void InterruptHTTPServer()
 {
     LogPrint("http", "Interrupting HTTP server\n");
+    fHTTPInterrupted = true;
     if (eventHTTP) {
         // Unlisten sockets
         BOOST_FOREACH (evhttp_bound_socket *socket, boundSockets) {
@@ -510,6 +545,17 @@ struct event_base* EventBase()
     return eventBase;
 }
 
+bool PostHTTPWork(const boost::function<void()>& func)
+{
+    if (!workQueue)
+        return false;
+    std::unique_ptr<HTTPWorkFunction> item(new HTTPWorkFunction(func));
+    if (!workQueue->Enqueue(item.get()))
+        return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
 {
     // Static handler: simply call inner handler
@@ -545,7 +591,10 @@ HTTPRequest::~HTTPRequest()
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
-        WriteReply(HTTP_INTERNAL, "Unhandled request");
+        if (chunks)
+            EndReply(); // too late for an error status
+        else
+            WriteReply(HTTP_INTERNAL, "Unhandled request");
     }
     // evhttpd cleans up the request, as long as a reply was sent.
 }
@@ -607,6 +656,128 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+/** Called by libevent when the output of a chunked reply has been written out */
+static void http_reply_chunk_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPReplyChunks* chunks = (HTTPReplyChunks*)arg;
+    boost::unique_lock<boost::mutex> lock(chunks->cs);
+    chunks->nQueued = 0;
+    chunks->cond.notify_all();
+}
+
+/** Called by libevent when the connection of a chunked reply is closed, before freeing its requests */
+static void http_reply_close_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPReplyChunks* chunks = (HTTPReplyChunks*)arg;
+    boost::unique_lock<boost::mutex> lock(chunks->cs);
+    chunks->fClosed = true;
+    chunks->cond.notify_all();
+}
+
+static void http_reply_start(struct evhttp_request* req, int nStatus, std::shared_ptr<HTTPReplyChunks> chunks)
+{
+    // Without chunked transfer encoding, the end of the body is the end of the connection
+    if (req->major == 1 && req->minor == 0)
+        evhttp_add_header(evhttp_request_get_output_headers(req), "Connection", "close");
+    evhttp_connection_set_closecb(evhttp_request_get_connection(req), http_reply_close_cb, chunks.get());
+    evhttp_send_reply_start(req, nStatus, NULL);
+}
+
+static void http_reply_chunk(struct evhttp_request* req, struct evbuffer* evb, std::shared_ptr<HTTPReplyChunks> chunks)
+{
+    if (!chunks->fClosed)
+        evhttp_send_reply_chunk_with_cb(req, evb, http_reply_chunk_cb, chunks.get());
+    evbuffer_free(evb);
+}
+
+static void http_reply_end(struct evhttp_request* req, std::shared_ptr<HTTPReplyChunks> chunks)
+{
+    // The callbacks refer to chunks, which goes away with this closure
+    if (!chunks->fClosed) {
+        evhttp_connection_set_closecb(evhttp_request_get_connection(req), NULL, NULL);
+        evhttp_send_reply_end(req);
+    }
+}
+
+void HTTPRequest::StartReply(int nStatus)
+{
+    assert(!replySent && req && !chunks);
+    chunks = std::make_shared<HTTPReplyChunks>();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_reply_start, req, nStatus, chunks));
+    ev->trigger(0);
+}
+
+bool HTTPRequest::WriteReplyChunk(std::string& strChunk)
+{
+    assert(!replySent && req && chunks);
+    {
+        boost::unique_lock<boost::mutex> lock(chunks->cs);
+        while (!chunks->fClosed && !fHTTPInterrupted &&
+               chunks->nQueued >= MAX_HTTP_REPLY_BUFFERS_QUEUED * DEFAULT_HTTP_REPLY_BUFFER) {
+            chunks->cond.timed_wait(lock, boost::posix_time::milliseconds(100));
+        }
+        if (chunks->fClosed || fHTTPInterrupted)
+            return false;
+        chunks->nQueued += strChunk.size();
+    }
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    strChunk.clear();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_reply_chunk, req, evb, chunks));
+    ev->trigger(0);
+    return true;
+}
+
+void HTTPRequest::EndReply()
+{
+    assert(!replySent && req && chunks);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_reply_end, req, chunks));
+    ev->trigger(0);
+    chunks.reset();
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
+HTTPReplyStream::HTTPReplyStream(HTTPRequest* req, int nStatus, size_t nBufferSize) :
+    req(req), nStatus(nStatus), nBufferSize(nBufferSize), fStarted(false), fOpen(true), fEnded(false)
+{
+    buffer.reserve(nBufferSize);
+}
+
+HTTPReplyStream::~HTTPReplyStream()
+{
+    if (!fEnded)
+        End();
+}
+
+bool HTTPReplyStream::Flush()
+{
+    if (buffer.size() < nBufferSize)
+        return fOpen;
+    if (!fStarted) {
+        req->StartReply(nStatus);
+        fStarted = true;
+    }
+    if (fOpen)
+        fOpen = req->WriteReplyChunk(buffer);
+    buffer.clear();
+    return fOpen;
+}
+
+void HTTPReplyStream::End()
+{
+    assert(!fEnded);
+    fEnded = true;
+    if (!fStarted) {
+        req->WriteReply(nStatus, buffer);
+        return;
+    }
+    if (fOpen && !buffer.empty())
+        req->WriteReplyChunk(buffer);
+    req->EndReply();
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <memory>
 #include <string>
 #include <stdint.h>
 #include <boost/thread.hpp>
@@ -14,11 +15,16 @@
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+/** Size of the buffer of a reply produced in pieces, above which it is sent in chunks */
+static const size_t DEFAULT_HTTP_REPLY_BUFFER=256 * 1024;
+/** How many buffers of a chunked reply may wait for the client before the producer blocks */
+static const size_t MAX_HTTP_REPLY_BUFFERS_QUEUED=4;
 
 struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPReplyChunks;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -49,6 +55,13 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Queue a function to run on the HTTP worker threads, e.g. to split up the
+ * work of a request. Returns false if the work queue is full or stopped: the
+ * function is then not run. A queued function may also be dropped without
+ * running at shutdown.
+ */
+bool PostHTTPWork(const boost::function<void()>& func);
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -115,6 +128,62 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     virtual void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a reply whose body is then sent in pieces with WriteReplyChunk,
+     * using chunked transfer encoding for HTTP/1.1 clients.
+     *
+     * @note call WriteHeader before, and EndReply once the body is complete.
+     */
+    virtual void StartReply(int nStatus);
+
+    /**
+     * Send a piece of the body of a reply started with StartReply, and clear
+     * strChunk. Blocks while too much of the body waits for the client.
+     * Returns false when the client is gone or the server is shutting down:
+     * stop producing the body then, but still call EndReply.
+     */
+    virtual bool WriteReplyChunk(std::string& strChunk);
+
+    /**
+     * Terminate a reply started with StartReply.
+     *
+     * @note Same as WriteReply, do not call any other HTTPRequest methods
+     * after calling this.
+     */
+    virtual void EndReply();
+
+private:
+    std::shared_ptr<HTTPReplyChunks> chunks;
+};
+
+/** Body of a reply produced in pieces, written to Buffer() and passed on by
+ * Flush(). A body which fits in the buffer is sent as a plain reply; a larger
+ * one is sent in chunks while it is produced, so that neither the producer
+ * nor the server ever holds all of it.
+ */
+class HTTPReplyStream
+{
+public:
+    HTTPReplyStream(HTTPRequest* req, int nStatus, size_t nBufferSize = DEFAULT_HTTP_REPLY_BUFFER);
+    ~HTTPReplyStream();
+
+    std::string& Buffer() { return buffer; }
+
+    /** Send the buffer if it is full. Returns false once the client is gone. */
+    bool Flush();
+
+    /** Send what is left and terminate the reply. Called by the destructor if needed. */
+    void End();
+
+private:
+    HTTPRequest* req;
+    int nStatus;
+    size_t nBufferSize;
+    std::string buffer;
+    bool fStarted;
+    bool fOpen;
+    bool fEnded;
 };
 
 /** Event handler closure.
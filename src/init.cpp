@@ -9,11 +9,14 @@
 
 #include "init.h"
 #include "crypto/common.h"
+#include "crypto/blake2b.h"
+#include "crypto/sha256.h"
 #include "addrman.h"
 #include "amount.h"
 #ifdef ENABLE_MINING
 #include "base58.h"
 #endif
+#include "blockfilemap.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
@@ -25,6 +28,7 @@
 #include "miner.h"
 #include "net.h"
 #include "rpc/server.h"
+#include "script/sigcache.h"
 #include "script/standard.h"
 #include "scheduler.h"
 #include "txdb.h"
@@ -83,10 +87,12 @@ bool fFeeEstimatesInitialized = false;
 
 #if ENABLE_ZMQ
 static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
+static CAsyncValidationInterface* pzmqAsyncNotificationInterface = NULL;
 #endif
 
 #if ENABLE_PROTON
 static AMQPNotificationInterface* pAMQPNotificationInterface = NULL;
+static CAsyncValidationInterface* pAMQPAsyncNotificationInterface = NULL;
 #endif
 
 #ifdef WIN32
@@ -233,6 +239,9 @@ void Shutdown()
         }
         delete pcoinsTip;
         pcoinsTip = NULL;
+        // Pending writes are completed before the databases go away
+        delete pdbwriter;
+        pdbwriter = NULL;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
         delete pcoinsdbview;
@@ -246,6 +255,12 @@ void Shutdown()
 #endif
 
 #if ENABLE_ZMQ
+    if (pzmqAsyncNotificationInterface) {
+        UnregisterValidationInterface(pzmqAsyncNotificationInterface);
+        delete pzmqAsyncNotificationInterface;
+        pzmqAsyncNotificationInterface = NULL;
+    }
+
     if (pzmqNotificationInterface) {
         UnregisterValidationInterface(pzmqNotificationInterface);
         delete pzmqNotificationInterface;
@@ -254,6 +269,12 @@ void Shutdown()
 #endif
 
 #if ENABLE_PROTON
+    if (pAMQPAsyncNotificationInterface) {
+        UnregisterValidationInterface(pAMQPAsyncNotificationInterface);
+        delete pAMQPAsyncNotificationInterface;
+        pAMQPAsyncNotificationInterface = NULL;
+    }
+
     if (pAMQPNotificationInterface) {
         UnregisterValidationInterface(pAMQPNotificationInterface);
         delete pAMQPNotificationInterface;
@@ -344,6 +365,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("This help message"));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-blockfilemaps=<n>", strprintf(_("Keep up to <n> block and undo files memory-mapped to read historical blocks (0 to disable, default: %u)"), DEFAULT_BLOCKFILE_MAPS));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), 288));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), 3));
@@ -359,6 +381,8 @@ std::string HelpMessage(HelpMessageMode mode)
         FormatVersion(CLIENT_VERSION)));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbbackgroundwrite", strprintf(_("Write the block index and the chain state to disk from a dedicated thread; the changes being written are counted against -dbcache (default: %u)"), DEFAULT_DB_BACKGROUND_WRITE));
+    strUsage += HelpMessageOpt("-coinsperoutput", strprintf(_("Store the chain state with one record per unspent output, converting the existing one at startup (-reindex is needed to go back) (default: %u)"), DEFAULT_COINS_PER_OUTPUT));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
@@ -392,11 +416,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-banscore=<n>", strprintf(_("Threshold for disconnecting misbehaving peers (default: %u)"), 100));
     strUsage += HelpMessageOpt("-bantime=<n>", strprintf(_("Number of seconds to keep misbehaving peers from reconnecting (default: %u)"), 86400));
     strUsage += HelpMessageOpt("-bind=<addr>", _("Bind to given address and always listen on it. Use [host]:port notation for IPv6"));
+    strUsage += HelpMessageOpt("-compactblocks", strprintf(_("Download new blocks from peers as compact blocks, rebuilt from the mempool (default: %u)"), DEFAULT_COMPACT_BLOCKS));
     strUsage += HelpMessageOpt("-connect=<ip>", _("Connect only to the specified node(s)"));
     strUsage += HelpMessageOpt("-discover", _("Discover own IP addresses (default: 1 when listening and no -externalip or -proxy)"));
     strUsage += HelpMessageOpt("-dns", _("Allow DNS lookups for -addnode, -seednode and -connect") + " " + _("(default: 1)"));
     strUsage += HelpMessageOpt("-dnsseed", _("Query for peer addresses via DNS lookup, if low on addresses (default: 1 unless -connect)"));
     strUsage += HelpMessageOpt("-externalip=<ip>", _("Specify your own public address"));
+    strUsage += HelpMessageOpt("-feefilter", strprintf(_("Tell peers the minimum fee rate of the transactions and certificates to announce to us (default: %u)"), DEFAULT_FEEFILTER));
     strUsage += HelpMessageOpt("-forcednsseed", strprintf(_("Always query for peer addresses via DNS lookup (default: %u)"), 0));
     strUsage += HelpMessageOpt("-listen", _("Accept connections from outside (default: 1 if no -proxy or -connect)"));
     strUsage += HelpMessageOpt("-listenonion", strprintf(_("Automatically create Tor hidden service (default: %d)"), DEFAULT_LISTEN_ONION));
@@ -422,6 +448,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-websocket=<0 or 1>", _("If set to 1 opens a websocket channel listening for client connections (default: 0)"));
     strUsage += HelpMessageOpt("-wsaddress=<ip address>", _("If websocket=1, listen for ws connections at this ip address (default: 127.0.0.1)"));
     strUsage += HelpMessageOpt("-wsport=<port>", _("If websocket=1, listen for ws connections at <wsaddress>:<wsport> (default: 8888)"));
+    strUsage += HelpMessageOpt("-wsqueuesize=<n>", strprintf(_("If websocket=1, deliver tip updates from a queue of up to <n> entries on a dedicated thread, 0 to deliver them synchronously (default: %u)"), DEFAULT_NOTIFICATION_QUEUE_SIZE));
+    strUsage += HelpMessageOpt("-wsqueuepolicy=<policy>", strprintf(_("If websocket=1, what to do with notifications when the queue is full: block (lose none), drop (default: %s)"), DEFAULT_NOTIFICATION_QUEUE_POLICY));
 #ifdef USE_UPNP
 #if USE_UPNP
     strUsage += HelpMessageOpt("-upnp", _("Use UPnP to map the listening port (default: 1 when listening and no -proxy)"));
@@ -436,6 +464,7 @@ std::string HelpMessage(HelpMessageMode mode)
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(_("Wallet options:"));
     strUsage += HelpMessageOpt("-disablewallet", _("Do not load the wallet and disable wallet RPC calls"));
+    strUsage += HelpMessageOpt("-joinsplitprovers=<n>", strprintf(_("Number of JoinSplit proofs z_sendmany generates at once, at most one per core (default: %u)"), DEFAULT_JOINSPLIT_PROVERS));
     strUsage += HelpMessageOpt("-keypool=<n>", strprintf(_("Set key pool size to <n> (default: %u)"), 100));
     if (showDebug)
         strUsage += HelpMessageOpt("-mintxfee=<amt>", strprintf("Fees (in %s/kB) smaller than this are considered zero fee for transaction creation (default: %s)",
@@ -463,6 +492,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubhashcert=<address>", _("Enable publish hash certificate in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawcert=<address>", _("Enable publish raw certificate in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubscevent=<address>", _("Enable publish sidechain certificate status events (backward transfers on/off, ceasing) in <address>"));
+    strUsage += HelpMessageOpt("-zmq<topic>scid=<scid>", _("Only publish certificates and sidechain events of sidechain <scid> on <topic> (pubhashcert, pubrawcert, pubscevent). Can be specified multiple times"));
+    strUsage += HelpMessageOpt("-zmqqueuesize=<n>", strprintf(_("Deliver ZeroMQ notifications from a queue of up to <n> entries on a dedicated thread, 0 to deliver them synchronously (default: %u)"), DEFAULT_NOTIFICATION_QUEUE_SIZE));
+    strUsage += HelpMessageOpt("-zmqqueuepolicy=<policy>", strprintf(_("What to do with ZeroMQ notifications when the queue is full: block (lose none), drop (default: %s)"), DEFAULT_NOTIFICATION_QUEUE_POLICY));
 #endif
 
 #if ENABLE_PROTON
@@ -471,6 +506,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-amqppubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-amqppubhashcert=<address>", _("Enable publish hash certificate in <address>"));
+    strUsage += HelpMessageOpt("-amqppubrawcert=<address>", _("Enable publish raw certificate in <address>"));
+    strUsage += HelpMessageOpt("-amqppubscevent=<address>", _("Enable publish sidechain certificate status events (backward transfers on/off, ceasing) in <address>"));
+    strUsage += HelpMessageOpt("-amqp<topic>scid=<scid>", _("Only publish certificates and sidechain events of sidechain <scid> on <topic> (pubhashcert, pubrawcert, pubscevent). Can be specified multiple times"));
+    strUsage += HelpMessageOpt("-amqpqueuesize=<n>", strprintf(_("Deliver AMQP notifications from a queue of up to <n> entries on a dedicated thread, 0 to deliver them synchronously (default: %u)"), DEFAULT_NOTIFICATION_QUEUE_SIZE));
+    strUsage += HelpMessageOpt("-amqpqueuepolicy=<policy>", strprintf(_("What to do with AMQP notifications when the queue is full: block (lose none), drop (default: %s)"), DEFAULT_NOTIFICATION_QUEUE_POLICY));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -485,7 +526,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-flushwallet", strprintf("Run a thread to flush wallet periodically (default: %u)", 1));
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", 0));
     }
-    string debugCategories = "addrman, alert, bench, cert, coindb, db, estimatefee, fork, http, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
+    string debugCategories = "addrman, alert, bench, cert, cmpctblock, coindb, db, estimatefee, fork, http, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
                              "rand, reindex, rpc, sc, selectcoins, tor, ws, zendoo_mc_cryptolib, zmq, zrpc, zrpcunsafe (implies zrpc)"; // Don't translate these
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
         _("If <category> is not supplied or if <category> = 1, output all debugging information.") + " " + _("<category> can be:") + " " + debugCategories + ".");
@@ -498,7 +539,7 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", 0));
-        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> entries (default: %u)", 50000));
+        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> entries, 0 to disable it (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying (default: %s)"),
         CURRENCY_UNIT, FormatMoney(::minRelayTxFee.GetFeePerK())));
@@ -595,6 +636,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
     if (showDebug) {
+        strUsage += HelpMessageOpt("-rpcbatchconcurrency=<n>", strprintf("Set the number of threads running the read-only calls of a JSON-RPC batch together (default: %d)", DEFAULT_RPC_BATCH_CONCURRENCY));
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
@@ -612,6 +654,33 @@ std::string HelpMessage(HelpMessageMode mode)
     return strUsage;
 }
 
+#if ENABLE_ZMQ || ENABLE_PROTON
+/** Check the sidechain ids filtering the notifications published on -<prefix><topic> (-<prefix><topic>scid) */
+static bool CheckNotifierScIdFilters(const std::string& prefix)
+{
+    static const std::set<std::string> setFilteredTopics = {"pubhashcert", "pubrawcert", "pubscevent"};
+
+    for (const auto& arg : mapMultiArgs)
+    {
+        const std::string& strArg = arg.first;
+        if (strArg.size() <= prefix.size() + 5 || strArg.compare(0, prefix.size() + 1, "-" + prefix) != 0 ||
+            strArg.compare(strArg.size() - 4, 4, "scid") != 0)
+            continue;
+
+        std::string topic = strArg.substr(prefix.size() + 1, strArg.size() - prefix.size() - 5);
+        if (!setFilteredTopics.count(topic))
+            return InitError(strprintf(_("Sidechain ids can not filter the notifications of %s, only those of pubhashcert, pubrawcert and pubscevent"), "-" + prefix + topic));
+
+        for (const std::string& strScId : arg.second)
+        {
+            if (!IsHex(strScId) || strScId.size() != 64)
+                return InitError(strprintf(_("Invalid sidechain id for %s: '%s'"), strArg, strScId));
+        }
+    }
+    return true;
+}
+#endif
+
 static void BlockNotifyCallback(const uint256& hashNewTip)
 {
     std::string strCmd = GetArg("-blocknotify", "");
@@ -1105,6 +1174,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     fServer = GetBoolArg("-server", false);
 
+    blockFileMaps.SetMaxFiles(std::max<int64_t>(GetArg("-blockfilemaps", DEFAULT_BLOCKFILE_MAPS), 0));
+
     // block pruning; get the amount of disk space (in MB) to allot for block & undo files
     int64_t nSignedPruneTarget = GetArg("-prune", 0) * 1024 * 1024;
     if (nSignedPruneTarget < 0) {
@@ -1223,6 +1294,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         return false;
     }
 
+    // Select the fastest SHA-256 and BLAKE2b implementations the CPU supports, before anything gets hashed
+    std::string sha256_algo = SHA256AutoDetect();
+    std::string blake2b_algo = BLAKE2bAutoDetect();
+
     // Initialize elliptic curve code
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1271,6 +1346,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (fPrintToDebugLog)
         OpenDebugLog();
 
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LogPrintf("Using the '%s' BLAKE2b implementation\n", blake2b_algo);
     LogPrintf("Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
@@ -1285,6 +1362,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
     std::ostringstream strErrors;
 
+    InitSignatureCache();
+
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
@@ -1475,15 +1554,25 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
 
 #if ENABLE_ZMQ
-    pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
+    if (!CheckNotifierScIdFilters("zmq"))
+        return false;
+
+    pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs, mapMultiArgs);
 
     if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+        pzmqAsyncNotificationInterface = CAsyncValidationInterface::CreateWithArguments("zmq", pzmqNotificationInterface);
+        if (pzmqAsyncNotificationInterface)
+            RegisterValidationInterface(pzmqAsyncNotificationInterface);
+        else
+            RegisterValidationInterface(pzmqNotificationInterface);
     }
 #endif
 
 #if ENABLE_PROTON
-    pAMQPNotificationInterface = AMQPNotificationInterface::CreateWithArguments(mapArgs);
+    if (!CheckNotifierScIdFilters("amqp"))
+        return false;
+
+    pAMQPNotificationInterface = AMQPNotificationInterface::CreateWithArguments(mapArgs, mapMultiArgs);
 
     if (pAMQPNotificationInterface) {
 
@@ -1493,7 +1582,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(_("AMQP support requires -experimentalfeatures."));
         }
 
-        RegisterValidationInterface(pAMQPNotificationInterface);
+        pAMQPAsyncNotificationInterface = CAsyncValidationInterface::CreateWithArguments("amqp", pAMQPNotificationInterface);
+        if (pAMQPAsyncNotificationInterface)
+            RegisterValidationInterface(pAMQPAsyncNotificationInterface);
+        else
+            RegisterValidationInterface(pAMQPNotificationInterface);
     }
 #endif
 
@@ -1584,6 +1677,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
+                delete pdbwriter;
+                pdbwriter = NULL;
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
@@ -1593,6 +1688,22 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
+                // an interrupted upgrade is always completed
+                if (!pcoinsdbview->IsPerOutputLayout() &&
+                    (GetBoolArg("-coinsperoutput", DEFAULT_COINS_PER_OUTPUT) || pcoinsdbview->IsUpgradingLayout())) {
+                    uiInterface.InitMessage(_("Upgrading chain state database..."));
+                    if (!pcoinsdbview->UpgradeToPerOutputLayout()) {
+                        strLoadError = _("Error upgrading chain state database");
+                        break;
+                    }
+                }
+
+                if (GetBoolArg("-dbbackgroundwrite", DEFAULT_DB_BACKGROUND_WRITE)) {
+                    pdbwriter = new CDBBackgroundWriter();
+                    pblocktree->SetBackgroundWriter(pdbwriter);
+                    pcoinsdbview->SetBackgroundWriter(pdbwriter);
+                }
+
                 if (fReindex || fReindexFast) {
                     if (fReindex) pblocktree->WriteReindexing(true);
                     if (fReindexFast) pblocktree->WriteFastReindexing(true);
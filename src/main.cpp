@@ -10,6 +10,9 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockencodings.h"
+#include "blockfilemap.h"
+#include "blockfilereader.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/validation.h"
@@ -28,6 +31,7 @@
 #include "wallet/asyncrpcoperation_shieldcoinbase.h"
 #include "maturityheightindex.h"
 
+#include <atomic>
 #include <sstream>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -64,6 +68,7 @@ CCriticalSection cs_main;
 
 BlockSet sGlobalForkTips;
 BlockTimeMap mGlobalForkTips;
+uint64_t nGlobalForkTipsChanges = 0;
 
 BlockMap mapBlockIndex;
 CChain chainActive;
@@ -96,6 +101,7 @@ bool fRegtestAllowDustOutput = true;
 bool fIsStartupSyncing = true;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
+CBlockFileMapCache blockFileMaps(DEFAULT_BLOCKFILE_MAPS);
 bool fAlerts = DEFAULT_ALERTS;
 
 /** Fees smaller than this (in satoshi) are considered zero fee (for relaying and mining) */
@@ -297,6 +303,16 @@ struct CNodeState {
     int nBlocksInFlightValidHeaders;
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload;
+    //! Whether this peer can send us compact blocks (it sent sendcmpct).
+    bool fSupportsCompactBlocks;
+    //! The compact block from this peer we are completing, waiting for blocktxn.
+    std::shared_ptr<PartiallyDownloadedBlock> partialBlock;
+    //! Whether this peer wants new blocks announced with headers rather than inv (it sent sendheaders).
+    bool fPreferHeaders;
+    //! The best header we have sent this peer, either in a headers message or as an announcement.
+    CBlockIndex *pindexBestHeaderSent;
+    //! Number of headers messages not connecting to our headers received from this peer in a row.
+    int nUnconnectingHeaders;
 
     CNodeState() {
         fCurrentlyConnected = false;
@@ -310,6 +326,10 @@ struct CNodeState {
         nBlocksInFlight = 0;
         nBlocksInFlightValidHeaders = 0;
         fPreferredDownload = false;
+        fSupportsCompactBlocks = false;
+        fPreferHeaders = false;
+        pindexBestHeaderSent = NULL;
+        nUnconnectingHeaders = 0;
     }
 };
 
@@ -439,6 +459,17 @@ void UpdateBlockAvailability(NodeId nodeid, const uint256 &hash) {
     }
 }
 
+// Requires cs_main and pnode->cs_inventory.
+bool PeerHasHeader(CNodeState *state, CNode *pnode, const CBlockIndex *pindex)
+{
+    if (state->pindexBestKnownBlock && pindex == state->pindexBestKnownBlock->GetAncestor(pindex->nHeight))
+        return true;
+    if (state->pindexBestHeaderSent && pindex == state->pindexBestHeaderSent->GetAncestor(pindex->nHeight))
+        return true;
+    // fork tips are off the chains tracked above, but the peer has them if they were exchanged already
+    return pnode->setInventoryKnown.count(CInv(MSG_BLOCK, pindex->GetBlockHash())) > 0;
+}
+
 /** Find the last common ancestor two blocks have.
  *  Both pa and pb must be non-NULL. */
 CBlockIndex* LastCommonAncestor(CBlockIndex* pa, CBlockIndex* pb) {
@@ -598,6 +629,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
+CDBBackgroundWriter *pdbwriter = NULL;
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -2007,21 +2039,61 @@ bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::M
     return true;
 }
 
+/**
+ * Locate the record at pos (a block, or undo data followed by its checksum) in the memory-mapped
+ * blk or rev file. Returns false if it isn't available that way, to read it with stdio instead.
+ */
+static bool GetMappedRecord(const CDiskBlockPos& pos, bool fUndo, std::shared_ptr<const CMappedFile>& mapped,
+                            const char*& pbegin, const char*& pend)
+{
+    // the record is preceded by the message start and by its size
+    if (pos.IsNull() || pos.nPos < MESSAGE_START_SIZE + sizeof(uint32_t))
+        return false;
+    mapped = blockFileMaps.Get(pos.nFile, fUndo, pos.nPos);
+    if (!mapped)
+        return false;
+
+    const uint64_t nEnd = (uint64_t)pos.nPos + ReadLE32((const unsigned char*)mapped->data() + pos.nPos - sizeof(uint32_t)) +
+                          (fUndo ? sizeof(uint256) : 0);
+    if (nEnd > mapped->size() && !(mapped = blockFileMaps.Get(pos.nFile, fUndo, nEnd)))
+        return false;
+
+    pbegin = mapped->data() + pos.nPos;
+    pend = mapped->data() + nEnd;
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
-    // Read block
-    try {
-        filein >> block;
+    std::shared_ptr<const CMappedFile> mapped;
+    const char *pbegin, *pend;
+    if (GetMappedRecord(pos, false, mapped, pbegin, pend))
+    {
+        // Deserialize in place
+        try {
+            CSpanReader spanin(pbegin, pend, SER_DISK, CLIENT_VERSION);
+            spanin >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    else
+    {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -2042,6 +2114,61 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+namespace {
+    /** Network serialization of the most recently notified blocks, newest first */
+    CCriticalSection cs_recentSerializedBlocks;
+    std::list<std::pair<uint256, std::shared_ptr<const CDataStream> > > lRecentSerializedBlocks;
+}
+
+static std::shared_ptr<const CDataStream> FindRecentSerializedBlock(const uint256& hash)
+{
+    AssertLockHeld(cs_recentSerializedBlocks);
+    for (const auto& entry : lRecentSerializedBlocks)
+    {
+        if (entry.first == hash)
+            return entry.second;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const CDataStream> GetSerializedBlock(const CBlockIndex* pindex)
+{
+    const uint256& hash = pindex->GetBlockHash();
+    {
+        LOCK(cs_recentSerializedBlocks);
+        std::shared_ptr<const CDataStream> ss = FindRecentSerializedBlock(hash);
+        if (ss)
+            return ss;
+    }
+
+    // cs_main only guards the position, the block is read and serialized without it
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = pindex->GetBlockPos();
+    }
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pos))
+        return nullptr;
+    if (block.GetHash() != hash) {
+        error("%s: GetHash() doesn't match index for %s at %s", __func__, hash.ToString(), pos.ToString());
+        return nullptr;
+    }
+
+    std::shared_ptr<CDataStream> ss = std::make_shared<CDataStream>(SER_NETWORK, PROTOCOL_VERSION);
+    *ss << block;
+
+    // the other notifiers of this block find it here, unless one of them was faster
+    LOCK(cs_recentSerializedBlocks);
+    std::shared_ptr<const CDataStream> ssRecent = FindRecentSerializedBlock(hash);
+    if (ssRecent)
+        return ssRecent;
+    lRecentSerializedBlocks.push_front(std::make_pair(hash, ss));
+    if (lRecentSerializedBlocks.size() > RECENT_SERIALIZED_BLOCKS)
+        lRecentSerializedBlocks.pop_back();
+    return ss;
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     CAmount nSubsidy = 12.5 * COIN;
@@ -2646,19 +2773,36 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s: OpenBlockFile failed", __func__);
-
-    // Read block
     uint256 hashChecksum;
-    try {
-        filein >> blockundo;
-        filein >> hashChecksum;
+    std::shared_ptr<const CMappedFile> mapped;
+    const char *pbegin, *pend;
+    if (GetMappedRecord(pos, true, mapped, pbegin, pend))
+    {
+        // Deserialize in place
+        try {
+            CSpanReader spanin(pbegin, pend, SER_DISK, CLIENT_VERSION);
+            spanin >> blockundo;
+            spanin >> hashChecksum;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s", __func__, e.what());
+        }
     }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    else
+    {
+        // Open history file to read
+        CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("%s: OpenBlockFile failed", __func__);
+
+        // Read block
+        try {
+            filein >> blockundo;
+            filein >> hashChecksum;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
     }
 
     // Verify checksum
@@ -3116,6 +3260,10 @@ void static FlushBlockFile(bool fFinalize = false)
 
     CDiskBlockPos posOld(nLastBlockFile, 0);
 
+    // the mappings would outlast the truncated tails
+    if (fFinalize)
+        blockFileMaps.Forget(nLastBlockFile);
+
     FILE *fileOld = OpenBlockFile(posOld);
     if (fileOld) {
         if (fFinalize)
@@ -3231,6 +3379,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     const CChainParams& chainparams = Params();
     AssertLockHeld(cs_main);
 
+    // Signatures of a block actually being connected are not needed anymore once checked, so their
+    // cache entries get erased; a block just being checked (e.g. a template) will be connected later
+    const bool fCacheResults = (processingType == flagBlockProcessingType::CHECK_ONLY);
+
     if(block.nVersion != BLOCK_VERSION_SC_SUPPORT)
     {
         fScRelatedChecks = flagScRelatedChecks::OFF;
@@ -3445,7 +3597,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             nFees += tx.GetFeeAmount(view.GetValueIn(tx));
 
             std::vector<CScriptCheck> vChecks;
-            if (!ContextualCheckTxInputs(tx, state, view, fExpensiveChecks, chain, flags, false, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
+            if (!ContextualCheckTxInputs(tx, state, view, fExpensiveChecks, chain, flags, fCacheResults, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
                 return false;
 
             control.Add(vChecks);
@@ -3578,7 +3730,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         nFees += cert.GetFeeAmount(view.GetValueIn(cert));
 
         std::vector<CScriptCheck> vChecks;
-        if (!ContextualCheckCertInputs(cert, state, view, fExpensiveChecks, chain, flags, false, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
+        if (!ContextualCheckCertInputs(cert, state, view, fExpensiveChecks, chain, flags, fCacheResults, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
             return false;
 
         control.Add(vChecks);
@@ -3801,6 +3953,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     nTimeVerify += deltaVerifyTime;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs] (nScriptCheckThreads=%d)\n", nInputs - 1, 0.001 * deltaVerifyTime, nInputs <= 1 ? 0 : 0.001 * deltaVerifyTime / (nInputs-1), nTimeVerify * 0.000001, nScriptCheckThreads);
+    const CCheckQueueStats& checkStats = control.GetStats();
+    LogPrint("bench", "    - Check queue: %u checks, %u stolen, %u contended locks, busy %.2fms, idle %.2fms\n",
+        checkStats.nChecks, checkStats.nStolen, checkStats.nContended, 0.001 * checkStats.nBusyMicros, 0.001 * checkStats.nIdleMicros);
 
     if (fScRelatedChecks == flagScRelatedChecks::ON)
     {
@@ -3984,6 +4139,11 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         nLastSetChain = nNow;
     }
     size_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+    // The changes handed to the background writer stay in memory until they are written, on top of the cache:
+    // when they take the total over the limit, wait for them rather than flushing a cache that still fits.
+    if (pdbwriter && mode == FLUSH_STATE_IF_NEEDED && cacheSize <= nCoinCacheUsage &&
+        cacheSize + pdbwriter->PendingMemoryUsage() > nCoinCacheUsage && !pdbwriter->Wait())
+        return AbortNode(state, "Failed to write to coin database");
     // The cache is large and close to the limit, but we have time now (not in the middle of a block processing).
     bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize * (10.0/9) > nCoinCacheUsage;
     // The cache is over the limit, we have to write now.
@@ -3999,6 +4159,9 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         // Depend on nMinDiskSpace to ensure we can write block index
         if (!CheckDiskSpace(0))
             return state.Error("out of disk space");
+        // Do not let background writes pile up: the previous ones have to be done before queueing new ones.
+        if (pdbwriter && !pdbwriter->Wait())
+            return AbortNode(state, "Failed to write to block index or coin database");
         // First make sure all block and undo data is flushed to disk.
         FlushBlockFile();
         // Then update all block file information (which may refer to block and undo files).
@@ -4019,9 +4182,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 return AbortNode(state, "Files to write to block index database");
             }
         }
-        // Finally remove any pruned files
-        if (fFlushForPrune)
+        // Finally remove any pruned files, once the block index on disk does not refer to them anymore
+        if (fFlushForPrune) {
+            if (pdbwriter && !pdbwriter->Wait())
+                return AbortNode(state, "Failed to write to block index database");
             UnlinkPrunedFiles(setFilesToPrune);
+        }
         nLastWrite = nNow;
     }
     // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -4034,11 +4200,21 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // Flush the chainstate (which may refer to block index entries).
-        if (!pcoinsTip->Flush())
+        // Write the changes but keep the cache warm, evicting only the least recently used coins
+        // if it is large, even when we are over the limit in the middle of block processing.
+        if (!pcoinsTip->Sync())
             return AbortNode(state, "Failed to write to coin database");
+        if (pcoinsTip->DynamicMemoryUsage() * (10.0/9) > nCoinCacheUsage)
+            pcoinsTip->Trim(nCoinCacheUsage / 100 * COINS_CACHE_TRIM_PERCENT);
         nLastFlush = nNow;
     }
+    // An explicit flush returns once everything is on disk.
+    if (mode == FLUSH_STATE_ALWAYS && pdbwriter && !pdbwriter->Wait())
+        return AbortNode(state, "Failed to write to block index or coin database");
     if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
+        // The wallet best block must not get ahead of the chain state on disk
+        if (pdbwriter && !pdbwriter->Wait())
+            return AbortNode(state, "Failed to write to block index or coin database");
         // Update best block in wallet (so we can detect restored wallets).
         GetMainSignals().SetBestChain(chainActive.GetLocator());
         nLastSetChain = nNow;
@@ -4482,7 +4658,7 @@ bool ActivateBestChain(CValidationState &state, CBlock *pblock, bool &postponeRe
                 {
                     if (chainActive.Height() > (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : nBlockEstimate))
                     {
-                        pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
+                        pnode->PushBlockHash(hashNewTip);
                     }
                     else
                     {
@@ -4603,7 +4779,10 @@ bool addToGlobalForkTips(const CBlockIndex* pindex)
             __func__, __LINE__, pindex->nHeight, pindex->GetBlockHash().ToString());
     }
 
-    return mGlobalForkTips.insert(std::make_pair( pindex, (int)GetTime() )).second;
+    bool inserted = mGlobalForkTips.insert(std::make_pair( pindex, (int)GetTime() )).second;
+    if (erased || inserted)
+        nGlobalForkTipsChanges++;
+    return inserted;
 }
 
 bool updateGlobalForkTips(const CBlockIndex* pindex, bool lookForwardTips)
@@ -4652,11 +4831,8 @@ bool updateGlobalForkTips(const CBlockIndex* pindex, bool lookForwardTips)
                     continue;
                 }
 
-                const CBlockIndex* dum = tipIndex;
-                while ( dum != pindex && dum->nHeight >= h)
-                {
-                    dum = dum->pprev;
-                }
+                // jump straight to the height of pindex through the skip list
+                const CBlockIndex* dum = tipIndex->GetAncestor(h);
 
                 if (dum == pindex)
                 {
@@ -4668,8 +4844,8 @@ bool updateGlobalForkTips(const CBlockIndex* pindex, bool lookForwardTips)
                 else
                 {
                     // we must neglect this branch since not linked to the pindex
-                    LogPrint("forks", "%s():%d - stopped at %s h(%d)\n",
-                        __func__, __LINE__, dum->GetBlockHash().ToString(), dum->nHeight);
+                    LogPrint("forks", "%s():%d - not linked, tip below h(%d)\n",
+                        __func__, __LINE__, h);
                 }
             }
 
@@ -5184,7 +5360,8 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     return true;
 }
 
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex, bool lookForwardTips)
+bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex, bool lookForwardTips,
+                       flagCheckPow fCheckPOW)
 {
     dump_global_tips(10);
 
@@ -5208,7 +5385,7 @@ bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBloc
         return true;
     }
 
-    if (!CheckBlockHeader(block, state))
+    if (!CheckBlockHeader(block, state, fCheckPOW))
         return false;
 
     // Get prev block index
@@ -5238,14 +5415,15 @@ bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBloc
     return true;
 }
 
-bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex, bool fRequested, CDiskBlockPos* dbp, BlockSet* sForkTips)
+bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex, bool fRequested, CDiskBlockPos* dbp, BlockSet* sForkTips,
+                 flagCheckPow fCheckPOW)
 {
     const CChainParams& chainparams = Params();
     AssertLockHeld(cs_main);
 
     CBlockIndex *&pindex = *ppindex;
 
-    if (!AcceptBlockHeader(block, state, &pindex))
+    if (!AcceptBlockHeader(block, state, &pindex, /*lookForwardTips*/false, fCheckPOW))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -5271,7 +5449,7 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
 
     // See method docstring for why this is always disabled
     auto verifier = libzcash::ProofVerifier::Disabled();
-    if ((!CheckBlock(block, state, verifier)) || !ContextualCheckBlock(block, state, pindex->pprev)) {
+    if ((!CheckBlock(block, state, verifier, fCheckPOW)) || !ContextualCheckBlock(block, state, pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
             setDirtyBlockIndex.insert(pindex);
@@ -5304,11 +5482,12 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
     return true;
 }
 
-bool ProcessNewBlock(CValidationState &state, CNode* pfrom, CBlock* pblock, bool fForceProcessing, CDiskBlockPos *dbp)
+bool ProcessNewBlock(CValidationState &state, CNode* pfrom, CBlock* pblock, bool fForceProcessing, CDiskBlockPos *dbp,
+                     flagCheckPow fCheckPOW)
 {
     // Preliminary checks
     auto verifier = libzcash::ProofVerifier::Disabled();
-    bool checked = CheckBlock(*pblock, state, verifier);
+    bool checked = CheckBlock(*pblock, state, verifier, fCheckPOW);
 
     BlockSet sForkTips;
 
@@ -5326,7 +5505,7 @@ bool ProcessNewBlock(CValidationState &state, CNode* pfrom, CBlock* pblock, bool
         // Store to disk
         CBlockIndex *pindex = NULL;
 
-        bool ret = AcceptBlock(*pblock, state, &pindex, fRequested, dbp, &sForkTips);
+        bool ret = AcceptBlock(*pblock, state, &pindex, fRequested, dbp, &sForkTips, fCheckPOW);
 
         if (pindex && pfrom)
         {
@@ -5443,6 +5622,7 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
 {
     for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        blockFileMaps.Forget(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -6005,46 +6185,25 @@ bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeade
 
     try
     {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof())
+        // Reading, deserialization and header checks run ahead in other threads; this takes over fileIn
+        CBlockFileReader reader(fileIn, dbp ? dbp->nFile : -1, loadHeadersOnly,
+                                std::min(GetNumCores() - 1, MAX_BLOCKFILE_CHECK_THREADS));
+        std::shared_ptr<CBlockFileEntry> entry;
+        while ((entry = reader.Next()))
         {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue; //only first byte of magic number matches. Keep searching...
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
-                    continue; //magic number matches but size can't be block one. Keep searching...
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
+            // couldn't be deserialized or invalid header: already logged
+            if (!entry->fHeaderOk)
+                continue;
+
             try
             {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock loadedBlk;
-                blkdat >> loadedBlk;
-                nRewind = blkdat.GetPos();
+                    *dbp = entry->pos;
+                CBlock& loadedBlk = entry->block;
                 // detect out of order blocks, and store them for later
-                uint256 hash = loadedBlk.GetHash();
+                const uint256 hash = entry->hash;
                 if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(loadedBlk.hashPrevBlock) == mapBlockIndex.end()) {
                     LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
                             loadedBlk.hashPrevBlock.ToString());
@@ -6053,20 +6212,20 @@ bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeade
                     continue;
                 }
 
-                // process in case the block isn't known yet
+                // process in case the block isn't known yet; its Equihash solution and proof of work have been checked by the reader
                 if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0)
                 {
                     CValidationState state;
                     if (loadHeadersOnly)
                     {
-                        if (AcceptBlockHeader(loadedBlk, state, /*ppindex*/nullptr, /*lookForwardTips*/false)) //Todo: verify lookForwardTips
+                        if (AcceptBlockHeader(loadedBlk, state, /*ppindex*/nullptr, /*lookForwardTips*/false, flagCheckPow::OFF)) //Todo: verify lookForwardTips
                             ++nLoadedHeaders;
 
                         if (state.IsError())
                             break;
                     } else
                     {
-                        if (ProcessNewBlock(state, NULL, &loadedBlk, true, dbp))
+                        if (ProcessNewBlock(state, NULL, &loadedBlk, true, dbp, flagCheckPow::OFF))
                             nLoadedBlocks++;
 
                         if (state.IsError())
@@ -6440,7 +6599,7 @@ void static ProcessGetData(CNode* pfrom)
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
             {
                 bool send = false;
                 BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
@@ -6493,6 +6652,19 @@ void static ProcessGetData(CNode* pfrom)
                         LogPrint("forks", "%s():%d - Pushing block [%s]\n", __func__, __LINE__, block.GetHash().ToString() );
                         pfrom->PushMessage("block", block);
                     }
+                    else if (inv.type == MSG_CMPCT_BLOCK)
+                    {
+                        // Only recent blocks are likely to be in the peer's mempool, older ones are sent in full
+                        if (mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH)
+                        {
+                            CBlockHeaderAndShortTxIDs cmpctblock(block);
+                            pfrom->PushMessage("cmpctblock", cmpctblock);
+                        }
+                        else
+                        {
+                            pfrom->PushMessage("block", block);
+                        }
+                    }
                     else // MSG_FILTERED_BLOCK)
                     if (inv.type == MSG_FILTERED_BLOCK)
                     {
@@ -6622,16 +6794,61 @@ void static ProcessGetData(CNode* pfrom)
     }
 }
 
+// Whether a tx or certificate in our mempool passes the fee filter pfrom asked us to apply to the
+// announcements we send it. Filtered ones are accounted as the inv, getdata and tx/cert not exchanged.
+static bool PassesFeeFilter(const CTxMemPool& pool, const CInv& inv, CAmount nFeeFilter, CAmount nCertFeeFilter)
+{
+    if (nFeeFilter <= 0 && nCertFeeFilter <= 0)
+        return true;
+
+    CFeeRate feeRate;
+    size_t nSize = 0;
+    bool fCertificate = false;
+    if (!pool.lookupFeeRate(inv.hash, feeRate, nSize, fCertificate))
+        return true;
+    if (feeRate.GetFeePerK() >= (fCertificate ? nCertFeeFilter : nFeeFilter))
+        return true;
+
+    CNode::RecordBytesFeeFiltered(2 * ::GetSerializeSize(inv, SER_NETWORK, PROTOCOL_VERSION) + nSize);
+    return false;
+}
+
+// Fee rates we currently accept txs and certificates at, advertised to peers with feefilter
+static void GetFeeFilterRates(CAmount& nTxFeeFilter, CAmount& nCertFeeFilter)
+{
+    const CAmount nMinRelayFee = ::minRelayTxFee.GetFeePerK();
+    const bool fFreeRelay = GetArg("-limitfreerelay", 15) > 0;
+
+    // Free txs only fit the priority area of blocks: once our mempool holds several blocks worth
+    // of txs they would be waiting for long anyway, so don't have peers send them to us
+    nTxFeeFilter = nMinRelayFee;
+    if (fFreeRelay && mempool.GetTotalTxSize() < (uint64_t)FEEFILTER_MEMPOOL_PRESSURE_BLOCKS * MAX_BLOCK_SIZE)
+        nTxFeeFilter = 0;
+
+    // Certificates have their own policy: they must reach miners within the submission window
+    // of their epoch, so they are never held back by the pressure of txs
+    nCertFeeFilter = fFreeRelay ? 0 : nMinRelayFee;
+}
+
 void ProcessMempoolMsg(const CTxMemPool& pool, CNode* pfrom)
 {
     LOCK2(cs_main, pfrom->cs_filter);
 
+    CAmount nFeeFilter, nCertFeeFilter;
+    {
+        LOCK(pfrom->cs_feeFilter);
+        nFeeFilter = pfrom->minFeeFilter;
+        nCertFeeFilter = pfrom->minCertFeeFilter;
+    }
+
     std::vector<uint256> vtxid;
     pool.queryHashes(vtxid);
     vector<CInv> vInv;
     for(uint256& hash: vtxid)
     {
         CInv inv(MSG_TX, hash);
+        if (!PassesFeeFilter(pool, inv, nFeeFilter, nCertFeeFilter))
+            continue;
         std::unique_ptr<CTransactionBase> mempoolObjPtr{};
         bool fInMemPool = false;
 
@@ -6831,6 +7048,24 @@ void ProcessTxBaseMsg(const CTransactionBase& txBase, CNode* pfrom)
     }
 }
 
+// Process a block rebuilt from a compact block, as if it was received in full from pfrom
+static void ProcessReconstructedBlock(CNode* pfrom, CBlock& block)
+{
+    CValidationState state;
+    ProcessNewBlock(state, pfrom, &block, false, NULL);
+    if (state.IsInvalid())
+    {
+        LogPrint("forks", "%s():%d - Pushing reject, DoS[%d]\n", __func__, __LINE__, state.GetDoS());
+        pfrom->PushMessage("reject", std::string("block"), CValidationState::CodeToChar(state.GetRejectCode()),
+                           state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), block.GetHash());
+        if (state.GetDoS() > 0)
+        {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), state.GetDoS());
+        }
+    }
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     const CChainParams& chainparams = Params();
@@ -6979,6 +7214,56 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             LOCK(cs_main);
             State(pfrom->GetId())->fCurrentlyConnected = true;
         }
+
+        // Tell the peer we understand compact blocks. We only ask for them (no unsolicited
+        // announcements), so peers that don't know this message just ignore it.
+        if (GetBoolArg("-compactblocks", DEFAULT_COMPACT_BLOCKS))
+            pfrom->PushMessage("sendcmpct", false, COMPACT_BLOCKS_VERSION);
+
+        // Ask the peer to announce new blocks with headers rather than inv, saving us
+        // a getheaders/headers round trip for each of them
+        pfrom->PushMessage("sendheaders");
+    }
+
+
+    else if (strCommand == "sendcmpct")
+    {
+        bool fAnnounceUsingCmpctBlock = false;
+        uint64_t nCmpctBlockVersion = 0;
+        vRecv >> fAnnounceUsingCmpctBlock >> nCmpctBlockVersion;
+        if (nCmpctBlockVersion == COMPACT_BLOCKS_VERSION) {
+            LOCK(cs_main);
+            State(pfrom->GetId())->fSupportsCompactBlocks = true;
+        }
+        // Announcing new blocks with unsolicited cmpctblock messages is not supported,
+        // fAnnounceUsingCmpctBlock is ignored: blocks are announced by inv as usual
+    }
+
+
+    else if (strCommand == "feefilter")
+    {
+        CAmount newFeeFilter = 0;
+        vRecv >> newFeeFilter;
+        // The certificates fee filter follows the txs one, peers that don't send it apply the same to both
+        CAmount newCertFeeFilter = newFeeFilter;
+        if (!vRecv.empty())
+            vRecv >> newCertFeeFilter;
+        if (MoneyRange(newFeeFilter) && MoneyRange(newCertFeeFilter)) {
+            {
+                LOCK(pfrom->cs_feeFilter);
+                pfrom->minFeeFilter = newFeeFilter;
+                pfrom->minCertFeeFilter = newCertFeeFilter;
+            }
+            LogPrint("net", "received: feefilter of %s, certificates %s from peer=%d\n",
+                CFeeRate(newFeeFilter).ToString(), CFeeRate(newCertFeeFilter).ToString(), pfrom->id);
+        }
+    }
+
+
+    else if (strCommand == "sendheaders")
+    {
+        LOCK(cs_main);
+        State(pfrom->GetId())->fPreferHeaders = true;
     }
 
 
@@ -7108,7 +7393,11 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     CNodeState *nodestate = State(pfrom->GetId());
                     if (chainActive.Tip()->GetBlockTime() > GetTime() - chainparams.GetConsensus().nPowTargetSpacing * 20 &&
                         nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
-                        vToFetch.push_back(inv);
+                        // This is a new block close to the tip: most of its txs and certs should already be in our mempool
+                        if (nodestate->fSupportsCompactBlocks && GetBoolArg("-compactblocks", DEFAULT_COMPACT_BLOCKS))
+                            vToFetch.push_back(CInv(MSG_CMPCT_BLOCK, inv.hash));
+                        else
+                            vToFetch.push_back(inv);
                         // Mark block as in flight already, even though the actual "getdata" message only goes out
                         // later (within the same cs_main lock, though).
                         MarkBlockAsInFlight(pfrom->GetId(), inv.hash, chainparams.GetConsensus());
@@ -7252,6 +7541,12 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             }
             LogPrint("forks", "%s():%d - Pushing %d headers to node[%s]\n", __func__, __LINE__, vHeaders.size(), pfrom->addrName);
             pfrom->PushMessage("headers", vHeaders);
+            if (!vHeaders.empty())
+            {
+                // pindex is NULL if we reached our tip
+                CNodeState *nodestate = State(pfrom->GetId());
+                nodestate->pindexBestHeaderSent = pindex ? pindex : chainActive.Tip();
+            }
         }
         else
         {
@@ -7449,6 +7744,19 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             return true;
         }
 
+        if (nCount <= MAX_BLOCKS_TO_ANNOUNCE && mapBlockIndex.find(headers[0].hashPrevBlock) == mapBlockIndex.end()) {
+            // An announcement not connecting to our headers: the peer does not know where we are, catch up
+            // with getheaders rather than penalizing it for an unknown previous block, unless it keeps doing so
+            CNodeState *nodestate = State(pfrom->GetId());
+            nodestate->nUnconnectingHeaders++;
+            LogPrint("net", "%s():%d - unconnecting headers %s from peer=%d (%d in a row), sending getheaders\n",
+                __func__, __LINE__, headers[0].GetHash().ToString(), pfrom->id, nodestate->nUnconnectingHeaders);
+            pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), uint256());
+            if (nodestate->nUnconnectingHeaders % MAX_UNCONNECTING_HEADERS == 0)
+                Misbehaving(pfrom->GetId(), 20);
+            return true;
+        }
+
         CBlockIndex *pindexLast = NULL;
         int cnt = 0;
         BOOST_FOREACH(const CBlockHeader& header, headers) {
@@ -7472,9 +7780,45 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             }
         }
 
+        CNodeState *nodestate = State(pfrom->GetId());
+        if (nodestate->nUnconnectingHeaders > 0 && pindexLast) {
+            LogPrint("net", "%s():%d - peer=%d: resetting nUnconnectingHeaders (%d -> 0)\n",
+                __func__, __LINE__, pfrom->id, nodestate->nUnconnectingHeaders);
+            nodestate->nUnconnectingHeaders = 0;
+        }
+
         if (pindexLast)
             UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
 
+        if (pindexLast && nCount <= MAX_BLOCKS_TO_ANNOUNCE && !(pindexLast->nStatus & BLOCK_HAVE_DATA) &&
+            chainActive.Tip()->GetBlockTime() > GetTime() - chainparams.GetConsensus().nPowTargetSpacing * 20) {
+            // Headers announcing new blocks close to the tip: fetch them right away, as the inv handler does,
+            // without waiting for the download logic to pick them up
+            std::vector<CBlockIndex*> vToFetch;
+            CBlockIndex *pindexWalk = pindexLast;
+            while (pindexWalk && !chainActive.Contains(pindexWalk) && vToFetch.size() < MAX_BLOCKS_TO_ANNOUNCE) {
+                if (!(pindexWalk->nStatus & BLOCK_HAVE_DATA) && !mapBlocksInFlight.count(pindexWalk->GetBlockHash()))
+                    vToFetch.push_back(pindexWalk);
+                pindexWalk = pindexWalk->pprev;
+            }
+
+            vector<CInv> vGetData;
+            BOOST_REVERSE_FOREACH(CBlockIndex* pindex, vToFetch) {
+                if (nodestate->nBlocksInFlight >= MAX_BLOCKS_IN_TRANSIT_PER_PEER)
+                    break;
+                vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
+                MarkBlockAsInFlight(pfrom->GetId(), pindex->GetBlockHash(), chainparams.GetConsensus(), pindex);
+            }
+            if (!vGetData.empty()) {
+                // A single new block has most of its txs and certs in our mempool already
+                if (vGetData.size() == 1 && nodestate->fSupportsCompactBlocks && GetBoolArg("-compactblocks", DEFAULT_COMPACT_BLOCKS))
+                    vGetData[0].type = MSG_CMPCT_BLOCK;
+                LogPrint("net", "%s():%d - downloading %u announced block(s) up to %s from peer=%d\n",
+                    __func__, __LINE__, vGetData.size(), pindexLast->GetBlockHash().ToString(), pfrom->id);
+                pfrom->PushMessage("getdata", vGetData);
+            }
+        }
+
         if (nCount == MAX_HEADERS_RESULTS && pindexLast) {
             // Headers message had its maximum size; the peer may have more headers.
             // TODO: optimize: if pindexLast is an ancestor of chainActive.Tip or pindexBestHeader, continue
@@ -7526,6 +7870,181 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
+    else if (strCommand == "cmpctblock" && !fImporting && !fReindex && !fReindexFast) // Ignore blocks received while importing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+
+        const uint256 hash = cmpctblock.header.GetHash();
+        LogPrint("net", "%s():%d - received cmpctblock %s peer=%d\n", __func__, __LINE__, hash.ToString(), pfrom->id);
+
+        CBlock block;
+        bool fBlockReconstructed = false;
+        {
+            LOCK(cs_main);
+            pfrom->AddInventoryKnown(CInv(MSG_BLOCK, hash));
+
+            // We only ask for compact blocks, never accept unsolicited ones
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+            if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != pfrom->GetId()) {
+                LogPrint("net", "%s():%d - unrequested cmpctblock %s from peer=%d\n", __func__, __LINE__, hash.ToString(), pfrom->id);
+                return true;
+            }
+
+            if (mapBlockIndex.find(cmpctblock.header.hashPrevBlock) == mapBlockIndex.end()) {
+                // The headers leading to it have not been connected yet, let the full block path deal with it
+                pfrom->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, hash)));
+                return true;
+            }
+
+            CValidationState state;
+            CBlockIndex *pindex = NULL;
+            if (!AcceptBlockHeader(cmpctblock.header, state, &pindex)) {
+                if (state.IsInvalid()) {
+                    if (state.GetDoS() > 0)
+                        Misbehaving(pfrom->GetId(), state.GetDoS());
+                    return error("invalid header received");
+                }
+                // Not a network rule violation, fetch the full block
+                pfrom->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, hash)));
+                return true;
+            }
+            if (pindex->nStatus & BLOCK_HAVE_DATA) {
+                // Got it meanwhile from another peer, do not leave it in flight from this one
+                MarkBlockAsReceived(hash);
+                return true;
+            }
+
+            CNodeState *nodestate = State(pfrom->GetId());
+            nodestate->partialBlock.reset(new PartiallyDownloadedBlock(&mempool));
+            ReadStatus status = nodestate->partialBlock->InitData(cmpctblock);
+            if (status == READ_STATUS_INVALID) {
+                nodestate->partialBlock.reset();
+                MarkBlockAsReceived(hash);
+                Misbehaving(pfrom->GetId(), 100);
+                return error("invalid compact block %s received from peer=%d", hash.ToString(), pfrom->id);
+            }
+            if (status == READ_STATUS_FAILED) {
+                // Duplicate short ids, fetch the full block (it is still in flight from this peer)
+                nodestate->partialBlock.reset();
+                pfrom->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, hash)));
+                return true;
+            }
+
+            BlockTransactionsRequest req;
+            req.blockhash = hash;
+            for (size_t i = 0; i < nodestate->partialBlock->TxCount(); i++)
+                if (!nodestate->partialBlock->IsTxAvailable(i))
+                    req.txindexes.push_back(i);
+            for (size_t i = 0; i < nodestate->partialBlock->CertCount(); i++)
+                if (!nodestate->partialBlock->IsCertAvailable(i))
+                    req.certindexes.push_back(i);
+
+            if (!req.IsEmpty()) {
+                LogPrint("cmpctblock", "%s():%d - requesting %u txs and %u certs of block %s from peer=%d\n", __func__, __LINE__,
+                    req.txindexes.size(), req.certindexes.size(), hash.ToString(), pfrom->id);
+                pfrom->PushMessage("getblocktxn", req);
+                return true;
+            }
+
+            // Everything was in our mempool
+            status = nodestate->partialBlock->FillBlock(block, std::vector<CTransaction>(), std::vector<CScCertificate>());
+            nodestate->partialBlock.reset();
+            if (status != READ_STATUS_OK) {
+                // Short id collision with a mempool entry, fall back to the full block
+                pfrom->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, hash)));
+                return true;
+            }
+            fBlockReconstructed = true;
+        }
+
+        if (fBlockReconstructed)
+            ProcessReconstructedBlock(pfrom, block);
+    }
+
+
+    else if (strCommand == "getblocktxn")
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        LOCK(cs_main);
+
+        BlockMap::iterator it = mapBlockIndex.find(req.blockhash);
+        if (it == mapBlockIndex.end() || !(it->second->nStatus & BLOCK_HAVE_DATA)) {
+            LogPrint("net", "Peer %d sent us a getblocktxn for a block we don't have\n", pfrom->id);
+            return true;
+        }
+
+        if (it->second->nHeight < chainActive.Height() - MAX_BLOCKTXN_DEPTH) {
+            // Peers should only ask for txs of blocks we have just sent them as compact blocks,
+            // answer with the full block as getdata would
+            LogPrint("net", "Peer %d sent us a getblocktxn for a block > %i deep\n", pfrom->id, MAX_BLOCKTXN_DEPTH);
+            pfrom->vRecvGetData.push_back(CInv(MSG_BLOCK, req.blockhash));
+            ProcessGetData(pfrom);
+            return true;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, it->second)) {
+            // The peer is not to blame: leave it to request the full block
+            LogPrintf("%s(): cannot load block %s from disk for getblocktxn from peer=%d\n",
+                __func__, req.blockhash.ToString(), pfrom->id);
+            return true;
+        }
+
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.txindexes.size(); i++) {
+            if (req.txindexes[i] >= block.vtx.size()) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("Peer %d sent us a getblocktxn with out-of-bounds tx indices", pfrom->id);
+            }
+            resp.txn[i] = block.vtx[req.txindexes[i]];
+        }
+        for (size_t i = 0; i < req.certindexes.size(); i++) {
+            if (req.certindexes[i] >= block.vcert.size()) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("Peer %d sent us a getblocktxn with out-of-bounds cert indices", pfrom->id);
+            }
+            resp.certs[i] = block.vcert[req.certindexes[i]];
+        }
+        pfrom->PushMessage("blocktxn", resp);
+    }
+
+
+    else if (strCommand == "blocktxn" && !fImporting && !fReindex && !fReindexFast) // Ignore blocks received while importing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        CBlock block;
+        {
+            LOCK(cs_main);
+
+            CNodeState *nodestate = State(pfrom->GetId());
+            if (!nodestate->partialBlock || nodestate->partialBlock->header.GetHash() != resp.blockhash) {
+                LogPrint("net", "Peer %d sent us block transactions for block we weren't expecting\n", pfrom->id);
+                return true;
+            }
+
+            ReadStatus status = nodestate->partialBlock->FillBlock(block, resp.txn, resp.certs);
+            nodestate->partialBlock.reset();
+            if (status == READ_STATUS_INVALID) {
+                MarkBlockAsReceived(resp.blockhash);
+                Misbehaving(pfrom->GetId(), 100);
+                return error("Peer %d sent us invalid compact block/non-matching block transactions", pfrom->id);
+            }
+            if (status == READ_STATUS_FAILED) {
+                // Might have collided, fall back to the full block (still in flight from this peer)
+                pfrom->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, resp.blockhash)));
+                return true;
+            }
+        }
+
+        ProcessReconstructedBlock(pfrom, block);
+    }
+
+
     // This asymmetric behavior for inbound and outbound connections was introduced
     // to prevent a fingerprinting attack: an attacker can send specific fake addresses
     // to users' AddrMan and later request them by sending getaddr messages.
@@ -8026,11 +8545,74 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             GetMainSignals().Broadcast(nTimeBestReceived);
         }
 
+        //
+        // Message: block announcements
+        //
+        // Peers that sent sendheaders get the headers of new tips and fork tips, together with
+        // the ancestors they miss (up to MAX_BLOCKS_TO_ANNOUNCE); everything else goes by inv.
+        {
+            LOCK(pto->cs_inventory);
+            BOOST_FOREACH(const uint256& hash, pto->vBlockHashesToAnnounce)
+            {
+                BlockMap::iterator mi = mapBlockIndex.find(hash);
+                if (mi == mapBlockIndex.end())
+                    continue;
+                CBlockIndex *pindex = mi->second;
+
+                if (state.fPreferHeaders)
+                {
+                    if (PeerHasHeader(&state, pto, pindex))
+                        continue;
+
+                    std::deque<CBlockHeaderForNetwork> dHeaders;
+                    const CBlockIndex *pindexWalk = pindex;
+                    bool fConnecting = false;
+                    while (dHeaders.size() < MAX_BLOCKS_TO_ANNOUNCE)
+                    {
+                        dHeaders.push_front(CBlockHeaderForNetwork(pindexWalk->GetBlockHeader()));
+                        if (!pindexWalk->pprev || PeerHasHeader(&state, pto, pindexWalk->pprev))
+                        {
+                            fConnecting = true;
+                            break;
+                        }
+                        pindexWalk = pindexWalk->pprev;
+                    }
+
+                    if (fConnecting)
+                    {
+                        LogPrint("net", "%s():%d - sending %u header(s) up to %s to peer=%d\n",
+                            __func__, __LINE__, dHeaders.size(), hash.ToString(), pto->id);
+                        pto->PushMessage("headers", std::vector<CBlockHeaderForNetwork>(dHeaders.begin(), dHeaders.end()));
+
+                        // the peer now has all of them, never announce them again
+                        for (const CBlockIndex *p = pindex; p != pindexWalk->pprev; p = p->pprev)
+                            pto->setInventoryKnown.insert(CInv(MSG_BLOCK, p->GetBlockHash()));
+                        if (!state.pindexBestHeaderSent || pindex->nChainWork > state.pindexBestHeaderSent->nChainWork)
+                            state.pindexBestHeaderSent = pindex;
+                        continue;
+                    }
+                    // too far from what the peer knows, let it catch up with getheaders
+                    LogPrint("net", "%s():%d - no header connecting %s for peer=%d, using inv\n",
+                        __func__, __LINE__, hash.ToString(), pto->id);
+                }
+
+                if (!pto->setInventoryKnown.count(CInv(MSG_BLOCK, hash)))
+                    pto->vInventoryToSend.push_back(CInv(MSG_BLOCK, hash));
+            }
+            pto->vBlockHashesToAnnounce.clear();
+        }
+
         //
         // Message: inventory
         //
         vector<CInv> vInv;
         vector<CInv> vInvWait;
+        CAmount nFeeFilter, nCertFeeFilter;
+        {
+            LOCK(pto->cs_feeFilter);
+            nFeeFilter = pto->minFeeFilter;
+            nCertFeeFilter = pto->minCertFeeFilter;
+        }
         {
             LOCK(pto->cs_inventory);
             vInv.reserve(pto->vInventoryToSend.size());
@@ -8040,6 +8622,10 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                 if (pto->setInventoryKnown.count(inv))
                     continue;
 
+                // don't announce what the peer would not accept
+                if (inv.type == MSG_TX && !PassesFeeFilter(mempool, inv, nFeeFilter, nCertFeeFilter))
+                    continue;
+
                 // trickle out tx inv to protect privacy
                 if (inv.type == MSG_TX && !fSendTrickle)
                 {
@@ -8157,6 +8743,32 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         if (!vGetData.empty())
             pto->PushMessage("getdata", vGetData);
 
+        //
+        // Message: feefilter
+        //
+        if (!pto->fDisconnect && GetBoolArg("-feefilter", DEFAULT_FEEFILTER)) {
+            // We don't want txs and certificates while in initial block download
+            CAmount nTxFeeFilter = MAX_MONEY;
+            CAmount nCertFeeFilterToSend = MAX_MONEY;
+            if (!IsInitialBlockDownload())
+                GetFeeFilterRates(nTxFeeFilter, nCertFeeFilterToSend);
+
+            int64_t timeNow = GetTimeMicros();
+            LOCK(pto->cs_feeFilter);
+            bool fChanged = nTxFeeFilter != pto->lastSentFeeFilter || nCertFeeFilterToSend != pto->lastSentCertFeeFilter;
+            if (timeNow > pto->nextSendTimeFeeFilter) {
+                if (fChanged) {
+                    LogPrint("net", "sending feefilter %d, certificates %d to peer=%d\n", nTxFeeFilter, nCertFeeFilterToSend, pto->id);
+                    pto->PushMessage("feefilter", nTxFeeFilter, nCertFeeFilterToSend);
+                    pto->lastSentFeeFilter = nTxFeeFilter;
+                    pto->lastSentCertFeeFilter = nCertFeeFilterToSend;
+                }
+                pto->nextSendTimeFeeFilter = timeNow + (AVG_FEEFILTER_BROADCAST_INTERVAL / 2 + GetRand(AVG_FEEFILTER_BROADCAST_INTERVAL)) * 1000000;
+            } else if (fChanged && timeNow + MAX_FEEFILTER_CHANGE_DELAY * 1000000 < pto->nextSendTimeFeeFilter) {
+                // Don't wait for the regular broadcast to tell the peer about a change
+                pto->nextSendTimeFeeFilter = timeNow + GetRand(MAX_FEEFILTER_CHANGE_DELAY) * 1000000;
+            }
+        }
     }
     return true;
 }
@@ -8276,9 +8888,9 @@ bool RelayAlternativeChain(CValidationState &state, CBlock *pblock, BlockSet* sF
                 {
                     BOOST_FOREACH(CInv& inv, vInv)
                     {
-                        LogPrint("forks", "%s():%d - Pushing inv to Node [%s] (id=%d) hash[%s]\n",
+                        LogPrint("forks", "%s():%d - Announcing to Node [%s] (id=%d) hash[%s]\n",
                             __func__, __LINE__, pnode->addrName, pnode->GetId(), inv.hash.ToString() );
-                        pnode->PushInventory(inv);
+                        pnode->PushBlockHash(inv.hash);
                     }
                 }
             }
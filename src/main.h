@@ -43,6 +43,8 @@ class CCoinsView;
 class CBlock;
 class CBlockLocator;
 class CBlockTreeDB;
+class CDBBackgroundWriter;
+class CBlockFileMapCache;
 class CScriptCheck;
 class CValidationState;
 class CTxUndo;
@@ -101,10 +103,38 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Share of the coins cache (in percent) kept resident when it has to be trimmed after a flush. */
+static const unsigned int COINS_CACHE_TRIM_PERCENT = 50;
+/** Default for -dbbackgroundwrite */
+static const bool DEFAULT_DB_BACKGROUND_WRITE = true;
+/** Default for -coinsperoutput */
+static const bool DEFAULT_COINS_PER_OUTPUT = false;
+/** Default for -compactblocks */
+static const bool DEFAULT_COMPACT_BLOCKS = true;
+/** Version of the compact blocks announced with sendcmpct */
+static const uint64_t COMPACT_BLOCKS_VERSION = 1;
+/** Blocks deeper than this are served in full when asked as compact blocks. */
+static const int MAX_CMPCTBLOCK_DEPTH = 5;
+/** Requests of transactions of blocks deeper than this are answered with the full block. */
+static const int MAX_BLOCKTXN_DEPTH = 10;
+/** Maximum number of headers to announce when relaying blocks with headers messages. */
+static const unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
+/** Number of headers messages not connecting to our headers a peer may send before being penalized */
+static const int MAX_UNCONNECTING_HEADERS = 10;
+/** Default for -feefilter */
+static const bool DEFAULT_FEEFILTER = true;
+/** Average delay (in seconds) between the feefilter messages sent to a peer. */
+static const unsigned int AVG_FEEFILTER_BROADCAST_INTERVAL = 10 * 60;
+/** Maximum delay (in seconds) before a changed fee filter is sent to a peer. */
+static const unsigned int MAX_FEEFILTER_CHANGE_DELAY = 5 * 60;
+/** Size of the mempool txs, in blocks, beyond which free txs are filtered out of the relay from peers. */
+static const unsigned int FEEFILTER_MEMPOOL_PRESSURE_BLOCKS = 3;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 /* Maximum number of heigths meaningful when looking for block finality */
 static const int MAX_BLOCK_AGE_FOR_FINALITY = 2000;
+/** Number of recently notified blocks whose network serialization is kept for the block notifiers */
+static const unsigned int RECENT_SERIALIZED_BLOCKS = 8;
 
 #ifdef ENABLE_ADDRESS_INDEXING
 static const bool DEFAULT_ADDRESSINDEX = false;
@@ -182,6 +212,8 @@ struct CompareBlocksByHeight
 
 typedef std::map<const CBlockIndex*, int, CompareBlocksByHeight> BlockTimeMap;
 extern BlockTimeMap mGlobalForkTips;
+/** Bumped whenever a tip is added to or removed from mGlobalForkTips, for the caches built on them. */
+extern uint64_t nGlobalForkTipsChanges;
 
 typedef std::set<const CBlockIndex*, CompareBlocksByHeight> BlockSet;
 extern BlockSet sGlobalForkTips;
@@ -200,6 +232,8 @@ extern bool fHavePruned;
 extern bool fPruneMode;
 /** Number of MiB of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
+/** Memory mappings of the block and undo files, for historical reads. */
+extern CBlockFileMapCache blockFileMaps;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
@@ -218,6 +252,8 @@ void RegisterNodeSignals(CNodeSignals& nodeSignals);
 /** Unregister a network node */
 void UnregisterNodeSignals(CNodeSignals& nodeSignals);
 
+enum class flagCheckPow             { ON, OFF };
+
 /** 
  * Process an incoming block. This only returns after the best known valid
  * block is made active. Note that it does not, however, guarantee that the
@@ -228,9 +264,11 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals);
  * @param[in]   pblock  The block we want to process.
  * @param[in]   fForceProcessing Process this block even if unrequested; used for non-network block sources and whitelisted peers.
  * @param[out]  dbp     If pblock is stored to disk (or already there), this will be set to its location.
+ * @param[in]   fCheckPOW OFF if the Equihash solution and proof of work of pblock have already been checked by the caller.
  * @return True if state.IsValid()
  */
-bool ProcessNewBlock(CValidationState &state, CNode* pfrom, CBlock* pblock, bool fForceProcessing, CDiskBlockPos *dbp);
+bool ProcessNewBlock(CValidationState &state, CNode* pfrom, CBlock* pblock, bool fForceProcessing, CDiskBlockPos *dbp,
+                     flagCheckPow fCheckPOW = flagCheckPow::ON);
 /** Check whether enough disk space is available for an incoming block */
 bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
 /** Open a block file (blk?????.dat) */
@@ -534,6 +572,12 @@ bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::M
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
 CBlock LoadBlockFrom(CBufferedFile& blkdat, CDiskBlockPos* pLastLoadedBlkPos);
+/**
+ * Get the network serialization of a block, shared with the other callers. The first caller reads
+ * the block from disk and serializes it without holding cs_main, the next ones are served from memory.
+ * Returns nullptr if the block can not be read.
+ */
+std::shared_ptr<const CDataStream> GetSerializedBlock(const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -553,7 +597,6 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
                      bool* pfClean = NULL, std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo = nullptr);
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins */
-enum class flagCheckPow             { ON, OFF };
 enum class flagCheckMerkleRoot      { ON, OFF };
 enum class flagScRelatedChecks      { ON, OFF };
 enum class flagScProofVerification  { ON, OFF };
@@ -600,8 +643,10 @@ bool TestBlockValidity(CValidationState &state, const CBlock& block, CBlockIndex
  * - The only caller of AcceptBlock verifies JoinSplit proofs elsewhere.
  * If dbp is non-NULL, the file is known to already reside on disk
  */
-bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex **pindex, bool fRequested, CDiskBlockPos* dbp, BlockSet* sForkTips = NULL);
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex **ppindex= NULL, bool lookForwardTips = false);
+bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex **pindex, bool fRequested, CDiskBlockPos* dbp, BlockSet* sForkTips = NULL,
+                 flagCheckPow fCheckPOW = flagCheckPow::ON);
+bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex **ppindex= NULL, bool lookForwardTips = false,
+                       flagCheckPow fCheckPOW = flagCheckPow::ON);
 
 
 class CBlockFileInfo
@@ -684,6 +729,9 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/** Global variable that points to the writer of the block tree and coins database batches, if enabled (protected by cs_main) */
+extern CDBBackgroundWriter *pdbwriter;
+
 /**
  * Check if the output nIn is CF Reward
  */
@@ -350,8 +350,10 @@ CNode::eTlsOption CNode::tlsValidate       = CNode::eTlsOption::FALLBACK_UNSET;
 
 uint64_t CNode::nTotalBytesRecv = 0;
 uint64_t CNode::nTotalBytesSent = 0;
+uint64_t CNode::nTotalBytesFeeFiltered = 0;
 CCriticalSection CNode::cs_totalBytesRecv;
 CCriticalSection CNode::cs_totalBytesSent;
+CCriticalSection CNode::cs_totalBytesFeeFiltered;
 
 CNode* FindNode(const CNetAddr& ip)
 {
@@ -694,6 +696,8 @@ void CNode::copyStats(CNodeStats &stats)
     X(nStartingHeight);
     X(nSendBytes);
     X(nRecvBytes);
+    X(nRecvBytesCopied);
+    X(nRecvBytesDirect);
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -711,6 +715,12 @@ void CNode::copyStats(CNodeStats &stats)
     stats.dPingTime = (((double)nPingUsecTime) / 1e6);
     stats.dPingWait = (((double)nPingUsecWait) / 1e6);
 
+    {
+        LOCK(cs_feeFilter);
+        stats.minFeeFilter = minFeeFilter;
+        stats.minCertFeeFilter = minCertFeeFilter;
+    }
+
     // Leave string empty if addrLocal invalid (not filled in yet)
     stats.addrLocal = addrLocal.IsValid() ? addrLocal.ToString() : "";
 
@@ -719,6 +729,7 @@ void CNode::copyStats(CNodeStats &stats)
         LOCK(cs_hSocket);
         stats.fTLSEstablished = (ssl != NULL) && (SSL_get_state(ssl) == TLS_ST_OK);
         stats.fTLSVerified = (ssl != NULL) && ValidatePeerCertificate(ssl);
+        stats.fTLSResumed = (ssl != NULL) && SSL_session_reused(ssl);
     }
 }
 #undef X
@@ -762,6 +773,26 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
     return true;
 }
 
+// requires LOCK(cs_vRecvMsg)
+char *CNode::GetRecvMsgDataBuffer(unsigned int nMax, unsigned int& nSize)
+{
+    nSize = 0;
+    if (vRecvMsg.empty() || vRecvMsg.back().complete() || !vRecvMsg.back().in_data)
+        return NULL;
+    return vRecvMsg.back().dataBuffer(nMax, nSize);
+}
+
+// requires LOCK(cs_vRecvMsg)
+void CNode::RecvMsgDataWritten(unsigned int nBytes)
+{
+    CNetMessage& msg = vRecvMsg.back();
+    msg.dataWritten(nBytes);
+    if (msg.complete()) {
+        msg.nTime = GetTimeMicros();
+        messageHandlerCondition.notify_one();
+    }
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -794,19 +825,25 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 }
 
 int CNetMessage::readData(const char *pch, unsigned int nBytes)
+{
+    unsigned int nCopy;
+    memcpy(dataBuffer(nBytes, nCopy), pch, nCopy);
+    dataWritten(nCopy);
+
+    return nCopy;
+}
+
+char *CNetMessage::dataBuffer(unsigned int nBytes, unsigned int& nSize)
 {
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
-    unsigned int nCopy = std::min(nRemaining, nBytes);
+    nSize = std::min(nRemaining, nBytes);
 
-    if (vRecv.size() < nDataPos + nCopy) {
+    if (vRecv.size() < nDataPos + nSize) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nSize + 256 * 1024));
     }
 
-    memcpy(&vRecv[nDataPos], pch, nCopy);
-    nDataPos += nCopy;
-
-    return nCopy;
+    return &vRecv[nDataPos];
 }
 
 
@@ -2169,6 +2206,12 @@ void CNode::RecordBytesSent(uint64_t bytes)
     nTotalBytesSent += bytes;
 }
 
+void CNode::RecordBytesFeeFiltered(uint64_t bytes)
+{
+    LOCK(cs_totalBytesFeeFiltered);
+    nTotalBytesFeeFiltered += bytes;
+}
+
 uint64_t CNode::GetTotalBytesRecv()
 {
     LOCK(cs_totalBytesRecv);
@@ -2181,6 +2224,12 @@ uint64_t CNode::GetTotalBytesSent()
     return nTotalBytesSent;
 }
 
+uint64_t CNode::GetTotalBytesFeeFiltered()
+{
+    LOCK(cs_totalBytesFeeFiltered);
+    return nTotalBytesFeeFiltered;
+}
+
 void CNode::Fuzz(int nChance)
 {
     if (!fSuccessfullyConnected) return; // Don't fuzz initial handshake
@@ -2333,6 +2382,8 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nLastRecv = 0;
     nSendBytes = 0;
     nRecvBytes = 0;
+    nRecvBytesCopied = 0;
+    nRecvBytesDirect = 0;
     nTimeConnected = GetTime();
     nTimeOffset = 0;
     addr = addrIn;
@@ -2360,6 +2411,11 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nPingUsecTime = 0;
     fPingQueued = false;
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
+    minFeeFilter = 0;
+    minCertFeeFilter = 0;
+    lastSentFeeFilter = 0;
+    lastSentCertFeeFilter = 0;
+    nextSendTimeFeeFilter = 0;
 
     {
         LOCK(cs_nLastNodeId);
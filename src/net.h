@@ -6,6 +6,7 @@
 #ifndef BITCOIN_NET_H
 #define BITCOIN_NET_H
 
+#include "amount.h"
 #include "bloom.h"
 #include "compat.h"
 #include "hash.h"
@@ -206,9 +207,14 @@ public:
     int nStartingHeight;
     uint64_t nSendBytes;
     uint64_t nRecvBytes;
+    uint64_t nRecvBytesCopied;
+    uint64_t nRecvBytesDirect;
+    bool fTLSResumed;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
+    CAmount minFeeFilter;
+    CAmount minCertFeeFilter;
     std::string addrLocal;
 };
 
@@ -251,6 +257,13 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+
+    /** Where up to nSize of the next nBytes of data can be written in place; requires in_data */
+    char *dataBuffer(unsigned int nBytes, unsigned int& nSize);
+    void dataWritten(unsigned int nBytes)
+    {
+        nDataPos += nBytes;
+    }
 };
 
 
@@ -279,6 +292,8 @@ public:
     std::deque<CNetMessage> vRecvMsg;
     CCriticalSection cs_vRecvMsg;
     uint64_t nRecvBytes;
+    uint64_t nRecvBytesCopied; // received through an intermediate buffer
+    uint64_t nRecvBytesDirect; // received in place, see GetRecvMsgDataBuffer
     int nRecvVersion;
 
     int64_t nLastSend;
@@ -349,6 +364,8 @@ public:
     // inventory based relay
     mruset<CInv> setInventoryKnown;
     std::vector<CInv> vInventoryToSend;
+    //! New tips and fork tips to announce, as headers or inv depending on the peer
+    std::vector<uint256> vBlockHashesToAnnounce;
     CCriticalSection cs_inventory;
     std::set<uint256> setAskFor;
     std::multimap<int64_t, CInv> mapAskFor;
@@ -365,6 +382,15 @@ public:
     // Whether a ping is requested.
     bool fPingQueued;
 
+    // Fee filters (in zatoshis per kB) the peer asked us to apply to the txs and certificates we
+    // announce, and the ones we last sent it. Protected by cs_feeFilter.
+    CCriticalSection cs_feeFilter;
+    CAmount minFeeFilter;
+    CAmount minCertFeeFilter;
+    CAmount lastSentFeeFilter;
+    CAmount lastSentCertFeeFilter;
+    int64_t nextSendTimeFeeFilter;
+
     CNode(SOCKET hSocketIn, const CAddress &addrIn, const std::string &addrNameIn = "", bool fInboundIn = false, SSL *sslIn = NULL);
     ~CNode();
 
@@ -372,8 +398,10 @@ private:
     // Network usage totals
     static CCriticalSection cs_totalBytesRecv;
     static CCriticalSection cs_totalBytesSent;
+    static CCriticalSection cs_totalBytesFeeFiltered;
     static uint64_t nTotalBytesRecv;
     static uint64_t nTotalBytesSent;
+    static uint64_t nTotalBytesFeeFiltered;
 
     CNode(const CNode&);
     void operator=(const CNode&);
@@ -402,6 +430,15 @@ public:
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes);
 
+    // requires LOCK(cs_vRecvMsg)
+    // Where the data of the message being received can be written in place, at most nMax bytes of it: the
+    // number of bytes is returned in nSize. NULL if the header of the message hasn't been received yet.
+    char *GetRecvMsgDataBuffer(unsigned int nMax, unsigned int& nSize);
+
+    // requires LOCK(cs_vRecvMsg)
+    // Account for bytes written to the buffer returned by GetRecvMsgDataBuffer
+    void RecvMsgDataWritten(unsigned int nBytes);
+
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn)
     {
@@ -460,6 +497,12 @@ public:
         }
     }
 
+    void PushBlockHash(const uint256& hash)
+    {
+        LOCK(cs_inventory);
+        vBlockHashesToAnnounce.push_back(hash);
+    }
+
     void AskFor(const CInv& inv);
 
     // TODO: Document the postcondition of this function.  Is cs_vSend locked?
@@ -672,8 +715,12 @@ public:
     static void RecordBytesRecv(uint64_t bytes);
     static void RecordBytesSent(uint64_t bytes);
 
+    //! Bytes not exchanged because of the fee filters of our peers: invs, getdatas and txs/certificates
+    static void RecordBytesFeeFiltered(uint64_t bytes);
+
     static uint64_t GetTotalBytesRecv();
     static uint64_t GetTotalBytesSent();
+    static uint64_t GetTotalBytesFeeFiltered();
 
     // resource deallocation on cleanup, called at node shutdown
     static void NetCleanup();
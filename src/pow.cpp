@@ -79,33 +79,68 @@ unsigned int CalculateNextWorkRequired(arith_uint256 bnAvg,
     return bnNew.GetCompact();
 }
 
+/** Serialize the BLAKE2b input of the Equihash solution: I||V, the block header minus solution */
+static void SerializeEquihashInput(const CBlockHeader& header, CDataStream& ss)
+{
+    // I = the block header minus nonce and solution.
+    CEquihashInput I{header};
+    ss.clear();
+    ss << I;
+    ss << header.nNonce;
+}
+
 bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& params)
 {
     unsigned int n = params.EquihashN();
     unsigned int k = params.EquihashK();
 
-    // Hash state
-    crypto_generichash_blake2b_state state;
-    EhInitialiseState(n, k, state);
-
-    // I = the block header minus nonce and solution.
-    CEquihashInput I{*pblock};
     // I||V
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss << I;
-    ss << pblock->nNonce;
-
-    // H(I||V||...
-    crypto_generichash_blake2b_update(&state, (unsigned char*)&ss[0], ss.size());
+    SerializeEquihashInput(*pblock, ss);
 
     bool isValid;
-    EhIsValidSolution(n, k, state, pblock->nSolution, isValid);
+    EhIsValidSolutionOfInput(n, k, (const unsigned char*)&ss[0], ss.size(), pblock->nSolution, isValid);
     if (!isValid)
         return error("CheckEquihashSolution(): invalid solution");
 
     return true;
 }
 
+template<unsigned int N, unsigned int K>
+static bool CheckEquihashSolutions(Equihash<N,K>& eh, const std::vector<CBlockHeader>& headers, std::vector<bool>& vValid)
+{
+    // The verifier memory and the input buffer are shared by all of the headers
+    std::unique_ptr<typename Equihash<N,K>::VerifyScratch> scratch(new typename Equihash<N,K>::VerifyScratch);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    bool fAllValid = true;
+    vValid.assign(headers.size(), false);
+    for (size_t i = 0; i < headers.size(); i++) {
+        SerializeEquihashInput(headers[i], ss);
+        vValid[i] = eh.IsValidSolution((const unsigned char*)&ss[0], ss.size(),
+                                       headers[i].nSolution.data(), headers[i].nSolution.size(), *scratch);
+        fAllValid &= vValid[i];
+    }
+    return fAllValid;
+}
+
+bool CheckEquihashSolutions(const std::vector<CBlockHeader>& headers, const CChainParams& params, std::vector<bool>& vValid)
+{
+    unsigned int n = params.EquihashN();
+    unsigned int k = params.EquihashK();
+
+    if (n == 96 && k == 3) {
+        return CheckEquihashSolutions(Eh96_3, headers, vValid);
+    } else if (n == 200 && k == 9) {
+        return CheckEquihashSolutions(Eh200_9, headers, vValid);
+    } else if (n == 96 && k == 5) {
+        return CheckEquihashSolutions(Eh96_5, headers, vValid);
+    } else if (n == 48 && k == 5) {
+        return CheckEquihashSolutions(Eh48_5, headers, vValid);
+    } else {
+        throw std::invalid_argument("Unsupported Equihash parameters");
+    }
+}
+
 /** extracted from rpc command generate and reused in UTs **/
 void generateEquihash(CBlock& block)
 {
@@ -6,6 +6,7 @@
 #define BITCOIN_POW_H
 
 #include <stdint.h>
+#include <vector>
 
 namespace Consensus {
     class Params;
@@ -25,6 +26,8 @@ unsigned int CalculateNextWorkRequired(arith_uint256 bnAvg,
 
 /** Check whether the Equihash solution in a block header is valid */
 bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams&);
+/** Check the Equihash solutions of many headers at once, vValid receiving the result of each: return whether all are valid */
+bool CheckEquihashSolutions(const std::vector<CBlockHeader>& headers, const CChainParams&, std::vector<bool>& vValid);
 
 /** extracted from rpc command generate and reused in UTs **/
 void generateEquihash(CBlock& block);
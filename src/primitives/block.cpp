@@ -6,6 +6,7 @@
 #include "primitives/block.h"
 
 #include "hash.h"
+#include "crypto/sha256.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "crypto/common.h"
@@ -126,22 +127,28 @@ uint256 CBlock::BuildMerkleTree(std::vector<uint256>& vMerkleTreeIn, size_t vtxS
     bool mutated = false;
     for (int nSize = vtxSize; nSize > 1; nSize = (nSize + 1) / 2)
     {
+        if (nSize % 2 == 0 && vMerkleTreeIn[j+nSize-2] == vMerkleTreeIn[j+nSize-1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        // The pairs of siblings lie next to each other: hash them all at once as 64 bytes blobs,
+        // the last one of an odd level is paired with itself
+        size_t nOut = vMerkleTreeIn.size();
+        vMerkleTreeIn.resize(nOut + (nSize + 1) / 2);
+        SHA256D64(vMerkleTreeIn[nOut].begin(), vMerkleTreeIn[j].begin(), nSize / 2);
+        if (nSize % 2)
+            vMerkleTreeIn.back() = Hash(BEGIN(vMerkleTreeIn[j+nSize-1]), END(vMerkleTreeIn[j+nSize-1]),
+                                        BEGIN(vMerkleTreeIn[j+nSize-1]), END(vMerkleTreeIn[j+nSize-1]));
+#ifdef DEBUG_MKLTREE_HASH
         for (int i = 0; i < nSize; i += 2)
         {
             int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTreeIn[j+i] == vMerkleTreeIn[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTreeIn.push_back(Hash(BEGIN(vMerkleTreeIn[j+i]),  END(vMerkleTreeIn[j+i]),
-                                         BEGIN(vMerkleTreeIn[j+i2]), END(vMerkleTreeIn[j+i2])));
-#ifdef DEBUG_MKLTREE_HASH
             std::cout << " -------------------------------------------" << std::endl;
-            std::cout << i << ") mkl hash: " << vMerkleTreeIn.back().ToString() << std::endl;
+            std::cout << i << ") mkl hash: " << vMerkleTreeIn[nOut + i/2].ToString() << std::endl;
             std::cout <<      "      hash1: " << vMerkleTreeIn[j+i].ToString() << std::endl;
             std::cout <<      "      hash2: " << vMerkleTreeIn[j+i2].ToString() << std::endl;
-#endif
         }
+#endif
         j += nSize;
     }
     if (fMutated) {
@@ -5,17 +5,24 @@
 
 #include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "hash.h"
 #include "main.h"
 #include "httpserver.h"
 #include "rpc/server.h"
+#include "sc/sidechain.h"
+#include "sc/sidechainrpc.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <list>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/dynamic_bitset.hpp>
+#include <boost/function.hpp>
 
 #include <univalue.h>
 
@@ -57,11 +64,14 @@ struct CCoin {
 };
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
+extern void CertToJSON(const CScCertificate& cert, const uint256 hashBlock, UniValue& entry);
 extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
 extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
+extern bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechain::State scState,
+    const CCoinsViewCache& scView, UniValue& sc, bool bOnlyAlive, bool bVerbose);
 
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message)
 {
@@ -70,6 +80,53 @@ static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message
     return false;
 }
 
+/** Write the JSON of a block to stream. With the details of its transactions,
+ * only one of them is held in memory at a time. */
+static void WriteBlockJSON(HTTPReplyStream& stream, const CBlock& block, const CBlockIndex* pblockindex, bool showTxDetails)
+{
+    const std::function<void(std::string&)> flush = [&stream](std::string&) { stream.Flush(); };
+    std::string& s = stream.Buffer();
+
+    // Same members as blockToJSON(block, pblockindex, true), with tx and cert expanded while written
+    UniValue objBlock = blockToJSON(block, pblockindex, false);
+    if (!showTxDetails) {
+        objBlock.write(s, flush);
+        return;
+    }
+    const std::vector<std::string>& keys = objBlock.getKeys();
+    const std::vector<UniValue>& values = objBlock.getValues();
+    s += "{";
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (i > 0)
+            s += ",";
+        s += UniValue(keys[i]).write() + ":";
+        if (keys[i] == "tx") {
+            s += "[";
+            for (size_t n = 0; n < block.vtx.size(); n++) {
+                if (n > 0)
+                    s += ",";
+                UniValue objTx(UniValue::VOBJ);
+                TxToJSON(block.vtx[n], uint256(), objTx);
+                objTx.write(s, flush);
+            }
+            s += "]";
+        } else if (keys[i] == "cert") {
+            s += "[";
+            for (size_t n = 0; n < block.vcert.size(); n++) {
+                if (n > 0)
+                    s += ",";
+                UniValue objCert(UniValue::VOBJ);
+                CertToJSON(block.vcert[n], uint256(), objCert);
+                objCert.write(s, flush);
+            }
+            s += "]";
+        } else {
+            values[i].write(s, flush);
+        }
+    }
+    s += "}";
+}
+
 static enum RetFormat ParseDataFormat(vector<string>& params, const string& strReq)
 {
     boost::split(params, strReq, boost::is_any_of("."));
@@ -237,10 +294,11 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        string strJSON = objBlock.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        HTTPReplyStream stream(req, HTTP_OK);
+        WriteBlockJSON(stream, block, pblockindex, showTxDetails);
+        stream.Buffer() += "\n";
+        stream.End();
         return true;
     }
 
@@ -324,9 +382,11 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
     case RF_JSON: {
         UniValue mempoolObject = mempoolToJSON(true);
 
-        string strJSON = mempoolObject.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        HTTPReplyStream stream(req, HTTP_OK);
+        mempoolObject.write(stream.Buffer(), [&stream](std::string&) { stream.Flush(); });
+        stream.Buffer() += "\n";
+        stream.End();
         return true;
     }
     default: {
@@ -587,6 +647,244 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+/**
+ * Replies of the sidechain state endpoints, keyed by their ETag. An ETag commits to
+ * the chain tip, to the mempool update counter and to the URI, so that a poller whose
+ * state did not move is answered without cs_main, and the cache is dropped as a whole
+ * as soon as the tip or the mempool change. Within a generation, the oldest replies are
+ * evicted to keep the tags and bodies within MAX_REST_STATE_CACHE_BYTES.
+ */
+static const size_t MAX_REST_STATE_CACHE_BYTES = 16 * 1024 * 1024;
+static CCriticalSection cs_restStateCache;
+static uint256 restStateGeneration;
+static std::map<std::string, std::string> mapRestStateCache;
+//! Tags of mapRestStateCache, oldest first
+static std::list<std::string> listRestStateCache;
+static size_t nRestStateCacheBytes = 0;
+
+static void ResetRESTStateCache(const uint256& generation)
+{
+    AssertLockHeld(cs_restStateCache);
+    if (restStateGeneration == generation)
+        return;
+    mapRestStateCache.clear();
+    listRestStateCache.clear();
+    nRestStateCacheBytes = 0;
+    restStateGeneration = generation;
+}
+
+static void AddRESTStateCache(const std::string& strETag, const std::string& strBody)
+{
+    AssertLockHeld(cs_restStateCache);
+    const size_t nBytes = strETag.size() + strBody.size();
+    if (nBytes > MAX_REST_STATE_CACHE_BYTES || mapRestStateCache.count(strETag))
+        return;
+    while (nRestStateCacheBytes + nBytes > MAX_REST_STATE_CACHE_BYTES) {
+        std::map<std::string, std::string>::iterator it = mapRestStateCache.find(listRestStateCache.front());
+        nRestStateCacheBytes -= it->first.size() + it->second.size();
+        mapRestStateCache.erase(it);
+        listRestStateCache.pop_front();
+    }
+    mapRestStateCache[strETag] = strBody;
+    listRestStateCache.push_back(strETag);
+    nRestStateCacheBytes += nBytes;
+}
+
+/** Fills the binary or the JSON representation of a state reply, returns false if not found. Called with cs_main held. */
+typedef boost::function<bool(bool fJSON, CDataStream& ssBinary, UniValue& json)> RESTStateBuilder;
+
+static uint256 GetRESTStateGeneration()
+{
+    std::shared_ptr<const CChainSnapshot> chain = chainActive.Snapshot();
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << (chain->Tip() ? chain->Tip()->GetBlockHash() : uint256());
+    ss << mempool.GetTransactionsUpdated();
+    return ss.GetHash();
+}
+
+static string GetRESTStateETag(const uint256& generation, const std::string& strURIPart)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << generation << strURIPart;
+    return "\"" + ss.GetHash().GetHex() + "\"";
+}
+
+static void WriteRESTStateReply(HTTPRequest* req, enum RetFormat rf, const std::string& strETag, const std::string& strBody)
+{
+    switch (rf) {
+    case RF_BINARY:
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        break;
+    case RF_HEX:
+        req->WriteHeader("Content-Type", "text/plain");
+        break;
+    default:
+        req->WriteHeader("Content-Type", "application/json");
+        break;
+    }
+    req->WriteHeader("ETag", strETag);
+    req->WriteReply(HTTP_OK, strBody);
+}
+
+static bool rest_state(HTTPRequest* req, const std::string& strURIPart, enum RetFormat rf,
+                       const RESTStateBuilder& build, const std::string& strNotFound)
+{
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    uint256 generation = GetRESTStateGeneration();
+    string strETag = GetRESTStateETag(generation, strURIPart);
+
+    std::pair<bool, std::string> ifNoneMatch = req->GetHeader("If-None-Match");
+    if (ifNoneMatch.first && ifNoneMatch.second == strETag) {
+        req->WriteHeader("ETag", strETag);
+        req->WriteReply(HTTP_NOT_MODIFIED);
+        return true;
+    }
+
+    {
+        LOCK(cs_restStateCache);
+        ResetRESTStateCache(generation);
+        std::map<std::string, std::string>::const_iterator it = mapRestStateCache.find(strETag);
+        if (it != mapRestStateCache.end()) {
+            WriteRESTStateReply(req, rf, strETag, it->second);
+            return true;
+        }
+    }
+
+    string strBody;
+    {
+        LOCK(cs_main);
+        // the state can't move any more: tag the reply with what it is built from
+        generation = GetRESTStateGeneration();
+        strETag = GetRESTStateETag(generation, strURIPart);
+
+        CDataStream ssBinary(SER_NETWORK, PROTOCOL_VERSION);
+        UniValue json(UniValue::VOBJ);
+        if (!build(rf == RF_JSON, ssBinary, json))
+            return RESTERR(req, HTTP_NOT_FOUND, strNotFound);
+
+        if (rf == RF_BINARY)
+            strBody = ssBinary.str();
+        else if (rf == RF_HEX)
+            strBody = HexStr(ssBinary.begin(), ssBinary.end()) + "\n";
+        else
+            strBody = json.write() + "\n";
+    }
+
+    {
+        LOCK(cs_restStateCache);
+        ResetRESTStateCache(generation);
+        AddRESTStateCache(strETag, strBody);
+    }
+
+    WriteRESTStateReply(req, rf, strETag, strBody);
+    return true;
+}
+
+static bool BuildSidechainState(const uint256& scId, bool fJSON, CDataStream& ssBinary, UniValue& json)
+{
+    CCoinsViewCache scView(pcoinsTip);
+    CSidechain info;
+    if (!scView.GetSidechain(scId, info))
+        return false;
+    const CSidechain::State scState = scView.GetSidechainState(scId);
+
+    if (fJSON)
+        FillScRecordFromInfo(scId, info, scState, scView, json, false, true);
+    else
+        ssBinary << static_cast<uint8_t>(scState) << info;
+    return true;
+}
+
+static bool rest_sidechain(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    uint256 scId;
+    if (!ParseHashStr(params[0], scId))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid scid: " + params[0]);
+
+    return rest_state(req, "sidechain/" + strURIPart, rf,
+                      boost::bind(BuildSidechainState, scId, _1, _2, _3), params[0] + " not found");
+}
+
+static bool BuildCertState(const uint256& hash, bool fJSON, CDataStream& ssBinary, UniValue& json)
+{
+    CScCertificate cert;
+    uint256 hashBlock;
+    if (!GetCertificate(hash, cert, hashBlock, true))
+        return false;
+
+    if (fJSON) {
+        CertToJSON(cert, hashBlock, json);
+        CTxIndexValue txIndexValue;
+        if (fTxIndex && !hashBlock.IsNull() && pblocktree->ReadTxIndex(hash, txIndexValue))
+            json.pushKV("maturityHeight", txIndexValue.maturityHeight);
+    } else {
+        ssBinary << cert;
+    }
+    return true;
+}
+
+static bool rest_cert(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    uint256 hash;
+    if (!ParseHashStr(params[0], hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + params[0]);
+
+    return rest_state(req, "cert/" + strURIPart, rf,
+                      boost::bind(BuildCertState, hash, _1, _2, _3), params[0] + " not found");
+}
+
+static bool BuildCswNullifierState(const uint256& scId, const CFieldElement& nullifier,
+                                   bool fJSON, CDataStream& ssBinary, UniValue& json)
+{
+    const bool fSpent = pcoinsTip->HaveCswNullifier(scId, nullifier);
+    // same reply as the checkcswnullifier rpc
+    if (fJSON)
+        json.pushKV("data", fSpent ? "true" : "false");
+    else
+        ssBinary << fSpent;
+    return true;
+}
+
+static bool rest_cswnullifier(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No nullifier specified. Use /rest/cswnullifier/<scid>/<nullifier>.<ext>.");
+
+    uint256 scId;
+    if (!ParseHashStr(path[0], scId))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid scid: " + path[0]);
+
+    std::string strError;
+    std::vector<unsigned char> vNullifier;
+    if (!Sidechain::AddScData(path[1], vNullifier, CFieldElement::ByteSize(), Sidechain::CheckSizeMode::CHECK_STRICT, strError))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid nullifier: " + strError);
+    CFieldElement nullifier{vNullifier};
+    if (!nullifier.IsValid())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid nullifier: " + path[1]);
+
+    return rest_state(req, "cswnullifier/" + strURIPart, rf,
+                      boost::bind(BuildCswNullifierState, scId, nullifier, _1, _2, _3), "");
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -599,6 +897,9 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/sidechain/", rest_sidechain},
+      {"/rest/cert/", rest_cert},
+      {"/rest/cswnullifier/", rest_cswnullifier},
 };
 
 bool StartREST()
@@ -116,12 +116,15 @@ static UniValue ValuePoolDesc(
 
 UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 {
+    // Only immutable header fields are read, so no need for cs_main
+    std::shared_ptr<const CChainSnapshot> chain = chainActive.Snapshot();
+
     UniValue result(UniValue::VOBJ);
     result.pushKV("hash", blockindex->GetBlockHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (chain->Contains(blockindex))
+        confirmations = chain->Height() - blockindex->nHeight + 1;
     result.pushKV("confirmations", confirmations);
     result.pushKV("height", blockindex->nHeight);
     result.pushKV("version", blockindex->nVersion);
@@ -137,7 +140,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    const CBlockIndex *pnext = chain->Next(blockindex);
     if (pnext)
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
     return result;
@@ -147,7 +150,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 {
     UniValue result(UniValue::VOBJ);
-    result.pushKV("hash", block.GetHash().GetHex());
+    result.pushKVEnd("hash", block.GetHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
     if (chainActive.Contains(blockindex)) {
@@ -155,21 +158,22 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
     } else {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block is an orphan");
     }
-    result.pushKV("confirmations", confirmations);
-    result.pushKV("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
-    result.pushKV("height", blockindex->nHeight);
-    result.pushKV("version", block.nVersion);
-    result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
+    result.pushKVEnd("confirmations", confirmations);
+    result.pushKVEnd("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    result.pushKVEnd("height", blockindex->nHeight);
+    result.pushKVEnd("version", block.nVersion);
+    result.pushKVEnd("merkleroot", block.hashMerkleRoot.GetHex());
 
     UniValue deltas(UniValue::VARR);
+    deltas.reserve(block.vtx.size());
 
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
         const CTransaction &tx = block.vtx[i];
         const uint256 txhash = tx.GetHash();
 
         UniValue entry(UniValue::VOBJ);
-        entry.pushKV("txid", txhash.GetHex());
-        entry.pushKV("index", (int)i);
+        entry.pushKVEnd("txid", txhash.GetHex());
+        entry.pushKVEnd("index", (int)i);
 
         UniValue inputs(UniValue::VARR);
 
@@ -185,18 +189,18 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 
                 if (GetSpentIndex(spentKey, spentInfo)) {
                     if (spentInfo.addressType == 1) {
-                        delta.pushKV("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString());
+                        delta.pushKVEnd("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString());
                     } else if (spentInfo.addressType == 2)  {
-                        delta.pushKV("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString());
+                        delta.pushKVEnd("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString());
                     } else {
                         continue;
                     }
-                    delta.pushKV("satoshis", -1 * spentInfo.satoshis);
-                    delta.pushKV("index", (int)j);
-                    delta.pushKV("prevtxid", input.prevout.hash.GetHex());
-                    delta.pushKV("prevout", (int)input.prevout.n);
+                    delta.pushKVEnd("satoshis", -1 * spentInfo.satoshis);
+                    delta.pushKVEnd("index", (int)j);
+                    delta.pushKVEnd("prevtxid", input.prevout.hash.GetHex());
+                    delta.pushKVEnd("prevout", (int)input.prevout.n);
 
-                    inputs.push_back(delta);
+                    inputs.push_back(std::move(delta));
                 } else {
                     throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
                 }
@@ -204,7 +208,7 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
             }
         }
 
-        entry.pushKV("inputs", inputs);
+        entry.pushKVEnd("inputs", std::move(inputs));
 
         UniValue outputs(UniValue::VARR);
 
@@ -216,37 +220,37 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
             uint160 const addrHash = out.scriptPubKey.AddressHash();
 
             if (out.scriptPubKey.IsPayToScriptHash()) {
-                delta.pushKV("address", CBitcoinAddress(CScriptID(addrHash)).ToString());
+                delta.pushKVEnd("address", CBitcoinAddress(CScriptID(addrHash)).ToString());
 
             } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                delta.pushKV("address", CBitcoinAddress(CKeyID(addrHash)).ToString());
+                delta.pushKVEnd("address", CBitcoinAddress(CKeyID(addrHash)).ToString());
             } else {
                 continue;
             }
 
-            delta.pushKV("satoshis", out.nValue);
-            delta.pushKV("index", (int)k);
+            delta.pushKVEnd("satoshis", out.nValue);
+            delta.pushKVEnd("index", (int)k);
 
-            outputs.push_back(delta);
+            outputs.push_back(std::move(delta));
         }
 
-        entry.pushKV("outputs", outputs);
-        deltas.push_back(entry);
+        entry.pushKVEnd("outputs", std::move(outputs));
+        deltas.push_back(std::move(entry));
 
     }
-    result.pushKV("deltas", deltas);
-    result.pushKV("time", block.GetBlockTime());
-    result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
-    result.pushKV("nonce", block.nNonce.GetHex());
-    result.pushKV("bits", strprintf("%08x", block.nBits));
-    result.pushKV("difficulty", GetDifficulty(blockindex));
-    result.pushKV("chainwork", blockindex->nChainWork.GetHex());
+    result.pushKVEnd("deltas", std::move(deltas));
+    result.pushKVEnd("time", block.GetBlockTime());
+    result.pushKVEnd("mediantime", (int64_t)blockindex->GetMedianTimePast());
+    result.pushKVEnd("nonce", block.nNonce.GetHex());
+    result.pushKVEnd("bits", strprintf("%08x", block.nBits));
+    result.pushKVEnd("difficulty", GetDifficulty(blockindex));
+    result.pushKVEnd("chainwork", blockindex->nChainWork.GetHex());
 
     if (blockindex->pprev)
-        result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+        result.pushKVEnd("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
-        result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
+        result.pushKVEnd("nextblockhash", pnext->GetBlockHash().GetHex());
     return result;
 }
 #endif // ENABLE_ADDRESS_INDEXING
@@ -254,70 +258,72 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
 {
     UniValue result(UniValue::VOBJ);
-    result.pushKV("hash", block.GetHash().GetHex());
+    result.pushKVEnd("hash", block.GetHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
     if (chainActive.Contains(blockindex))
         confirmations = chainActive.Height() - blockindex->nHeight + 1;
 
-    result.pushKV("confirmations", confirmations);
-    result.pushKV("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
-    result.pushKV("height", blockindex->nHeight);
-    result.pushKV("version", block.nVersion);
-    result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
-    result.pushKV("scTxsCommitment", block.hashScTxsCommitment.GetHex());
+    result.pushKVEnd("confirmations", confirmations);
+    result.pushKVEnd("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    result.pushKVEnd("height", blockindex->nHeight);
+    result.pushKVEnd("version", block.nVersion);
+    result.pushKVEnd("merkleroot", block.hashMerkleRoot.GetHex());
+    result.pushKVEnd("scTxsCommitment", block.hashScTxsCommitment.GetHex());
 
     UniValue txs(UniValue::VARR);
+    txs.reserve(block.vtx.size());
     BOOST_FOREACH(const CTransaction&tx, block.vtx)
     {
         if(txDetails)
         {
             UniValue objTx(UniValue::VOBJ);
             TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
+            txs.push_back(std::move(objTx));
         }
         else
             txs.push_back(tx.GetHash().GetHex());
     }
 
-    result.pushKV("tx", txs);
+    result.pushKVEnd("tx", std::move(txs));
     if (block.nVersion == BLOCK_VERSION_SC_SUPPORT)
     {
         UniValue certs(UniValue::VARR);
+        certs.reserve(block.vcert.size());
         BOOST_FOREACH(const CScCertificate& cert, block.vcert)
         {
             if(txDetails)
             {
                 UniValue objCert(UniValue::VOBJ);
                 CertToJSON(cert, uint256(), objCert);
-                certs.push_back(objCert);
+                certs.push_back(std::move(objCert));
             }
             else
             {
                 certs.push_back(cert.GetHash().GetHex());
             }
         }
-        result.pushKV("cert", certs);
+        result.pushKVEnd("cert", std::move(certs));
     }
 
-    result.pushKV("time", block.GetBlockTime());
-    result.pushKV("nonce", block.nNonce.GetHex());
-    result.pushKV("solution", HexStr(block.nSolution));
-    result.pushKV("bits", strprintf("%08x", block.nBits));
-    result.pushKV("difficulty", GetDifficulty(blockindex));
-    result.pushKV("chainwork", blockindex->nChainWork.GetHex());
-    result.pushKV("anchor", blockindex->hashAnchorEnd.GetHex());
-    result.pushKV("scCumTreeHash", blockindex->scCumTreeHash.GetHexRepr());
+    result.pushKVEnd("time", block.GetBlockTime());
+    result.pushKVEnd("nonce", block.nNonce.GetHex());
+    result.pushKVEnd("solution", HexStr(block.nSolution));
+    result.pushKVEnd("bits", strprintf("%08x", block.nBits));
+    result.pushKVEnd("difficulty", GetDifficulty(blockindex));
+    result.pushKVEnd("chainwork", blockindex->nChainWork.GetHex());
+    result.pushKVEnd("anchor", blockindex->hashAnchorEnd.GetHex());
+    result.pushKVEnd("scCumTreeHash", blockindex->scCumTreeHash.GetHexRepr());
 
     UniValue valuePools(UniValue::VARR);
     valuePools.push_back(ValuePoolDesc("sprout", blockindex->nChainSproutValue, blockindex->nSproutValue));
-    result.pushKV("valuePools", valuePools);
+    result.pushKVEnd("valuePools", std::move(valuePools));
 
     if (blockindex->pprev)
-        result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+        result.pushKVEnd("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
-        result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
+        result.pushKVEnd("nextblockhash", pnext->GetBlockHash().GetHex());
     return result;
 }
 
@@ -336,8 +342,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return chainActive.Snapshot()->Height();
 }
 
 UniValue getbestblockhash(const UniValue& params, bool fHelp)
@@ -355,8 +360,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return chainActive.Snapshot()->Tip()->GetBlockHash().GetHex();
 }
 
 UniValue getdifficulty(const UniValue& params, bool fHelp)
@@ -387,7 +391,7 @@ static void AddDependancy(const CTransactionBase& root, UniValue& info)
         depends.push_back(hash.ToString());
     }
 
-    info.pushKV("depends", depends);
+    info.pushKVEnd("depends", std::move(depends));
 }
 
 UniValue mempoolToJSON(bool fVerbose = false)
@@ -401,34 +405,34 @@ UniValue mempoolToJSON(bool fVerbose = false)
             const uint256& hash = entry.first;
             const CTxMemPoolEntry& e = entry.second;
             UniValue info(UniValue::VOBJ);
-            info.pushKV("size", (int)e.GetTxSize());
-            info.pushKV("fee", ValueFromAmount(e.GetFee()));
-            info.pushKV("time", e.GetTime());
-            info.pushKV("height", (int)e.GetHeight());
-            info.pushKV("startingpriority", e.GetPriority(e.GetHeight()));
-            info.pushKV("currentpriority", e.GetPriority(chainActive.Height()));
-            info.pushKV("isCert", false);
+            info.pushKVEnd("size", (int)e.GetTxSize());
+            info.pushKVEnd("fee", ValueFromAmount(e.GetFee()));
+            info.pushKVEnd("time", e.GetTime());
+            info.pushKVEnd("height", (int)e.GetHeight());
+            info.pushKVEnd("startingpriority", e.GetPriority(e.GetHeight()));
+            info.pushKVEnd("currentpriority", e.GetPriority(chainActive.Height()));
+            info.pushKVEnd("isCert", false);
             const CTransaction& tx = e.GetTx();
-            info.pushKV("version", tx.nVersion);
+            info.pushKVEnd("version", tx.nVersion);
             AddDependancy(tx, info);
-            o.pushKV(hash.ToString(), info);
+            o.pushKVEnd(hash.ToString(), std::move(info));
         }
         BOOST_FOREACH(const PAIRTYPE(uint256, CCertificateMemPoolEntry)& entry, mempool.mapCertificate)
         {
             const uint256& hash = entry.first;
             const auto& e = entry.second;
             UniValue info(UniValue::VOBJ);
-            info.pushKV("size", (int)e.GetCertificateSize());
-            info.pushKV("fee", ValueFromAmount(e.GetFee()));
-            info.pushKV("time", e.GetTime());
-            info.pushKV("height", (int)e.GetHeight());
-            info.pushKV("startingpriority", e.GetPriority(e.GetHeight()));
-            info.pushKV("currentpriority", e.GetPriority(chainActive.Height()));
-            info.pushKV("isCert", true);
+            info.pushKVEnd("size", (int)e.GetCertificateSize());
+            info.pushKVEnd("fee", ValueFromAmount(e.GetFee()));
+            info.pushKVEnd("time", e.GetTime());
+            info.pushKVEnd("height", (int)e.GetHeight());
+            info.pushKVEnd("startingpriority", e.GetPriority(e.GetHeight()));
+            info.pushKVEnd("currentpriority", e.GetPriority(chainActive.Height()));
+            info.pushKVEnd("isCert", true);
             const CScCertificate& cert = e.GetCertificate();
-            info.pushKV("version", cert.nVersion);
+            info.pushKVEnd("version", cert.nVersion);
             AddDependancy(cert, info);
-            o.pushKV(hash.ToString(), info);
+            o.pushKVEnd(hash.ToString(), std::move(info));
         }
         BOOST_FOREACH(const auto& entry, mempool.mapDeltas)
         {
@@ -436,9 +440,10 @@ UniValue mempoolToJSON(bool fVerbose = false)
             const auto& p = entry.second.first;
             const auto& f = entry.second.second;
             UniValue info(UniValue::VOBJ);
-            info.pushKV("fee", ValueFromAmount(f));
-            info.pushKV("priority", p);
-            o.pushKV(hash.ToString(), info);
+            info.pushKVEnd("fee", ValueFromAmount(f));
+            info.pushKVEnd("priority", p);
+            // may replace the entry of a transaction in the pool
+            o.pushKV(hash.ToString(), std::move(info));
         }
         return o;
     }
@@ -615,13 +620,13 @@ UniValue getblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
-    LOCK(cs_main);
+    std::shared_ptr<const CChainSnapshot> chain = chainActive.Snapshot();
 
     int nHeight = params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    if (nHeight < 0 || nHeight > chain->Height())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    const CBlockIndex* pblockindex = (*chain)[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -660,8 +665,6 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -669,10 +672,15 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    // cs_main only guards the lookup: the entry itself is never freed, nor its header modified
+    CBlockIndex* pblockindex = NULL;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mi->second;
+    }
 
     if (!fVerbose)
     {
@@ -1312,76 +1320,101 @@ UniValue getchaintips(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getchaintips", "")
         );
 
-    LOCK(cs_main);
-
     if ((params.size() >= 1) && !params[0].isBool())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "\"with-penalties\" paramenter should be boolean");
 
     bool bShowPenaltyInfo = (params.size() >= 1)? params[0].getBool() : false;
 
-    /* Build up a list of chain tips.  We start with the list of all
-       known blocks, and successively remove blocks that appear as pprev
-       of another block. */
-    std::set<const CBlockIndex*, CompareBlocksByHeight> setTips;
-    for(const PAIRTYPE(const uint256, CBlockIndex*)& item: mapBlockIndex)
-        setTips.insert(item.second);
-    for(const PAIRTYPE(const uint256, CBlockIndex*)& item: mapBlockIndex) {
-        const CBlockIndex* pprev = item.second->pprev;
-        if (pprev)
-            setTips.erase(pprev);
-    }
+    /* What is reported about a tip: gathered under cs_main, turned into JSON once it is released */
+    struct ChainTip
+    {
+        const CBlockIndex* pindex;
+        int branchLen;
+        const char* status;
+        int64_t penaltyAtStart;
+        int64_t penaltyAtTip;
+        int64_t blocksToMainchain;
+    };
+    std::vector<ChainTip> vTips;
+
+    {
+        LOCK(cs_main);
 
-    // Always report the currently active tip.
-    setTips.insert(chainActive.Tip());
+        /* Build up a list of chain tips.  We start with the list of all
+           known blocks, and successively remove blocks that appear as pprev
+           of another block. */
+        std::set<const CBlockIndex*, CompareBlocksByHeight> setTips;
+        for(const PAIRTYPE(const uint256, CBlockIndex*)& item: mapBlockIndex)
+            setTips.insert(item.second);
+        for(const PAIRTYPE(const uint256, CBlockIndex*)& item: mapBlockIndex) {
+            const CBlockIndex* pprev = item.second->pprev;
+            if (pprev)
+                setTips.erase(pprev);
+        }
+
+        // Always report the currently active tip.
+        setTips.insert(chainActive.Tip());
+
+        vTips.reserve(setTips.size());
+        for(const CBlockIndex* forkTip: setTips) {
+            ChainTip tip = {forkTip, 0, "", 0, 0, 0};
+            tip.branchLen = forkTip->nHeight - chainActive.FindFork(forkTip)->nHeight;
+
+            if (chainActive.Contains(forkTip)) {
+                // This block is part of the currently active chain.
+                tip.status = "active";
+            } else if (forkTip->nStatus & BLOCK_FAILED_MASK) {
+                // This block or one of its ancestors is invalid.
+                tip.status = "invalid";
+            } else if (forkTip->nChainTx == 0) {
+                // This block cannot be connected because full block data for it or one of its parents is missing.
+                tip.status = "headers-only";
+            } else if (forkTip->IsValid(BLOCK_VALID_SCRIPTS)) {
+                // This block is fully validated, but no longer part of the active chain. It was probably the active block once, but was reorganized.
+                tip.status = "valid-fork";
+            } else if (forkTip->IsValid(BLOCK_VALID_TREE)) {
+                // The headers for this block are valid, but it has not been validated. It was probably never part of the most-work chain.
+                tip.status = "valid-headers";
+            } else {
+                // No clue.
+                tip.status = "unknown";
+            }
+
+            if (bShowPenaltyInfo)
+            {
+                // the block right after the fork base, reached through the skip list
+                const CBlockIndex* pForkBase = chainActive.FindFork(forkTip);
+                const CBlockIndex* pFirstBlockInBranch = forkTip;
+                if (pForkBase && pForkBase != forkTip)
+                    pFirstBlockInBranch = forkTip->GetAncestor(pForkBase->nHeight + 1);
+
+                tip.penaltyAtStart = pFirstBlockInBranch->nChainDelay;
+                tip.penaltyAtTip = forkTip->nChainDelay;
+                if (forkTip != chainActive.Tip())
+                    tip.blocksToMainchain = blocksToOvertakeTarget(forkTip, chainActive.Tip());
+            }
+
+            vTips.push_back(tip);
+        }
+    }
 
     /* Construct the output array.  */
     UniValue res(UniValue::VARR);
-    for(const CBlockIndex* forkTip: setTips) {
+    res.reserve(vTips.size());
+    for(const ChainTip& tip: vTips) {
         UniValue obj(UniValue::VOBJ);
-        obj.pushKV("height", forkTip->nHeight);
-        obj.pushKV("hash", forkTip->phashBlock->GetHex());
-
-        const int branchLen = forkTip->nHeight - chainActive.FindFork(forkTip)->nHeight;
-        obj.pushKV("branchlen", branchLen);
-
-        string status;
-        if (chainActive.Contains(forkTip)) {
-            // This block is part of the currently active chain.
-            status = "active";
-        } else if (forkTip->nStatus & BLOCK_FAILED_MASK) {
-            // This block or one of its ancestors is invalid.
-            status = "invalid";
-        } else if (forkTip->nChainTx == 0) {
-            // This block cannot be connected because full block data for it or one of its parents is missing.
-            status = "headers-only";
-        } else if (forkTip->IsValid(BLOCK_VALID_SCRIPTS)) {
-            // This block is fully validated, but no longer part of the active chain. It was probably the active block once, but was reorganized.
-            status = "valid-fork";
-        } else if (forkTip->IsValid(BLOCK_VALID_TREE)) {
-            // The headers for this block are valid, but it has not been validated. It was probably never part of the most-work chain.
-            status = "valid-headers";
-        } else {
-            // No clue.
-            status = "unknown";
-        }
-        obj.pushKV("status", status);
-
+        obj.pushKVEnd("height", tip.pindex->nHeight);
+        obj.pushKVEnd("hash", tip.pindex->phashBlock->GetHex());
+        obj.pushKVEnd("branchlen", tip.branchLen);
+        obj.pushKVEnd("status", tip.status);
         if (bShowPenaltyInfo)
         {
-            const CBlockIndex* pFirstBlockInBranch = forkTip;
-            for(; pFirstBlockInBranch != nullptr && pFirstBlockInBranch->pprev != nullptr
-                && !chainActive.Contains(pFirstBlockInBranch->pprev);
-                pFirstBlockInBranch = pFirstBlockInBranch->pprev);
-            
-            obj.pushKV("penalty-at-start",    pFirstBlockInBranch->nChainDelay);
-            obj.pushKV("penalty-at-tip",      forkTip->nChainDelay);
-            if (forkTip == chainActive.Tip())
-                obj.pushKV("blocks-to-mainchain", 0);
-            else
-                obj.pushKV("blocks-to-mainchain", blocksToOvertakeTarget(forkTip, chainActive.Tip()));
+            obj.pushKVEnd("penalty-at-start",    tip.penaltyAtStart);
+            obj.pushKVEnd("penalty-at-tip",      tip.penaltyAtTip);
+            obj.pushKVEnd("blocks-to-mainchain", tip.blocksToMainchain);
         }
 
-        res.push_back(obj);
+        res.push_back(std::move(obj));
     }
 
     return res;
@@ -2238,63 +2271,149 @@ UniValue checkcswnullifier(const UniValue& params, bool fHelp)
     return ret;
 }
 
+// Blocks to mine on a fork tip stemming below the target block to revert it. It only depends on the tip
+// and on the main chain height.
+static int64_t blocksToOvertakeFromTip(const CBlockIndex* forkTip)
+{
+    const int selectedTipHeight = forkTip->nHeight;
+
+    // during a node's life, there might be many tips in the container, it is not useful
+    // keeping all of them into account for calculating the finality, just consider the most recent ones.
+    // Blocks are ordered by height, stop if we exceed a safe limit in depth, lets say the max age
+    if ((chainActive.Height() - selectedTipHeight) >= MAX_BLOCK_AGE_FOR_FINALITY) {
+        LogPrint("forks", "%s():%d - tip h(%d) too old, max age reached: chain[%d]\n",
+                __func__, __LINE__, selectedTipHeight, chainActive.Height());
+        return LLONG_MAX;
+    }
+
+    // finality also depends on the current penalty ongoing on the fork
+    int64_t gap = 0;
+    int64_t forkDelay = forkTip->nChainDelay;
+    if (selectedTipHeight >= chainActive.Height()) {
+        // if forkDelay is null one has to mine 1 block only
+        gap = forkDelay ? forkDelay : 1;
+        LogPrint("forks", "%s():%d - gap[%d], forkDelay[%d]\n", __func__,
+                __LINE__, gap, forkDelay);
+    } else {
+        int64_t dt = chainActive.Height() - selectedTipHeight + 1;
+        dt = dt * (dt + 1) / 2;
+        gap = dt + forkDelay + 1;
+        LogPrint("forks", "%s():%d - gap[%d], forkDelay[%d], dt[%d]\n",
+                __func__, __LINE__, gap, forkDelay, dt);
+    }
+    return gap;
+}
+
+// Blocks to mine from just below the target block, on the main chain, to revert it
+static int64_t blocksToOvertakeFromMainChain(int targetBlockHeight)
+{
+    int64_t gap = 0;
+    int64_t targetToTipDelta = chainActive.Height() - targetBlockHeight + 1;
+
+    // this also handles the main chain tip
+    if (targetToTipDelta < PENALTY_THRESHOLD + 1) {
+        // an attacker can mine from previous block up to tip + 1
+        gap = targetToTipDelta + 1;
+        LogPrint("forks", "%s():%d - gap[%d], delta[%d]\n", __func__,
+                __LINE__, gap, targetToTipDelta);
+    } else {
+        // penalty applies
+        gap = (targetToTipDelta * (targetToTipDelta + 1) / 2);
+        LogPrint("forks", "%s():%d - gap[%d], delta[%d]\n", __func__,
+                __LINE__, gap, targetToTipDelta);
+    }
+    return gap;
+}
+
 int64_t blocksToOvertakeTarget(const CBlockIndex* forkTip, const CBlockIndex* targetBlock)
 {
     //this function assumes forkTip and targetBlock are non-null.
     if (!chainActive.Contains(targetBlock))
         return LLONG_MAX;
 
-    int64_t gap = 0;
-    const int targetBlockHeight = targetBlock->nHeight;
-    const int selectedTipHeight = forkTip->nHeight;
     const int intersectionHeight = chainActive.FindFork(forkTip)->nHeight;
 
     LogPrint("forks", "%s():%d - processing tip h(%d) [%s] forkBaseHeight[%d]\n",
             __func__, __LINE__, forkTip->nHeight, forkTip->GetBlockHash().ToString(),
             intersectionHeight);
 
-    // during a node's life, there might be many tips in the container, it is not useful
-    // keeping all of them into account for calculating the finality, just consider the most recent ones.
-    // Blocks are ordered by height, stop if we exceed a safe limit in depth, lets say the max age
-    if ((chainActive.Height() - selectedTipHeight) >= MAX_BLOCK_AGE_FOR_FINALITY) {
-        LogPrint("forks", "%s():%d - exiting loop on tips, max age reached: forkBaseHeight[%d], chain[%d]\n",
-                __func__, __LINE__, intersectionHeight, chainActive.Height());
-        gap = LLONG_MAX;
-    } else if (intersectionHeight < targetBlockHeight) {
-        // if the fork base is older than the input block, finality also depends on the current penalty
-        // ongoing on the fork
-        int64_t forkDelay = forkTip->nChainDelay;
-        if (selectedTipHeight >= chainActive.Height()) {
-            // if forkDelay is null one has to mine 1 block only
-            gap = forkDelay ? forkDelay : 1;
-            LogPrint("forks", "%s():%d - gap[%d], forkDelay[%d]\n", __func__,
-                    __LINE__, gap, forkDelay);
-        } else {
-            int64_t dt = chainActive.Height() - selectedTipHeight + 1;
-            dt = dt * (dt + 1) / 2;
-            gap = dt + forkDelay + 1;
-            LogPrint("forks", "%s():%d - gap[%d], forkDelay[%d], dt[%d]\n",
-                    __func__, __LINE__, gap, forkDelay, dt);
+    if ((chainActive.Height() - forkTip->nHeight) >= MAX_BLOCK_AGE_FOR_FINALITY)
+        return LLONG_MAX;
+
+    // if the fork base is older than the input block, the fork has to be extended
+    if (intersectionHeight < targetBlock->nHeight)
+        return blocksToOvertakeFromTip(forkTip);
+
+    return blocksToOvertakeFromMainChain(targetBlock->nHeight);
+}
+
+/**
+ * Finality of the main chain blocks. A block is reverted either by out-mining the main chain from just
+ * below it, which only depends on its depth, or by extending a fork tip stemming below it. The latter
+ * only depends on the tip, so the fork tips are summarized once per main chain tip (or fork tips) change,
+ * by fork base height: each query then costs a binary search rather than a walk of every tip.
+ */
+class CFinalityIndexCache
+{
+private:
+    const CBlockIndex* pindexTip = nullptr;
+    uint64_t nForkTipsChanges = 0;
+    //! (fork base height, min gap of the fork tips stemming at that height or below), by fork base height
+    std::vector<std::pair<int, int64_t> > vForkGaps;
+
+    void Rebuild()
+    {
+        std::vector<std::pair<int, int64_t> > vTipGaps;
+        vTipGaps.reserve(mGlobalForkTips.size());
+        for (const auto& mapPair: mGlobalForkTips) {
+            const CBlockIndex* forkTip = mapPair.first;
+            const CBlockIndex* forkBase = chainActive.FindFork(forkTip);
+            if (!forkBase)
+                continue;
+            int64_t gap = blocksToOvertakeFromTip(forkTip);
+            if (gap != LLONG_MAX)
+                vTipGaps.push_back(std::make_pair(forkBase->nHeight, gap));
         }
-    } else {
-        int64_t targetToTipDelta = chainActive.Height() - targetBlockHeight + 1;
-
-        // this also handles the main chain tip
-        if (targetToTipDelta < PENALTY_THRESHOLD + 1) {
-            // an attacker can mine from previous block up to tip + 1
-            gap = targetToTipDelta + 1;
-            LogPrint("forks", "%s():%d - gap[%d], delta[%d]\n", __func__,
-                    __LINE__, gap, targetToTipDelta);
-        } else {
-            // penalty applies
-            gap = (targetToTipDelta * (targetToTipDelta + 1) / 2);
-            LogPrint("forks", "%s():%d - gap[%d], delta[%d]\n", __func__,
-                    __LINE__, gap, targetToTipDelta);
+        std::sort(vTipGaps.begin(), vTipGaps.end());
+
+        vForkGaps.clear();
+        int64_t minGap = LLONG_MAX;
+        for (const auto& tipGap: vTipGaps) {
+            minGap = std::min(minGap, tipGap.second);
+            if (!vForkGaps.empty() && vForkGaps.back().first == tipGap.first)
+                vForkGaps.back().second = minGap;
+            else
+                vForkGaps.push_back(std::make_pair(tipGap.first, minGap));
         }
+
+        pindexTip = chainActive.Tip();
+        nForkTipsChanges = nGlobalForkTipsChanges;
+        LogPrint("forks", "%s():%d - %d fork tips at %d fork bases for tip h(%d)\n",
+            __func__, __LINE__, vTipGaps.size(), vForkGaps.size(), chainActive.Height());
     }
 
-    return gap;
-}
+public:
+    //! targetBlock must be on the main chain. Requires cs_main.
+    int64_t GetFinalityIndex(const CBlockIndex* targetBlock)
+    {
+        AssertLockHeld(cs_main);
+        if (pindexTip != chainActive.Tip() || nForkTipsChanges != nGlobalForkTipsChanges)
+            Rebuild();
+
+        // the main chain tip itself
+        int64_t minGap = blocksToOvertakeFromMainChain(targetBlock->nHeight);
+
+        // the fork tips whose base is below the target
+        auto it = std::lower_bound(vForkGaps.begin(), vForkGaps.end(),
+            std::make_pair(targetBlock->nHeight, std::numeric_limits<int64_t>::min()));
+        if (it != vForkGaps.begin())
+            minGap = std::min(minGap, std::prev(it)->second);
+
+        return minGap;
+    }
+};
+
+static CFinalityIndexCache finalityIndexCache;
 
 UniValue getblockfinalityindex(const UniValue& params, bool fHelp)
 {
@@ -2344,25 +2463,8 @@ UniValue getblockfinalityindex(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Old block: older than 2000!");
     }
 
-    std::set<const CBlockIndex*, CompareBlocksByHeight> setTips;
-    for(auto mapPair: mGlobalForkTips)
-    {
-        const CBlockIndex* idx = mapPair.first;
-        setTips.insert(idx);
-    }
-    setTips.insert(chainActive.Tip());
-
-//    dump_global_tips();
-
-    // For each tip find the stemming block on the main chain
-    // In case of main tip such a block would be the tip itself
-    //-----------------------------------------------------------------------
-    int64_t minGap = LLONG_MAX;
-    for(auto selectedTip: setTips)
-    {
-        int64_t gap = blocksToOvertakeTarget(selectedTip, pTargetBlockIdx);
-        minGap = std::min(minGap, gap);
-    }
+    // The fork tips are looked at only when the main chain tip or the set of tips change
+    int64_t minGap = finalityIndexCache.GetFinalityIndex(pTargetBlockIdx);
 
     LogPrint("forks", "%s():%d - returning [%d]\n", __func__, __LINE__, minGap);
     return minGap;
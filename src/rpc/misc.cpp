@@ -12,6 +12,7 @@
 #include "rpc/server.h"
 #include "txmempool.h"
 #include "util.h"
+#include "validationinterface.h"
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
@@ -110,6 +111,46 @@ UniValue getinfo(const UniValue& params, bool fHelp)
     return obj;
 }
 
+UniValue getnotificationqueueinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getnotificationqueueinfo\n"
+            "\nReturns the state of the queues of the notifiers (zmq, amqp, ws) running asynchronously.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",         (string) the notifier\n"
+            "    \"queuesize\": n,          (numeric) notifications waiting to be delivered\n"
+            "    \"maxqueuesize\": n,       (numeric) maximum number of waiting notifications\n"
+            "    \"processed\": n,          (numeric) notifications delivered so far\n"
+            "    \"dropped\": n,            (numeric) notifications dropped because the queue was full\n"
+            "    \"lastlagmicros\": n,      (numeric) time the last delivered notification waited in the queue, in microseconds\n"
+            "    \"maxlagmicros\": n        (numeric) maximum time a notification waited in the queue, in microseconds\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getnotificationqueueinfo", "")
+            + HelpExampleRpc("getnotificationqueueinfo", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (const CAsyncValidationInterface::Stats& stats : GetAsyncValidationInterfacesStats())
+    {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("queuesize", (uint64_t)stats.queueSize);
+        obj.pushKV("maxqueuesize", (uint64_t)stats.maxQueueSize);
+        obj.pushKV("processed", stats.nProcessed);
+        obj.pushKV("dropped", stats.nDropped);
+        obj.pushKV("lastlagmicros", stats.nLastLagMicros);
+        obj.pushKV("maxlagmicros", stats.nMaxLagMicros);
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
 #ifdef ENABLE_WALLET
 class DescribeAddressVisitor : public boost::static_visitor<UniValue>
 {
@@ -683,14 +724,11 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
     std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
 
     UniValue utxos(UniValue::VARR);
-    int currentTipHeight = -1;
+    std::shared_ptr<const CChainSnapshot> chain = chainActive.Snapshot();
+    int currentTipHeight = chain->Height();
     std::string bestHashStr;
-    {
-        LOCK(cs_main);
-        if (includeChainInfo)
-            bestHashStr = chainActive.Tip()->GetBlockHash().GetHex();
-        currentTipHeight = (int)chainActive.Height();
-    }
+    if (includeChainInfo)
+        bestHashStr = chain->Tip()->GetBlockHash().GetHex();
 
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
         UniValue output(UniValue::VOBJ);
@@ -839,6 +877,7 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
     }
 
     UniValue deltas(UniValue::VARR);
+    deltas.reserve(addressIndex.size());
 
     for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         std::string address;
@@ -847,39 +886,39 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         }
 
         UniValue delta(UniValue::VOBJ);
-        delta.pushKV("satoshis", it->second.satoshis);
-        delta.pushKV("txid", it->first.txhash.GetHex());
-        delta.pushKV("index", (int)it->first.index);
-        delta.pushKV("blockindex", (int)it->first.txindex);
-        delta.pushKV("height", it->first.blockHeight);
-        delta.pushKV("address", address);
-        deltas.push_back(delta);
+        delta.pushKVEnd("satoshis", it->second.satoshis);
+        delta.pushKVEnd("txid", it->first.txhash.GetHex());
+        delta.pushKVEnd("index", (int)it->first.index);
+        delta.pushKVEnd("blockindex", (int)it->first.txindex);
+        delta.pushKVEnd("height", it->first.blockHeight);
+        delta.pushKVEnd("address", address);
+        deltas.push_back(std::move(delta));
     }
 
     UniValue result(UniValue::VOBJ);
 
     if (includeChainInfo && start > 0 && end > 0) {
-        LOCK(cs_main);
+        std::shared_ptr<const CChainSnapshot> chain = chainActive.Snapshot();
 
-        if (start > chainActive.Height() || end > chainActive.Height()) {
+        if (start > chain->Height() || end > chain->Height()) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
         }
 
-        CBlockIndex* startIndex = chainActive[start];
-        CBlockIndex* endIndex = chainActive[end];
+        const CBlockIndex* startIndex = (*chain)[start];
+        const CBlockIndex* endIndex = (*chain)[end];
 
         UniValue startInfo(UniValue::VOBJ);
         UniValue endInfo(UniValue::VOBJ);
 
-        startInfo.pushKV("hash", startIndex->GetBlockHash().GetHex());
-        startInfo.pushKV("height", start);
+        startInfo.pushKVEnd("hash", startIndex->GetBlockHash().GetHex());
+        startInfo.pushKVEnd("height", start);
 
-        endInfo.pushKV("hash", endIndex->GetBlockHash().GetHex());
-        endInfo.pushKV("height", end);
+        endInfo.pushKVEnd("hash", endIndex->GetBlockHash().GetHex());
+        endInfo.pushKVEnd("height", end);
 
-        result.pushKV("deltas", deltas);
-        result.pushKV("start", startInfo);
-        result.pushKV("end", endInfo);
+        result.pushKVEnd("deltas", std::move(deltas));
+        result.pushKVEnd("start", std::move(startInfo));
+        result.pushKVEnd("end", std::move(endInfo));
 
         return result;
     } else {
@@ -935,7 +974,7 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
     CAmount received = 0;
     CAmount immature = 0;
 
-    int currentTipHeight = chainActive.Tip()->nHeight;
+    int currentTipHeight = chainActive.Snapshot()->Height();
 
     for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         //If maturityHeight is negative it's superseded and we skip it
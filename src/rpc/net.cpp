@@ -12,6 +12,7 @@
 #include "sync.h"
 #include "util.h"
 #include "version.h"
+#include "zen/tlsmanager.h"
 #include "zen/utiltls.h"
 
 #include <boost/foreach.hpp>
@@ -97,14 +98,19 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "    \"services\":\"xxxxxxxxxxxxxxxx\",      (string) the services offered\n"
             "    \"tls_established\": true|false,        (boolean) status of TLS connection\n"
             "    \"tls_verified\": true|false,           (boolean) status of peer certificate. True if the chain of trust of a peer certificate can be verified using the OS certificate store\n"
+            "    \"tls_resumed\": true|false,            (boolean) whether the TLS connection resumed a previous session, skipping the full handshake\n"
             "    \"lastsend\": ttt,                      (numeric) the time in seconds since epoch (Jan 1 1970 GMT) of the last send\n"
             "    \"lastrecv\": ttt,                      (numeric) the time in seconds since epoch (Jan 1 1970 GMT) of the last receive\n"
             "    \"bytessent\": n,                       (numeric) the total bytes sent\n"
             "    \"bytesrecv\": n,                       (numeric) the total bytes received\n"
+            "    \"bytesrecv_copied\": n,                (numeric) the bytes received through an intermediate buffer\n"
+            "    \"bytesrecv_direct\": n,                (numeric) the bytes received directly into their message\n"
             "    \"conntime\": ttt,                      (numeric) the connection time in seconds since 1 Jan 1970 GMT\n"
             "    \"timeoffset\": ttt,                    (numeric) the time offset in seconds\n"
             "    \"pingtime\": n,                        (numeric) ping time\n"
             "    \"pingwait\": n,                        (numeric) ping wait\n"
+            "    \"minfeefilter\": n,                    (numeric) the minimum fee rate (in " + CURRENCY_UNIT + "/kB) of the txs announced to this peer\n"
+            "    \"mincertfeefilter\": n,                (numeric) the minimum fee rate (in " + CURRENCY_UNIT + "/kB) of the certificates announced to this peer\n"
             "    \"version\": v,                         (numeric) the protocol version of the peer\n"
             "    \"subver\": \"/zen:x.y.z[-v]/\",        (string) the user agent of the peer\n"
             "    \"inbound\": true|false,                (boolean) inbound (true) or outbound (false)\n"
@@ -144,15 +150,20 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
         obj.pushKV("services", strprintf("%016x", stats.nServices));
         obj.pushKV("tls_established", stats.fTLSEstablished);
         obj.pushKV("tls_verified", stats.fTLSVerified);
+        obj.pushKV("tls_resumed", stats.fTLSResumed);
         obj.pushKV("lastsend", stats.nLastSend);
         obj.pushKV("lastrecv", stats.nLastRecv);
         obj.pushKV("bytessent", stats.nSendBytes);
         obj.pushKV("bytesrecv", stats.nRecvBytes);
+        obj.pushKV("bytesrecv_copied", stats.nRecvBytesCopied);
+        obj.pushKV("bytesrecv_direct", stats.nRecvBytesDirect);
         obj.pushKV("conntime", stats.nTimeConnected);
         obj.pushKV("timeoffset", stats.nTimeOffset);
         obj.pushKV("pingtime", stats.dPingTime);
         if (stats.dPingWait > 0.0)
             obj.pushKV("pingwait", stats.dPingWait);
+        obj.pushKV("minfeefilter", ValueFromAmount(stats.minFeeFilter));
+        obj.pushKV("mincertfeefilter", ValueFromAmount(stats.minCertFeeFilter));
         obj.pushKV("version", stats.nVersion);
         // Use the sanitized form of subver here, to avoid tricksy remote peers from
         // corrupting or modifiying the JSON output by putting special characters in
@@ -390,6 +401,9 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) total bytes sent\n"
+            "  \"totalbytesfeefiltered\": n, (numeric) estimate of the bytes not exchanged because of the peers fee filters\n"
+            "  \"tlshandshakesfull\": n,  (numeric) TLS handshakes, inbound and outbound, which established a new session\n"
+            "  \"tlshandshakesresumed\": n, (numeric) TLS handshakes, inbound and outbound, which resumed a previous session\n"
             "  \"timemillis\": t        (numeric) number of milliseconds since 1 Jan 1970 GMT\n"
             "}\n"
             
@@ -401,6 +415,9 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("totalbytesrecv", CNode::GetTotalBytesRecv());
     obj.pushKV("totalbytessent", CNode::GetTotalBytesSent());
+    obj.pushKV("totalbytesfeefiltered", CNode::GetTotalBytesFeeFiltered());
+    obj.pushKV("tlshandshakesfull", (uint64_t)zen::TLSManager::nFullHandshakes);
+    obj.pushKV("tlshandshakesresumed", (uint64_t)zen::TLSManager::nResumedHandshakes);
     obj.pushKV("timemillis", GetTimeMillis());
     return obj;
 }
@@ -55,30 +55,31 @@ void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fInclud
     UniValue a(UniValue::VARR);
     BOOST_FOREACH(const CTxDestination& addr, addresses)
         a.push_back(CBitcoinAddress(addr).ToString());
-    out.pushKV("addresses", a);
+    out.pushKV("addresses", std::move(a));
 }
 
 
 UniValue TxJoinSplitToJSON(const CTransaction& tx) {
     bool useGroth = tx.nVersion == GROTH_TX_VERSION;
     UniValue vjoinsplit(UniValue::VARR);
+    vjoinsplit.reserve(tx.GetVjoinsplit().size());
     for (unsigned int i = 0; i < tx.GetVjoinsplit().size(); i++) {
         const JSDescription& jsdescription = tx.GetVjoinsplit()[i];
         UniValue joinsplit(UniValue::VOBJ);
 
-        joinsplit.pushKV("vpub_old", ValueFromAmount(jsdescription.vpub_old));
-        joinsplit.pushKV("vpub_oldZat", jsdescription.vpub_old);
-        joinsplit.pushKV("vpub_new", ValueFromAmount(jsdescription.vpub_new));
-        joinsplit.pushKV("vpub_newZat", jsdescription.vpub_new);
+        joinsplit.pushKVEnd("vpub_old", ValueFromAmount(jsdescription.vpub_old));
+        joinsplit.pushKVEnd("vpub_oldZat", jsdescription.vpub_old);
+        joinsplit.pushKVEnd("vpub_new", ValueFromAmount(jsdescription.vpub_new));
+        joinsplit.pushKVEnd("vpub_newZat", jsdescription.vpub_new);
 
-        joinsplit.pushKV("anchor", jsdescription.anchor.GetHex());
+        joinsplit.pushKVEnd("anchor", jsdescription.anchor.GetHex());
 
         {
             UniValue nullifiers(UniValue::VARR);
             BOOST_FOREACH(const uint256 nf, jsdescription.nullifiers) {
                 nullifiers.push_back(nf.GetHex());
             }
-            joinsplit.pushKV("nullifiers", nullifiers);
+            joinsplit.pushKVEnd("nullifiers", std::move(nullifiers));
         }
 
         {
@@ -86,34 +87,34 @@ UniValue TxJoinSplitToJSON(const CTransaction& tx) {
             BOOST_FOREACH(const uint256 commitment, jsdescription.commitments) {
                 commitments.push_back(commitment.GetHex());
             }
-            joinsplit.pushKV("commitments", commitments);
+            joinsplit.pushKVEnd("commitments", std::move(commitments));
         }
 
-        joinsplit.pushKV("onetimePubKey", jsdescription.ephemeralKey.GetHex());
-        joinsplit.pushKV("randomSeed", jsdescription.randomSeed.GetHex());
+        joinsplit.pushKVEnd("onetimePubKey", jsdescription.ephemeralKey.GetHex());
+        joinsplit.pushKVEnd("randomSeed", jsdescription.randomSeed.GetHex());
 
         {
             UniValue macs(UniValue::VARR);
             BOOST_FOREACH(const uint256 mac, jsdescription.macs) {
                 macs.push_back(mac.GetHex());
             }
-            joinsplit.pushKV("macs", macs);
+            joinsplit.pushKVEnd("macs", std::move(macs));
         }
 
         CDataStream ssProof(SER_NETWORK, PROTOCOL_VERSION);
         auto ps = SproutProofSerializer<CDataStream>(ssProof, useGroth, SER_NETWORK, PROTOCOL_VERSION);
         boost::apply_visitor(ps, jsdescription.proof);
-        joinsplit.pushKV("proof", HexStr(ssProof.begin(), ssProof.end()));
+        joinsplit.pushKVEnd("proof", HexStr(ssProof.begin(), ssProof.end()));
 
         {
             UniValue ciphertexts(UniValue::VARR);
             for (const ZCNoteEncryption::Ciphertext ct : jsdescription.ciphertexts) {
                 ciphertexts.push_back(HexStr(ct.begin(), ct.end()));
             }
-            joinsplit.pushKV("ciphertexts", ciphertexts);
+            joinsplit.pushKVEnd("ciphertexts", std::move(ciphertexts));
         }
 
-        vjoinsplit.push_back(joinsplit);
+        vjoinsplit.push_back(std::move(joinsplit));
     }
     return vjoinsplit;
 }
@@ -127,38 +128,39 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
     entry.pushKV("version", tx.nVersion);
     entry.pushKV("locktime", (int64_t)tx.GetLockTime());
     UniValue vin(UniValue::VARR);
+    vin.reserve(tx.GetVin().size());
     BOOST_FOREACH(const CTxIn& txin, tx.GetVin()) {
         UniValue in(UniValue::VOBJ);
         if (tx.IsCoinBase())
-            in.pushKV("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            in.pushKVEnd("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
         else {
-            in.pushKV("txid", txin.prevout.hash.GetHex());
-            in.pushKV("vout", (int64_t)txin.prevout.n);
+            in.pushKVEnd("txid", txin.prevout.hash.GetHex());
+            in.pushKVEnd("vout", (int64_t)txin.prevout.n);
             UniValue o(UniValue::VOBJ);
-            o.pushKV("asm", txin.scriptSig.ToString());
-            o.pushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
-            in.pushKV("scriptSig", o);
+            o.pushKVEnd("asm", txin.scriptSig.ToString());
+            o.pushKVEnd("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            in.pushKVEnd("scriptSig", std::move(o));
 
 #ifdef ENABLE_ADDRESS_INDEXING
             // Add address and value info if spentindex enabled
             CSpentIndexValue spentInfo;
             CSpentIndexKey spentKey(txin.prevout.hash, txin.prevout.n);
             if (GetSpentIndex(spentKey, spentInfo)) {
-                in.pushKV("value", ValueFromAmount(spentInfo.satoshis));
-                in.pushKV("valueZat", spentInfo.satoshis);
+                in.pushKVEnd("value", ValueFromAmount(spentInfo.satoshis));
+                in.pushKVEnd("valueZat", spentInfo.satoshis);
                 if (spentInfo.addressType == 1) {
-                    in.pushKV("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString());
+                    in.pushKVEnd("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString());
                 } else if (spentInfo.addressType == 2)  {
-                    in.pushKV("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString());
+                    in.pushKVEnd("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString());
                 }
             }
 #endif // ENABLE_ADDRESS_INDEXING
 
         }
-        in.pushKV("sequence", (int64_t)txin.nSequence);
-        vin.push_back(in);
+        in.pushKVEnd("sequence", (int64_t)txin.nSequence);
+        vin.push_back(std::move(in));
     }
-    entry.pushKV("vin", vin);
+    entry.pushKV("vin", std::move(vin));
 
     if(tx.IsScVersion())
     {
@@ -167,30 +169,31 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
     }
 
     UniValue vout(UniValue::VARR);
+    vout.reserve(tx.GetVout().size());
     for (unsigned int i = 0; i < tx.GetVout().size(); i++) {
         const CTxOut& txout = tx.GetVout()[i];
         UniValue out(UniValue::VOBJ);
-        out.pushKV("value", ValueFromAmount(txout.nValue));
-        out.pushKV("valueZat", txout.nValue);
-        out.pushKV("n", (int64_t)i);
+        out.pushKVEnd("value", ValueFromAmount(txout.nValue));
+        out.pushKVEnd("valueZat", txout.nValue);
+        out.pushKVEnd("n", (int64_t)i);
         UniValue o(UniValue::VOBJ);
         ScriptPubKeyToJSON(txout.scriptPubKey, o, true);
-        out.pushKV("scriptPubKey", o);
+        out.pushKVEnd("scriptPubKey", std::move(o));
 
 #ifdef ENABLE_ADDRESS_INDEXING
         // Add spent information if spentindex is enabled
         CSpentIndexValue spentInfo;
         CSpentIndexKey spentKey(txid, i);
         if (GetSpentIndex(spentKey, spentInfo)) {
-            out.pushKV("spentTxId", spentInfo.txid.GetHex());
-            out.pushKV("spentIndex", (int)spentInfo.inputIndex);
-            out.pushKV("spentHeight", spentInfo.blockHeight);
+            out.pushKVEnd("spentTxId", spentInfo.txid.GetHex());
+            out.pushKVEnd("spentIndex", (int)spentInfo.inputIndex);
+            out.pushKVEnd("spentHeight", spentInfo.blockHeight);
         }
 #endif // ENABLE_ADDRESS_INDEXING
 
-        vout.push_back(out);
+        vout.push_back(std::move(out));
     }
-    entry.pushKV("vout", vout);
+    entry.pushKV("vout", std::move(vout));
 
     if(tx.IsScVersion())
     {
@@ -198,8 +201,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
         Sidechain::AddSidechainOutsToJSON(tx, entry);
     }
 
-    UniValue vjoinsplit = TxJoinSplitToJSON(tx);
-    entry.pushKV("vjoinsplit", vjoinsplit);
+    entry.pushKV("vjoinsplit", TxJoinSplitToJSON(tx));
 
     if (!hashBlock.IsNull()) {
         entry.pushKV("blockhash", hashBlock.GetHex());
@@ -227,93 +229,95 @@ void CertToJSON(const CScCertificate& cert, const uint256 hashBlock, UniValue& e
     entry.pushKV("version", cert.nVersion);
     entry.pushKV("locktime", (int64_t)cert.GetLockTime());
     UniValue vin(UniValue::VARR);
+    vin.reserve(cert.GetVin().size());
     BOOST_FOREACH(const CTxIn& txin, cert.GetVin()) {
         UniValue in(UniValue::VOBJ);
-        in.pushKV("txid", txin.prevout.hash.GetHex());
-        in.pushKV("vout", (int64_t)txin.prevout.n);
+        in.pushKVEnd("txid", txin.prevout.hash.GetHex());
+        in.pushKVEnd("vout", (int64_t)txin.prevout.n);
         UniValue o(UniValue::VOBJ);
-        o.pushKV("asm", txin.scriptSig.ToString());
-        o.pushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
-        in.pushKV("scriptSig", o);
+        o.pushKVEnd("asm", txin.scriptSig.ToString());
+        o.pushKVEnd("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+        in.pushKVEnd("scriptSig", std::move(o));
 
 #ifdef ENABLE_ADDRESS_INDEXING
         // Add address and value info if spentindex enabled
         CSpentIndexValue spentInfo;
         CSpentIndexKey spentKey(txin.prevout.hash, txin.prevout.n);
         if (GetSpentIndex(spentKey, spentInfo)) {
-            in.pushKV("value", ValueFromAmount(spentInfo.satoshis));
-            in.pushKV("valueZat", spentInfo.satoshis);
+            in.pushKVEnd("value", ValueFromAmount(spentInfo.satoshis));
+            in.pushKVEnd("valueZat", spentInfo.satoshis);
             if (spentInfo.addressType == 1) {
-                in.pushKV("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString());
+                in.pushKVEnd("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString());
             } else if (spentInfo.addressType == 2)  {
-                in.pushKV("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString());
+                in.pushKVEnd("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString());
             }
         }
 #endif // ENABLE_ADDRESS_INDEXING
 
-        in.pushKV("sequence", (int64_t)txin.nSequence);
-        vin.push_back(in);
+        in.pushKVEnd("sequence", (int64_t)txin.nSequence);
+        vin.push_back(std::move(in));
     }
-    entry.pushKV("vin", vin);
+    entry.pushKV("vin", std::move(vin));
     UniValue vout(UniValue::VARR);
+    vout.reserve(cert.GetVout().size());
     for (unsigned int i = 0; i < cert.GetVout().size(); i++) {
         const CTxOut& txout = cert.GetVout()[i];
         UniValue out(UniValue::VOBJ);
-        out.pushKV("value", ValueFromAmount(txout.nValue));
-        out.pushKV("valueZat", txout.nValue);
-        out.pushKV("n", (int64_t)i);
+        out.pushKVEnd("value", ValueFromAmount(txout.nValue));
+        out.pushKVEnd("valueZat", txout.nValue);
+        out.pushKVEnd("n", (int64_t)i);
         UniValue o(UniValue::VOBJ);
         ScriptPubKeyToJSON(txout.scriptPubKey, o, true);
-        out.pushKV("scriptPubKey", o);
+        out.pushKVEnd("scriptPubKey", std::move(o));
 
 #ifdef ENABLE_ADDRESS_INDEXING
         // Add spent information if spentindex is enabled
         CSpentIndexValue spentInfo;
         CSpentIndexKey spentKey(certId, i);
         if (GetSpentIndex(spentKey, spentInfo)) {
-            out.pushKV("spentTxId", spentInfo.txid.GetHex());
-            out.pushKV("spentIndex", (int)spentInfo.inputIndex);
-            out.pushKV("spentHeight", spentInfo.blockHeight);
+            out.pushKVEnd("spentTxId", spentInfo.txid.GetHex());
+            out.pushKVEnd("spentIndex", (int)spentInfo.inputIndex);
+            out.pushKVEnd("spentHeight", spentInfo.blockHeight);
         }
 #endif // ENABLE_ADDRESS_INDEXING
 
         if (cert.IsBackwardTransfer(i))
         {
-            out.pushKV("backwardTransfer", true);
+            out.pushKVEnd("backwardTransfer", true);
         }
-        vout.push_back(out);
+        vout.push_back(std::move(out));
     }
 
     UniValue x(UniValue::VOBJ);
-    x.pushKV("scid", cert.GetScId().GetHex());
-    x.pushKV("epochNumber", cert.epochNumber);
-    x.pushKV("quality", cert.quality);
-    x.pushKV("endEpochCumScTxCommTreeRoot", cert.endEpochCumScTxCommTreeRoot.GetHexRepr());
-    x.pushKV("scProof", cert.scProof.GetHexRepr());
+    x.pushKVEnd("scid", cert.GetScId().GetHex());
+    x.pushKVEnd("epochNumber", cert.epochNumber);
+    x.pushKVEnd("quality", cert.quality);
+    x.pushKVEnd("endEpochCumScTxCommTreeRoot", cert.endEpochCumScTxCommTreeRoot.GetHexRepr());
+    x.pushKVEnd("scProof", cert.scProof.GetHexRepr());
 
     UniValue vCfe(UniValue::VARR);
     for (const auto& entry : cert.vFieldElementCertificateField) {
         vCfe.push_back(HexStr(entry.getVRawData()));
     }
-    x.pushKV("vFieldElementCertificateField", vCfe);
+    x.pushKVEnd("vFieldElementCertificateField", std::move(vCfe));
 
     UniValue vCmt(UniValue::VARR);
     for (const auto& entry : cert.vBitVectorCertificateField) {
         vCmt.push_back(HexStr(entry.getVRawData()));
     }
-    x.pushKV("vBitVectorCertificateField", vCmt);
+    x.pushKVEnd("vBitVectorCertificateField", std::move(vCmt));
 
-    x.pushKV("ftScFee", ValueFromAmount(cert.forwardTransferScFee));
-    x.pushKV("mbtrScFee", ValueFromAmount(cert.mainchainBackwardTransferRequestScFee));
+    x.pushKVEnd("ftScFee", ValueFromAmount(cert.forwardTransferScFee));
+    x.pushKVEnd("mbtrScFee", ValueFromAmount(cert.mainchainBackwardTransferRequestScFee));
 
-    x.pushKV("totalAmount", ValueFromAmount(cert.GetValueOfBackwardTransfers()));
+    x.pushKVEnd("totalAmount", ValueFromAmount(cert.GetValueOfBackwardTransfers()));
 
-    entry.pushKV("cert", x);
-    entry.pushKV("vout", vout);
+    entry.pushKV("cert", std::move(x));
+    entry.pushKV("vout", std::move(vout));
 
     // add an empty array for compatibility with txes
     UniValue vjoinsplit(UniValue::VARR);
-    entry.pushKV("vjoinsplit", vjoinsplit);
+    entry.pushKV("vjoinsplit", std::move(vjoinsplit));
 
     if (!hashBlock.IsNull()) {
         entry.pushKV("blockhash", hashBlock.GetHex());
@@ -14,7 +14,9 @@
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <atomic>
 #include <memory>
+#include <set>
 
 #include <univalue.h>
 
@@ -286,6 +288,7 @@ static const CRPCCommand vRPCCommands[] =
     /* Overall control/query calls */
     { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
     { "control",            "help",                   &help,                   true  },
+    { "control",            "getnotificationqueueinfo", &getnotificationqueueinfo, true  },
     { "control",            "stop",                   &stop,                   true  },
     { "control",            "dbg_log",                &dbg_log,                true  },
     { "control",            "dbg_do",                 &dbg_do,                 true  },
@@ -598,7 +601,7 @@ static UniValue JSONRPCExecOne(const UniValue& req)
         jreq.parse(req);
 
         UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-        rpc_result = JSONRPCReplyObj(result, NullUniValue, jreq.id);
+        rpc_result = JSONRPCReplyObj(std::move(result), NullUniValue, jreq.id);
     }
     catch (const UniValue& objError)
     {
@@ -613,12 +616,124 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const UniValue& vReq)
+bool IsConcurrentRPCMethod(const std::string& strMethod)
 {
-    UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    // Queries of the chain and its indexes: they only read state under their own locks
+    static const std::set<std::string> setConcurrent = {
+        "getbestblockhash", "getblockcount", "getblock", "getblockexpanded", "getblockhash",
+        "getblockheader", "getblockhashes", "getblockdeltas", "getspentinfo", "getrawtransaction",
+        "gettxout", "gettxoutproof", "verifytxoutproof", "decoderawtransaction", "decodescript",
+        "getaddressmempool", "getaddressutxos", "getaddressdeltas", "getaddresstxids",
+        "getaddressbalance", "getscinfo",
+    };
+    return setConcurrent.count(strMethod) > 0;
+}
+
+static bool IsConcurrentRequest(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req.get_obj(), "method");
+    return method.isStr() && IsConcurrentRPCMethod(method.get_str());
+}
+
+namespace {
+
+/** A run of concurrent calls of a batch, shared by the threads executing them */
+struct BatchRun
+{
+    //! Only dereferenced for claimed calls, which the batch waits for
+    const UniValue* vReq;
+    UniValue* vReply;
+    size_t nEnd;
+    std::atomic<size_t> nNext;
+    //! Helpers posted which haven't started yet
+    std::atomic<int> nPending;
+
+    CWaitableCriticalSection cs;
+    CConditionVariable cond;
+    size_t nDone;
+
+    BatchRun(const UniValue* vReq, UniValue* vReply, size_t nBegin, size_t nEnd) :
+        vReq(vReq), vReply(vReply), nEnd(nEnd), nNext(nBegin), nPending(0), nDone(nBegin) {}
+
+    //! Number of calls nobody has claimed yet
+    size_t Unclaimed() const
+    {
+        const size_t n = nNext;
+        return n < nEnd ? nEnd - n : 0;
+    }
+};
+
+/** Execute a claimed call of the run */
+void ExecBatchCall(BatchRun& run, size_t n)
+{
+    run.vReply[n] = JSONRPCExecOne(run.vReq[n]);
+    boost::unique_lock<boost::mutex> lock(run.cs);
+    if (++run.nDone == run.nEnd)
+        run.cond.notify_all();
+}
+
+/** Execute calls of the run until none is left to claim, returning at once if it is over */
+void ExecBatchHelper(const std::shared_ptr<BatchRun>& run)
+{
+    run->nPending--;
+    size_t n;
+    while ((n = run->nNext++) < run->nEnd)
+        ExecBatchCall(*run, n);
+}
+
+}
+
+std::string JSONRPCExecBatch(const UniValue& vReq, const RPCWorkPoster& post)
+{
+    const std::vector<UniValue>& vCalls = vReq.getValues();
+    std::vector<UniValue> vReply(vCalls.size());
+    const int nConcurrency = post ? (int)GetArg("-rpcbatchconcurrency", DEFAULT_RPC_BATCH_CONCURRENCY) : 1;
+
+    size_t reqIdx = 0;
+    while (reqIdx < vCalls.size()) {
+        size_t nEnd = reqIdx + 1;
+        if (nConcurrency > 1 && IsConcurrentRequest(vCalls[reqIdx])) {
+            while (nEnd < vCalls.size() && IsConcurrentRequest(vCalls[nEnd]))
+                nEnd++;
+        }
+        if (nEnd - reqIdx == 1) {
+            vReply[reqIdx] = JSONRPCExecOne(vCalls[reqIdx]);
+            reqIdx = nEnd;
+            continue;
+        }
 
+        // Post a helper only once the previous one has got a thread, and only while there is
+        // a call left for it besides the one this thread claims next: a busy pool then holds
+        // at most one helper of the run, which returns at once when it finally gets a thread
+        std::shared_ptr<BatchRun> run(new BatchRun(vCalls.data(), vReply.data(), reqIdx, nEnd));
+        int nHelpers = nConcurrency - 1;
+        while (true) {
+            if (nHelpers > 0 && run->nPending == 0 && run->Unclaimed() > 1) {
+                run->nPending++;
+                if (post(boost::bind(&ExecBatchHelper, run))) {
+                    nHelpers--;
+                } else {
+                    run->nPending--;
+                    nHelpers = 0;
+                }
+            }
+            const size_t n = run->nNext++;
+            if (n >= nEnd)
+                break;
+            ExecBatchCall(*run, n);
+        }
+        {
+            boost::unique_lock<boost::mutex> lock(run->cs);
+            while (run->nDone < nEnd)
+                run->cond.wait(lock);
+        }
+        reqIdx = nEnd;
+    }
+
+    UniValue ret(UniValue::VARR);
+    ret.push_backV(std::move(vReply));
     return ret.write() + "\n";
 }
 
@@ -20,6 +20,9 @@
 #include <univalue.h>
 
 class AsyncRPCQueue;
+
+/** Default number of threads, the requesting one included, running the calls of a JSON-RPC batch */
+static const int DEFAULT_RPC_BATCH_CONCURRENCY = 4;
 class CRPCCommand;
 class uint256;
 
@@ -245,6 +248,7 @@ extern UniValue walletlock(const UniValue& params, bool fHelp);
 extern UniValue encryptwallet(const UniValue& params, bool fHelp);
 extern UniValue validateaddress(const UniValue& params, bool fHelp);
 extern UniValue getinfo(const UniValue& params, bool fHelp);
+extern UniValue getnotificationqueueinfo(const UniValue& params, bool fHelp);
 extern UniValue getwalletinfo(const UniValue& params, bool fHelp);
 extern UniValue getblockchaininfo(const UniValue& params, bool fHelp);
 extern UniValue getnetworkinfo(const UniValue& params, bool fHelp);
@@ -340,6 +344,17 @@ extern UniValue setproofverifierlowpriorityguard(const UniValue& params, bool fH
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const UniValue& vReq);
+
+/** Queue a task to run on another RPC thread. Returns false if it could not be queued. */
+typedef boost::function<bool(const boost::function<void()>&)> RPCWorkPoster;
+/** Whether a method only reads state, so that batched calls to it may run concurrently */
+bool IsConcurrentRPCMethod(const std::string& strMethod);
+/**
+ * Execute a batch of requests and return the array of their replies, in order.
+ * Consecutive calls to concurrent methods are spread over up to
+ * -rpcbatchconcurrency threads obtained from post; any other call runs alone,
+ * after the calls before it and before the ones after it.
+ */
+std::string JSONRPCExecBatch(const UniValue& vReq, const RPCWorkPoster& post = RPCWorkPoster());
 
 #endif // BITCOIN_RPCSERVER_H
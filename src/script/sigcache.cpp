@@ -5,95 +5,156 @@
 
 #include "sigcache.h"
 
+#include "cuckoocache.h"
+#include "crypto/sha256.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
 #include "util.h"
 
+#include <limits>
+
 #include <boost/thread.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
 
 namespace {
 
+/**
+ * We're hashing a nonce into the entries themselves, so we don't need extra
+ * blinding in the set hash computation.
+ *
+ * This may exhibit platform endian dependent behavior but because these are
+ * nonced hashes (random) and this state is only ever used locally it is safe.
+ * All that matters is local consistency.
+ */
+class SignatureCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select < 8, "SignatureCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * Entries are fixed size salted hashes kept in a cuckoo table: lookups only take
+ * the shared lock and marking an entry for erasure is lock free, while inserts
+ * take the exclusive lock for a bounded number of moves, without allocations.
  */
 class CSignatureCache
 {
 private:
-     //! sigdata_type is (signature hash, signature, public key):
-    typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
+    //! Entries are SHA256(nonce || signature hash || public key || signature):
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    //! The table is only allocated by setup(): until then the cache is disabled
+    bool fSetup;
     boost::shared_mutex cs_sigcache;
 
 public:
-    bool
-    Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    CSignatureCache() : fSetup(false)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        GetRandBytes(nonce.begin(), 32);
+    }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
-            return true;
-        return false;
+    void
+    ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.begin(), pubkey.size())
+                 .Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
     }
 
-    void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    bool
+    Get(const uint256& entry, const bool erase)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there are a maximum of 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return fSetup && setValid.contains(entry, erase);
+    }
 
+    void Set(const uint256& entry)
+    {
         boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        if (fSetup)
+            setValid.insert(entry);
+    }
 
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
-        {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
-        }
-
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+    //! The cuckoo table can only be set up once
+    uint32_t setup(uint32_t nEntries)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        assert(!fSetup);
+        fSetup = true;
+        return setValid.setup(nEntries);
     }
 };
 
-}
-
-CachingTransactionSignatureChecker::CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn,
-                                                                       const CChain* chainIn, bool storeIn):
-                                                                        TransactionSignatureChecker(txToIn, nInIn, chainIn),
-                                                                        store(storeIn) {}
+/* In previous versions of this code, signatureCache was a local static variable
+ * in VerifySignature. This meant that there was no way to set the size of the
+ * cache before first use: it is now shared by the transaction and certificate checkers.
+ */
+CSignatureCache signatureCache;
 
-bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+/**
+ * Look the signature up, verifying and storing it on a miss.
+ *
+ * Signatures checked with store=false are those of a block being connected: they
+ * won't be needed again, so a hit marks the entry as erasable and the slot gets
+ * reused by the next insert. Entries never hit again are recycled by the cache
+ * generations as newer ones come in.
+ */
+template <typename Verify>
+bool CachedVerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash,
+                           bool store, Verify verify)
 {
-    static CSignatureCache signatureCache;
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
 
-    if (signatureCache.Get(sighash, vchSig, pubkey))
+    if (signatureCache.Get(entry, !store))
         return true;
 
-    if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
+    if (!verify())
         return false;
 
     if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+        signatureCache.Set(entry);
     return true;
 }
 
+}
+
+void InitSignatureCache()
+{
+    int64_t nMaxCacheSize = GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE);
+    if (nMaxCacheSize <= 0) {
+        LogPrintf("Signature cache disabled\n");
+        return;
+    }
+    // The cache can hold up to 2^32 - 2 entries
+    nMaxCacheSize = std::min(nMaxCacheSize, (int64_t)std::numeric_limits<uint32_t>::max() - 1);
+    uint32_t nEntries = signatureCache.setup(nMaxCacheSize);
+    LogPrintf("Using %u entries (%u MiB) for the signature cache\n", nEntries, (uint64_t(nEntries) * sizeof(uint256)) >> 20);
+}
+
+CachingTransactionSignatureChecker::CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn,
+                                                                       const CChain* chainIn, bool storeIn):
+                                                                        TransactionSignatureChecker(txToIn, nInIn, chainIn),
+                                                                        store(storeIn) {}
+
+bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    return CachedVerifySignature(vchSig, pubkey, sighash, store, [&]() {
+        return TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash);
+    });
+}
+
 CachingCertificateSignatureChecker::CachingCertificateSignatureChecker(const CScCertificate* certToIn, unsigned int nInIn,
                                                                        const CChain* chainIn, bool storeIn):
                                                                         CertificateSignatureChecker(certToIn, nInIn, chainIn),
@@ -101,15 +162,7 @@ CachingCertificateSignatureChecker::CachingCertificateSignatureChecker(const CSc
 
 bool CachingCertificateSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
-    static CSignatureCache signatureCache;
-
-    if (signatureCache.Get(sighash, vchSig, pubkey))
-        return true;
-
-    if (!CertificateSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
-        return false;
-
-    if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
-    return true;
+    return CachedVerifySignature(vchSig, pubkey, sighash, store, [&]() {
+        return CertificateSignatureChecker::VerifySignature(vchSig, pubkey, sighash);
+    });
 }
@@ -10,6 +10,10 @@
 
 #include <vector>
 
+// DoS prevention: limit cache size to 10MB of 32 bytes entries. A block holds at most
+// MAX_BLOCK_SIGOPS signature operations, so this keeps several blocks worth of them.
+static const int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 320000;
+
 class CPubKey;
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
@@ -32,4 +36,7 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/** Size the signature cache according to -maxsigcachesize. Until then, or if it is 0, signatures are not cached. */
+void InitSignatureCache();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -373,6 +373,54 @@ public:
 
 };
 
+/** Read-only stream over a range of memory it doesn't own, such as a memory-mapped file.
+ *  The range must outlive the stream.
+ */
+class CSpanReader
+{
+private:
+    int nType;
+    int nVersion;
+
+    const char* pCur;
+    const char* pEnd;
+
+public:
+    CSpanReader(const char* pbegin, const char* pend, int nTypeIn, int nVersionIn) :
+        nType(nTypeIn), nVersion(nVersionIn), pCur(pbegin), pEnd(pend) { }
+
+    int GetType()                { return nType; }
+    int GetVersion()             { return nVersion; }
+
+    size_t size() const          { return pEnd - pCur; }
+    bool empty() const           { return pCur == pEnd; }
+
+    CSpanReader& read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CSpanReader::read: end of data");
+        memcpy(pch, pCur, nSize);
+        pCur += nSize;
+        return (*this);
+    }
+
+    CSpanReader& ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CSpanReader::ignore: end of data");
+        pCur += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CSpanReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 
 
 
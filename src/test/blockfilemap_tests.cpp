@@ -0,0 +1,85 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "main.h"
+#include "streams.h"
+
+#include "test/test_bitcoin.h"
+
+#include <stdio.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilemap_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(spanreader)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << genesis << 42;
+
+    CSpanReader span(&ss[0], &ss[0] + ss.size(), SER_DISK, CLIENT_VERSION);
+    CBlock block;
+    int n;
+    span >> block >> n;
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+    BOOST_CHECK_EQUAL(n, 42);
+    BOOST_CHECK(span.empty());
+    BOOST_CHECK_THROW(span >> n, std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(read_mapped_block)
+{
+    const CBlockIndex* pindex = chainActive.Genesis();
+    BOOST_REQUIRE(pindex != NULL);
+
+    CBlock blockRead, blockMapped;
+    blockFileMaps.SetMaxFiles(0);
+    BOOST_CHECK(!blockFileMaps.Get(pindex->GetBlockPos().nFile, false, pindex->GetBlockPos().nPos));
+    BOOST_CHECK(ReadBlockFromDisk(blockRead, pindex));
+
+    blockFileMaps.SetMaxFiles(DEFAULT_BLOCKFILE_MAPS);
+    BOOST_CHECK(ReadBlockFromDisk(blockMapped, pindex));
+    BOOST_CHECK(blockMapped.GetHash() == blockRead.GetHash());
+    BOOST_CHECK_EQUAL(blockMapped.vtx.size(), blockRead.vtx.size());
+    BOOST_CHECK(blockMapped.vtx[0].GetHash() == blockRead.vtx[0].GetHash());
+#ifndef WIN32
+    BOOST_CHECK(blockFileMaps.Get(pindex->GetBlockPos().nFile, false, pindex->GetBlockPos().nPos));
+#endif
+}
+
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(mapped_file_growth)
+{
+    const int nFile = 999;
+    FILE* file = OpenBlockFile(CDiskBlockPos(nFile, 0));
+    BOOST_REQUIRE(file != NULL);
+    fwrite("0123456789", 1, 10, file);
+    fflush(file);
+
+    std::shared_ptr<const CMappedFile> mapped = blockFileMaps.Get(nFile, false, 10);
+    BOOST_REQUIRE(mapped);
+    BOOST_CHECK_EQUAL(mapped->size(), 10U);
+    BOOST_CHECK(!blockFileMaps.Get(nFile, false, 20));
+
+    // a read past the mapped length maps the file again
+    fwrite("abcdefghij", 1, 10, file);
+    fclose(file);
+    std::shared_ptr<const CMappedFile> remapped = blockFileMaps.Get(nFile, false, 20);
+    BOOST_REQUIRE(remapped);
+    BOOST_CHECK_EQUAL(std::string(remapped->data() + 10, 10), "abcdefghij");
+    BOOST_CHECK(blockFileMaps.Get(nFile, false, 5) == remapped);
+
+    // forgotten mappings stay valid for whoever holds them
+    blockFileMaps.Forget(nFile);
+    BOOST_CHECK(blockFileMaps.Get(nFile, false, 5) != remapped);
+    BOOST_CHECK_EQUAL(std::string(mapped->data(), 10), "0123456789");
+    blockFileMaps.Forget(nFile);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
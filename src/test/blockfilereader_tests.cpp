@@ -0,0 +1,138 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilereader.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "streams.h"
+
+#include "test/test_bitcoin.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilereader_tests, BasicTestingSetup)
+
+namespace {
+
+/** Append a block record (magic, size, data) to file, and return the position of its data */
+unsigned int WriteRecord(FILE* file, const std::vector<char>& vData)
+{
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    fileout << FLATDATA(Params().MessageStart()) << (unsigned int)vData.size();
+    unsigned int nPos = ftell(file);
+    fileout.write(vData.data(), vData.size());
+    fileout.release();
+    return nPos;
+}
+
+std::vector<char> Serialize(const CBlock& block)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    return std::vector<char>(ss.begin(), ss.end());
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(blockfilereader_order_and_checks)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CBlock badSolution(genesis);
+    badSolution.nSolution[10] ^= 0x01;
+
+    for (int fHeadersOnly = 0; fHeadersOnly < 2; fHeadersOnly++) {
+        FILE* file = tmpfile();
+        BOOST_REQUIRE(file != NULL);
+
+        // garbage, then blocks mixed with records that can't be blocks
+        const char junk[] = "not a block";
+        fwrite(junk, 1, sizeof(junk), file);
+        std::vector<unsigned int> vPos;
+        vPos.push_back(WriteRecord(file, Serialize(genesis)));
+        WriteRecord(file, std::vector<char>(10, 0)); // too short to be a block
+        vPos.push_back(WriteRecord(file, Serialize(badSolution)));
+        for (int i = 0; i < 20; i++)
+            vPos.push_back(WriteRecord(file, Serialize(genesis)));
+        rewind(file);
+
+        CBlockFileReader reader(file, 7, fHeadersOnly, 3);
+        std::vector<std::shared_ptr<CBlockFileEntry> > vEntries;
+        std::shared_ptr<CBlockFileEntry> entry;
+        while ((entry = reader.Next()))
+            vEntries.push_back(entry);
+
+        BOOST_REQUIRE_EQUAL(vEntries.size(), vPos.size());
+        for (size_t i = 0; i < vEntries.size(); i++) {
+            BOOST_CHECK_EQUAL(vEntries[i]->pos.nFile, 7);
+            BOOST_CHECK_EQUAL(vEntries[i]->pos.nPos, vPos[i]);
+            BOOST_CHECK(vEntries[i]->ssRaw.empty());
+            if (i == 1) {
+                // invalid Equihash solution
+                BOOST_CHECK(!vEntries[i]->fHeaderOk);
+                continue;
+            }
+            BOOST_CHECK(vEntries[i]->fHeaderOk);
+            BOOST_CHECK(vEntries[i]->hash == genesis.GetHash());
+            BOOST_CHECK_EQUAL(vEntries[i]->block.vtx.size(), fHeadersOnly ? 0U : genesis.vtx.size());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockfilereader_corrupt_size)
+{
+    const std::vector<char> vGenesis = Serialize(Params().GenesisBlock());
+
+    FILE* file = tmpfile();
+    BOOST_REQUIRE(file != NULL);
+
+    // a corrupt record whose size looks valid, but reaches into the block records that follow it
+    std::vector<char> vCorrupt(100, 0x11);
+    const unsigned int nCorruptSize = vCorrupt.size() + MESSAGE_START_SIZE + sizeof(unsigned int) + vGenesis.size() + 5;
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    fileout << FLATDATA(Params().MessageStart()) << nCorruptSize;
+    const unsigned int nCorruptPos = ftell(file);
+    fileout.write(vCorrupt.data(), vCorrupt.size());
+    fileout.release();
+    std::vector<unsigned int> vPos;
+    for (int i = 0; i < 3; i++)
+        vPos.push_back(WriteRecord(file, Serialize(Params().GenesisBlock())));
+    // and the space preallocated after the last block
+    const std::vector<char> vZeros(1000, 0);
+    fwrite(vZeros.data(), 1, vZeros.size(), file);
+    rewind(file);
+
+    CBlockFileReader reader(file, 0, false, 2);
+    std::vector<std::shared_ptr<CBlockFileEntry> > vEntries;
+    std::shared_ptr<CBlockFileEntry> entry;
+    while ((entry = reader.Next()))
+        vEntries.push_back(entry);
+
+    // the corrupt record is reported, and the blocks it covers are still found
+    BOOST_REQUIRE_EQUAL(vEntries.size(), 1 + vPos.size());
+    BOOST_CHECK_EQUAL(vEntries[0]->pos.nPos, nCorruptPos);
+    BOOST_CHECK(!vEntries[0]->fHeaderOk);
+    for (size_t i = 0; i < vPos.size(); i++) {
+        BOOST_CHECK_EQUAL(vEntries[i + 1]->pos.nPos, vPos[i]);
+        BOOST_CHECK(vEntries[i + 1]->fHeaderOk);
+        BOOST_CHECK(vEntries[i + 1]->hash == Params().GenesisBlock().GetHash());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockfilereader_stop_early)
+{
+    FILE* file = tmpfile();
+    BOOST_REQUIRE(file != NULL);
+    for (int i = 0; i < 100; i++)
+        WriteRecord(file, Serialize(Params().GenesisBlock()));
+    rewind(file);
+
+    // the reader can be dropped while its threads are still busy
+    CBlockFileReader reader(file, 0, false, 2);
+    BOOST_CHECK(reader.Next() != NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+// Copyright (c) 2012-2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkqueue.h"
+#include "random.h"
+
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(checkqueue_tests, BasicTestingSetup)
+
+namespace {
+
+static const int NUM_WORKERS = 7;
+
+/** Counts its runs, and fails when told to */
+struct CountingCheck
+{
+    std::atomic<unsigned int>* pCount;
+    bool fOk;
+
+    CountingCheck() : pCount(NULL), fOk(true) {}
+    CountingCheck(std::atomic<unsigned int>& count, bool fOkIn) : pCount(&count), fOk(fOkIn) {}
+
+    bool operator()()
+    {
+        (*pCount)++;
+        return fOk;
+    }
+
+    void swap(CountingCheck& check)
+    {
+        std::swap(pCount, check.pCount);
+        std::swap(fOk, check.fOk);
+    }
+};
+
+/** Starts the workers of a queue, and stops them when going out of scope */
+template <typename T>
+class WorkerPool
+{
+    boost::thread_group threads;
+
+public:
+    explicit WorkerPool(CCheckQueue<T>& queue)
+    {
+        for (int i = 0; i < NUM_WORKERS; i++)
+            threads.create_thread(boost::bind(&CCheckQueue<T>::Thread, boost::ref(queue)));
+    }
+
+    ~WorkerPool()
+    {
+        threads.interrupt_all();
+        threads.join_all();
+    }
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_all_ok)
+{
+    CCheckQueue<CountingCheck> queue(128);
+    WorkerPool<CountingCheck> pool(queue);
+
+    for (int nRound = 0; nRound < 100; nRound++) {
+        std::atomic<unsigned int> nCount(0);
+        unsigned int nAdded = 0;
+        CCheckQueueControl<CountingCheck> control(&queue);
+        // batches of all sizes, some of them larger than the batch size
+        for (int i = insecure_rand() % 50; i > 0; i--) {
+            std::vector<CountingCheck> vChecks(insecure_rand() % 300, CountingCheck(nCount, true));
+            nAdded += vChecks.size();
+            control.Add(vChecks);
+        }
+        BOOST_CHECK(control.Wait());
+        BOOST_CHECK_EQUAL(nCount, nAdded);
+        BOOST_CHECK_EQUAL(control.GetStats().nChecks, nAdded);
+        BOOST_CHECK(control.GetStats().nStolen <= nAdded);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_failure)
+{
+    CCheckQueue<CountingCheck> queue(128);
+    WorkerPool<CountingCheck> pool(queue);
+
+    for (int nRound = 0; nRound < 100; nRound++) {
+        std::atomic<unsigned int> nCount(0);
+        CCheckQueueControl<CountingCheck> control(&queue);
+        const bool fFail = nRound % 2;
+        for (int i = 0; i < 20; i++) {
+            std::vector<CountingCheck> vChecks(100, CountingCheck(nCount, true));
+            if (fFail && i == 10)
+                vChecks[insecure_rand() % vChecks.size()] = CountingCheck(nCount, false);
+            control.Add(vChecks);
+        }
+        // a failure is reported, and doesn't leak into the next round
+        BOOST_CHECK_EQUAL(control.Wait(), !fFail);
+        BOOST_CHECK(nCount <= 2000);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
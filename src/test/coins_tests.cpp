@@ -154,6 +154,7 @@ public:
         BOOST_CHECK_EQUAL(DynamicMemoryUsage(), ret);
     }
 
+    size_t GetNullifiersCacheSize() const { return cacheNullifiers.size(); }
 };
 
 }
@@ -732,6 +733,68 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(missed_an_entry);
 }
 
+BOOST_AUTO_TEST_CASE(coins_cache_sync_and_trim)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+
+    std::vector<uint256> txids;
+    for (unsigned int i = 0; i < 100; i++) {
+        txids.push_back(GetRandHash());
+        CCoinsModifier entry = cache.ModifyCoins(txids.back());
+        entry->nVersion = 1;
+        entry->vout.resize(1);
+        entry->vout[0].nValue = i + 1;
+    }
+
+    // Sync writes everything to the base and keeps the coins resident
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 100);
+    cache.SelfTest();
+    {
+        CCoinsViewCacheTest check(&base);
+        for (const uint256& txid : txids)
+            BOOST_CHECK(check.HaveCoins(txid));
+    }
+
+    // Spent coins are written and dropped
+    cache.ModifyCoins(txids[0])->Clear();
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 99);
+    cache.SelfTest();
+    {
+        CCoinsViewCacheTest check(&base);
+        const CCoins* coins = check.AccessCoins(txids[0]);
+        BOOST_CHECK(!coins || coins->IsPruned());
+    }
+
+    // A batch from a child cache moves the cache to a new access tick, then only half the coins are used
+    {
+        CCoinsViewCacheTest child(&cache);
+        child.Flush();
+    }
+    for (unsigned int i = 50; i < 100; i++)
+        BOOST_CHECK(cache.AccessCoins(txids[i]) != NULL);
+
+    // Trimming evicts the coins not used since the older tick
+    cache.Trim(cache.DynamicMemoryUsage() - 1);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 50);
+    cache.SelfTest();
+    for (unsigned int i = 50; i < 100; i++)
+        BOOST_CHECK_EQUAL(cache.AccessCoins(txids[i])->vout[0].nValue, CAmount(i + 1));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 50);
+
+    // Dirty coins are never evicted, clean nullifiers always are
+    cache.ModifyCoins(txids[50])->vout[0].nValue = 1000;
+    BOOST_CHECK(!cache.GetNullifier(GetRandHash()));
+    BOOST_CHECK_EQUAL(cache.GetNullifiersCacheSize(), 1);
+    cache.Trim(0);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1);
+    BOOST_CHECK_EQUAL(cache.GetNullifiersCacheSize(), 0);
+    BOOST_CHECK_EQUAL(cache.AccessCoins(txids[50])->vout[0].nValue, 1000);
+    cache.SelfTest();
+}
+
 BOOST_AUTO_TEST_CASE(coins_coinbase_spends)
 {
     CCoinsViewTest base;
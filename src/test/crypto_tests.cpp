@@ -2,16 +2,21 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/blake2b.h"
+#include "crypto/common.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 
+#include "sodium.h"
+
 #include <vector>
 
 #include <boost/assign/list_of.hpp>
@@ -248,4 +253,51 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    // Every batch size, so that all of the 8-way, 2-way and single implementations get their turn
+    for (int i = 0; i <= 32; ++i) {
+        unsigned char in[64 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 64 * i; ++j) {
+            in[j] = insecure_rand();
+        }
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+        }
+        SHA256D64(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blake2b_indices)
+{
+    // Every prefix length up to three blocks, so that the index lands in every
+    // position of the final block and straddles two blocks too
+    unsigned char personal[CBLAKE2bIndexHasher::PERSONAL_SIZE] = "ZcashPoW";
+    for (size_t nPrefix = 0; nPrefix < 3 * 128; nPrefix++) {
+        std::vector<unsigned char> prefix(nPrefix);
+        for (unsigned char& c : prefix)
+            c = insecure_rand();
+        const size_t outLen = 1 + nPrefix % CBLAKE2bIndexHasher::MAX_OUTPUT_SIZE;
+        uint32_t indices[7];
+        for (uint32_t& i : indices)
+            i = insecure_rand();
+        unsigned char out[7 * CBLAKE2bIndexHasher::MAX_OUTPUT_SIZE];
+        CBLAKE2bIndexHasher(outLen, personal, prefix.data(), nPrefix).Hash(indices, 7, out);
+
+        for (int i = 0; i < 7; i++) {
+            crypto_generichash_blake2b_state state;
+            crypto_generichash_blake2b_init_salt_personal(&state, NULL, 0, outLen, NULL, personal);
+            crypto_generichash_blake2b_update(&state, prefix.data(), nPrefix);
+            unsigned char le[4];
+            WriteLE32(le, indices[i]);
+            crypto_generichash_blake2b_update(&state, le, 4);
+            unsigned char expected[CBLAKE2bIndexHasher::MAX_OUTPUT_SIZE];
+            crypto_generichash_blake2b_final(&state, expected, outLen);
+            BOOST_CHECK(memcmp(out + i * outLen, expected, outLen) == 0);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
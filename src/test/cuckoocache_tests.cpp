@@ -0,0 +1,107 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+#include "random.h"
+#include "uint256.h"
+#include "test/test_bitcoin.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cuckoocache_tests, BasicTestingSetup)
+
+namespace {
+
+/** Picks the 8 hashes out of the (random) element, as the signature cache does */
+struct UInt256Hasher
+{
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+typedef CuckooCache::cache<uint256, UInt256Hasher> Cache;
+
+uint256 RandomElement()
+{
+    uint256 ret;
+    for (int i = 0; i < 8; i++) {
+        uint32_t r = insecure_rand();
+        std::memcpy(ret.begin() + 4 * i, &r, 4);
+    }
+    return ret;
+}
+
+/** Fill a cache of nSize entries with load * nSize elements, returning the share of them still found */
+double HitRate(uint32_t nSize, double load)
+{
+    Cache cache;
+    cache.setup(nSize);
+    std::vector<uint256> elements(nSize * load);
+    for (uint256& e : elements) {
+        e = RandomElement();
+        cache.insert(e);
+    }
+    size_t nHits = 0;
+    for (const uint256& e : elements)
+        nHits += cache.contains(e, false);
+    return double(nHits) / elements.size();
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_no_fakes)
+{
+    Cache cache;
+    cache.setup(1 << 16);
+    for (int i = 0; i < 100000; i++)
+        cache.insert(RandomElement());
+    for (int i = 0; i < 100000; i++)
+        BOOST_CHECK(!cache.contains(RandomElement(), false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_hit_rate)
+{
+    // Everything fits up to the 90% load the generations aim at, and eviction
+    // keeps most of what was inserted even well past the cache size
+    BOOST_CHECK(HitRate(1 << 16, 0.5) > 0.999);
+    BOOST_CHECK(HitRate(1 << 16, 0.9) > 0.99);
+    BOOST_CHECK(HitRate(1 << 16, 2.0) > 0.45);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_erase)
+{
+    const uint32_t nSize = 1 << 16;
+    Cache cache;
+    cache.setup(nSize);
+
+    // Half of the entries is marked as erasable, as a block connection would do
+    std::vector<uint256> elements(nSize / 2);
+    for (uint256& e : elements) {
+        e = RandomElement();
+        cache.insert(e);
+    }
+    for (size_t i = 0; i < elements.size() / 2; i++)
+        BOOST_CHECK(cache.contains(elements[i], true));
+
+    // Erased entries are still found until their slot is needed
+    for (const uint256& e : elements)
+        BOOST_CHECK(cache.contains(e, false));
+
+    // New entries take the place of the erased ones first: all of the others survive
+    for (size_t i = 0; i < elements.size() / 2; i++)
+        cache.insert(RandomElement());
+    size_t nKept = 0;
+    for (size_t i = elements.size() / 2; i < elements.size(); i++)
+        nKept += cache.contains(elements[i], false);
+    BOOST_CHECK(double(nKept) / (elements.size() / 2) > 0.99);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
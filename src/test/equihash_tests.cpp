@@ -99,6 +99,12 @@ void TestEquihashValidator(unsigned int n, unsigned int k, const std::string &I,
     bool isValid;
     EhIsValidSolution(n, k, state, GetMinimalFromIndices(soln, cBitLen), isValid);
     BOOST_CHECK(isValid == expected);
+
+    // The verifier working on I||V directly must agree
+    std::vector<unsigned char> input(I.begin(), I.end());
+    input.insert(input.end(), V.begin(), V.end());
+    EhIsValidSolutionOfInput(n, k, input.data(), input.size(), GetMinimalFromIndices(soln, cBitLen), isValid);
+    BOOST_CHECK(isValid == expected);
 }
 
 #ifdef ENABLE_MINING
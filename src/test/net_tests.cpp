@@ -0,0 +1,61 @@
+// Copyright (c) 2018 The Zencash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "net.h"
+#include "netbase.h"
+#include "protocol.h"
+#include "streams.h"
+
+#include "test/test_bitcoin.h"
+
+#include <string.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(net_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(recv_msg_in_place)
+{
+    // A message larger than both the read size and the allocation step of its data
+    std::vector<char> vPayload(600000);
+    for (size_t i = 0; i < vPayload.size(); i++)
+        vPayload[i] = (char)(i * 7);
+    CDataStream ssMsg(SER_NETWORK, PROTOCOL_VERSION);
+    ssMsg << CMessageHeader(Params().MessageStart(), "block", vPayload.size());
+    ssMsg.insert(ssMsg.end(), vPayload.begin(), vPayload.end());
+
+    CAddress addr(CService("10.0.0.1", 8233));
+    CNode nodeCopied(INVALID_SOCKET, addr, "", true);
+    CNode nodeInPlace(INVALID_SOCKET, addr, "", true);
+    LOCK2(nodeCopied.cs_vRecvMsg, nodeInPlace.cs_vRecvMsg);
+
+    BOOST_CHECK(nodeCopied.ReceiveMsgBytes(&ssMsg[0], ssMsg.size()));
+
+    // Nothing can be written in place until the header is complete
+    unsigned int nSize = 1;
+    BOOST_CHECK(nodeInPlace.GetRecvMsgDataBuffer(0x10000, nSize) == NULL);
+    BOOST_CHECK_EQUAL(nSize, 0U);
+    size_t nPos = CMessageHeader::HEADER_SIZE + 10;
+    BOOST_CHECK(nodeInPlace.ReceiveMsgBytes(&ssMsg[0], nPos));
+
+    char* pch;
+    while ((pch = nodeInPlace.GetRecvMsgDataBuffer(0x10000, nSize)) != NULL) {
+        BOOST_CHECK(nSize > 0 && nSize <= 0x10000);
+        BOOST_CHECK(nPos + nSize <= ssMsg.size());
+        memcpy(pch, &ssMsg[nPos], nSize);
+        nodeInPlace.RecvMsgDataWritten(nSize);
+        nPos += nSize;
+    }
+    BOOST_CHECK_EQUAL(nPos, ssMsg.size());
+
+    BOOST_CHECK_EQUAL(nodeInPlace.vRecvMsg.size(), 1U);
+    const CNetMessage& msg = nodeInPlace.vRecvMsg.front();
+    BOOST_CHECK(msg.complete());
+    BOOST_CHECK(msg.nTime != 0);
+    BOOST_CHECK(msg.vRecv.str() == nodeCopied.vRecvMsg.front().vRecv.str());
+    BOOST_CHECK(msg.vRecv.str() == std::string(vPayload.begin(), vPayload.end()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
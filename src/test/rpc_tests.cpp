@@ -6,11 +6,13 @@
 #include "rpc/client.h"
 
 #include "base58.h"
+#include "main.h"
 #include "netbase.h"
 
 #include "test/test_bitcoin.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/thread.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include <univalue.h>
@@ -304,4 +306,77 @@ BOOST_AUTO_TEST_CASE(rpc_ban)
     BOOST_CHECK_EQUAL(adr.get_str(), "2001:4d48:ac57:400:cacf:e9ff:fe1d:9c63/ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
 }
 
+BOOST_AUTO_TEST_CASE(rpc_batch)
+{
+    BOOST_CHECK(IsConcurrentRPCMethod("getrawtransaction"));
+    BOOST_CHECK(!IsConcurrentRPCMethod("sendrawtransaction"));
+
+    if (RPCIsInWarmup(NULL))
+        SetRPCWarmupFinished();
+    const std::string strGenesis = chainActive.Genesis()->GetBlockHash().GetHex();
+
+    // 20 concurrent calls, a mutating one, a malformed one, 20 concurrent calls
+    UniValue vReq(UniValue::VARR);
+    for (int i = 0; i < 42; i++) {
+        UniValue req(UniValue::VOBJ);
+        UniValue params(UniValue::VARR);
+        if (i == 20) {
+            req.pushKV("method", "setban");
+        } else if (i % 2) {
+            req.pushKV("method", "getblockcount");
+        } else {
+            req.pushKV("method", "getblockhash");
+            params.push_back(0);
+        }
+        req.pushKV("params", params);
+        req.pushKV("id", i);
+        vReq.push_back(i == 21 ? UniValue("not a request") : req);
+    }
+
+    boost::thread_group threads;
+    int nPosted = 0;
+    RPCWorkPoster post = [&threads, &nPosted](const boost::function<void()>& func) {
+        nPosted++;
+        threads.create_thread(func);
+        return true;
+    };
+    // a saturated pool: helpers only get a thread after the batch is over
+    std::vector<boost::function<void()> > vDeferred;
+    RPCWorkPoster defer = [&vDeferred](const boost::function<void()>& func) {
+        vDeferred.push_back(func);
+        return true;
+    };
+    RPCWorkPoster refuse = [](const boost::function<void()>&) { return false; };
+
+    for (const RPCWorkPoster& poster : {RPCWorkPoster(), post, defer, refuse}) {
+        UniValue ret;
+        BOOST_CHECK(ret.read(JSONRPCExecBatch(vReq, poster)));
+        BOOST_CHECK_EQUAL(ret.size(), 42U);
+        for (int i = 0; i < 42; i++) {
+            // replies come back in order, with the results of the concurrent calls
+            const UniValue& result = find_value(ret[i], "result");
+            if (i == 20 || i == 21) {
+                BOOST_CHECK(result.isNull());
+                BOOST_CHECK(find_value(ret[i], "error").isObject());
+            } else {
+                BOOST_CHECK(find_value(ret[i], "error").isNull());
+                if (i % 2)
+                    BOOST_CHECK_EQUAL(result.get_int(), 0);
+                else
+                    BOOST_CHECK_EQUAL(result.get_str(), strGenesis);
+            }
+            if (i != 21)
+                BOOST_CHECK_EQUAL(find_value(ret[i], "id").get_int(), i);
+        }
+    }
+    threads.join_all();
+    // only the two runs of concurrent calls were spread, over at most the allowed helpers each
+    BOOST_CHECK(nPosted >= 2);
+    BOOST_CHECK(nPosted <= 2 * (DEFAULT_RPC_BATCH_CONCURRENCY - 1));
+    // while the pool is busy each run holds a single slot, released at once
+    BOOST_CHECK_EQUAL(vDeferred.size(), 2U);
+    for (const boost::function<void()>& func : vDeferred)
+        func();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
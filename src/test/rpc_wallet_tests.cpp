@@ -22,6 +22,7 @@
 #include "rpc/protocol.h"
 #include "init.h"
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 
@@ -1243,6 +1244,55 @@ BOOST_AUTO_TEST_CASE(rpc_z_sendmany_internals)
 }
 
 
+/*
+ * JoinSplits without input notes are proved concurrently: the proofs must come
+ * back in the order a sequential loop would produce them, with at most the
+ * requested number of provers at once.
+ */
+BOOST_AUTO_TEST_CASE(rpc_z_sendmany_independent_joinsplits_order)
+{
+    const size_t n = 10;
+    std::vector<size_t> sequential;
+    for (size_t i = 0; i < n; i++) {
+        sequential.push_back(i * i);
+    }
+
+    for (size_t nProvers : {1, 2, 3, 8, 10, 20}) {
+        std::atomic<int> nRunning(0);
+        std::atomic<int> nMaxRunning(0);
+        // Later proofs finish first, so completion order is the reverse of plan order
+        std::vector<size_t> parallel = ProveInWaves<size_t>(n, nProvers, [&](size_t i) {
+            int nNow = ++nRunning;
+            int nMax = nMaxRunning;
+            while (nNow > nMax && !nMaxRunning.compare_exchange_weak(nMax, nNow)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(2 * (n - i)));
+            --nRunning;
+            return i * i;
+        });
+        BOOST_CHECK(parallel == sequential);
+        BOOST_CHECK(nMaxRunning <= (int)nProvers);
+    }
+
+    // The failure of one proof is reported once its wave is done
+    BOOST_CHECK_THROW(ProveInWaves<size_t>(n, 3, [](size_t i) -> size_t {
+        if (i == 4) {
+            throw std::runtime_error("proof failed");
+        }
+        return i;
+    }), std::runtime_error);
+
+    BOOST_CHECK(ProveInWaves<size_t>(0, 4, [](size_t i) { return i; }).empty());
+
+    // -joinsplitprovers is capped by the cores and can't go below one prover
+    mapArgs["-joinsplitprovers"] = "0";
+    BOOST_CHECK_EQUAL(GetJoinSplitProvers(), (size_t)1);
+    mapArgs["-joinsplitprovers"] = "100000";
+    BOOST_CHECK_EQUAL(GetJoinSplitProvers(), (size_t)GetNumCores());
+    mapArgs.erase("-joinsplitprovers");
+    BOOST_CHECK_EQUAL(GetJoinSplitProvers(), (size_t)std::min(DEFAULT_JOINSPLIT_PROVERS, GetNumCores()));
+}
+
+
 /*
  * This test covers storing encrypted zkeys in the wallet.
  */
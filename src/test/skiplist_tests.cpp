@@ -100,4 +100,90 @@ BOOST_AUTO_TEST_CASE(getlocator_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(findfork_test)
+{
+    // A main chain 10000 blocks long, with side branches of random length stemming at random heights.
+    std::vector<CBlockIndex> vBlocksMain(10000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].BuildSkip();
+    }
+    CChain chain;
+    chain.SetTip(&vBlocksMain.back());
+
+    std::vector<std::vector<CBlockIndex> > vBranches(100);
+    for (unsigned int b=0; b<vBranches.size(); b++) {
+        int nForkHeight = insecure_rand() % vBlocksMain.size();
+        vBranches[b].resize(1 + insecure_rand() % 3000);
+        for (unsigned int i=0; i<vBranches[b].size(); i++) {
+            vBranches[b][i].nHeight = nForkHeight + i + 1;
+            vBranches[b][i].pprev = i ? &vBranches[b][i - 1] : &vBlocksMain[nForkHeight];
+            vBranches[b][i].BuildSkip();
+        }
+
+        // Any block of the branch forks where the branch stems
+        for (int n=0; n<10; n++) {
+            const CBlockIndex* pindex = &vBranches[b][insecure_rand() % vBranches[b].size()];
+            BOOST_CHECK(chain.FindFork(pindex) == &vBlocksMain[nForkHeight]);
+        }
+        BOOST_CHECK(chain.FindFork(&vBranches[b].back()) == &vBlocksMain[nForkHeight]);
+    }
+
+    // Blocks of the chain are their own fork point
+    for (int n=0; n<100; n++) {
+        const CBlockIndex* pindex = &vBlocksMain[insecure_rand() % vBlocksMain.size()];
+        BOOST_CHECK(chain.FindFork(pindex) == pindex);
+    }
+
+    // A shorter chain: blocks above its tip fork at most at the tip
+    CChain shortChain;
+    shortChain.SetTip(&vBlocksMain[5000]);
+    BOOST_CHECK(shortChain.FindFork(&vBlocksMain.back()) == &vBlocksMain[5000]);
+    for (unsigned int b=0; b<vBranches.size(); b++) {
+        int nForkHeight = vBranches[b][0].nHeight - 1;
+        BOOST_CHECK(shortChain.FindFork(&vBranches[b].back()) == &vBlocksMain[std::min(nForkHeight, 5000)]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chainsnapshot_test)
+{
+    // A main chain 10000 blocks long, and a branch splitting off at block 4999
+    std::vector<CBlockIndex> vBlocksMain(10000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].BuildSkip();
+    }
+    std::vector<CBlockIndex> vBlocksSide(1000);
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vBlocksSide[i].nHeight = i + 5000;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[4999];
+        vBlocksSide[i].BuildSkip();
+    }
+
+    CChain chain;
+    BOOST_CHECK(chain.Snapshot()->Tip() == NULL);
+    BOOST_CHECK_EQUAL(chain.Snapshot()->Height(), -1);
+
+    chain.SetTip(&vBlocksMain.back());
+    std::shared_ptr<const CChainSnapshot> snapshot = chain.Snapshot();
+    for (int n=0; n<100; n++) {
+        int r = insecure_rand() % 10000;
+        BOOST_CHECK((*snapshot)[r] == chain[r]);
+        BOOST_CHECK(snapshot->Next(&vBlocksMain[r]) == chain.Next(&vBlocksMain[r]));
+        BOOST_CHECK(snapshot->Contains(&vBlocksMain[r]));
+        BOOST_CHECK(!snapshot->Contains(&vBlocksSide[r % 1000]));
+    }
+    BOOST_CHECK((*snapshot)[10000] == NULL);
+
+    // A reorganization publishes a new snapshot, and leaves the one already taken alone
+    chain.SetTip(&vBlocksSide.back());
+    BOOST_CHECK(snapshot->Tip() == &vBlocksMain.back());
+    BOOST_CHECK(snapshot->Contains(&vBlocksMain[7000]));
+    BOOST_CHECK_EQUAL(chain.Snapshot()->Height(), 5999);
+    BOOST_CHECK(chain.Snapshot()->Contains(&vBlocksSide[500]));
+    BOOST_CHECK(chain.Snapshot()->Next(&vBlocksMain[4999]) == &vBlocksSide[0]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -285,6 +285,45 @@ BOOST_AUTO_TEST_CASE(univalue_object)
     BOOST_CHECK_EQUAL(obj.size(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(univalue_move)
+{
+    UniValue inner(UniValue::VARR);
+    inner.push_back("zippy");
+    inner.push_back(UniValue((int64_t)1023LL));
+
+    UniValue obj(UniValue::VOBJ);
+    obj.reserve(4);
+    BOOST_CHECK(obj.pushKVEnd("inner", std::move(inner)));
+    BOOST_CHECK_EQUAL(obj["inner"].size(), 2);
+    BOOST_CHECK_EQUAL(obj["inner"][0].getValStr(), "zippy");
+
+    // pushKV still replaces an existing key, whether it copies or moves
+    UniValue age((int64_t)42);
+    BOOST_CHECK(obj.pushKV("age", age));
+    BOOST_CHECK(obj.pushKV("age", UniValue((int64_t)43)));
+    BOOST_CHECK_EQUAL(obj.size(), 2);
+    BOOST_CHECK_EQUAL(obj["age"].getValStr(), "43");
+
+    // pushKVEnd doesn't look for it
+    BOOST_CHECK(obj.pushKVEnd("age", UniValue((int64_t)44)));
+    BOOST_CHECK_EQUAL(obj.size(), 3);
+    BOOST_CHECK(obj.push_back(Pair("name", UniValue("foo bar"))));
+    BOOST_CHECK_EQUAL(obj["name"].getValStr(), "foo bar");
+
+    UniValue arr(UniValue::VARR);
+    BOOST_CHECK(!arr.pushKVEnd("key", UniValue("value")));
+    vector<UniValue> vec(3, UniValue("boing"));
+    BOOST_CHECK(arr.push_backV(std::move(vec)));
+    BOOST_CHECK(arr.push_backV(vector<UniValue>(2, UniValue("going"))));
+    BOOST_CHECK(arr.push_back(std::move(obj)));
+    BOOST_CHECK_EQUAL(arr.size(), 6);
+    BOOST_CHECK_EQUAL(arr[2].getValStr(), "boing");
+    BOOST_CHECK_EQUAL(arr[4].getValStr(), "going");
+    BOOST_CHECK_EQUAL(arr[5]["age"].getValStr(), "43");
+    BOOST_CHECK_EQUAL(arr.write(), "[\"boing\",\"boing\",\"boing\",\"going\",\"going\","
+                      "{\"inner\":[\"zippy\",1023],\"age\":43,\"age\":44,\"name\":\"foo bar\"}]");
+}
+
 static const char *json1 =
 "[1.10000000,{\"key1\":\"str\\u0000\",\"key2\":800,\"key3\":{\"name\":\"martian http://test.com\"}}]";
 
@@ -316,5 +355,32 @@ BOOST_AUTO_TEST_CASE(univalue_readwrite)
     BOOST_CHECK_EQUAL(strJson1, v.write());
 }
 
+BOOST_AUTO_TEST_CASE(univalue_write_stream)
+{
+    UniValue v;
+    BOOST_CHECK(v.read(json1));
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 100; i++)
+        arr.push_back(v);
+
+    // whatever the chunk size, the pieces make up the same document
+    for (size_t nChunkSize : {1, 10, 100, 100000}) {
+        for (unsigned int prettyIndent : {0, 4}) {
+            std::string strOut, strBuffer;
+            size_t nFlushes = 0;
+            arr.write(strBuffer, [&](std::string& s) {
+                nFlushes++;
+                if (s.size() >= nChunkSize) {
+                    strOut += s;
+                    s.clear();
+                }
+            }, prettyIndent);
+            strOut += strBuffer;
+            BOOST_CHECK_EQUAL(strOut, arr.write(prettyIndent));
+            BOOST_CHECK(nFlushes > 100);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
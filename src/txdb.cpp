@@ -8,11 +8,14 @@
 #include "chainparams.h"
 #include "hash.h"
 #include "main.h"
+#include "memusage.h"
 #include "pow.h"
 #include "uint256.h"
 
 #include <stdint.h>
 
+#include <algorithm>
+
 #include <boost/thread.hpp>
 #include <sc/sidechaintypes.h>
 #include "utilmoneystr.h"
@@ -45,6 +48,68 @@ static const char DB_FAST_REINDEX_FLAG = 'S';
 static const char DB_LAST_BLOCK = 'l';
 static const char DB_CSW_NULLIFIER = 'n';
 static const char DB_MATURITY_HEIGHT = 'h';
+static const char DB_COINS_HEADER = 'C';
+static const char DB_COINS_OUTPUT = 'o';
+static const char DB_COINS_LAYOUT = 'L';
+
+/**
+ * Per-output layout: the attributes of a transaction/certificate coins, stored under DB_COINS_HEADER,
+ * with the bitmask of its unspent outputs, each stored under DB_COINS_OUTPUT.
+ */
+struct CCoinsHeader
+{
+    bool fCoinBase;
+    int nHeight;
+    int nVersion;
+    int nFirstBwtPos;
+    int nBwtMaturityHeight;
+    std::vector<unsigned char> vAvail;
+
+    CCoinsHeader() : fCoinBase(false), nHeight(0), nVersion(0), nFirstBwtPos(BWT_POS_UNSET), nBwtMaturityHeight(0) {}
+
+    explicit CCoinsHeader(const CCoins& coins) :
+        fCoinBase(coins.fCoinBase), nHeight(coins.nHeight), nVersion(coins.nVersion),
+        nFirstBwtPos(coins.nFirstBwtPos), nBwtMaturityHeight(coins.nBwtMaturityHeight),
+        vAvail((coins.vout.size() + 7) / 8, 0)
+    {
+        for (unsigned int i = 0; i < coins.vout.size(); i++)
+            if (!coins.vout[i].IsNull())
+                vAvail[i / 8] |= (1 << (i % 8));
+    }
+
+    unsigned int Size() const { return vAvail.size() * 8; }
+
+    bool IsAvailable(unsigned int nPos) const {
+        return nPos / 8 < vAvail.size() && (vAvail[nPos / 8] & (1 << (nPos % 8))) != 0;
+    }
+
+    //! Set the attributes of coins, with room for all the outputs
+    void ToCoins(CCoins& coins) const {
+        coins.fCoinBase = fCoinBase;
+        coins.nHeight = nHeight;
+        coins.nVersion = nVersion;
+        coins.nFirstBwtPos = nFirstBwtPos;
+        coins.nBwtMaturityHeight = nBwtMaturityHeight;
+        coins.vout.assign(Size(), CTxOut());
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(VARINT(this->nVersion));
+        READWRITE(fCoinBase);
+        READWRITE(VARINT(nHeight));
+        READWRITE(vAvail);
+        // same test as CCoins::IsFromCert(), bwt attributes are meaningful only for certificates
+        if ((this->nVersion & 0x7f) == (SC_CERT_VERSION & 0x7f)) {
+            READWRITE(nFirstBwtPos);
+            READWRITE(nBwtMaturityHeight);
+        } else if (ser_action.ForRead()) {
+            nFirstBwtPos = BWT_POS_UNSET;
+        }
+    }
+};
 
 
 void static BatchWriteAnchor(CLevelDBBatch &batch,
@@ -73,6 +138,28 @@ void static BatchWriteCoins(CLevelDBBatch &batch, const uint256 &hash, const CCo
         batch.Write(make_pair(DB_COINS, hash), coins);
 }
 
+// Per-output layout: only the outputs whose availability differs from the one on disk, as recorded in the
+// cache entry, are touched. Past the outputs the entry keeps track of, they are written or erased anyway.
+void static BatchWriteCoinsPerOutput(CLevelDBBatch &batch, const uint256 &hash, const CCoinsCacheEntry &entry) {
+    const CCoins& coins = entry.coins;
+    const bool fFresh = entry.flags & CCoinsCacheEntry::FRESH;
+    unsigned int nSize = fFresh ? coins.vout.size() : std::max((unsigned int)coins.vout.size(), entry.nBaseOutputs);
+    for (unsigned int i = 0; i < nSize; i++) {
+        bool fAvail = coins.IsAvailable(i);
+        bool fUntracked = !fFresh && i >= CCoinsCacheEntry::BASE_AVAIL_OUTPUTS;
+        bool fAvailOld = !fFresh && entry.IsBaseAvail(i);
+        if (fAvail && (fUntracked || !fAvailOld))
+            batch.Write(make_pair(DB_COINS_OUTPUT, make_pair(hash, i)), CTxOutCompressor(REF(coins.vout[i])));
+        else if (!fAvail && (fUntracked || fAvailOld))
+            batch.Erase(make_pair(DB_COINS_OUTPUT, make_pair(hash, i)));
+    }
+
+    if (coins.IsPruned())
+        batch.Erase(make_pair(DB_COINS_HEADER, hash));
+    else
+        batch.Write(make_pair(DB_COINS_HEADER, hash), CCoinsHeader(coins));
+}
+
 void static BatchSidechains(CLevelDBBatch &batch, const uint256 &scId, const CSidechainsCacheEntry &sidechain) {
     switch (sidechain.flag) {
         case CSidechainsCacheEntry::Flags::FRESH:
@@ -129,10 +216,111 @@ void static BatchWriteCswNullifier(CLevelDBBatch &batch, const uint256 &scId, co
     }
 }
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe, false, 64) {
+CDBBackgroundWriter::CDBBackgroundWriter() : fBusy(false), fFailed(false), fStop(false), nPendingMemoryUsage(0)
+{
+    worker = boost::thread(&CDBBackgroundWriter::ThreadProcess, this);
+}
+
+CDBBackgroundWriter::~CDBBackgroundWriter()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+    }
+    condChanged.notify_all();
+    // queued batches are still written when stopping
+    if (worker.joinable())
+        worker.join();
+}
+
+void CDBBackgroundWriter::Submit(CLevelDBWrapper& db, std::unique_ptr<CLevelDBBatch> batch, bool fSync,
+                                 std::function<void(bool)> onDone, size_t nMemoryUsage)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        queue.push_back(Job{&db, std::move(batch), fSync, std::move(onDone), nMemoryUsage});
+        nPendingMemoryUsage += nMemoryUsage;
+    }
+    condChanged.notify_all();
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, false, 64) {
+bool CDBBackgroundWriter::Wait()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (!queue.empty() || fBusy)
+        condChanged.wait(lock);
+    return !fFailed;
+}
+
+size_t CDBBackgroundWriter::PendingMemoryUsage()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return nPendingMemoryUsage;
+}
+
+void CDBBackgroundWriter::ThreadProcess()
+{
+    RenameThread("horizen-dbwriter");
+
+    while (true)
+    {
+        Job job;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty() && !fStop)
+                condChanged.wait(lock);
+            if (queue.empty())
+                return;
+
+            job = std::move(queue.front());
+            queue.pop_front();
+            fBusy = true;
+        }
+
+        bool fOk = false;
+        int64_t nStart = GetTimeMicros();
+        try {
+            fOk = job.db->WriteBatch(*job.batch, job.fSync);
+        } catch (const std::exception& e) {
+            LogPrintf("%s(): error writing to database: %s\n", __func__, e.what());
+        }
+        LogPrint("bench", "%s(): batch written in %.2fms%s\n", __func__, (GetTimeMicros() - nStart) * 0.001, job.fSync ? " (sync)" : "");
+
+        if (job.onDone)
+            job.onDone(fOk);
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fBusy = false;
+            nPendingMemoryUsage -= job.nMemoryUsage;
+            if (!fOk)
+                fFailed = true;
+        }
+        condChanged.notify_all();
+    }
+}
+
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe, false, 64), nLayout(LAYOUT_RECORD), pwriter(NULL) {
+    db.Read(DB_COINS_LAYOUT, nLayout);
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, false, 64), nLayout(LAYOUT_RECORD), pwriter(NULL) {
+    db.Read(DB_COINS_LAYOUT, nLayout);
+}
+
+template <typename Map>
+bool CCoinsViewDB::FindPending(Map CChanges::*pmap, const typename Map::key_type& key, typename Map::mapped_type& entry) const
+{
+    boost::unique_lock<boost::mutex> lock(csPending);
+    for (auto it = listPending.rbegin(); it != listPending.rend(); ++it) {
+        const Map& map = (**it).*pmap;
+        typename Map::const_iterator found = map.find(key);
+        if (found != map.end()) {
+            entry = found->second;
+            return true;
+        }
+    }
+    return false;
 }
 
 
@@ -143,12 +331,24 @@ bool CCoinsViewDB::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree)
         return true;
     }
 
+    CAnchorsCacheEntry pending;
+    if (FindPending(&CChanges::mapAnchors, rt, pending)) {
+        if (!pending.entered)
+            return false;
+        tree = pending.tree;
+        return true;
+    }
+
     bool read = db.Read(make_pair(DB_ANCHOR, rt), tree);
 
     return read;
 }
 
 bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
+    CNullifiersCacheEntry pending;
+    if (FindPending(&CChanges::mapNullifiers, nf, pending))
+        return pending.entered;
+
     bool spent = false;
     bool read = db.Read(make_pair(DB_NULLIFIER, nf), spent);
 
@@ -156,30 +356,159 @@ bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
 }
 
 bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
-    return db.Read(make_pair(DB_COINS, txid), coins);
+    CCoinsCacheEntry pending;
+    if (FindPending(&CChanges::mapCoins, txid, pending)) {
+        // pruned coins are erased from the database
+        if (pending.coins.IsPruned())
+            return false;
+        coins.swap(pending.coins);
+        return true;
+    }
+
+    return ReadCoins(txid, coins);
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
-    return db.Exists(make_pair(DB_COINS, txid));
+    CCoinsCacheEntry pending;
+    if (FindPending(&CChanges::mapCoins, txid, pending))
+        return !pending.coins.IsPruned();
+
+    if (nLayout == LAYOUT_RECORD)
+        return db.Exists(make_pair(DB_COINS, txid));
+    if (db.Exists(make_pair(DB_COINS_HEADER, txid)))
+        return true;
+    return nLayout == LAYOUT_UPGRADING && db.Exists(make_pair(DB_COINS, txid));
+}
+
+bool CCoinsViewDB::UpgradeToPerOutputLayout() {
+    assert(!pwriter);
+    if (nLayout == LAYOUT_OUTPUT)
+        return true;
+
+    LogPrintf("Upgrading the coin database to the per-output layout...\n");
+    int64_t nStart = GetTimeMillis();
+    if (!db.Write(DB_COINS_LAYOUT, (int)LAYOUT_UPGRADING))
+        return false;
+    nLayout = LAYOUT_UPGRADING;
+
+    // Each record is converted and erased in the same batch, so that an interrupted upgrade can be resumed
+    static const size_t UPGRADE_BATCH_SIZE = 10000;
+    const std::string prefix(1, DB_COINS);
+    size_t nConverted = 0;
+    std::unique_ptr<CLevelDBBatch> batch(new CLevelDBBatch());
+    std::unique_ptr<leveldb::Iterator> it(db.NewIterator());
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next()) {
+        boost::this_thread::interruption_point();
+
+        leveldb::Slice slKey = it->key();
+        CDataStream ssKey(slKey.data() + sizeof(char), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        uint256 txid;
+        ssKey >> txid;
+        leveldb::Slice slValue = it->value();
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        CCoinsCacheEntry entry;
+        ssValue >> entry.coins;
+        entry.flags = CCoinsCacheEntry::FRESH;
+
+        BatchWriteCoinsPerOutput(*batch, txid, entry);
+        batch->Erase(make_pair(DB_COINS, txid));
+
+        if (++nConverted % UPGRADE_BATCH_SIZE == 0) {
+            if (!db.WriteBatch(*batch))
+                return false;
+            batch.reset(new CLevelDBBatch());
+            LogPrint("coindb", "%s: %u coins converted\n", __func__, nConverted);
+        }
+    }
+
+    batch->Write(DB_COINS_LAYOUT, (int)LAYOUT_OUTPUT);
+    if (!db.WriteBatch(*batch, true))
+        return false;
+    nLayout = LAYOUT_OUTPUT;
+
+    LogPrintf("Upgraded %u coins to the per-output layout in %dms\n", nConverted, GetTimeMillis() - nStart);
+    return true;
+}
+
+bool CCoinsViewDB::ReadCoins(const uint256 &txid, CCoins &coins) const {
+    if (nLayout == LAYOUT_RECORD)
+        return db.Read(make_pair(DB_COINS, txid), coins);
+
+    CCoinsHeader header;
+    if (!db.Read(make_pair(DB_COINS_HEADER, txid), header)) {
+        // while upgrading, coins not converted yet are still in the record layout
+        return nLayout == LAYOUT_UPGRADING && db.Read(make_pair(DB_COINS, txid), coins);
+    }
+    header.ToCoins(coins);
+
+    // the outputs of txid are contiguous in the database, a single seek gets all of them
+    CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+    ssPrefix << make_pair(DB_COINS_OUTPUT, txid);
+    const leveldb::Slice slPrefix(&ssPrefix[0], ssPrefix.size());
+
+    unsigned int nFound = 0;
+    std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+    for (it->Seek(slPrefix); it->Valid() && it->key().starts_with(slPrefix); it->Next()) {
+        leveldb::Slice slKey = it->key();
+        CDataStream ssKey(slKey.data() + slPrefix.size(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        unsigned int nPos;
+        ssKey >> nPos;
+        if (!header.IsAvailable(nPos))
+            throw std::runtime_error(strprintf("%s: unexpected output %s:%u", __func__, txid.ToString(), nPos));
+
+        leveldb::Slice slValue = it->value();
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> REF(CTxOutCompressor(coins.vout[nPos]));
+        nFound++;
+    }
+    coins.Cleanup();
+
+    if ((int)nFound != std::count_if(coins.vout.begin(), coins.vout.end(), [](const CTxOut& out) { return !out.IsNull(); }))
+        throw std::runtime_error(strprintf("%s: missing outputs of %s", __func__, txid.ToString()));
+    return true;
 }
 
 bool CCoinsViewDB::GetSidechain(const uint256& scId, CSidechain& info) const
 {
+    CSidechainsCacheEntry pending;
+    if (FindPending(&CChanges::mapSidechains, scId, pending)) {
+        if (pending.flag == CSidechainsCacheEntry::Flags::ERASED)
+            return false;
+        info = pending.sidechain;
+        return true;
+    }
+
     return db.Read(std::make_pair(DB_SIDECHAINS, scId), info);
 }
 
 bool CCoinsViewDB::HaveSidechain(const uint256& scId) const
 {
+    CSidechainsCacheEntry pending;
+    if (FindPending(&CChanges::mapSidechains, scId, pending))
+        return pending.flag != CSidechainsCacheEntry::Flags::ERASED;
+
     return db.Exists(std::make_pair(DB_SIDECHAINS, scId));
 }
 
 bool CCoinsViewDB::HaveSidechainEvents(int height) const
 {
+    CSidechainEventsCacheEntry pending;
+    if (FindPending(&CChanges::mapSidechainEvents, height, pending))
+        return pending.flag != CSidechainEventsCacheEntry::Flags::ERASED;
+
     return db.Exists(std::make_pair(DB_CEASEDSCS, height));
 }
 
 bool CCoinsViewDB::GetSidechainEvents(int height, CSidechainEvents& ceasingScs) const
 {
+    CSidechainEventsCacheEntry pending;
+    if (FindPending(&CChanges::mapSidechainEvents, height, pending)) {
+        if (pending.flag == CSidechainEventsCacheEntry::Flags::ERASED)
+            return false;
+        ceasingScs = pending.scEvents;
+        return true;
+    }
+
     return db.Read(std::make_pair(DB_CEASEDSCS, height), ceasingScs);
 }
 
@@ -200,10 +529,28 @@ void CCoinsViewDB::GetScIds(std::set<uint256>& scIdsList) const
         scIdsList.insert(keyScId);
     }
 
+    // apply the changes not written yet, oldest first
+    boost::unique_lock<boost::mutex> lock(csPending);
+    for (const auto& pending : listPending) {
+        for (const auto& entry : pending->mapSidechains) {
+            if (entry.second.flag == CSidechainsCacheEntry::Flags::ERASED)
+                scIdsList.erase(entry.first);
+            else
+                scIdsList.insert(entry.first);
+        }
+    }
+
     return;
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        for (auto it = listPending.rbegin(); it != listPending.rend(); ++it)
+            if (!(*it)->hashBlock.IsNull())
+                return (*it)->hashBlock;
+    }
+
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -211,6 +558,13 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 }
 
 uint256 CCoinsViewDB::GetBestAnchor() const {
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        for (auto it = listPending.rbegin(); it != listPending.rend(); ++it)
+            if (!(*it)->hashAnchor.IsNull())
+                return (*it)->hashAnchor;
+    }
+
     uint256 hashBestAnchor;
     if (!db.Read(DB_BEST_ANCHOR, hashBestAnchor))
         return ZCIncrementalMerkleTree::empty_root();
@@ -219,6 +573,11 @@ uint256 CCoinsViewDB::GetBestAnchor() const {
 
 bool CCoinsViewDB::HaveCswNullifier(const uint256& scId, const CFieldElement &nullifier) const {
     std::pair<uint256, CFieldElement> position = std::make_pair(scId, nullifier);
+
+    CCswNullifiersCacheEntry pending;
+    if (FindPending(&CChanges::mapCswNullifiers, position, pending))
+        return pending.flag != CCswNullifiersCacheEntry::Flags::ERASED;
+
     return db.Exists(make_pair(DB_CSW_NULLIFIER, position));
 }
 
@@ -230,66 +589,144 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
                               CSidechainsMap& mapSidechains,
                               CSidechainEventsMap& mapSidechainEvents,
                               CCswNullifiersMap& cswNullifies) {
-    CLevelDBBatch batch;
+    std::shared_ptr<CChanges> changes = std::make_shared<CChanges>();
+    changes->mapCoins.swap(mapCoins);
+    changes->hashBlock = hashBlock;
+    changes->hashAnchor = hashAnchor;
+    changes->mapAnchors.swap(mapAnchors);
+    changes->mapNullifiers.swap(mapNullifiers);
+    changes->mapSidechains.swap(mapSidechains);
+    changes->mapSidechainEvents.swap(mapSidechainEvents);
+    changes->mapCswNullifiers.swap(cswNullifies);
+
+    if (!pwriter) {
+        CLevelDBBatch batch;
+        FillBatch(batch, *changes, true);
+        return db.WriteBatch(batch);
+    }
+
+    // Keep serving the changes until the writer has committed them
+    std::unique_ptr<CLevelDBBatch> batch(new CLevelDBBatch());
+    FillBatch(*batch, *changes, false);
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        listPending.push_back(changes);
+    }
+    // The changes are held until then, on top of the coins cache they came from. The serialized batch,
+    // of a comparable size, is not counted.
+    size_t nMemoryUsage = memusage::DynamicUsage(changes->mapCoins) +
+                          memusage::DynamicUsage(changes->mapAnchors) +
+                          memusage::DynamicUsage(changes->mapNullifiers) +
+                          memusage::DynamicUsage(changes->mapSidechains) +
+                          memusage::DynamicUsage(changes->mapSidechainEvents) +
+                          memusage::DynamicUsage(changes->mapCswNullifiers);
+    for (const auto& entry : changes->mapCoins)
+        nMemoryUsage += entry.second.coins.DynamicMemoryUsage();
+    pwriter->Submit(db, std::move(batch), false, [this, changes](bool fOk) {
+        // on failure keep serving them, the node is shutting down anyway
+        if (fOk) {
+            boost::unique_lock<boost::mutex> lock(csPending);
+            listPending.remove(changes);
+        }
+    }, nMemoryUsage);
+    return true;
+}
+
+bool CCoinsViewDB::BatchWriteDirty(const CCoinsMap &mapCoins,
+                                   const uint256 &hashBlock,
+                                   const uint256 &hashAnchor,
+                                   const CAnchorsMap &mapAnchors,
+                                   const CNullifiersMap &mapNullifiers,
+                                   const CSidechainsMap& mapSidechains,
+                                   const CSidechainEventsMap& mapSidechainEvents,
+                                   const CCswNullifiersMap& cswNullifies) {
+    const CChangesRef changes{mapCoins, hashBlock, hashAnchor, mapAnchors, mapNullifiers,
+                              mapSidechains, mapSidechainEvents, cswNullifies};
+
+    if (!pwriter) {
+        CLevelDBBatch batch;
+        FillBatch(batch, changes, false);
+        return db.WriteBatch(batch);
+    }
+
+    // The caller drops or evicts its entries as soon as it gets back: hand a copy of the dirty ones to
+    // BatchWrite, which serves them to readers until the writer has committed them
+    return CCoinsView::BatchWriteDirty(mapCoins, hashBlock, hashAnchor, mapAnchors, mapNullifiers,
+                                       mapSidechains, mapSidechainEvents, cswNullifies);
+}
+
+//! Next entry of map, erasing the current one if fConsume
+template <typename Map>
+static typename Map::iterator NextEntry(Map& map, typename Map::iterator it, bool fConsume) {
+    return fConsume ? map.erase(it) : std::next(it);
+}
+
+//! Maps left in place are never consumed
+template <typename Map>
+static typename Map::const_iterator NextEntry(const Map& map, typename Map::const_iterator it, bool fConsume) {
+    assert(!fConsume);
+    return std::next(it);
+}
+
+// Add the changes to batch. If fConsume, entries are removed as soon as they are added, to bound memory usage.
+template <typename Changes>
+void CCoinsViewDB::FillBatch(CLevelDBBatch& batch, Changes& changes, bool fConsume) const {
     size_t count = 0;
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (auto it = changes.mapCoins.begin(); it != changes.mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            BatchWriteCoins(batch, it->first, it->second.coins);
+            if (nLayout == LAYOUT_OUTPUT) {
+                BatchWriteCoinsPerOutput(batch, it->first, it->second);
+            } else {
+                BatchWriteCoins(batch, it->first, it->second.coins);
+            }
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        it = NextEntry(changes.mapCoins, it, fConsume);
     }
 
-    for (CAnchorsMap::iterator it = mapAnchors.begin(); it != mapAnchors.end();) {
+    for (auto it = changes.mapAnchors.begin(); it != changes.mapAnchors.end();) {
         if (it->second.flags & CAnchorsCacheEntry::DIRTY) {
             BatchWriteAnchor(batch, it->first, it->second.tree, it->second.entered);
             // TODO: changed++?
         }
-        CAnchorsMap::iterator itOld = it++;
-        mapAnchors.erase(itOld);
+        it = NextEntry(changes.mapAnchors, it, fConsume);
     }
 
-    for (CNullifiersMap::iterator it = mapNullifiers.begin(); it != mapNullifiers.end();) {
+    for (auto it = changes.mapNullifiers.begin(); it != changes.mapNullifiers.end();) {
         if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
             BatchWriteNullifier(batch, it->first, it->second.entered);
             // TODO: changed++?
         }
-        CNullifiersMap::iterator itOld = it++;
-        mapNullifiers.erase(itOld);
+        it = NextEntry(changes.mapNullifiers, it, fConsume);
     }
 
-    for (CSidechainsMap::iterator it = mapSidechains.begin(); it != mapSidechains.end();) {
+    for (auto it = changes.mapSidechains.begin(); it != changes.mapSidechains.end();) {
         BatchSidechains(batch, it->first, it->second);
-        CSidechainsMap::iterator itOld = it++;
-        mapSidechains.erase(itOld);
+        it = NextEntry(changes.mapSidechains, it, fConsume);
     }
 
-    for (CSidechainEventsMap::iterator it = mapSidechainEvents.begin(); it != mapSidechainEvents.end();) {
+    for (auto it = changes.mapSidechainEvents.begin(); it != changes.mapSidechainEvents.end();) {
         BatchCeasedScs(batch, it->first, it->second);
-        CSidechainEventsMap::iterator itOld = it++;
-        mapSidechainEvents.erase(itOld);
+        it = NextEntry(changes.mapSidechainEvents, it, fConsume);
     }
-    
-    for (CCswNullifiersMap::iterator it = cswNullifies.begin(); it != cswNullifies.end();) {
+
+    for (auto it = changes.mapCswNullifiers.begin(); it != changes.mapCswNullifiers.end();) {
         const std::pair<uint256, CFieldElement>& position = it->first;
         BatchWriteCswNullifier(batch, position.first, position.second, it->second);
-        CCswNullifiersMap::iterator itOld = it++;
-        cswNullifies.erase(itOld);
+        it = NextEntry(changes.mapCswNullifiers, it, fConsume);
     }
 
-    if (!hashBlock.IsNull())
-        BatchWriteHashBestChain(batch, hashBlock);
-    if (!hashAnchor.IsNull())
-        BatchWriteHashBestAnchor(batch, hashAnchor);
+    if (!changes.hashBlock.IsNull())
+        BatchWriteHashBestChain(batch, changes.hashBlock);
+    if (!changes.hashAnchor.IsNull())
+        BatchWriteHashBestAnchor(batch, changes.hashAnchor);
 
     LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return db.WriteBatch(batch);
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles), pwriter(NULL) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -323,7 +760,42 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
     return Read(DB_LAST_BLOCK, nFile);
 }
 
+static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, CAmount& nTotalAmount, const uint256& txhash, const CCoins& coins)
+{
+    ss << txhash;
+    ss << VARINT(coins.nVersion);
+    ss << (coins.fCoinBase ? 'c' : 'n');
+    ss << VARINT(coins.nHeight);
+
+    // add cert attribute to the hash writer obj, such values are meaningful only in this case 
+    // the size of the hash writer obj buffer is different anyway (larger) from the actual serialized size
+    // because the coin serialization is compressed 
+    if (coins.IsFromCert()) {
+        ss << coins.nFirstBwtPos;
+        ss << coins.nBwtMaturityHeight;
+    }
+
+    // - transactions and certificates are lumped together 
+    // - nTotalAmount includes certificate valid bwt amounts (not-null, as for low-quality certs)
+    //   even if not yet matured, as it is done currently with coinbase vouts
+    stats.nTransactions++;
+    for (unsigned int i=0; i<coins.vout.size(); i++) {
+        const CTxOut &out = coins.vout[i];
+        if (!out.IsNull()) {
+            stats.nTransactionOutputs++;
+            ss << VARINT(i+1);
+            ss << out;
+            nTotalAmount += out.nValue;
+        }
+    }
+    ss << VARINT(0);
+}
+
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
+    // the statistics are computed from the database only
+    if (pwriter)
+        pwriter->Wait();
+
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
@@ -348,35 +820,19 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
                 ssValue >> coins;
                 uint256 txhash;
                 ssKey >> txhash;
-                ss << txhash;
-                ss << VARINT(coins.nVersion);
-                ss << (coins.fCoinBase ? 'c' : 'n');
-                ss << VARINT(coins.nHeight);
-
-                // add cert attribute to the hash writer obj, such values are meaningful only in this case 
-                // the size of the hash writer obj buffer is different anyway (larger) from the actual serialized size
-                // because the coin serialization is compressed 
-                if (coins.IsFromCert()) {
-                    ss << coins.nFirstBwtPos;
-                    ss << coins.nBwtMaturityHeight;
-                }
-
-                // - transactions and certificates are lumped together 
-                // - nTotalAmount includes certificate valid bwt amounts (not-null, as for low-quality certs)
-                //   even if not yet matured, as it is done currently with coinbase vouts
-                stats.nTransactions++;
-                for (unsigned int i=0; i<coins.vout.size(); i++) {
-                    const CTxOut &out = coins.vout[i];
-                    if (!out.IsNull()) {
-                        stats.nTransactionOutputs++;
-                        ss << VARINT(i+1);
-                        ss << out;
-                        nTotalAmount += out.nValue;
-                    }
-                }
-                
+                ApplyStats(stats, ss, nTotalAmount, txhash, coins);
                 stats.nSerializedSize += 32 + slValue.size();
-                ss << VARINT(0);
+            } else if (chType == DB_COINS_HEADER) {
+                // hashed as in the record layout, for hash_serialized not to depend on the layout
+                uint256 txhash;
+                ssKey >> txhash;
+                CCoins coins;
+                if (!ReadCoins(txhash, coins))
+                    return error("%s: missing coins %s", __func__, txhash.ToString());
+                ApplyStats(stats, ss, nTotalAmount, txhash, coins);
+                stats.nSerializedSize += 32 + pcursor->value().size();
+            } else if (chType == DB_COINS_OUTPUT) {
+                stats.nSerializedSize += pcursor->key().size() + pcursor->value().size();
             }
             pcursor->Next();
         } catch (const std::exception& e) {
@@ -428,15 +884,20 @@ void CCoinsViewDB::Dump_info()  const
 }
 
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
-    CLevelDBBatch batch;
+    std::unique_ptr<CLevelDBBatch> batch(new CLevelDBBatch());
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
-        batch.Write(make_pair(DB_BLOCK_FILES, it->first), *it->second);
+        batch->Write(make_pair(DB_BLOCK_FILES, it->first), *it->second);
     }
-    batch.Write(DB_LAST_BLOCK, nLastFile);
+    batch->Write(DB_LAST_BLOCK, nLastFile);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
-        batch.Write(make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+        batch->Write(make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+    }
+    if (pwriter) {
+        // the entries are serialized above, under the caller's lock; only the write is deferred
+        pwriter->Submit(*this, std::move(batch), true);
+        return true;
     }
-    return WriteBatch(batch, true);
+    return WriteBatch(*batch, true);
 }
 
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CTxIndexValue &val) {
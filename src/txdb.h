@@ -10,11 +10,17 @@
 #include "coins.h"
 #include "leveldbwrapper.h"
 
+#include <deque>
+#include <functional>
+#include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <boost/thread.hpp>
+
 class CBlockFileInfo;
 class CBlockIndex;
 struct CTxIndexValue;
@@ -120,15 +126,113 @@ struct CTxIndexValue {
     }
 };
 
+/**
+ * Writes LevelDB batches on a dedicated thread, in the order they were submitted.
+ * The block index and the chain state share one writer, so that the chain state
+ * (and its best block marker) never lands on disk before the block index it refers to.
+ */
+class CDBBackgroundWriter
+{
+public:
+    CDBBackgroundWriter();
+    ~CDBBackgroundWriter();
+
+    /**
+     * Queue batch to be written to db. onDone is called from the writer thread with the outcome.
+     * nMemoryUsage is the memory the caller holds until the batch is written, see PendingMemoryUsage().
+     */
+    void Submit(CLevelDBWrapper& db, std::unique_ptr<CLevelDBBatch> batch, bool fSync,
+                std::function<void(bool)> onDone = nullptr, size_t nMemoryUsage = 0);
+
+    //! Wait for all the queued batches to be written. Returns false if a write has failed.
+    bool Wait();
+
+    //! Memory held for the batches not written yet, which comes on top of the coins cache
+    size_t PendingMemoryUsage();
+
+private:
+    struct Job {
+        CLevelDBWrapper* db;
+        std::unique_ptr<CLevelDBBatch> batch;
+        bool fSync;
+        std::function<void(bool)> onDone;
+        size_t nMemoryUsage;
+    };
+
+    void ThreadProcess();
+
+    boost::mutex mutex;
+    boost::condition_variable condChanged;
+    std::deque<Job> queue;
+    bool fBusy;
+    bool fFailed;
+    bool fStop;
+    size_t nPendingMemoryUsage;
+    boost::thread worker;
+};
+
 /** CCoinsView backed by the LevelDB coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CLevelDBWrapper db;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    //! How coins are laid out in the database
+    enum Layout {
+        LAYOUT_RECORD = 0,    //!< one record per transaction/certificate, holding all of its unspent outputs
+        LAYOUT_UPGRADING = 1, //!< conversion from LAYOUT_RECORD to LAYOUT_OUTPUT was interrupted
+        LAYOUT_OUTPUT = 2,    //!< a header per transaction/certificate plus one record per unspent output
+    };
+    int nLayout;
+
+    //! Changes handed to BatchWrite
+    struct CChanges {
+        CCoinsMap mapCoins;
+        uint256 hashBlock;
+        uint256 hashAnchor;
+        CAnchorsMap mapAnchors;
+        CNullifiersMap mapNullifiers;
+        CSidechainsMap mapSidechains;
+        CSidechainEventsMap mapSidechainEvents;
+        CCswNullifiersMap mapCswNullifiers;
+    };
+
+    //! Changes left in place by the caller of BatchWriteDirty
+    struct CChangesRef {
+        const CCoinsMap& mapCoins;
+        uint256 hashBlock;
+        uint256 hashAnchor;
+        const CAnchorsMap& mapAnchors;
+        const CNullifiersMap& mapNullifiers;
+        const CSidechainsMap& mapSidechains;
+        const CSidechainEventsMap& mapSidechainEvents;
+        const CCswNullifiersMap& mapCswNullifiers;
+    };
+
+    //! If set, BatchWrite only queues the changes to the writer
+    CDBBackgroundWriter* pwriter;
+    //! Changes queued to the writer but not written yet (oldest first), reads are served from them first
+    mutable boost::mutex csPending;
+    std::list<std::shared_ptr<const CChanges> > listPending;
+
+    template <typename Map>
+    bool FindPending(Map CChanges::*pmap, const typename Map::key_type& key, typename Map::mapped_type& entry) const;
+    template <typename Changes>
+    void FillBatch(CLevelDBBatch& batch, Changes& changes, bool fConsume) const;
+    bool ReadCoins(const uint256 &txid, CCoins &coins) const;
+
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
+    //! Write the changes from writer's thread instead of the caller's one (NULL to write synchronously)
+    void SetBackgroundWriter(CDBBackgroundWriter* writer) { pwriter = writer; }
+
+    bool IsPerOutputLayout() const { return nLayout == LAYOUT_OUTPUT; }
+    bool IsUpgradingLayout() const { return nLayout == LAYOUT_UPGRADING; }
+    //! Convert the database to the per-output layout. It must not be in use yet, and it can't be converted back.
+    bool UpgradeToPerOutputLayout();
+
     bool GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree)   const override;
     bool GetNullifier(const uint256 &nf)                                 const override;
     bool GetCoins(const uint256 &txid, CCoins &coins)                    const override;
@@ -151,6 +255,14 @@ public:
                     CSidechainsMap& mapSidechains,
                     CSidechainEventsMap& mapSidechainEvents,
                     CCswNullifiersMap& cswNullifies)                           override;
+    bool BatchWriteDirty(const CCoinsMap &mapCoins,
+                         const uint256 &hashBlock,
+                         const uint256 &hashAnchor,
+                         const CAnchorsMap &mapAnchors,
+                         const CNullifiersMap &mapNullifiers,
+                         const CSidechainsMap& mapSidechains,
+                         const CSidechainEventsMap& mapSidechainEvents,
+                         const CCswNullifiersMap& cswNullifies)                     override;
     bool GetStats(CCoinsStats &stats)                                    const override;
     void Dump_info() const;
 };
@@ -163,7 +275,12 @@ public:
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
+
+    //! If set, WriteBatchSync queues its batch to the writer
+    CDBBackgroundWriter* pwriter;
 public:
+    //! Write the block index batches from writer's thread instead of the caller's one (NULL to write synchronously)
+    void SetBackgroundWriter(CDBBackgroundWriter* writer) { pwriter = writer; }
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
     bool ReadLastBlockFile(int &nFile);
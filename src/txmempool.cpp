@@ -1645,6 +1645,26 @@ bool CTxMemPool::lookup(const uint256& hash, CScCertificate& result) const
     return true;
 }
 
+bool CTxMemPool::lookupFeeRate(const uint256& hash, CFeeRate& feeRate, size_t& nSize, bool& fCertificate) const
+{
+    LOCK(cs);
+    std::map<uint256, CTxMemPoolEntry>::const_iterator it = mapTx.find(hash);
+    if (it != mapTx.end()) {
+        nSize = it->second.GetTxSize();
+        feeRate = CFeeRate(it->second.GetFee(), nSize);
+        fCertificate = false;
+        return true;
+    }
+    std::map<uint256, CCertificateMemPoolEntry>::const_iterator itCert = mapCertificate.find(hash);
+    if (itCert != mapCertificate.end()) {
+        nSize = itCert->second.GetCertificateSize();
+        feeRate = CFeeRate(itCert->second.GetFee(), nSize);
+        fCertificate = true;
+        return true;
+    }
+    return false;
+}
+
 void CTxMemPool::CertQualityStatusString(const CScCertificate& cert, std::string& statusString) const
 {
     const uint256& scid = cert.GetScId();
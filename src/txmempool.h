@@ -370,6 +370,8 @@ public:
 
     bool lookup(const uint256& hash, CTransaction& result) const;
     bool lookup(const uint256& hash, CScCertificate& result) const;
+    /** Fee rate and size of a mempool tx or certificate, used to filter relay; false if not in the mempool */
+    bool lookupFeeRate(const uint256& hash, CFeeRate& feeRate, size_t& nSize, bool& fCertificate) const;
 
     void CertQualityStatusString(const CScCertificate& cert, std::string& statusString) const;
 
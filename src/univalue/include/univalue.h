@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <map>
@@ -98,14 +99,27 @@ public:
     bool isObject() const { return (typ == VOBJ); }
 
     bool push_back(const UniValue& val);
+    bool push_back(UniValue&& val);
     bool push_backV(const std::vector<UniValue>& vec);
+    bool push_backV(std::vector<UniValue>&& vec);
 
     void _pushKV(const std::string& key, const UniValue& val);
+    void _pushKV(const std::string& key, UniValue&& val);
     bool pushKV(const std::string& key, const UniValue& val);
+    bool pushKV(const std::string& key, UniValue&& val);
+    // Append without looking for an existing value of key, in constant time:
+    // only for keys known to be unique in the object
+    bool pushKVEnd(const std::string& key, const UniValue& val);
+    bool pushKVEnd(const std::string& key, UniValue&& val);
     bool pushKVs(const UniValue& obj);
 
     std::string write(unsigned int prettyIndent = 0,
                       unsigned int indentLevel = 0) const;
+    // Append to s, calling flush(s) after each array element and object
+    // member and once at the end: flush may send what s holds and clear it,
+    // so that the whole document never sits in memory.
+    void write(std::string& s, const std::function<void(std::string&)>& flush,
+               unsigned int prettyIndent = 0) const;
 
     bool read(const char *raw, size_t len);
     bool read(const char *raw) { return read(raw, strlen(raw)); }
@@ -120,8 +134,12 @@ private:
     std::vector<UniValue> values;
 
     bool findKey(const std::string& key, size_t& retIdx) const;
-    void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
-    void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
+    void writeTo(std::string& s, unsigned int prettyIndent, unsigned int indentLevel,
+                 const std::function<void(std::string&)>* flush) const;
+    void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s,
+                    const std::function<void(std::string&)>* flush) const;
+    void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s,
+                     const std::function<void(std::string&)>* flush) const;
 
 public:
     // Strict type-specific getters, these throw std::runtime_error if the
@@ -138,7 +156,7 @@ public:
 
     enum VType type() const { return getType(); }
     bool push_back(std::pair<std::string,UniValue> pear) {
-        return pushKV(pear.first, pear.second);
+        return pushKV(pear.first, std::move(pear.second));
     }
     friend const UniValue& find_value( const UniValue& obj, const std::string& name);
 };
@@ -216,6 +234,16 @@ static inline std::pair<std::string,UniValue> Pair(std::string key, const UniVal
     return std::make_pair(key, uVal);
 }
 
+static inline std::pair<std::string,UniValue> Pair(const char *cKey, UniValue&& uVal)
+{
+    return std::make_pair(std::string(cKey), std::move(uVal));
+}
+
+static inline std::pair<std::string,UniValue> Pair(std::string key, UniValue&& uVal)
+{
+    return std::make_pair(std::move(key), std::move(uVal));
+}
+
 enum jtokentype {
     JTOK_ERR        = -1,
     JTOK_NONE       = 0,                           // eof
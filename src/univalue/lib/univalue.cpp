@@ -5,6 +5,7 @@
 
 #include <stdint.h>
 #include <iomanip>
+#include <iterator>
 #include <sstream>
 #include <stdlib.h>
 
@@ -125,6 +126,15 @@ bool UniValue::push_back(const UniValue& val_)
     return true;
 }
 
+bool UniValue::push_back(UniValue&& val_)
+{
+    if (typ != VARR)
+        return false;
+
+    values.push_back(std::move(val_));
+    return true;
+}
+
 bool UniValue::push_backV(const std::vector<UniValue>& vec)
 {
     if (typ != VARR)
@@ -135,12 +145,33 @@ bool UniValue::push_backV(const std::vector<UniValue>& vec)
     return true;
 }
 
+bool UniValue::push_backV(std::vector<UniValue>&& vec)
+{
+    if (typ != VARR)
+        return false;
+
+    if (values.empty()) {
+        values = std::move(vec);
+    } else {
+        values.insert(values.end(), std::make_move_iterator(vec.begin()),
+                      std::make_move_iterator(vec.end()));
+    }
+
+    return true;
+}
+
 void UniValue::_pushKV(const std::string& key, const UniValue& val_)
 {
     keys.push_back(key);
     values.push_back(val_);
 }
 
+void UniValue::_pushKV(const std::string& key, UniValue&& val_)
+{
+    keys.push_back(key);
+    values.push_back(std::move(val_));
+}
+
 bool UniValue::pushKV(const std::string& key, const UniValue& val_)
 {
     if (typ != VOBJ)
@@ -154,6 +185,37 @@ bool UniValue::pushKV(const std::string& key, const UniValue& val_)
     return true;
 }
 
+bool UniValue::pushKV(const std::string& key, UniValue&& val_)
+{
+    if (typ != VOBJ)
+        return false;
+
+    size_t idx;
+    if (findKey(key, idx))
+        values[idx] = std::move(val_);
+    else
+        _pushKV(key, std::move(val_));
+    return true;
+}
+
+bool UniValue::pushKVEnd(const std::string& key, const UniValue& val_)
+{
+    if (typ != VOBJ)
+        return false;
+
+    _pushKV(key, val_);
+    return true;
+}
+
+bool UniValue::pushKVEnd(const std::string& key, UniValue&& val_)
+{
+    if (typ != VOBJ)
+        return false;
+
+    _pushKV(key, std::move(val_));
+    return true;
+}
+
 bool UniValue::pushKVs(const UniValue& obj)
 {
     if (typ != VOBJ || obj.typ != VOBJ)
@@ -7,10 +7,9 @@
 #include "univalue.h"
 #include "univalue_escapes.h"
 
-static std::string json_escape(const std::string& inS)
+static void json_escape(const std::string& inS, std::string& outS)
 {
-    std::string outS;
-    outS.reserve(inS.size() * 2);
+    outS.reserve(outS.size() + inS.size() + 2);
 
     for (unsigned int i = 0; i < inS.size(); i++) {
         unsigned char ch = inS[i];
@@ -21,8 +20,6 @@ static std::string json_escape(const std::string& inS)
         else
             outS += ch;
     }
-
-    return outS;
 }
 
 std::string UniValue::write(unsigned int prettyIndent,
@@ -30,7 +27,20 @@ std::string UniValue::write(unsigned int prettyIndent,
 {
     std::string s;
     s.reserve(1024);
+    writeTo(s, prettyIndent, indentLevel, NULL);
+    return s;
+}
+
+void UniValue::write(std::string& s, const std::function<void(std::string&)>& flush,
+                     unsigned int prettyIndent) const
+{
+    writeTo(s, prettyIndent, 0, &flush);
+    flush(s);
+}
 
+void UniValue::writeTo(std::string& s, unsigned int prettyIndent, unsigned int indentLevel,
+                       const std::function<void(std::string&)>* flush) const
+{
     unsigned int modIndent = indentLevel;
     if (modIndent == 0)
         modIndent = 1;
@@ -40,13 +50,15 @@ std::string UniValue::write(unsigned int prettyIndent,
         s += "null";
         break;
     case VOBJ:
-        writeObject(prettyIndent, modIndent, s);
+        writeObject(prettyIndent, modIndent, s, flush);
         break;
     case VARR:
-        writeArray(prettyIndent, modIndent, s);
+        writeArray(prettyIndent, modIndent, s, flush);
         break;
     case VSTR:
-        s += "\"" + json_escape(val) + "\"";
+        s += "\"";
+        json_escape(val, s);
+        s += "\"";
         break;
     case VNUM:
         s += val;
@@ -55,8 +67,6 @@ std::string UniValue::write(unsigned int prettyIndent,
         s += (val == "1" ? "true" : "false");
         break;
     }
-
-    return s;
 }
 
 static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, std::string& s)
@@ -64,7 +74,8 @@ static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, std::
     s.append(prettyIndent * indentLevel, ' ');
 }
 
-void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const
+void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s,
+                          const std::function<void(std::string&)>* flush) const
 {
     s += "[";
     if (prettyIndent)
@@ -73,12 +84,14 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     for (unsigned int i = 0; i < values.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += values[i].write(prettyIndent, indentLevel + 1);
+        values[i].writeTo(s, prettyIndent, indentLevel + 1, flush);
         if (i != (values.size() - 1)) {
             s += ",";
         }
         if (prettyIndent)
             s += "\n";
+        if (flush)
+            (*flush)(s);
     }
 
     if (prettyIndent)
@@ -86,7 +99,8 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     s += "]";
 }
 
-void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const
+void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s,
+                           const std::function<void(std::string&)>* flush) const
 {
     s += "{";
     if (prettyIndent)
@@ -95,18 +109,21 @@ void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
     for (unsigned int i = 0; i < keys.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += "\"" + json_escape(keys[i]) + "\":";
+        s += "\"";
+        json_escape(keys[i], s);
+        s += "\":";
         if (prettyIndent)
             s += " ";
-        s += values.at(i).write(prettyIndent, indentLevel + 1);
+        values.at(i).writeTo(s, prettyIndent, indentLevel + 1, flush);
         if (i != (values.size() - 1))
             s += ",";
         if (prettyIndent)
             s += "\n";
+        if (flush)
+            (*flush)(s);
     }
 
     if (prettyIndent)
         indentStr(prettyIndent, indentLevel - 1, s);
     s += "}";
 }
-
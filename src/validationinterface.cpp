@@ -5,6 +5,10 @@
 
 #include "validationinterface.h"
 #include <primitives/certificate.h>
+#include "util.h"
+#include "utiltime.h"
+
+#include <set>
 
 static CMainSignals g_signals;
 
@@ -66,3 +70,192 @@ void SyncWithWallets(const CScCertificate &cert, const CBlock *pblock, int bwtMa
 void SyncCertStatusUpdate(const CScCertificateStatusUpdateInfo& certStatusInfo) {
     g_signals.SyncCertStatus(certStatusInfo);
 }
+
+namespace {
+    boost::mutex cs_asyncInterfaces;
+    std::set<const CAsyncValidationInterface*> setAsyncInterfaces;
+}
+
+CAsyncValidationInterface::CAsyncValidationInterface(const std::string& nameIn, CValidationInterface* subscriberIn,
+                                                     size_t maxQueueSizeIn, NotificationQueuePolicy policyIn):
+    name(nameIn), subscriber(subscriberIn), maxQueueSize(maxQueueSizeIn), policy(policyIn),
+    state(std::make_shared<State>())
+{
+    assert(maxQueueSize > 0);
+    worker = boost::thread(&CAsyncValidationInterface::ThreadProcess, name, state);
+
+    boost::unique_lock<boost::mutex> lock(cs_asyncInterfaces);
+    setAsyncInterfaces.insert(this);
+}
+
+CAsyncValidationInterface::~CAsyncValidationInterface()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs_asyncInterfaces);
+        setAsyncInterfaces.erase(this);
+    }
+    Stop();
+}
+
+CAsyncValidationInterface* CAsyncValidationInterface::CreateWithArguments(const std::string& name, CValidationInterface* subscriber)
+{
+    int64_t queueSize = GetArg("-" + name + "queuesize", DEFAULT_NOTIFICATION_QUEUE_SIZE);
+    if (queueSize <= 0)
+        return NULL;
+
+    NotificationQueuePolicy policy = NotificationQueuePolicy::BLOCK;
+    std::string strPolicy = GetArg("-" + name + "queuepolicy", DEFAULT_NOTIFICATION_QUEUE_POLICY);
+    if (strPolicy == "drop") {
+        policy = NotificationQueuePolicy::DROP;
+    } else if (strPolicy != "block") {
+        LogPrintf("%s(): unknown -%squeuepolicy '%s', using 'block'\n", __func__, name, strPolicy);
+    }
+
+    LogPrintf("%s(): %s notifications are queued (size %d, policy %s)\n", __func__, name, queueSize,
+        (policy == NotificationQueuePolicy::DROP) ? "drop" : "block");
+    return new CAsyncValidationInterface(name, subscriber, queueSize, policy);
+}
+
+void CAsyncValidationInterface::Stop(int64_t nTimeoutMillis)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(state->mutex);
+        state->fStop = true;
+    }
+    state->condNotEmpty.notify_all();
+    state->condNotFull.notify_all();
+    if (!worker.joinable())
+        return;
+    if (worker.try_join_for(boost::chrono::milliseconds(nTimeoutMillis)))
+        return;
+
+    if (policy == NotificationQueuePolicy::DROP) {
+        // the subscriber does not keep up, give up on what is still queued
+        size_t nDiscarded;
+        {
+            boost::unique_lock<boost::mutex> lock(state->mutex);
+            nDiscarded = state->queue.size();
+            state->nDropped += nDiscarded;
+            state->queue.clear();
+        }
+        LogPrintf("%s(): %s notifications not delivered within %d ms, %u dropped\n", __func__, name, nTimeoutMillis, nDiscarded);
+    } else {
+        LogPrintf("%s(): %s notifications not delivered within %d ms, still waiting for them\n", __func__, name, nTimeoutMillis);
+    }
+
+    // the queued notifications point to the subscriber, which is destroyed once this returns
+    worker.join();
+}
+
+CAsyncValidationInterface::Stats CAsyncValidationInterface::GetStats() const
+{
+    boost::unique_lock<boost::mutex> lock(state->mutex);
+    Stats stats;
+    stats.name = name;
+    stats.queueSize = state->queue.size();
+    stats.maxQueueSize = maxQueueSize;
+    stats.nProcessed = state->nProcessed;
+    stats.nDropped = state->nDropped;
+    stats.nLastLagMicros = state->nLastLagMicros;
+    stats.nMaxLagMicros = state->nMaxLagMicros;
+    return stats;
+}
+
+void CAsyncValidationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    // block indexes are never deleted while the node runs, the pointer can be kept.
+    // Signalled without cs_main, this is the only notification that may wait for room in the queue.
+    CValidationInterface* subscriber = this->subscriber;
+    Enqueue([subscriber, pindex]() { subscriber->UpdatedBlockTip(pindex); }, true);
+}
+
+void CAsyncValidationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    CValidationInterface* subscriber = this->subscriber;
+    Enqueue([subscriber, tx]() { subscriber->SyncTransaction(tx, NULL); }, false);
+}
+
+void CAsyncValidationInterface::SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth)
+{
+    CValidationInterface* subscriber = this->subscriber;
+    Enqueue([subscriber, cert, bwtMaturityDepth]() { subscriber->SyncCertificate(cert, NULL, bwtMaturityDepth); }, false);
+}
+
+void CAsyncValidationInterface::SyncCertStatusInfo(const CScCertificateStatusUpdateInfo& certStatusInfo)
+{
+    CValidationInterface* subscriber = this->subscriber;
+    Enqueue([subscriber, certStatusInfo]() { subscriber->SyncCertStatusInfo(certStatusInfo); }, false);
+}
+
+void CAsyncValidationInterface::Enqueue(std::function<void()>&& notification, bool fMayBlock)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(state->mutex);
+        if (state->fStop)
+            return;
+
+        if (state->queue.size() >= maxQueueSize)
+        {
+            if (policy == NotificationQueuePolicy::DROP)
+            {
+                ++state->nDropped;
+                LogPrintf("%s(): %s queue full, notification dropped (%d so far)\n", __func__, name, state->nDropped);
+                return;
+            }
+
+            // waiting with cs_main held could deadlock with a subscriber that needs it: queue past the limit
+            if (fMayBlock)
+            {
+                while (state->queue.size() >= maxQueueSize && !state->fStop)
+                    state->condNotFull.wait(lock);
+                if (state->fStop)
+                    return;
+            }
+        }
+
+        state->queue.push_back(std::make_pair(GetTimeMicros(), std::move(notification)));
+    }
+    state->condNotEmpty.notify_one();
+}
+
+void CAsyncValidationInterface::ThreadProcess(std::string name, std::shared_ptr<State> state)
+{
+    RenameThread(("zen-notify-" + name).c_str());
+
+    while (true)
+    {
+        std::function<void()> notification;
+        {
+            boost::unique_lock<boost::mutex> lock(state->mutex);
+            while (state->queue.empty() && !state->fStop)
+                state->condNotEmpty.wait(lock);
+            // pending notifications are still delivered when stopping
+            if (state->queue.empty())
+                return;
+
+            state->nLastLagMicros = GetTimeMicros() - state->queue.front().first;
+            state->nMaxLagMicros = std::max(state->nMaxLagMicros, state->nLastLagMicros);
+            notification = std::move(state->queue.front().second);
+            state->queue.pop_front();
+        }
+        state->condNotFull.notify_one();
+
+        try {
+            notification();
+        } catch (const std::exception& e) {
+            LogPrintf("%s(): %s notification failed: %s\n", __func__, name, e.what());
+        }
+
+        boost::unique_lock<boost::mutex> lock(state->mutex);
+        ++state->nProcessed;
+    }
+}
+
+std::vector<CAsyncValidationInterface::Stats> GetAsyncValidationInterfacesStats()
+{
+    std::vector<CAsyncValidationInterface::Stats> vStats;
+    boost::unique_lock<boost::mutex> lock(cs_asyncInterfaces);
+    for (const CAsyncValidationInterface* pInterface : setAsyncInterfaces)
+        vStats.push_back(pInterface->GetStats());
+    return vStats;
+}
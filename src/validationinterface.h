@@ -7,6 +7,13 @@
 #define BITCOIN_VALIDATIONINTERFACE_H
 
 #include <boost/signals2/signal.hpp>
+#include <boost/thread.hpp>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "zcash/IncrementalMerkleTree.hpp"
 
@@ -53,8 +60,106 @@ protected:
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend class CAsyncValidationInterface;
+};
+
+/** What to do with a new notification when the queue of an asynchronous subscriber is full */
+enum class NotificationQueuePolicy
+{
+    BLOCK, /**< never lose a notification: wait for the subscriber to make room, slowing down the notifying thread */
+    DROP   /**< discard the new notification */
+};
+
+static const unsigned int DEFAULT_NOTIFICATION_QUEUE_SIZE = 1000;
+static const char* const DEFAULT_NOTIFICATION_QUEUE_POLICY = "block";
+/** How long stopping waits for a subscriber to process its queue before discarding it (NotificationQueuePolicy::DROP) */
+static const int64_t NOTIFICATION_STOP_TIMEOUT_MILLIS = 5000;
+
+/**
+ * Forwards the notifications meant for external notifiers (UpdatedBlockTip, SyncTransaction and
+ * SyncCertificate) to a subscriber on a dedicated worker thread, so that a slow subscriber does not
+ * delay block connection. Notifications are delivered in the order they were signalled.
+ * The block passed to SyncTransaction and SyncCertificate is not forwarded (the subscriber gets NULL),
+ * since it is not guaranteed to outlive the call.
+ *
+ * SyncTransaction, SyncCertificate and SyncCertStatusInfo are signalled with cs_main held, and the
+ * subscriber may need cs_main to process a notification, so they never wait for room: with
+ * NotificationQueuePolicy::BLOCK they are queued past the limit, and only UpdatedBlockTip waits.
+ * Every dropped notification is logged.
+ */
+class CAsyncValidationInterface : public CValidationInterface
+{
+public:
+    struct Stats
+    {
+        std::string name;
+        size_t queueSize;
+        size_t maxQueueSize;
+        uint64_t nProcessed;
+        uint64_t nDropped;
+        int64_t nLastLagMicros; /**< time the last delivered notification waited in the queue */
+        int64_t nMaxLagMicros;
+    };
+
+    CAsyncValidationInterface(const std::string& name, CValidationInterface* subscriber,
+                              size_t maxQueueSize, NotificationQueuePolicy policy);
+    virtual ~CAsyncValidationInterface();
+
+    /**
+     * Wrap subscriber according to -<name>queuesize and -<name>queuepolicy.
+     * Returns NULL if the subscriber has to be notified synchronously (-<name>queuesize=0).
+     */
+    static CAsyncValidationInterface* CreateWithArguments(const std::string& name, CValidationInterface* subscriber);
+
+    /**
+     * Deliver the queued notifications, then stop the worker thread. With NotificationQueuePolicy::DROP,
+     * the notifications still queued after nTimeoutMillis are discarded. In any case this returns only
+     * once the worker thread is joined, so that the subscriber can be destroyed afterwards.
+     */
+    void Stop(int64_t nTimeoutMillis = NOTIFICATION_STOP_TIMEOUT_MILLIS);
+
+    Stats GetStats() const;
+
+protected:
+    // CValidationInterface
+    void UpdatedBlockTip(const CBlockIndex *pindex) override;
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock) override;
+    void SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth) override;
+    void SyncCertStatusInfo(const CScCertificateStatusUpdateInfo& certStatusInfo) override;
+
+private:
+    /** Queue and statistics, shared with the worker thread */
+    struct State
+    {
+        boost::mutex mutex;
+        boost::condition_variable condNotEmpty;
+        boost::condition_variable condNotFull;
+        //! queued notifications, with the time (in micros) they were queued at
+        std::deque<std::pair<int64_t, std::function<void()> > > queue;
+        bool fStop;
+        uint64_t nProcessed;
+        uint64_t nDropped;
+        int64_t nLastLagMicros;
+        int64_t nMaxLagMicros;
+
+        State(): fStop(false), nProcessed(0), nDropped(0), nLastLagMicros(0), nMaxLagMicros(0) {}
+    };
+
+    void Enqueue(std::function<void()>&& notification, bool fMayBlock);
+    static void ThreadProcess(std::string name, std::shared_ptr<State> state);
+
+    const std::string name;
+    CValidationInterface* const subscriber;
+    const size_t maxQueueSize;
+    const NotificationQueuePolicy policy;
+
+    const std::shared_ptr<State> state;
+    boost::thread worker;
 };
 
+/** Statistics of all the asynchronous subscribers currently running */
+std::vector<CAsyncValidationInterface::Stats> GetAsyncValidationInterfacesStats();
+
 struct CMainSignals {
     /** Notifies listeners of updated block chain tip */
     boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
@@ -24,6 +24,7 @@
 #include <array>
 #include <iostream>
 #include <chrono>
+#include <future>
 #include <thread>
 #include <string>
 
@@ -441,7 +442,9 @@ bool AsyncRPCOperation_sendmany::main_impl() {
         }
 
         // Create joinsplits, where each output represents a zaddr recipient.
-        UniValue obj(UniValue::VOBJ);
+        // They have no input notes so none depends on another: plan them all,
+        // then prove them concurrently.
+        std::vector<AsyncJoinSplitInfo> vInfos;
         while (zOutputsDeque.size() > 0) {
             AsyncJoinSplitInfo info;
             info.vpub_old = 0;
@@ -464,8 +467,9 @@ bool AsyncRPCOperation_sendmany::main_impl() {
                 // Funds are removed from the value pool and enter the private pool
                 info.vpub_old += value;
             }
-            obj = perform_joinsplit(info);
+            vInfos.push_back(info);
         }
+        UniValue obj = perform_independent_joinsplits(vInfos);
         sign_send_raw_transaction(obj);
         return true;
     }
@@ -916,10 +920,56 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(AsyncJoinSplitInfo & info
     return perform_joinsplit(info, witnesses, anchor);
 }
 
+size_t GetJoinSplitProvers() {
+    int64_t nProvers = GetArg("-joinsplitprovers", DEFAULT_JOINSPLIT_PROVERS);
+    return std::max<int64_t>(1, std::min<int64_t>(nProvers, GetNumCores()));
+}
+
+UniValue AsyncRPCOperation_sendmany::perform_independent_joinsplits(std::vector<AsyncJoinSplitInfo> & vInfos) {
+    UniValue obj(UniValue::VOBJ);
+    if (vInfos.empty()) {
+        return obj;
+    }
+
+    uint256 anchor;
+    {
+        LOCK(cs_main);
+        anchor = pcoinsTip->GetBestAnchor();    // As there are no inputs, ask the wallet for the best anchor
+    }
+
+    // Prove in waves of at most nProvers joinsplits, then append them in plan
+    // order so that the transaction is laid out as if proved one by one.
+    const size_t nIndexBase = tx_.GetVjoinsplit().size();
+    const size_t nProvers = GetJoinSplitProvers();
+    const std::vector<boost::optional<ZCIncrementalWitness>> noWitnesses;
+    LogPrint("zrpcunsafe", "%s: proving %d independent joinsplits with up to %d provers\n",
+            getId(), vInfos.size(), nProvers);
+
+    std::vector<ProvedJoinSplit> vProved = ProveInWaves<ProvedJoinSplit>(vInfos.size(), nProvers,
+            [this, &vInfos, &noWitnesses, anchor, nIndexBase](size_t i) {
+                return prove_joinsplit(vInfos[i], noWitnesses, anchor, nIndexBase + i);
+            });
+
+    for (ProvedJoinSplit& proved : vProved) {
+        obj = append_joinsplit(proved);
+    }
+    return obj;
+}
+
 UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
         AsyncJoinSplitInfo & info,
         std::vector<boost::optional < ZCIncrementalWitness>> witnesses,
         uint256 anchor)
+{
+    ProvedJoinSplit proved = prove_joinsplit(info, witnesses, anchor, tx_.GetVjoinsplit().size());
+    return append_joinsplit(proved);
+}
+
+ProvedJoinSplit AsyncRPCOperation_sendmany::prove_joinsplit(
+        AsyncJoinSplitInfo & info,
+        const std::vector<boost::optional < ZCIncrementalWitness>> & witnesses,
+        const uint256 & anchor,
+        size_t jsIndex) const
 {
     if (anchor.IsNull()) {
         throw std::runtime_error("anchor is null");
@@ -949,51 +999,51 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
         throw runtime_error("unsupported joinsplit input/output counts");
     }
 
-    CMutableTransaction mtx(tx_);
-
     LogPrint("zrpcunsafe", "%s: creating joinsplit at index %d (vpub_old=%s, vpub_new=%s, in[0]=%s, in[1]=%s, out[0]=%s, out[1]=%s)\n",
             getId(),
-            tx_.GetVjoinsplit().size(),
+            jsIndex,
             FormatMoney(info.vpub_old), FormatMoney(info.vpub_new),
             FormatMoney(info.vjsin[0].note.value()), FormatMoney(info.vjsin[1].note.value()),
             FormatMoney(info.vjsout[0].value), FormatMoney(info.vjsout[1].value)
             );
 
     // Generate the proof, this can take over a minute.
+    ProvedJoinSplit proved;
+    proved.outputs = {info.vjsout[0], info.vjsout[1]};
     std::array<libzcash::JSInput, ZC_NUM_JS_INPUTS> inputs
             {info.vjsin[0], info.vjsin[1]};
-    std::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS> outputs
-            {info.vjsout[0], info.vjsout[1]};
-        #ifdef __APPLE__
-        std::array<uint64_t, ZC_NUM_JS_INPUTS> inputMap;
-        std::array<uint64_t, ZC_NUM_JS_OUTPUTS> outputMap;
-        #else
-        std::array<size_t, ZC_NUM_JS_INPUTS> inputMap;
-        std::array<size_t, ZC_NUM_JS_OUTPUTS> outputMap;
-        #endif
-
-    uint256 esk; // payment disclosure - secret
-
-    JSDescription jsdesc = JSDescription::Randomized(
-            mtx.nVersion == GROTH_TX_VERSION,
+
+    proved.jsdesc = JSDescription::Randomized(
+            tx_.nVersion == GROTH_TX_VERSION,
             *pzcashParams,
             joinSplitPubKey_,
             anchor,
             inputs,
-            outputs,
-            inputMap,
-            outputMap,
+            proved.outputs,
+            proved.inputMap,
+            proved.outputMap,
             info.vpub_old,
             info.vpub_new,
             !this->testmode,
-            &esk); // parameter expects pointer to esk, so pass in address
+            &proved.esk); // parameter expects pointer to esk, so pass in address
     {
         auto verifier = libzcash::ProofVerifier::Strict();
-        if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
+        if (!(proved.jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
             throw std::runtime_error("error verifying joinsplit");
         }
     }
+    return proved;
+}
 
+UniValue AsyncRPCOperation_sendmany::append_joinsplit(const ProvedJoinSplit & proved)
+{
+    const JSDescription& jsdesc = proved.jsdesc;
+    const auto& inputMap = proved.inputMap;
+    const auto& outputMap = proved.outputMap;
+    const auto& outputs = proved.outputs;
+    const uint256& esk = proved.esk;
+
+    CMutableTransaction mtx(tx_);
     mtx.vjoinsplit.push_back(jsdesc);
 
     // Empty output script.
@@ -14,6 +14,9 @@
 #include "wallet.h"
 #include "paymentdisclosure.h"
 
+#include <algorithm>
+#include <array>
+#include <future>
 #include <unordered_map>
 #include <tuple>
 
@@ -43,6 +46,51 @@ struct AsyncJoinSplitInfo
     CAmount vpub_new = 0;
 };
 
+/**
+ * Run prove(i) for every i in [0, n), at most nProvers at a time, and return
+ * the results in index order, as a loop calling prove(0) ... prove(n-1) would.
+ * Proofs run on std::async threads, in waves of nProvers; if one throws, the
+ * rest of its wave is joined and the exception is rethrown.
+ */
+template <typename T, typename Prove>
+std::vector<T> ProveInWaves(size_t n, size_t nProvers, Prove prove)
+{
+    nProvers = std::max<size_t>(1, std::min(nProvers, n));
+    std::vector<T> vResults;
+    vResults.reserve(n);
+    for (size_t nStart = 0; nStart < n; nStart += nProvers) {
+        const size_t nEnd = std::min(nStart + nProvers, n);
+        std::vector<std::future<T>> vFutures;
+        for (size_t i = nStart; i < nEnd; i++) {
+            vFutures.push_back(std::async(std::launch::async, prove, i));
+        }
+        // Futures of std::async join on destruction, so no prover outlives
+        // this scope even if get() rethrows the failure of one of them.
+        for (std::future<T>& future : vFutures) {
+            vResults.push_back(future.get());
+        }
+    }
+    return vResults;
+}
+
+// Number of JoinSplits z_sendmany proves at once (-joinsplitprovers, capped by the cores)
+size_t GetJoinSplitProvers();
+
+// A proved JoinSplit, with what is needed to append it to the transaction.
+struct ProvedJoinSplit
+{
+    JSDescription jsdesc;
+    std::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS> outputs;
+#ifdef __APPLE__
+    std::array<uint64_t, ZC_NUM_JS_INPUTS> inputMap;
+    std::array<uint64_t, ZC_NUM_JS_OUTPUTS> outputMap;
+#else
+    std::array<size_t, ZC_NUM_JS_INPUTS> inputMap;
+    std::array<size_t, ZC_NUM_JS_OUTPUTS> outputMap;
+#endif
+    uint256 esk; // payment disclosure - secret
+};
+
 // A struct to help us track the witness and anchor for a given JSOutPoint
 struct WitnessAnchorData {
 	boost::optional<ZCIncrementalWitness> witness;
@@ -115,6 +163,19 @@ private:
         std::vector<boost::optional < ZCIncrementalWitness>> witnesses,
         uint256 anchor);
 
+    // JoinSplits without any input notes, proved concurrently and appended in order
+    UniValue perform_independent_joinsplits(std::vector<AsyncJoinSplitInfo> &);
+
+    // Generate the proof of a JoinSplit, without touching the transaction
+    ProvedJoinSplit prove_joinsplit(
+        AsyncJoinSplitInfo & info,
+        const std::vector<boost::optional < ZCIncrementalWitness>> & witnesses,
+        const uint256 & anchor,
+        size_t jsIndex) const;
+
+    // Append a proved JoinSplit to the transaction and sign it
+    UniValue append_joinsplit(const ProvedJoinSplit & proved);
+
     void sign_send_raw_transaction(UniValue obj);     // throws exception if there was an error
 
     // payment disclosure!
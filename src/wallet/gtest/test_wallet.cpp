@@ -696,6 +696,53 @@ TEST(wallet_tests, cached_witnesses_chain_tip) {
     }
 }
 
+TEST(wallet_tests, cached_witnesses_many_notes_in_block) {
+    TestWallet wallet;
+    ZCIncrementalMerkleTree tree;
+
+    auto sk = libzcash::SpendingKey::random();
+    wallet.AddSpendingKey(sk);
+
+    // First block, with a single note already in the wallet
+    CBlock block1;
+    CBlockIndex index1(block1);
+    index1.nHeight = 1;
+    auto jsoutpt1 = CreateValidBlock(wallet, sk, index1, block1, tree);
+
+    // Second block, receiving several notes at once
+    CBlock block2;
+    block2.hashPrevBlock = block1.GetHash();
+    std::vector<JSOutPoint> notes {jsoutpt1};
+    for (int i = 0; i < 3; i++) {
+        auto wtx = GetValidReceive(sk, 50, true);
+        auto note = GetNote(sk, wtx.getWrappedTx(), 0, 1);
+        auto nullifier = note.nullifier(sk);
+
+        mapNoteData_t noteData;
+        JSOutPoint jsoutpt {wtx.getWrappedTx().GetHash(), 0, 1};
+        CNoteData nd {sk.address(), nullifier};
+        noteData[jsoutpt] = nd;
+        wtx.SetNoteData(noteData);
+        wallet.AddToWallet(wtx, true, NULL);
+
+        block2.vtx.push_back(wtx.getWrappedTx());
+        notes.push_back(jsoutpt);
+    }
+    CBlockIndex index2(block2);
+    index2.nHeight = 2;
+    wallet.IncrementNoteWitnesses(&index2, &block2, tree);
+
+    // Every witness, old or new, must have been advanced to the same tree
+    std::vector<boost::optional<ZCIncrementalWitness>> witnesses;
+    uint256 anchor;
+    wallet.GetNoteWitnesses(notes, witnesses, anchor);
+    EXPECT_EQ(tree.root(), anchor);
+    for (const auto& witness : witnesses) {
+        ASSERT_TRUE((bool) witness);
+        EXPECT_EQ(tree.root(), witness->root());
+    }
+}
+
 TEST(wallet_tests, CachedWitnessesDecrementFirst) {
     TestWallet wallet;
     uint256 anchor2;
@@ -1145,3 +1192,59 @@ TEST(wallet_tests, SetBestChainIgnoresTxsWithoutShieldedData) {
         .WillOnce(Return(true));
     wallet.SetBestChain(walletdb, loc);
 }
+
+TEST(wallet_tests, TxesByAddressIndex) {
+    SelectParams(CBaseChainParams::REGTEST);
+
+    TestWallet wallet;
+
+    CKey tsk;
+    tsk.MakeNewKey(true);
+    wallet.AddKey(tsk);
+    CTxDestination dest = tsk.GetPubKey().GetID();
+
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    CTxDestination otherDest = otherKey.GetPubKey().GetID();
+
+    // A tx funding our address
+    CMutableTransaction funding;
+    funding.resizeOut(1);
+    funding.getOut(0).nValue = 90*CENT;
+    funding.getOut(0).scriptPubKey = GetScriptForDestination(dest);
+    CWalletTx wtxFunding {nullptr, funding};
+
+    // A tx spending it to another address
+    CMutableTransaction spending;
+    spending.vin.resize(1);
+    spending.vin[0].prevout = COutPoint(funding.GetHash(), 0);
+    spending.resizeOut(1);
+    spending.getOut(0).nValue = 80*CENT;
+    spending.getOut(0).scriptPubKey = GetScriptForDestination(otherDest);
+    CWalletTx wtxSpending {nullptr, spending};
+
+    // Add the spending tx first: it can be indexed under our address only once the funding tx is known
+    wallet.AddToWallet(wtxSpending, true, nullptr);
+    wallet.AddToWallet(wtxFunding, true, nullptr);
+
+    LOCK(wallet.cs_wallet);
+    const TxAddressItems* pTxItems = wallet.GetTxesByAddress(dest);
+    ASSERT_TRUE(pTxItems != nullptr);
+    EXPECT_EQ(2, pTxItems->size());
+
+    pTxItems = wallet.GetTxesByAddress(otherDest);
+    ASSERT_TRUE(pTxItems != nullptr);
+    ASSERT_EQ(1, pTxItems->size());
+    EXPECT_EQ(spending.GetHash(), pTxItems->begin()->second->getTxBase()->GetHash());
+
+    // Reordering the wallet txes changes their nOrderPos, which the index is keyed on
+    for (const auto& item : wallet.getMapWallet())
+        item.second->nOrderPos += 10;
+    wallet.RebuildAddressIndex();
+
+    pTxItems = wallet.GetTxesByAddress(dest);
+    ASSERT_TRUE(pTxItems != nullptr);
+    ASSERT_EQ(2, pTxItems->size());
+    for (const auto& item : *pTxItems)
+        EXPECT_EQ(item.second->nOrderPos, item.first);
+}
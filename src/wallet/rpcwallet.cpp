@@ -87,24 +87,25 @@ void AddVinExpandedToJSON(const CWalletTransactionBase& tx, UniValue& entry)
     if (!tx.getTxBase()->IsCertificate() )
         entry.pushKV("locktime", (int64_t)tx.getTxBase()->GetLockTime());
     UniValue vinArr(UniValue::VARR);
+    vinArr.reserve(tx.getTxBase()->GetVin().size());
     for (const CTxIn& txin : tx.getTxBase()->GetVin())
     {
         UniValue in(UniValue::VOBJ);
         if (tx.getTxBase()->IsCoinBase())
         {
-            in.pushKV("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            in.pushKVEnd("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
         }
         else
         {
             const uint256& inputTxHash = txin.prevout.hash;
 
-            in.pushKV("txid", inputTxHash.GetHex());
-            in.pushKV("vout", (int64_t)txin.prevout.n);
+            in.pushKVEnd("txid", inputTxHash.GetHex());
+            in.pushKVEnd("vout", (int64_t)txin.prevout.n);
 
             UniValue o(UniValue::VOBJ);
-            o.pushKV("asm", txin.scriptSig.ToString());
-            o.pushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
-            in.pushKV("scriptSig", o);
+            o.pushKVEnd("asm", txin.scriptSig.ToString());
+            o.pushKVEnd("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            in.pushKVEnd("scriptSig", std::move(o));
 
             auto mi = pwalletMain->getMapWallet().find(inputTxHash);
             if (mi != pwalletMain->getMapWallet().end() )
@@ -113,26 +114,26 @@ void AddVinExpandedToJSON(const CWalletTransactionBase& tx, UniValue& entry)
                 {
                     const CTxOut& txout = (*mi).second->getTxBase()->GetVout()[txin.prevout.n];
 
-                    in.pushKV("value", ValueFromAmount(txout.nValue));
-                    in.pushKV("valueZat", txout.nValue);
+                    in.pushKVEnd("value", ValueFromAmount(txout.nValue));
+                    in.pushKVEnd("valueZat", txout.nValue);
 
                     txnouttype type;
                     int nRequired;
                     vector<CTxDestination> addresses;
                     if (!ExtractDestinations(txout.scriptPubKey, type, addresses, nRequired)) {
-                        in.pushKV("addr", "Unknown");
+                        in.pushKVEnd("addr", "Unknown");
                     } else {
                         const CTxDestination& addr = addresses[0];
-                        in.pushKV("addr", (CBitcoinAddress(addr).ToString() ));
+                        in.pushKVEnd("addr", (CBitcoinAddress(addr).ToString() ));
                     }
                 }
             }
 
         }
-        in.pushKV("sequence", (int64_t)txin.nSequence);
-        vinArr.push_back(in);
+        in.pushKVEnd("sequence", (int64_t)txin.nSequence);
+        vinArr.push_back(std::move(in));
     }
-    entry.pushKV("vin", vinArr);
+    entry.pushKV("vin", std::move(vinArr));
 }
 
 void TxExpandedToJSON(const CWalletTransactionBase& tx,  UniValue& entry)
@@ -172,23 +173,24 @@ void TxExpandedToJSON(const CWalletTransactionBase& tx,  UniValue& entry)
     }
 
     UniValue vout(UniValue::VARR);
+    vout.reserve(tx.getTxBase()->GetVout().size());
     for (unsigned int i = 0; i < tx.getTxBase()->GetVout().size(); i++) {
         const CTxOut& txout = tx.getTxBase()->GetVout()[i];
         UniValue out(UniValue::VOBJ);
-        out.pushKV("value", ValueFromAmount(txout.nValue));
-        out.pushKV("valueZat", txout.nValue);
-        out.pushKV("n", (int64_t)i);
+        out.pushKVEnd("value", ValueFromAmount(txout.nValue));
+        out.pushKVEnd("valueZat", txout.nValue);
+        out.pushKVEnd("n", (int64_t)i);
         UniValue o(UniValue::VOBJ);
         ScriptPubKeyToJSON(txout.scriptPubKey, o, true);
-        out.pushKV("scriptPubKey", o);
+        out.pushKVEnd("scriptPubKey", std::move(o));
         if (tx.getTxBase()->IsBackwardTransfer(i))
         {
-            out.pushKV("backwardTransfer", true);
-            out.pushKV("maturityHeight", bwtMaturityHeight);
+            out.pushKVEnd("backwardTransfer", true);
+            out.pushKVEnd("maturityHeight", bwtMaturityHeight);
         }
-        vout.push_back(out);
+        vout.push_back(std::move(out));
     }
-    entry.pushKV("vout", vout);
+    entry.pushKV("vout", std::move(vout));
 
     // add the cross chain outputs if tx version is -4
     if (tx.getTxBase()->nVersion == SC_TX_VERSION)
@@ -2745,30 +2747,54 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
             includeImmatureBTs = true;
 
     UniValue ret(UniValue::VARR);
-    const TxItems & txOrdered = pwalletMain->wtxOrdered;
-    // iterate backwards until we have nCount items to return:
-    for (TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+    if (baddress.IsValid())
     {
-        CWalletTransactionBase *const pwtx = (*it).second.first;
-        if (pwtx != nullptr){
-            if(baddress.IsValid()) {
-                for(const CTxOut& txout : pwtx->getTxBase()->GetVout()) {
-                    auto res = std::search(txout.scriptPubKey.begin(), txout.scriptPubKey.end(), scriptPubKey.begin(), scriptPubKey.end());
-                    if (res == txout.scriptPubKey.begin()) {
-                        ListTransactions(*pwtx, strAccount, 0, true, ret, filter, includeImmatureBTs);
-                        break;
-                    }
-                }
+        // walk the wallet index of the txes involving the address, merging in by order position
+        // the accounting entries, which are not bound to any address
+        TxItems acentriesOrdered;
+        for (CAccountingEntry& entry : pwalletMain->laccentries)
+            acentriesOrdered.insert(make_pair(entry.nOrderPos, TxPair((CWalletTransactionBase*)0, &entry)));
+
+        const TxAddressItems emptyTxItems;
+        const TxAddressItems* pTxItems = pwalletMain->GetTxesByAddress(baddress.Get());
+        if (pTxItems == nullptr)
+            pTxItems = &emptyTxItems;
+
+        // iterate backwards until we have nCount items to return:
+        TxAddressItems::const_reverse_iterator itTx = pTxItems->rbegin();
+        TxItems::const_reverse_iterator itAc = acentriesOrdered.rbegin();
+        while ((itTx != pTxItems->rend() || itAc != acentriesOrdered.rend()) && (int)ret.size() < (nCount+nFrom))
+        {
+            if (itAc == acentriesOrdered.rend() || (itTx != pTxItems->rend() && itTx->first >= itAc->first))
+            {
+                // the index also holds txes only spending from the address
+                const CWalletTransactionBase& wtx = *(itTx->second);
+                if (wtx.HasOutputFor(scriptPubKey))
+                    ListTransactions(wtx, strAccount, 0, true, ret, filter, includeImmatureBTs);
+                ++itTx;
             }
-            else {
-                ListTransactions(*pwtx, strAccount, 0, true, ret, filter, includeImmatureBTs);
+            else
+            {
+                AcentryToJSON(*(itAc->second.second), strAccount, ret);
+                ++itAc;
             }
         }
-        CAccountingEntry *const pacentry = (*it).second.second;
-        if (pacentry != nullptr)
-            AcentryToJSON(*pacentry, strAccount, ret);
+    }
+    else
+    {
+        const TxItems & txOrdered = pwalletMain->wtxOrdered;
+        // iterate backwards until we have nCount items to return:
+        for (TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+        {
+            CWalletTransactionBase *const pwtx = (*it).second.first;
+            if (pwtx != nullptr)
+                ListTransactions(*pwtx, strAccount, 0, true, ret, filter, includeImmatureBTs);
+            CAccountingEntry *const pacentry = (*it).second.second;
+            if (pacentry != nullptr)
+                AcentryToJSON(*pacentry, strAccount, ret);
 
-        if ((int)ret.size() >= (nCount+nFrom)) break;
+            if ((int)ret.size() >= (nCount+nFrom)) break;
+        }
     }
 
     //getting all the specific Txes requested by nCount and nFrom
@@ -2911,8 +2937,8 @@ UniValue listtxesbyaddress(const UniValue& params, bool fHelp)
     UniValue ret(UniValue::VARR);
     std::list<CAccountingEntry> unused;
 
-    // tx are ordered in this vector from the oldest to the newest
-    vTxWithInputs txOrdered = pwalletMain->OrderedTxWithInputs(address);
+    // tx are ordered in this vector from the oldest to the newest, only the most recent ones we need are there
+    vTxWithInputs txOrdered = pwalletMain->OrderedTxWithInputs(address, nCount+nFrom);
 
     // iterate backwards until we have nCount items to return:
     for (vTxWithInputs::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
@@ -4119,9 +4145,13 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             "sleep\n"
             "parameterloading\n"
             "createjoinsplit\n"
+            "createjoinsplits\n"
             "solveequihash\n"
             "verifyequihash\n"
             "validatelargetx\n"
+            "merkleroot\n"
+            "checkblock\n"
+            "blocktojson\n"
             "trydecryptnotes\n"
             "incnotewitnesses\n"
             "connectblockslow\n"
@@ -4185,6 +4215,15 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
                 // we are running one JoinSplit per thread.
                 sample_times.push_back(std::accumulate(vals.begin(), vals.end(), 0.0) / (nThreads*nThreads));
             }
+        } else if (benchmarktype == "createjoinsplits") {
+            int nJoinSplits = 4;
+            if (params.size() >= 3) {
+                nJoinSplits = params[2].get_int();
+                if (nJoinSplits <= 0) {
+                    throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of joinsplits");
+                }
+            }
+            sample_times.push_back(benchmark_create_independent_joinsplits(nJoinSplits));
         } else if (benchmarktype == "verifyjoinsplit") {
             sample_times.push_back(benchmark_verify_joinsplit(samplejoinsplit));
 #ifdef ENABLE_MINING
@@ -4198,9 +4237,24 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             }
 #endif
         } else if (benchmarktype == "verifyequihash") {
-            sample_times.push_back(benchmark_verify_equihash());
+            if (params.size() < 3) {
+                sample_times.push_back(benchmark_verify_equihash());
+            } else {
+                // Running time of a batch of nHeaders headers: nHeaders/runningtime is the headers per second
+                int nHeaders = params[2].get_int();
+                if (nHeaders <= 0) {
+                    throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of headers");
+                }
+                sample_times.push_back(benchmark_verify_equihash_batch(nHeaders));
+            }
         } else if (benchmarktype == "validatelargetx") {
             sample_times.push_back(benchmark_large_tx());
+        } else if (benchmarktype == "merkleroot") {
+            sample_times.push_back(benchmark_merkle_root());
+        } else if (benchmarktype == "checkblock") {
+            sample_times.push_back(benchmark_check_block());
+        } else if (benchmarktype == "blocktojson") {
+            sample_times.push_back(benchmark_block_to_json());
         } else if (benchmarktype == "trydecryptnotes") {
             int nAddrs = params[2].get_int();
             sample_times.push_back(benchmark_try_decrypt_notes(nAddrs));
@@ -691,6 +691,10 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
 {
     {
         LOCK(cs_wallet);
+        // Notes whose witnesses are behind the current height. They are
+        // collected with a single pass over mapWallet, so that the rest of
+        // this function does not depend on the size of the wallet.
+        std::vector<CNoteData*> vNotesBehind;
         for (auto& wtxItem : mapWallet)
         {
             for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
@@ -707,13 +711,15 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                     // (never incremented or decremented) or one below pindex
                     assert((nd->witnessHeight == -1) ||
                            (nd->witnessHeight == pindex->nHeight - 1));
-                    // Copy the witness for the previous block if we have one
+                    // Copy the witness for the previous block if we have one;
+                    // the copy shares its state until the front one advances
                     if (nd->witnesses.size() > 0) {
                         nd->witnesses.push_front(nd->witnesses.front());
                     }
                     if (nd->witnesses.size() > WITNESS_CACHE_SIZE) {
                         nd->witnesses.pop_back();
                     }
+                    vNotesBehind.push_back(nd);
                 }
             }
         }
@@ -728,36 +734,30 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
             pblock = &block;
         }
 
+        // The subtrees made of the block's note commitments, computed once for
+        // all the witnesses: both those carried over from the previous block
+        // and those of notes received in this block advance from them.
+        const size_t nTreeSizeBefore = tree.size();
+        ZCWitnessFrontier frontier(tree);
+
         for (const CTransaction& tx : pblock->vtx) {
             auto hash = tx.GetHash();
-            bool txIsOurs = mapWallet.count(hash);
+            auto itWtx = mapWallet.find(hash);
+            bool txIsOurs = (itWtx != mapWallet.end());
             for (size_t i = 0; i < tx.GetVjoinsplit().size(); i++) {
                 const JSDescription& jsdesc = tx.GetVjoinsplit()[i];
                 for (uint8_t j = 0; j < jsdesc.commitments.size(); j++) {
                     const uint256& note_commitment = jsdesc.commitments[j];
                     tree.append(note_commitment);
-
-                    // Increment existing witnesses
-                    for (auto& wtxItem : mapWallet)
-                    {
-                        for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                            CNoteData* nd = &(item.second);
-                            if (nd->witnessHeight < pindex->nHeight &&
-                                    nd->witnesses.size() > 0) {
-                                // Check the validity of the cache
-                                // See earlier comment about validity.
-                                assert(nWitnessCacheSize >= nd->witnesses.size());
-                                nd->witnesses.front().append(note_commitment);
-                            }
-                        }
-                    }
+                    frontier.append(note_commitment);
 
                     // If this is our note, witness it
                     if (txIsOurs) {
                         JSOutPoint jsoutpt {hash, i, j};
-                        if (mapWallet[hash]->mapNoteData.count(jsoutpt) &&
-                                mapWallet[hash]->mapNoteData[jsoutpt].witnessHeight < pindex->nHeight) {
-                            CNoteData* nd = &(mapWallet[hash]->mapNoteData[jsoutpt]);
+                        auto itNd = itWtx->second->mapNoteData.find(jsoutpt);
+                        if (itNd != itWtx->second->mapNoteData.end() &&
+                                itNd->second.witnessHeight < pindex->nHeight) {
+                            CNoteData* nd = &(itNd->second);
                             if (nd->witnesses.size() > 0) {
                                 // We think this can happen because we write out the
                                 // witness cache state after every block increment or
@@ -786,20 +786,26 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
             }
         }
 
-        // Update witness heights
-        for (auto& wtxItem : mapWallet)
-        {
-            for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                CNoteData* nd = &(item.second);
-                if (nd->witnessHeight < pindex->nHeight) {
-                    nd->witnessHeight = pindex->nHeight;
+        // Increment witnesses with the commitments they are missing
+        if (frontier.size() > nTreeSizeBefore) {
+            for (CNoteData* nd : vNotesBehind) {
+                if (nd->witnesses.size() > 0) {
                     // Check the validity of the cache
                     // See earlier comment about validity.
                     assert(nWitnessCacheSize >= nd->witnesses.size());
+                    frontier.advance(nd->witnesses.front());
                 }
             }
         }
 
+        // Update witness heights
+        for (CNoteData* nd : vNotesBehind) {
+            nd->witnessHeight = pindex->nHeight;
+            // Check the validity of the cache
+            // See earlier comment about validity.
+            assert(nWitnessCacheSize >= nd->witnesses.size());
+        }
+
         // For performance reasons, we write out the witness cache in
         // CWallet::SetBestChain() (which also ensures that overall consistency
         // of the wallet.dat is maintained).
@@ -965,10 +971,9 @@ int64_t CWallet::IncOrderPosNext(CWalletDB *pwalletdb)
     return nRet;
 }
 
-vTxWithInputs CWallet::OrderedTxWithInputs(const std::string& address) const
+vTxWithInputs CWallet::OrderedTxWithInputs(const std::string& address, int nMostRecent) const
 {
     AssertLockHeld(cs_wallet);
-    CWalletDB walletdb(strWalletFile);
 
     vTxWithInputs vOrderedTxes;
 
@@ -980,37 +985,128 @@ vTxWithInputs CWallet::OrderedTxWithInputs(const std::string& address) const
         return vOrderedTxes;
     }
 
-    const CScript& scriptPubKey = GetScriptForDestination(taddr.Get(), false);
+    const TxAddressItems* pTxItems = GetTxesByAddress(taddr.Get());
+    if (pTxItems == nullptr)
+        return vOrderedTxes;
 
-    // tx are ordered in this map, from the oldest to the newest. As a consequence, the returned vector is ordered 
-    // as well
-    for (auto it : wtxOrdered)
+    // the index is ordered from the oldest to the newest tx; walk it backwards so that
+    // we can stop as soon as we have the requested number of txes, then restore the order
+    for (auto it = pTxItems->rbegin(); it != pTxItems->rend(); ++it)
     {
-        CWalletTransactionBase* wtx = it.second.first;
-        int64_t orderPos = it.first;
-
-        LogPrintf("%s():%d - processing ordered tx: nOrderPos[%d]: tx[%s]\n", __func__, __LINE__,
-            orderPos, wtx->getTxBase()->GetHash().ToString() );
+        CWalletTransactionBase* wtx = it->second;
 
         if (wtx->GetDepthInMainChain() < 0) {
             LogPrintf("%s():%d - skipping tx[%s]: conflicted\n", __func__, __LINE__, wtx->getTxBase()->GetHash().ToString() );
             continue;
         }
 
-        bool outputFound = wtx->HasOutputFor(scriptPubKey);
+        vOrderedTxes.push_back(wtx);
+
+        if (nMostRecent > 0 && (int)vOrderedTxes.size() >= nMostRecent)
+            break;
+    }
+
+    std::reverse(vOrderedTxes.begin(), vOrderedTxes.end());
+    return vOrderedTxes;
+}
+
+const TxAddressItems* CWallet::GetTxesByAddress(const CTxDestination& dest) const
+{
+    AssertLockHeld(cs_wallet);
+
+    auto it = mapTxesByAddress.find(dest);
+    if (it == mapTxesByAddress.end())
+        return nullptr;
+
+    return &(it->second);
+}
+
+/**
+ * Returns true if scriptPubKey pays to a transparent address, in the same way a
+ * script built by GetScriptForDestination (with or without replay protection) does.
+ */
+static bool ExtractIndexedDestination(const CScript& scriptPubKey, CTxDestination& dest)
+{
+    if (!ExtractDestination(scriptPubKey, dest))
+        return false;
+
+    const CScript& scriptForDest = GetScriptForDestination(dest, false);
+    auto res = std::search(scriptPubKey.begin(), scriptPubKey.end(), scriptForDest.begin(), scriptForDest.end());
+    return (res == scriptPubKey.begin());
+}
+
+void CWallet::AddToAddressIndex(CWalletTransactionBase& wtx)
+{
+    const CTransactionBase& txBase = *wtx.getTxBase();
+    const uint256& hash = txBase.GetHash();
+    CTxDestination dest;
+
+    for (unsigned int pos = 0; pos < txBase.GetVout().size(); ++pos)
+    {
+        if (!ExtractIndexedDestination(txBase.GetVout()[pos].scriptPubKey, dest))
+            continue;
+
+        TxAddressItems& txItems = mapTxesByAddress[dest];
+        txItems.insert(std::make_pair(wtx.nOrderPos, &wtx));
 
-        bool inputFound = false;
-        if (!outputFound && !wtx->getTxBase()->IsCoinBase())
+        // wallet txes already spending this output could not be indexed as spending
+        // from this address when they were added, do it now
+        auto range = mapTxSpends.equal_range(COutPoint(hash, pos));
+        for (auto it = range.first; it != range.second; ++it)
         {
-            inputFound = wtx->HasInputFrom(scriptPubKey);
+            auto mi = mapWallet.find(it->second);
+            if (mi != mapWallet.end() && !mi->second->getTxBase()->IsCoinBase())
+                txItems.insert(std::make_pair(mi->second->nOrderPos, mi->second.get()));
         }
+    }
+
+    if (txBase.IsCoinBase())
+        return;
+
+    for (const CTxIn& txin : txBase.GetVin())
+    {
+        auto mi = mapWallet.find(txin.prevout.hash);
+        if (mi == mapWallet.end())
+            continue;
+
+        const std::vector<CTxOut>& vout = mi->second->getTxBase()->GetVout();
+        if (txin.prevout.n >= vout.size())
+            continue;
 
-        if (outputFound || inputFound) {
-            vOrderedTxes.push_back(wtx);
+        if (ExtractIndexedDestination(vout[txin.prevout.n].scriptPubKey, dest))
+            mapTxesByAddress[dest].insert(std::make_pair(wtx.nOrderPos, &wtx));
+    }
+}
+
+void CWallet::RemoveFromAddressIndex(const CWalletTransactionBase* pwtx)
+{
+    // a tx may be indexed under the address of an input whose tx is no longer in
+    // the wallet, hence the full scan; erasing wallet txes is a rare event
+    for (auto it = mapTxesByAddress.begin(); it != mapTxesByAddress.end(); )
+    {
+        TxAddressItems& txItems = it->second;
+        for (auto itItem = txItems.begin(); itItem != txItems.end(); )
+        {
+            if (itItem->second == pwtx)
+                itItem = txItems.erase(itItem);
+            else
+                ++itItem;
         }
+
+        if (txItems.empty())
+            it = mapTxesByAddress.erase(it);
+        else
+            ++it;
     }
+}
 
-    return vOrderedTxes;
+void CWallet::RebuildAddressIndex()
+{
+    AssertLockHeld(cs_wallet);
+
+    mapTxesByAddress.clear();
+    for (auto& item : mapWallet)
+        AddToAddressIndex(*item.second);
 }
 
 void CWallet::MarkDirty()
@@ -1091,6 +1187,7 @@ bool CWallet::AddToWallet(const CWalletTransactionBase& wtxIn, bool fFromLoadWal
         wtxOrdered.insert(make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
         UpdateNullifierNoteMapWithTx(*(mapWallet[hash]));
         AddToSpends(hash);
+        AddToAddressIndex(wtx);
     }
     else
     {
@@ -1153,6 +1250,7 @@ bool CWallet::AddToWallet(const CWalletTransactionBase& wtxIn, bool fFromLoadWal
                              wtxIn.hashBlock.ToString());
             }
             AddToSpends(hash);
+            AddToAddressIndex(wtx);
         }
 
         bool fUpdated = false;
@@ -1388,8 +1486,13 @@ void CWallet::EraseFromWallet(const uint256 &hash)
         LOCK(cs_wallet);
         LogPrint("cert", "%s():%d - called for obj[%s]\n", __func__, __LINE__, hash.ToString());
 
-        if (mapWallet.erase(hash))
+        auto mi = mapWallet.find(hash);
+        if (mi != mapWallet.end())
+        {
+            RemoveFromAddressIndex(mi->second.get());
+            mapWallet.erase(mi);
             CWalletDB(strWalletFile).EraseWalletTxBase(hash);
+        }
     }
     return;
 }
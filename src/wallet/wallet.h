@@ -62,6 +62,9 @@ static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 //  Should be large enough that we can expect not to reorg beyond our cache
 //  unless there is some exceptional network disruption.
 static const unsigned int WITNESS_CACHE_SIZE = COINBASE_MATURITY;
+//! -joinsplitprovers default
+//  Each JoinSplit proof takes its own large prover memory, so only a few run at once.
+static const int DEFAULT_JOINSPLIT_PROVERS = 2;
 
 class CBlockIndex;
 class CCoinControl;
@@ -139,6 +142,9 @@ typedef std::multimap<int64_t, TxPair > TxItems;
 //typedef std::pair<CWalletTransactionBase*, std::map<uint256, CWalletTransactionBase*> > TxWithInputsPair;
 typedef std::vector<CWalletTransactionBase*> vTxWithInputs;
 
+/** Wallet txes involving an address (paying to it or spending from it), ordered by nOrderPos */
+typedef std::set<std::pair<int64_t, CWalletTransactionBase*> > TxAddressItems;
+
 static void ReadOrderPos(int64_t& nOrderPos, mapValue_t& mapValue)
 {
     if (!mapValue.count("n"))
@@ -761,6 +767,15 @@ private:
     void AddToSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Index of wallet txes by transparent address, kept in sync with mapWallet
+     * so that per-address queries do not have to scan the whole wallet.
+     */
+    std::map<CTxDestination, TxAddressItems> mapTxesByAddress;
+
+    void AddToAddressIndex(CWalletTransactionBase& wtx);
+    void RemoveFromAddressIndex(const CWalletTransactionBase* pwtx);
+
 public:
     /*
      * Size of the incremental witness cache for the notes in our wallet.
@@ -1052,7 +1067,14 @@ public:
      */
     int64_t IncOrderPosNext(CWalletDB *pwalletdb = NULL);
 
-    vTxWithInputs OrderedTxWithInputs(const std::string& address) const;
+    /**
+     * Wallet txes paying to or spending from a transparent address, ordered from the oldest
+     * to the newest. If nMostRecent is positive only the newest nMostRecent txes are returned.
+     */
+    vTxWithInputs OrderedTxWithInputs(const std::string& address, int nMostRecent = 0) const;
+    const TxAddressItems* GetTxesByAddress(const CTxDestination& dest) const;
+    /** Rebuild the index of wallet txes by address, needed whenever the nOrderPos of wallet txes change */
+    void RebuildAddressIndex();
 
     void MarkDirty();
     bool UpdateNullifierNoteMap();
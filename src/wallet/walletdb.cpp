@@ -435,6 +435,9 @@ DBErrors CWalletDB::ReorderTransactions(CWallet* pwallet)
     }
     WriteOrderPosNext(nOrderPosNext);
 
+    // the address index is keyed on nOrderPos
+    pwallet->RebuildAddressIndex();
+
     return DB_LOAD_OK;
 }
 
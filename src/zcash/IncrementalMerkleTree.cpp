@@ -314,7 +314,7 @@ MerklePath IncrementalMerkleTree<Depth, Hash>::path(std::deque<Hash> filler_hash
 
 template<size_t Depth, typename Hash>
 std::deque<Hash> IncrementalWitness<Depth, Hash>::partial_path() const {
-    std::deque<Hash> uncles(filled.begin(), filled.end());
+    std::deque<Hash> uncles(filled->begin(), filled->end());
 
     if (cursor) {
         uncles.push_back(cursor->root(cursor_depth));
@@ -323,35 +323,155 @@ std::deque<Hash> IncrementalWitness<Depth, Hash>::partial_path() const {
     return uncles;
 }
 
+// The members of a witness may be shared with its copies: this gives one that
+// can be changed, copying it first if needed.
+template<typename T>
+static T& unshared(std::shared_ptr<T>& member) {
+    if (member.use_count() > 1) {
+        member = std::make_shared<T>(*member);
+    }
+    return *member;
+}
+
 template<size_t Depth, typename Hash>
 void IncrementalWitness<Depth, Hash>::append(Hash obj) {
     if (cursor) {
-        cursor->append(obj);
+        IncrementalMerkleTree<Depth, Hash>& cursor_tree = unshared(cursor);
+        cursor_tree.append(obj);
 
-        if (cursor->is_complete(cursor_depth)) {
-            filled.push_back(cursor->root(cursor_depth));
-            cursor = boost::none;
+        if (cursor_tree.is_complete(cursor_depth)) {
+            unshared(filled).push_back(cursor_tree.root(cursor_depth));
+            cursor.reset();
         }
     } else {
-        cursor_depth = tree.next_depth(filled.size());
+        cursor_depth = tree->next_depth(filled->size());
 
         if (cursor_depth >= Depth) {
             throw std::runtime_error("tree is full");
         }
 
         if (cursor_depth == 0) {
-            filled.push_back(obj);
+            unshared(filled).push_back(obj);
         } else {
-            cursor = IncrementalMerkleTree<Depth, Hash>();
+            cursor = std::make_shared<IncrementalMerkleTree<Depth, Hash>>();
             cursor->append(obj);
         }
     }
 }
 
+template<size_t Depth, typename Hash>
+WitnessFrontier<Depth, Hash>::WitnessFrontier(const IncrementalMerkleTree<Depth, Hash>& tree) {
+    nSize = tree.size();
+    if (nSize == 0) {
+        return;
+    }
+
+    // The parents are the complete left subtrees on the path from the last
+    // leaf to the root, the leaves sit at the end of the tree. A right leaf
+    // completes subtrees the tree has not collapsed yet.
+    const uint64_t pairs = (nSize - 1) >> 1;
+    for (size_t i = 0; i < tree.parents.size(); i++) {
+        if (tree.parents[i]) {
+            nodes[i + 1][(pairs >> i) - 1] = *tree.parents[i];
+        }
+    }
+    if (tree.right) {
+        nodes[0][nSize - 2] = *tree.left;
+        complete(nSize - 1, *tree.right);
+    } else {
+        nodes[0][nSize - 1] = *tree.left;
+    }
+}
+
+template<size_t Depth, typename Hash>
+void WitnessFrontier<Depth, Hash>::append(Hash obj) {
+    if (nSize >= (uint64_t(1) << Depth)) {
+        throw std::runtime_error("tree is full");
+    }
+
+    complete(nSize++, obj);
+}
+
+template<size_t Depth, typename Hash>
+void WitnessFrontier<Depth, Hash>::complete(uint64_t index, Hash obj) {
+    nodes[0][index] = obj;
+
+    // Complete every subtree this leaf is the last one of
+    for (size_t d = 0; d < Depth && (index & 1); d++) {
+        obj = Hash::combine(node(d, index - 1), obj, d);
+        index >>= 1;
+        nodes[d + 1][index] = obj;
+    }
+}
+
+template<size_t Depth, typename Hash>
+const Hash& WitnessFrontier<Depth, Hash>::node(size_t depth, uint64_t index) const {
+    typename std::map<uint64_t, Hash>::const_iterator it = nodes[depth].find(index);
+    if (it == nodes[depth].end()) {
+        throw std::runtime_error("witness is not up to date with the start of the frontier");
+    }
+    return it->second;
+}
+
+template<size_t Depth, typename Hash>
+IncrementalMerkleTree<Depth, Hash> WitnessFrontier<Depth, Hash>::subtree(uint64_t start) const {
+    // Lay out the leaves from start as IncrementalMerkleTree::append would
+    const uint64_t count = nSize - start;
+    IncrementalMerkleTree<Depth, Hash> tree;
+    if (count & 1) {
+        tree.left = node(0, nSize - 1);
+    } else {
+        tree.left = node(0, nSize - 2);
+        tree.right = node(0, nSize - 1);
+    }
+
+    const uint64_t pairs = (count - 1) >> 1;
+    for (size_t i = 0; (pairs >> i) > 0; i++) {
+        if ((pairs >> i) & 1) {
+            tree.parents.push_back(node(i + 1, (start >> (i + 1)) + (pairs >> i) - 1));
+        } else {
+            tree.parents.push_back(boost::none);
+        }
+    }
+    return tree;
+}
+
+template<size_t Depth, typename Hash>
+void WitnessFrontier<Depth, Hash>::advance(IncrementalWitness<Depth, Hash>& witness) const {
+    const uint64_t position = witness.position();
+    if (position >= nSize) {
+        throw std::runtime_error("witness is ahead of the frontier");
+    }
+
+    // The subtrees a witness fills are the right siblings of the path of its
+    // element, from the bottom up: fill those complete by now, and rebuild the
+    // cursor over the one still being appended to, if any.
+    witness.cursor.reset();
+    for (size_t skip = witness.filled->size(); ; skip++) {
+        const size_t depth = witness.tree->next_depth(skip);
+        const uint64_t index = (position >> depth) + 1;
+        const uint64_t start = index << depth;
+        if (depth >= Depth || start >= nSize) {
+            break;
+        }
+
+        witness.cursor_depth = depth;
+        if (start + (uint64_t(1) << depth) <= nSize) {
+            unshared(witness.filled).push_back(node(depth, index));
+        } else {
+            witness.cursor = std::make_shared<IncrementalMerkleTree<Depth, Hash>>(subtree(start));
+            break;
+        }
+    }
+}
+
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
 
 template class IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
 template class IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
 
+template class WitnessFrontier<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
+template class WitnessFrontier<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
+
 } // end namespace `libzcash`
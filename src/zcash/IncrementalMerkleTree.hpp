@@ -3,6 +3,8 @@
 
 #include <array>
 #include <deque>
+#include <map>
+#include <memory>
 #include <boost/optional.hpp>
 #include <boost/static_assert.hpp>
 
@@ -82,10 +84,14 @@ bool operator==(const EmptyMerkleRoots<Depth, Hash>& a,
 template<size_t Depth, typename Hash>
 class IncrementalWitness;
 
+template<size_t Depth, typename Hash>
+class WitnessFrontier;
+
 template<size_t Depth, typename Hash>
 class IncrementalMerkleTree {
 
 friend class IncrementalWitness<Depth, Hash>;
+friend class WitnessFrontier<Depth, Hash>;
 
 public:
     BOOST_STATIC_ASSERT(Depth >= 1);
@@ -155,40 +161,69 @@ bool operator==(const IncrementalMerkleTree<Depth, Hash>& a,
 template <size_t Depth, typename Hash>
 class IncrementalWitness {
 friend class IncrementalMerkleTree<Depth, Hash>;
+friend class WitnessFrontier<Depth, Hash>;
 
 public:
     // Required for Unserialize()
-    IncrementalWitness() {}
+    IncrementalWitness() :
+        tree(std::make_shared<IncrementalMerkleTree<Depth, Hash>>()),
+        filled(std::make_shared<std::vector<Hash>>()) {}
 
     MerklePath path() const {
-        return tree.path(partial_path());
+        return tree->path(partial_path());
     }
 
     // Return the element being witnessed (should be a note
     // commitment!)
     Hash element() const {
-        return tree.last();
+        return tree->last();
     }
 
     uint64_t position() const {
-        return tree.size() - 1;
+        return tree->size() - 1;
     }
 
     Hash root() const {
-        return tree.root(Depth, partial_path());
+        return tree->root(Depth, partial_path());
     }
 
     void append(Hash obj);
 
-    ADD_SERIALIZE_METHODS;
+    // Serialized as if tree, filled and cursor were plain members
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        CSizeComputer s(nType, nVersion);
+        Serialize(s, nType, nVersion);
+        return s.size();
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
-        READWRITE(tree);
-        READWRITE(filled);
-        READWRITE(cursor);
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        ::Serialize(s, *tree, nType, nVersion);
+        ::Serialize(s, *filled, nType, nVersion);
+        // Same encoding as boost::optional
+        unsigned char discriminant = cursor ? 0x01 : 0x00;
+        ::Serialize(s, discriminant, nType, nVersion);
+        if (cursor) {
+            ::Serialize(s, *cursor, nType, nVersion);
+        }
+    }
 
-        cursor_depth = tree.next_depth(filled.size());
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        IncrementalMerkleTree<Depth, Hash> treeIn;
+        std::vector<Hash> filledIn;
+        boost::optional<IncrementalMerkleTree<Depth, Hash>> cursorIn;
+        ::Unserialize(s, treeIn, nType, nVersion);
+        ::Unserialize(s, filledIn, nType, nVersion);
+        ::Unserialize(s, cursorIn, nType, nVersion);
+
+        tree = std::make_shared<IncrementalMerkleTree<Depth, Hash>>(treeIn);
+        filled = std::make_shared<std::vector<Hash>>(filledIn);
+        cursor.reset();
+        if (cursorIn) {
+            cursor = std::make_shared<IncrementalMerkleTree<Depth, Hash>>(*cursorIn);
+        }
+        cursor_depth = tree->next_depth(filled->size());
     }
 
     template <size_t D, typename H>
@@ -196,23 +231,65 @@ public:
                            const IncrementalWitness<D, H>& b);
 
 private:
-    IncrementalMerkleTree<Depth, Hash> tree;
-    std::vector<Hash> filled;
-    boost::optional<IncrementalMerkleTree<Depth, Hash>> cursor;
+    // Copies of a witness, like the levels of the wallet's witness cache,
+    // share these members until one of them appends: the tree never changes
+    // once witnessed, filled and cursor are copied before being changed.
+    std::shared_ptr<IncrementalMerkleTree<Depth, Hash>> tree;
+    std::shared_ptr<std::vector<Hash>> filled;
+    // Null when there is no cursor
+    std::shared_ptr<IncrementalMerkleTree<Depth, Hash>> cursor;
     size_t cursor_depth = 0;
     std::deque<Hash> partial_path() const;
-    IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) : tree(tree) {}
+    IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) :
+        tree(std::make_shared<IncrementalMerkleTree<Depth, Hash>>(tree)),
+        filled(std::make_shared<std::vector<Hash>>()) {}
 };
 
 template<size_t Depth, typename Hash>
 bool operator==(const IncrementalWitness<Depth, Hash>& a,
                 const IncrementalWitness<Depth, Hash>& b) {
-    return (a.tree == b.tree &&
-            a.filled == b.filled &&
-            a.cursor == b.cursor &&
+    return (*a.tree == *b.tree &&
+            *a.filled == *b.filled &&
+            (a.cursor ? (b.cursor && *a.cursor == *b.cursor) : !b.cursor) &&
             a.cursor_depth == b.cursor_depth);
 }
 
+/**
+ * What the witnesses of a tree need to catch up with a run of leaves appended
+ * to it: the frontier of the tree before the run, and every complete subtree
+ * holding some of the new leaves. These are computed once while the leaves are
+ * appended, then each witness takes from them the subtrees it is missing, with
+ * O(Depth) work rather than one append per leaf.
+ */
+template<size_t Depth, typename Hash>
+class WitnessFrontier {
+public:
+    // tree is the tree before the run of leaves
+    explicit WitnessFrontier(const IncrementalMerkleTree<Depth, Hash>& tree);
+
+    size_t size() const {
+        return nSize;
+    }
+
+    void append(Hash obj);
+
+    // Bring up to date a witness of the tree given at construction, or one
+    // taken after appending one of the leaves of the run. Throws if the
+    // witness is in neither state.
+    void advance(IncrementalWitness<Depth, Hash>& witness) const;
+
+private:
+    uint64_t nSize;
+    // Complete subtrees at each depth, by index from the left
+    std::array<std::map<uint64_t, Hash>, Depth + 1> nodes;
+
+    // Add a leaf and the subtrees it completes
+    void complete(uint64_t index, Hash obj);
+    const Hash& node(size_t depth, uint64_t index) const;
+    // The tree made of the leaves from start, aligned on a subtree, to the end
+    IncrementalMerkleTree<Depth, Hash> subtree(uint64_t start) const;
+};
+
 class SHA256Compress : public uint256 {
 public:
     SHA256Compress() : uint256() {}
@@ -253,4 +330,8 @@ typedef libzcash::IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, l
 
 typedef libzcash::IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::SHA256Compress> ZCIncrementalWitness;
 typedef libzcash::IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::SHA256Compress> ZCTestingIncrementalWitness;
+
+typedef libzcash::WitnessFrontier<INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::SHA256Compress> ZCWitnessFrontier;
+typedef libzcash::WitnessFrontier<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::SHA256Compress> ZCTestingWitnessFrontier;
+
 #endif /* ZC_INCREMENTALMERKLETREE_H_ */
@@ -24,6 +24,7 @@
 #include "txdb.h"
 #include "utiltest.h"
 #include "wallet/wallet.h"
+#include "wallet/asyncrpcoperation_sendmany.h"
 
 #include "zcbenchmarks.h"
 
@@ -151,6 +152,34 @@ std::vector<double> benchmark_create_joinsplit_threaded(int nThreads)
     return ret;
 }
 
+double benchmark_create_independent_joinsplits(size_t nJoinSplits)
+{
+    uint256 pubKeyHash;
+    uint256 anchor = ZCIncrementalMerkleTree().root();
+
+    // Same scheduling as z_sendmany uses for JoinSplits without input notes
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::vector<JSDescription> vjsdesc = ProveInWaves<JSDescription>(nJoinSplits, GetJoinSplitProvers(),
+        [&pubKeyHash, &anchor](size_t) {
+            return JSDescription(true,
+                                 *pzcashParams,
+                                 pubKeyHash,
+                                 anchor,
+                                 {JSInput(), JSInput()},
+                                 {JSOutput(), JSOutput()},
+                                 0,
+                                 0);
+        });
+    double ret = timer_stop(tv_start);
+
+    auto verifier = libzcash::ProofVerifier::Strict();
+    for (const JSDescription& jsdesc : vjsdesc) {
+        assert(jsdesc.Verify(*pzcashParams, verifier, pubKeyHash));
+    }
+    return ret;
+}
+
 double benchmark_verify_joinsplit(const JSDescription &joinsplit)
 {
     struct timeval tv_start;
@@ -222,6 +251,19 @@ double benchmark_verify_equihash()
     return timer_stop(tv_start);
 }
 
+double benchmark_verify_equihash_batch(size_t nHeaders)
+{
+    CChainParams params = Params(CBaseChainParams::MAIN);
+    std::vector<CBlockHeader> headers(nHeaders, params.GenesisBlock().GetBlockHeader());
+    std::vector<bool> vValid;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    bool fAllValid = CheckEquihashSolutions(headers, params, vValid);
+    double ret = timer_stop(tv_start);
+    assert(fAllValid);
+    return ret;
+}
+
 double benchmark_large_tx()
 {
     // Number of inputs in the spending transaction that we will simulate
@@ -282,6 +324,78 @@ double benchmark_large_tx()
     return timer_stop(tv_start);
 }
 
+// A block whose transactions fill nTxBytes, by default the whole tx partition, as simple one input, one output spends
+static CBlock CreateLargeBlock(size_t nTxBytes = BLOCK_TX_PARTITION_SIZE)
+{
+    CBlock block;
+    block.nVersion = BLOCK_VERSION_SC_SUPPORT;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << OP_1 << OP_1;
+    coinbase.addOut(CTxOut(1, CScript() << OP_TRUE));
+    block.vtx.push_back(CTransaction(coinbase));
+
+    size_t totTxSize = block.vtx[0].GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+    for (uint32_t n = 0; ; n++) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(Hash(BEGIN(n), END(n)), 0);
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+        mtx.addOut(CTxOut(1, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUALVERIFY << OP_CHECKSIG));
+        CTransaction tx(mtx);
+        totTxSize += tx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+        if (totTxSize > nTxBytes)
+            break;
+        block.vtx.push_back(tx);
+    }
+
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+
+double benchmark_merkle_root()
+{
+    CBlock block = CreateLargeBlock();
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    block.BuildMerkleTree();
+    return timer_stop(tv_start);
+}
+
+double benchmark_check_block()
+{
+    CBlock block = CreateLargeBlock();
+    auto verifier = libzcash::ProofVerifier::Disabled();
+    CValidationState state;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    assert(CheckBlock(block, state, verifier, flagCheckPow::OFF));
+    return timer_stop(tv_start);
+}
+
+extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+
+double benchmark_block_to_json()
+{
+    // getblock at verbosity 2 on a full size block
+    CBlock block = CreateLargeBlock(MAX_BLOCK_SIZE);
+    CBlockIndex index {block};
+    index.nHeight = 1;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    UniValue obj = blockToJSON(block, &index, true);
+    std::string strJSON = obj.write();
+    double ret = timer_stop(tv_start);
+
+    assert(obj["tx"].size() == block.vtx.size());
+    assert(!strJSON.empty());
+    return ret;
+}
+
 double benchmark_try_decrypt_notes(size_t nAddrs)
 {
     CWallet wallet;
@@ -8,11 +8,16 @@ extern double benchmark_sleep();
 extern double benchmark_parameter_loading();
 extern double benchmark_create_joinsplit();
 extern std::vector<double> benchmark_create_joinsplit_threaded(int nThreads);
+extern double benchmark_create_independent_joinsplits(size_t nJoinSplits);
 extern double benchmark_solve_equihash();
 extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
 extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
 extern double benchmark_verify_equihash();
+extern double benchmark_verify_equihash_batch(size_t nHeaders);
 extern double benchmark_large_tx();
+extern double benchmark_merkle_root();
+extern double benchmark_check_block();
+extern double benchmark_block_to_json();
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
 extern double benchmark_connectblock_slow();
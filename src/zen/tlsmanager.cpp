@@ -16,6 +16,23 @@ using namespace std;
 namespace zen
 {
 
+std::atomic<uint64_t> TLSManager::nFullHandshakes(0);
+std::atomic<uint64_t> TLSManager::nResumedHandshakes(0);
+std::map<std::string, SSL_SESSION*> TLSManager::mapClientSessions;
+CCriticalSection TLSManager::cs_mapClientSessions;
+
+static void freePeerKey(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx, long argl, void* argp)
+{
+    delete static_cast<std::string*>(ptr);
+}
+
+/** Index of the ex_data of outgoing SSL connections holding the peer address, which keys their sessions */
+static int peerKeyIndex()
+{
+    static const int nIndex = SSL_get_ex_new_index(0, NULL, NULL, NULL, freePeerKey);
+    return nIndex;
+}
+
 // this is the 'dh crypto environment' to be shared between two peers and it is meant to be public, therefore
 // it is OK to hard code it (or as an alternative to read it from a file)
 // ----
@@ -343,8 +360,17 @@ SSL* TLSManager::connect(SOCKET hSocket, const CAddress& addrConnect, unsigned l
     err_code = 0;
     SSL* ssl = NULL;
     bool bConnectedTLS = false;
+    const std::string strPeer = addrConnect.ToStringIPPort();
 
     if ((ssl = SSL_new(tls_ctx_client))) {
+        // offer the session this peer gave us last time, if any, to skip the full handshake
+        SSL_set_ex_data(ssl, peerKeyIndex(), new std::string(strPeer));
+        {
+            LOCK(cs_mapClientSessions);
+            std::map<std::string, SSL_SESSION*>::const_iterator it = mapClientSessions.find(strPeer);
+            if (it != mapClientSessions.end())
+                SSL_set_session(ssl, it->second);
+        }
         if (SSL_set_fd(ssl, hSocket)) {
             int ret = TLSManager::waitFor(SSL_CONNECT, hSocket, ssl, (DEFAULT_CONNECT_TIMEOUT / 1000), err_code);
             if (ret == 1)
@@ -363,12 +389,18 @@ SSL* TLSManager::connect(SOCKET hSocket, const CAddress& addrConnect, unsigned l
 
 
     if (bConnectedTLS) {
-        LogPrintf("TLS: connection to %s has been established (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s\n",
-            addrConnect.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl));
+        const bool fResumed = SSL_session_reused(ssl);
+        (fResumed ? nResumedHandshakes : nFullHandshakes)++;
+        LogPrintf("TLS: connection to %s has been established (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s%s\n",
+            addrConnect.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl),
+            fResumed ? " (session resumed)" : "");
     } else {
         LogPrintf("TLS: %s: %s():%d - TLS connection to %s failed (err_code 0x%X)\n",
             __FILE__, __func__, __LINE__, addrConnect.ToString(), err_code);
 
+        // don't offer again a session which may be the cause of the failure
+        forgetClientSession(strPeer);
+
         if (ssl) {
             SSL_free(ssl);
             ssl = NULL;
@@ -434,7 +466,19 @@ SSL_CTX* TLSManager::initCtx(
 
             LogPrintf("TLS: %s: %s():%d - setting dh callback\n", __FILE__, __func__, __LINE__);
             SSL_CTX_set_tmp_dh_callback(tlsCtx, tmp_dh_callback);
+
+            // let reconnecting peers resume their session, either from our cache or from a ticket; as peer
+            // certificates are requested, resumption is refused without a session id context
+            SSL_CTX_set_session_id_context(tlsCtx, (const unsigned char*)"zen", 3);
+            SSL_CTX_set_session_cache_mode(tlsCtx, SSL_SESS_CACHE_SERVER);
+        }
+        else
+        {
+            // OpenSSL doesn't look client sessions up by server: we keep them by peer address ourselves
+            SSL_CTX_set_session_cache_mode(tlsCtx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(tlsCtx, TLSManager::newClientSession);
         }
+        SSL_CTX_set_timeout(tlsCtx, SESSION_TIMEOUT);
 
         // Fix for Secure Client-Initiated Renegotiation DoS threat
         SSL_CTX_set_options(tlsCtx, SSL_OP_NO_RENEGOTIATION);
@@ -553,8 +597,11 @@ SSL* TLSManager::accept(SOCKET hSocket, const CAddress& addr, unsigned long& err
     }
 
     if (bAcceptedTLS) {
-        LogPrintf("TLS: connection from %s has been accepted (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s\n",
-            addr.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl));
+        const bool fResumed = SSL_session_reused(ssl);
+        (fResumed ? nResumedHandshakes : nFullHandshakes)++;
+        LogPrintf("TLS: connection from %s has been accepted (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s%s\n",
+            addr.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl),
+            fResumed ? " (session resumed)" : "");
 
         STACK_OF(SSL_CIPHER) *sk = SSL_get_ciphers(ssl); 
         for (int i = 0; i < sk_SSL_CIPHER_num(sk); i++) {
@@ -573,6 +620,54 @@ SSL* TLSManager::accept(SOCKET hSocket, const CAddress& addr, unsigned long& err
 
     return ssl;
 }
+/**
+ * @brief Keep a session a server issued us, to resume it when connecting to it again. Called by OpenSSL
+ * during the handshake or, with TLS 1.3, when a ticket arrives after it.
+ * 
+ * @param ssl the connection to the server.
+ * @param session the new session.
+ * @return int returns 1 if the session is kept (its reference is then owned by the cache), 0 otherwise.
+ */
+int TLSManager::newClientSession(SSL* ssl, SSL_SESSION* session)
+{
+    const std::string* pPeer = static_cast<const std::string*>(SSL_get_ex_data(ssl, peerKeyIndex()));
+    if (pPeer == NULL || !SSL_SESSION_is_resumable(session))
+        return 0;
+
+    LOCK(cs_mapClientSessions);
+    std::map<std::string, SSL_SESSION*>::iterator it = mapClientSessions.find(*pPeer);
+    if (it == mapClientSessions.end()) {
+        if (mapClientSessions.size() >= MAX_CLIENT_SESSIONS) {
+            // make room by dropping the oldest session
+            std::map<std::string, SSL_SESSION*>::iterator itOldest = mapClientSessions.begin();
+            for (it = mapClientSessions.begin(); it != mapClientSessions.end(); ++it) {
+                if (SSL_SESSION_get_time(it->second) < SSL_SESSION_get_time(itOldest->second))
+                    itOldest = it;
+            }
+            SSL_SESSION_free(itOldest->second);
+            mapClientSessions.erase(itOldest);
+        }
+        it = mapClientSessions.insert(std::make_pair(*pPeer, (SSL_SESSION*)NULL)).first;
+    } else {
+        SSL_SESSION_free(it->second);
+    }
+    it->second = session;
+    return 1;
+}
+/**
+ * @brief Drop the session kept for a peer, if any.
+ * 
+ * @param strPeer the peer address.
+ */
+void TLSManager::forgetClientSession(const std::string& strPeer)
+{
+    LOCK(cs_mapClientSessions);
+    std::map<std::string, SSL_SESSION*>::iterator it = mapClientSessions.find(strPeer);
+    if (it != mapClientSessions.end()) {
+        SSL_SESSION_free(it->second);
+        mapClientSessions.erase(it);
+    }
+}
 /**
  * @brief Determines whether a string exists in the non-TLS address pool.
  * 
@@ -653,6 +748,13 @@ int TLSManager::threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fds
                 bool bIsSSL = false;
                 int nBytes = 0, nRet = 0;
 
+                // once the header of a message is complete, its data is read in place rather than
+                // through pchBuf, which is left for headers and small messages
+                unsigned int nDirect = 0;
+                char* pchDirect = pnode->GetRecvMsgDataBuffer(sizeof(pchBuf), nDirect);
+                char* pchRead = pchDirect ? pchDirect : pchBuf;
+                const int nReadSize = pchDirect ? nDirect : sizeof(pchBuf);
+
                 {
                     LOCK(pnode->cs_hSocket);
 
@@ -665,17 +767,23 @@ int TLSManager::threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fds
 
                     if (bIsSSL) {
                         ERR_clear_error(); // clear the error queue, otherwise we may be reading an old error that occurred previously in the current thread
-                        nBytes = SSL_read(pnode->ssl, pchBuf, sizeof(pchBuf));
+                        nBytes = SSL_read(pnode->ssl, pchRead, nReadSize);
                         nRet = SSL_get_error(pnode->ssl, nBytes);
                     } else {
-                        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+                        nBytes = recv(pnode->hSocket, pchRead, nReadSize, MSG_DONTWAIT);
                         nRet = WSAGetLastError();
                     }
                 }
 
                 if (nBytes > 0) {
-                    if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
-                        pnode->CloseSocketDisconnect();
+                    if (pchDirect) {
+                        pnode->RecvMsgDataWritten(nBytes);
+                        pnode->nRecvBytesDirect += nBytes;
+                    } else {
+                        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
+                            pnode->CloseSocketDisconnect();
+                        pnode->nRecvBytesCopied += nBytes;
+                    }
                     pnode->nLastRecv = GetTime();
                     pnode->nRecvBytes += nBytes;
                     pnode->RecordBytesRecv(nBytes);
@@ -10,6 +10,8 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/foreach.hpp>
 #include <boost/signals2/signal.hpp>
+#include <atomic>
+#include <map>
 #ifdef WIN32
 #include <string.h>
 #else
@@ -43,6 +45,15 @@ public:
         function code and reason code. */
      static const long SELECT_TIMEDOUT = 0xFFFFFFFF;
 
+     /* Lifetime in seconds of the sessions we issue, so that peers reconnecting can resume them */
+     static const long SESSION_TIMEOUT = 3600;
+     /* Maximum number of client sessions kept for resumption, one per peer address */
+     static const size_t MAX_CLIENT_SESSIONS = 1000;
+
+     /* Handshakes completed since startup, inbound and outbound, by kind */
+     static std::atomic<uint64_t> nFullHandshakes;
+     static std::atomic<uint64_t> nResumedHandshakes;
+
      int waitFor(SSLConnectionRoutine eRoutine, SOCKET hSocket, SSL* ssl, int timeoutSec, unsigned long& err_code);
 
      SSL* connect(SOCKET hSocket, const CAddress& addrConnect, unsigned long& err_code);
@@ -58,5 +69,13 @@ public:
      void cleanNonTLSPool(std::vector<NODE_ADDR>& vPool, CCriticalSection& cs);
      int threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fdsetSend, fd_set& fdsetError);
      bool initialize();
+
+     static int newClientSession(SSL* ssl, SSL_SESSION* session);
+     static void forgetClientSession(const std::string& strPeer);
+
+private:
+     /* Sessions the servers we connected to have issued us, by peer address */
+     static std::map<std::string, SSL_SESSION*> mapClientSessions;
+     static CCriticalSection cs_mapClientSessions;
 };
 }
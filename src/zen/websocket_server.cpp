@@ -45,6 +45,7 @@ static int getheader(const CBlockIndex *pindex, std::string& blockHexStr);
 static void ws_updatetip(const CBlockIndex *pindex);
 
 static boost::shared_ptr<WsNotificationInterface> wsNotificationInterface;
+static boost::shared_ptr<CAsyncValidationInterface> wsAsyncNotificationInterface;
 static std::list< boost::shared_ptr<WsHandler> > listWsHandler;
 
 std::atomic<bool> exit_ws_thread{false};
@@ -222,23 +223,23 @@ private:
         write(wse);
     }
 
-    void sendBlockHeaders(const UniValue& headers, WsEvent::WsMsgType msgType, std::string clientRequestId = "")
+    void sendBlockHeaders(UniValue headers, WsEvent::WsMsgType msgType, std::string clientRequestId = "")
     {
         // Send a message to the client:  type = eventType
         WsEvent* wse = new WsEvent(msgType);
         LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
         UniValue rspPayload(UniValue::VOBJ);
         
-        rspPayload.pushKV("headers", headers);
+        rspPayload.pushKVEnd("headers", std::move(headers));
 
         UniValue* rv = wse->getPayload();
         if (!clientRequestId.empty())
             rv->pushKV("requestId", clientRequestId);
-        rv->pushKV("responsePayload", rspPayload);
+        rv->pushKV("responsePayload", std::move(rspPayload));
         write(wse);
     }
     
-    void sendTopQualityCertificates(const UniValue& mempoolCert, const UniValue& chainCert,
+    void sendTopQualityCertificates(UniValue mempoolCert, UniValue chainCert,
                                     WsEvent::WsMsgType msgType, std::string clientRequestId = "")
     {
         // Send a message to the client:  type = eventType
@@ -246,13 +247,13 @@ private:
         LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
         UniValue rspPayload(UniValue::VOBJ);
         
-        rspPayload.push_back(Pair("mempoolTopQualityCert", mempoolCert));
-        rspPayload.push_back(Pair("chainTopQualityCert", chainCert));
+        rspPayload.pushKVEnd("mempoolTopQualityCert", std::move(mempoolCert));
+        rspPayload.pushKVEnd("chainTopQualityCert", std::move(chainCert));
 
         UniValue* rv = wse->getPayload();
         if (!clientRequestId.empty())
-            rv->push_back(Pair("requestId", clientRequestId));
-        rv->push_back(Pair("responsePayload", rspPayload));
+            rv->pushKV("requestId", clientRequestId);
+        rv->pushKV("responsePayload", std::move(rspPayload));
         write(wse);
     }
 
@@ -511,7 +512,7 @@ private:
             headers.push_back(header);
         }
 
-        sendBlockHeaders(headers, WsEvent::MSG_RESPONSE, clientRequestId);
+        sendBlockHeaders(std::move(headers), WsEvent::MSG_RESPONSE, clientRequestId);
 
         return OK;
     }
@@ -561,7 +562,7 @@ private:
             }
         }
 
-        sendTopQualityCertificates(mempoolTopQualityCert, chainTopQualityCert, WsEvent::MSG_RESPONSE, clientRequestId);
+        sendTopQualityCertificates(std::move(mempoolTopQualityCert), std::move(chainTopQualityCert), WsEvent::MSG_RESPONSE, clientRequestId);
 
         return OK;
     }
@@ -1211,14 +1212,15 @@ static int getheader(const CBlockIndex *pindex, std::string& strHex)
 
 static void ws_updatetip(const CBlockIndex *pindex)
 {
-    std::string strHex;
-    int ret = getblock(pindex, strHex);
-    if (ret != WsHandler::OK)
+    // the new tip is shared with the other block notifiers, no need to read it again from disk
+    std::shared_ptr<const CDataStream> ss = GetSerializedBlock(pindex);
+    if (!ss)
     {
         // should not happen
         LogPrint("ws", "%s():%d - ERROR: can not update tip\n", __func__, __LINE__);
         return;
     }
+    std::string strHex = HexStr(ss->begin(), ss->end());
     {
         std::unique_lock<std::mutex> lck(wsmtx);
         if (listWsHandler.size() )
@@ -1323,7 +1325,11 @@ bool StartWsServer()
         wsNotificationInterface.reset(new WsNotificationInterface());
         LogPrint("ws", "%s():%d - starting server at %s:%d, allocated notif if %p\n",
             __func__, __LINE__, strAddress, port, wsNotificationInterface.get());
-        RegisterValidationInterface(wsNotificationInterface.get());
+        wsAsyncNotificationInterface.reset(CAsyncValidationInterface::CreateWithArguments("ws", wsNotificationInterface.get()));
+        if (wsAsyncNotificationInterface.get() != NULL)
+            RegisterValidationInterface(wsAsyncNotificationInterface.get());
+        else
+            RegisterValidationInterface(wsNotificationInterface.get());
     }
     catch (const std::exception& e)
     {
@@ -1345,6 +1351,11 @@ bool StopWsServer()
             acceptor->close();
             acceptor = NULL;
         }
+        if (wsAsyncNotificationInterface.get() != NULL)
+        {
+            UnregisterValidationInterface(wsAsyncNotificationInterface.get());
+            wsAsyncNotificationInterface.reset();
+        }
         if (wsNotificationInterface.get() != NULL)
         {
             UnregisterValidationInterface(wsNotificationInterface.get());
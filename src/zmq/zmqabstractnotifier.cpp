@@ -20,3 +20,13 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyCertificate(const CScCertificate &/*certificate*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyCertStatusUpdate(const CScCertificateStatusUpdateInfo &/*certStatusInfo*/)
+{
+    return true;
+}
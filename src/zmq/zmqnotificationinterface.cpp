@@ -29,7 +29,8 @@ CZMQNotificationInterface::~CZMQNotificationInterface()
     }
 }
 
-CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const std::map<std::string, std::string> &args)
+CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const std::map<std::string, std::string> &args,
+                                                                          const std::map<std::string, std::vector<std::string> > &multiArgs)
 {
     CZMQNotificationInterface* notificationInterface = NULL;
     std::map<std::string, CZMQNotifierFactory> factories;
@@ -39,6 +40,9 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubhashcert"] = CZMQAbstractNotifier::Create<CZMQPublishHashCertificateNotifier>;
+    factories["pubrawcert"] = CZMQAbstractNotifier::Create<CZMQPublishRawCertificateNotifier>;
+    factories["pubscevent"] = CZMQAbstractNotifier::Create<CZMQPublishSidechainEventNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -50,6 +54,17 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
             CZMQAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+
+            // the sidechain ids were checked at startup
+            std::set<uint256> scIdFilter;
+            std::map<std::string, std::vector<std::string> >::const_iterator k = multiArgs.find("-zmq" + i->first + "scid");
+            if (k!=multiArgs.end())
+            {
+                for (const std::string& strScId : k->second)
+                    scIdFilter.insert(uint256S(strScId));
+            }
+
+            notifier->SetScIdFilter(scIdFilter);
             notifiers.push_back(notifier);
         }
     }
@@ -157,3 +172,37 @@ void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+void CZMQNotificationInterface::SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth)
+{
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyCertificate(cert))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
+
+void CZMQNotificationInterface::SyncCertStatusInfo(const CScCertificateStatusUpdateInfo &certStatusInfo)
+{
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyCertStatusUpdate(certStatusInfo))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
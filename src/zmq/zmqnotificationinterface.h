@@ -8,6 +8,7 @@
 #include "validationinterface.h"
 #include <string>
 #include <map>
+#include <vector>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
@@ -17,7 +18,8 @@ class CZMQNotificationInterface : public CValidationInterface
 public:
     virtual ~CZMQNotificationInterface();
 
-    static CZMQNotificationInterface* CreateWithArguments(const std::map<std::string, std::string> &args);
+    static CZMQNotificationInterface* CreateWithArguments(const std::map<std::string, std::string> &args,
+                                                          const std::map<std::string, std::vector<std::string> > &multiArgs);
 
 protected:
     bool Initialize();
@@ -26,6 +28,8 @@ protected:
     // CValidationInterface
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth);
+    void SyncCertStatusInfo(const CScCertificateStatusUpdateInfo &certStatusInfo);
 
 private:
     CZMQNotificationInterface();
@@ -4,6 +4,7 @@
 
 #include "zmqpublishnotifier.h"
 #include "main.h"
+#include "primitives/certificate.h"
 #include "util.h"
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
@@ -12,6 +13,9 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_HASHCERT  = "hashcert";
+static const char *MSG_RAWCERT   = "rawcert";
+static const char *MSG_SCEVENT   = "scevent";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -163,20 +167,14 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    std::shared_ptr<const CDataStream> ss = GetSerializedBlock(pindex);
+    if (!ss)
     {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
+        zmqError("Can't read block from disk");
+        return false;
     }
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, &(*ss->begin()), ss->size());
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -187,3 +185,41 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishHashCertificateNotifier::NotifyCertificate(const CScCertificate &certificate)
+{
+    if (!IsScIdNotified(certificate.GetScId()))
+        return true;
+
+    uint256 hash = certificate.GetHash();
+    LogPrint("zmq", "zmq: Publish hashcert %s\n", hash.GetHex());
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHCERT, data, 32);
+}
+
+bool CZMQPublishRawCertificateNotifier::NotifyCertificate(const CScCertificate &certificate)
+{
+    if (!IsScIdNotified(certificate.GetScId()))
+        return true;
+
+    uint256 hash = certificate.GetHash();
+    LogPrint("zmq", "zmq: Publish rawcert %s\n", hash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << certificate;
+    return SendMessage(MSG_RAWCERT, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishSidechainEventNotifier::NotifyCertStatusUpdate(const CScCertificateStatusUpdateInfo &certStatusInfo)
+{
+    if (!IsScIdNotified(certStatusInfo.scId))
+        return true;
+
+    LogPrint("zmq", "zmq: Publish scevent %s\n", certStatusInfo.ToString());
+    // scId is not part of the serialized status info, send it first
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << certStatusInfo.scId;
+    ss << certStatusInfo;
+    return SendMessage(MSG_SCEVENT, &(*ss.begin()), ss.size());
+}
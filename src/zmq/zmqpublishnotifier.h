@@ -52,4 +52,22 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+class CZMQPublishHashCertificateNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyCertificate(const CScCertificate &certificate);
+};
+
+class CZMQPublishRawCertificateNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyCertificate(const CScCertificate &certificate);
+};
+
+class CZMQPublishSidechainEventNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyCertStatusUpdate(const CScCertificateStatusUpdateInfo &certStatusInfo);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H